@@ -0,0 +1,64 @@
+#include "../src/logger/buffer_manager.hpp"
+#include "bench_report.hpp"
+#include <atomic>
+#include <chrono>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Messages/sec through BufferManager with N producers and one flusher that
+// only swaps and clears, so the numbers isolate the buffer itself.
+namespace {
+
+constexpr std::string_view kMessage = "2025-01-01 00:00:00.000 [INFO] benchmark message with a typical payload\n";
+
+double run(int producers, int per_producer) {
+    BufferManager buffer;
+    std::atomic<int> finished{0};
+
+    std::thread flusher([&] {
+        while (finished.load(std::memory_order_acquire) != producers) {
+            if (buffer.get_pending_size() < buffer.capacity() / 2) {
+                std::this_thread::yield();
+                continue;
+            }
+            (void)buffer.get_data();
+            buffer.clear();
+        }
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < per_producer; ++i) {
+                while (!buffer.add_log(kMessage)) {
+                    std::this_thread::yield();
+                }
+            }
+            finished.fetch_add(1, std::memory_order_release);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    flusher.join();
+
+    return static_cast<double>(producers) * per_producer / elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchReport report("buffer_manager", argc, argv);
+    const int total = static_cast<int>(report.arg(0, 4000000));
+
+    for (const int producers : {1, 4, 16}) {
+        report.add("producers_" + std::to_string(producers))
+            .param("messages", total)
+            .param("producers", producers)
+            .metric("msg_per_s", run(producers, total / producers));
+    }
+    return report.finish();
+}
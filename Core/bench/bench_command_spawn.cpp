@@ -0,0 +1,90 @@
+#include "../src/filewatcher/watcher_core.hpp"
+#include "bench_report.hpp"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Commands/sec WatcherCore sustains: a rule runs /bin/true for every file
+// created in a directory while another thread creates files as fast as the
+// runner keeps up. Progress and the event-to-command latency come from the
+// core's own stats socket, as an operator would read them.
+namespace {
+
+// Below CommandRunner::kDefaultMaxQueued, so nothing is dropped for pacing.
+constexpr std::uint64_t kMaxInFlight = 128;
+
+void run(BenchReport& report, const std::string& dir, int concurrency, std::uint64_t total) {
+    const std::string socket = "bench_command_spawn_" + std::to_string(getpid()) + "_" + std::to_string(concurrency);
+    WatcherCore core;
+    core.set_max_concurrency(concurrency);
+    if (!core.add_watch(dir, "/bin/true", IN_CREATE) || !core.set_stats_socket(socket)) {
+        std::printf("%-24s  unavailable\n", "spawn");
+        return;
+    }
+
+    std::string stats;
+    std::uint64_t spawned = 0, dropped = 0, failed = 0;
+    auto poll_stats = [&] {
+        if (StatsEndpoint::query(socket, stats)) {
+            spawned = prometheus_value(stats, "aurora_filewatcher_commands_spawned_total");
+            dropped = prometheus_value(stats, "aurora_filewatcher_commands_dropped_total");
+            failed = prometheus_value(stats, "aurora_filewatcher_commands_failed_total");
+        }
+        return spawned + dropped + failed;
+    };
+
+    std::chrono::duration<double> elapsed{};
+    std::thread generator([&] {
+        const auto start = std::chrono::steady_clock::now();
+        for (std::uint64_t i = 0; i < total; ++i) {
+            while (i >= kMaxInFlight && i - poll_stats() > kMaxInFlight) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            const std::string path = dir + "/spawn_" + std::to_string(concurrency) + "_" + std::to_string(i);
+            close(open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644));
+        }
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+        while (poll_stats() < total && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        core.stop();
+    });
+    core.start();
+    generator.join();
+
+    const char* histogram = "aurora_filewatcher_event_to_command_seconds";
+    report.add("concurrency_" + std::to_string(concurrency))
+        .param("commands", static_cast<double>(total))
+        .param("max_concurrency", concurrency)
+        .metric("commands_per_s", static_cast<double>(spawned) / elapsed.count())
+        .metric("dropped", static_cast<double>(dropped))
+        .metric("failed", static_cast<double>(failed))
+        .metric("p50_us", prometheus_quantile(stats, histogram, "0.5"))
+        .metric("p90_us", prometheus_quantile(stats, histogram, "0.9"))
+        .metric("p99_us", prometheus_quantile(stats, histogram, "0.99"));
+
+    for (std::uint64_t i = 0; i < total; ++i) {
+        unlink((dir + "/spawn_" + std::to_string(concurrency) + "_" + std::to_string(i)).c_str());
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchReport report("command_spawn", argc, argv);
+    const auto total = static_cast<std::uint64_t>(report.arg(0, 5000));
+
+    char dir_template[] = "/tmp/bench_command_spawn_XXXXXX";
+    if (!mkdtemp(dir_template)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    for (const int concurrency : {1, 4, 16}) {
+        run(report, dir_template, concurrency, total);
+    }
+    rmdir(dir_template);
+    return report.finish();
+}
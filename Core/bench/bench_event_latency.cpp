@@ -0,0 +1,103 @@
+#include "../src/filewatcherAPI/filewatcher_api.hpp"
+#include "../src/metrics/metrics.hpp"
+#include "bench_report.hpp"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Event-to-callback latency of FileWatcher: one write at a time, timed from
+// just before pwrite() to the start of the callback, so each sample covers
+// the kernel queue, the epoll wakeup, decoding and dispatch. Runs with
+// callbacks on the watcher thread, on the dispatch pool, and on the
+// fanotify backend when it is available.
+namespace {
+
+struct Variant {
+    const char* name;
+    FileWatcherAPI::BackendKind backend;
+    bool dispatch;
+};
+
+bool run(const std::string& dir, const Variant& variant, int samples, LatencyHistogram& histogram) {
+    const std::string path = dir + "/latency.conf";
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    std::atomic<int64_t> written_at{0};
+    std::atomic<int> received{0};
+
+    FileWatcherAPI::FileWatcher watcher(variant.backend);
+    if (variant.dispatch) {
+        watcher.set_dispatch({});
+    }
+    const bool watched = watcher.add_watch(dir, [&](const FileWatcherAPI::FileEvent&) {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        const int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+        histogram.record(static_cast<uint64_t>(micros - written_at.load(std::memory_order_acquire)));
+        received.fetch_add(1, std::memory_order_release);
+    }, IN_MODIFY);
+    if (!watched) {
+        close(fd);
+        unlink(path.c_str());
+        return false;
+    }
+    watcher.start();
+
+    for (int i = 0; i < samples; ++i) {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        written_at.store(std::chrono::duration_cast<std::chrono::microseconds>(now).count(), std::memory_order_release);
+        (void)!pwrite(fd, "x", 1, 0);
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while (received.load(std::memory_order_acquire) <= i && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+        if (received.load(std::memory_order_acquire) <= i) {
+            break;   // event lost; report what was measured
+        }
+    }
+
+    watcher.stop();
+    close(fd);
+    unlink(path.c_str());
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchReport report("event_latency", argc, argv);
+    const int samples = static_cast<int>(report.arg(0, 20000));
+
+    char dir_template[] = "/tmp/bench_event_latency_XXXXXX";
+    if (!mkdtemp(dir_template)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+
+    const Variant variants[] = {
+        {"inotify_inline", FileWatcherAPI::BackendKind::INOTIFY, false},
+        {"inotify_dispatch", FileWatcherAPI::BackendKind::INOTIFY, true},
+        {"fanotify_inline", FileWatcherAPI::BackendKind::FANOTIFY, false},
+    };
+    for (const Variant& variant : variants) {
+        LatencyHistogram histogram;
+        if (!run(dir_template, variant, samples, histogram)) {
+            std::printf("%-24s  unavailable\n", variant.name);
+            continue;
+        }
+        report.add(variant.name)
+            .param("samples", samples)
+            .metric("delivered", static_cast<double>(histogram.count()))
+            .metric("p50_us", static_cast<double>(histogram.percentile(0.5)))
+            .metric("p90_us", static_cast<double>(histogram.percentile(0.9)))
+            .metric("p99_us", static_cast<double>(histogram.percentile(0.99)))
+            .metric("p999_us", static_cast<double>(histogram.percentile(0.999)))
+            .metric("max_us", static_cast<double>(histogram.max()))
+            .metric("mean_us", histogram.count() ? static_cast<double>(histogram.sum()) / histogram.count() : 0.0);
+    }
+    rmdir(dir_template);
+    return report.finish();
+}
@@ -0,0 +1,57 @@
+#include "../src/logger/file_manager.hpp"
+#include "bench_report.hpp"
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Sustained FileManager throughput: 64 KB batches of log lines (the size of
+// one BufferManager half at the daemon's default threshold), with rotation,
+// through writev and, when available, io_uring.
+namespace {
+
+double run(const char* path, bool io_uring, size_t total_bytes, size_t segment_size) {
+    FileManager file(path, segment_size, 3);
+    if (io_uring && !file.enable_io_uring()) {
+        return -1.0;
+    }
+
+    std::string line = "2025-01-01 00:00:00.000 [INFO] sustained throughput benchmark line\n";
+    std::string batch;
+    while (batch.size() + line.size() <= 64 * 1024) {
+        batch += line;
+    }
+    const std::string_view chunks[] = {batch};
+
+    const auto start = std::chrono::steady_clock::now();
+    size_t written = 0;
+    while (written < total_bytes) {
+        if (!file.write_batch(chunks)) {
+            return 0.0;
+        }
+        written += batch.size();
+    }
+    file.flush();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(written) / (1024.0 * 1024.0) / elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchReport report("file_manager", argc, argv);
+    const char* path = report.arg(0, "bench_file_manager.log");
+    const size_t total_mb = static_cast<size_t>(report.arg(1, 256));
+
+    for (const bool io_uring : {false, true}) {
+        const double rate = run(path, io_uring, total_mb << 20, 8 << 20);
+        if (rate < 0) {
+            std::printf("%-24s  unavailable\n", "io_uring");
+            continue;
+        }
+        report.add(io_uring ? "io_uring" : "writev")
+            .param("megabytes", static_cast<double>(total_mb))
+            .metric("mb_per_s", rate);
+    }
+    return report.finish();
+}
@@ -0,0 +1,101 @@
+#include "../src/filewatcherAPI/watch_backend.hpp"
+#include "bench_report.hpp"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <poll.h>
+
+// Raw event throughput of the inotify backend, without FileWatcher's
+// dispatch: one thread writes a set of files round-robin (so the kernel
+// cannot merge events), the other polls and drains. Reported per read
+// buffer size, with the read syscalls each event cost.
+namespace {
+
+constexpr int kFiles = 64;
+// Well below the default max_queued_events (16384).
+constexpr unsigned long kMaxInFlight = 8192;
+
+struct Run {
+    unsigned long events;
+    unsigned long overflows;
+    unsigned long long reads;
+    double seconds;
+};
+
+Run run(const std::string& dir, size_t read_buffer, unsigned long total) {
+    FileWatcherAPI::WatchBackend backend;
+    backend.set_read_buffer_size(read_buffer);
+    if (backend.add_watch(dir.c_str(), IN_MODIFY) < 0) {
+        return {};
+    }
+
+    int fds[kFiles];
+    for (int i = 0; i < kFiles; ++i) {
+        const std::string path = dir + "/file_" + std::to_string(i);
+        fds[i] = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+
+    std::atomic<unsigned long> delivered{0};
+    std::atomic<bool> overflowed{false};   // lost events never arrive; stop pacing
+    Run result{};
+    const unsigned long long reads_before = read_syscalls();
+    const auto start = std::chrono::steady_clock::now();
+
+    std::thread writer([&] {
+        for (unsigned long i = 0; i < total; ++i) {
+            while (i - delivered.load(std::memory_order_relaxed) > kMaxInFlight &&
+                   !overflowed.load(std::memory_order_relaxed)) {
+                std::this_thread::yield();
+            }
+            (void)!pwrite(fds[i % kFiles], "x", 1, 0);
+        }
+    });
+
+    struct pollfd pfd = {backend.fd(), POLLIN, 0};
+    while (result.events < total && poll(&pfd, 1, 1000) > 0) {
+        backend.drain([&](int id, uint32_t, std::string_view) {
+            if (id < 0) {
+                ++result.overflows;
+                overflowed.store(true, std::memory_order_relaxed);
+                return;
+            }
+            delivered.store(++result.events, std::memory_order_relaxed);
+        });
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    writer.join();
+
+    result.reads = read_syscalls() - reads_before;
+    result.seconds = elapsed.count();
+    for (int i = 0; i < kFiles; ++i) {
+        close(fds[i]);
+        unlink((dir + "/file_" + std::to_string(i)).c_str());
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchReport report("inotify_throughput", argc, argv);
+    const auto total = static_cast<unsigned long>(report.arg(0, 1000000));
+
+    char dir_template[] = "/tmp/bench_inotify_XXXXXX";
+    if (!mkdtemp(dir_template)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+
+    for (const size_t buffer : {size_t{4096}, size_t{65536}}) {
+        const Run result = run(dir_template, buffer, total);
+        report.add("read_buffer_" + std::to_string(buffer / 1024) + "k")
+            .param("events", static_cast<double>(total))
+            .param("read_buffer_bytes", static_cast<double>(buffer))
+            .metric("events_per_s", result.seconds > 0 ? result.events / result.seconds : 0.0)
+            .metric("events_per_read", result.reads ? static_cast<double>(result.events) / result.reads : 0.0)
+            .metric("overflows", static_cast<double>(result.overflows));
+    }
+    rmdir(dir_template);
+    return report.finish();
+}
@@ -0,0 +1,53 @@
+#include "../src/logger/ipc_client.hpp"
+#include "bench_report.hpp"
+#include <chrono>
+#include <string_view>
+#include <thread>
+
+// Client-side send rate against a running logger_daemon, over the socket
+// and over the shared-memory ring:  bench_ipc_client <daemon_pid> [count]
+// (bench_logger_ingest starts its own daemon and times the whole path).
+namespace {
+
+double run(int daemon_pid, bool ring, int count) {
+    IPCClient client(daemon_pid);
+    if (ring && !client.enable_shared_ring(4096)) {
+        return -1.0;
+    }
+
+    char line[64];
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        const int len = std::snprintf(line, sizeof(line), "benchmark line %d", i);
+        while (!client.send(std::string_view{line, static_cast<size_t>(len)})) {
+            std::this_thread::yield();
+        }
+    }
+    client.flush();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return count / elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchReport report("ipc_client", argc, argv);
+    const int daemon_pid = static_cast<int>(report.arg(0, 0L));
+    const int count = static_cast<int>(report.arg(1, 100000));
+    if (daemon_pid <= 0) {
+        std::fprintf(stderr, "Usage: %s <daemon_pid> [count] [--json <file>]\n", argv[0]);
+        return 1;
+    }
+
+    for (const bool ring : {false, true}) {
+        const double rate = run(daemon_pid, ring, count);
+        if (rate < 0) {
+            std::printf("%-24s  unavailable\n", "ring");
+            continue;
+        }
+        report.add(ring ? "ring" : "socket")
+            .param("messages", count)
+            .metric("msg_per_s", rate);
+    }
+    return report.finish();
+}
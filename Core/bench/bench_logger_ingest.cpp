@@ -0,0 +1,135 @@
+#include "../src/logger/ipc_client.hpp"
+#include "../src/metrics/metrics.hpp"
+#include "bench_report.hpp"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+// End-to-end ingest rate of a real logger_daemon: N producer threads, each
+// with its own IPCClient over the socket or the shared-memory ring, and the
+// clock stops when the daemon's own lines counter has seen every line. The
+// daemon is started from the build tree with a private stats socket and
+// writes (and rotates) into a temporary directory.
+extern char** environ;
+
+namespace {
+
+constexpr const char* kLinesTotal = "aurora_logger_lines_total";
+
+struct Daemon {
+    pid_t pid = -1;
+    std::string stats_socket;
+};
+
+bool start_daemon(const std::string& dir, Daemon& daemon) {
+    daemon.stats_socket = "bench_logger_ingest_" + std::to_string(getpid());
+    const std::string log_path = dir + "/ingest.log";
+    const char* argv[] = {LOGGER_DAEMON_PATH, "-f", log_path.c_str(), "-q", daemon.stats_socket.c_str(), nullptr};
+    if (posix_spawn(&daemon.pid, LOGGER_DAEMON_PATH, nullptr, nullptr, const_cast<char**>(argv), environ) != 0) {
+        return false;
+    }
+    std::string stats;
+    for (int i = 0; i < 500; ++i) {
+        if (StatsEndpoint::query(daemon.stats_socket, stats)) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+uint64_t lines_total(const Daemon& daemon) {
+    std::string stats;
+    return StatsEndpoint::query(daemon.stats_socket, stats) ? prometheus_value(stats, kLinesTotal) : 0;
+}
+
+double run(const Daemon& daemon, int producers, int per_producer, bool ring) {
+    const uint64_t before = lines_total(daemon);
+    const uint64_t target = before + static_cast<uint64_t>(producers) * per_producer;
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&] {
+            IPCClient client(daemon.pid);
+            if (ring && !client.enable_shared_ring(4096)) {
+                return;
+            }
+            char line[96];
+            for (int i = 0; i < per_producer; ++i) {
+                const int len = std::snprintf(line, sizeof(line), "ingest benchmark line %d with a typical payload", i);
+                while (!client.send(std::string_view{line, static_cast<size_t>(len)})) {
+                    std::this_thread::yield();
+                }
+            }
+            client.flush();
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    uint64_t seen = before;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while ((seen = lines_total(daemon)) < target && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(seen - before) / elapsed.count();
+}
+
+void remove_tree(const char* dir) {
+    if (DIR* entries = opendir(dir)) {
+        while (const struct dirent* entry = readdir(entries)) {
+            if (entry->d_name[0] != '.') {
+                unlink((std::string{dir} + "/" + entry->d_name).c_str());
+            }
+        }
+        closedir(entries);
+    }
+    rmdir(dir);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchReport report("logger_ingest", argc, argv);
+    const int total = static_cast<int>(report.arg(0, 400000));
+
+    char dir_template[] = "/tmp/bench_logger_ingest_XXXXXX";
+    if (!mkdtemp(dir_template)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    Daemon daemon;
+    if (!start_daemon(dir_template, daemon)) {
+        std::fprintf(stderr, "Could not start %s\n", LOGGER_DAEMON_PATH);
+        if (daemon.pid > 0) {
+            kill(daemon.pid, SIGKILL);
+            waitpid(daemon.pid, nullptr, 0);
+        }
+        remove_tree(dir_template);
+        return 1;
+    }
+
+    for (const bool ring : {false, true}) {
+        for (const int producers : {1, 4, 16}) {
+            const double rate = run(daemon, producers, total / producers, ring);
+            report.add(std::string{ring ? "ring" : "socket"} + "_producers_" + std::to_string(producers))
+                .param("lines", total)
+                .param("producers", producers)
+                .param("shared_ring", ring)
+                .metric("lines_per_s", rate);
+        }
+    }
+
+    kill(daemon.pid, SIGTERM);
+    waitpid(daemon.pid, nullptr, 0);
+    remove_tree(dir_template);
+    return report.finish();
+}
@@ -0,0 +1,165 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+// Collects one harness's results and prints them as aligned text; with
+// `--json <file>` it also writes them as JSON for comparison across commits:
+//
+//   {"benchmark": "buffer_manager", "commit": "3f2c1ab-dirty", "kernel": "6.1.0",
+//    "cpus": 8, "timestamp": 1700000000,
+//    "results": [{"name": "producers_4", "params": {"producers": 4},
+//                 "metrics": {"msg_per_s": 1.2e7}}]}
+//
+// Remaining arguments are the harness's own positionals, read with arg().
+class BenchReport {
+public:
+    class Result {
+    public:
+        explicit Result(std::string name) : name_(std::move(name)) {}
+
+        Result& param(std::string_view key, double value) {
+            params_.emplace_back(key, value);
+            return *this;
+        }
+        Result& metric(std::string_view key, double value) {
+            metrics_.emplace_back(key, value);
+            return *this;
+        }
+
+    private:
+        friend class BenchReport;
+        std::string name_;
+        std::vector<std::pair<std::string, double>> params_;
+        std::vector<std::pair<std::string, double>> metrics_;
+    };
+
+    BenchReport(std::string_view benchmark, int argc, char* argv[]) : benchmark_(benchmark) {
+        for (int i = 1; i < argc; ++i) {
+            if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+                json_path_ = argv[++i];
+            } else {
+                args_.push_back(argv[i]);
+            }
+        }
+    }
+
+    // Positional argument `index` as a number, or `fallback`.
+    long arg(size_t index, long fallback) const {
+        return index < args_.size() ? std::strtol(args_[index], nullptr, 10) : fallback;
+    }
+    const char* arg(size_t index, const char* fallback) const {
+        return index < args_.size() ? args_[index] : fallback;
+    }
+
+    // The reference stays valid until the next add().
+    Result& add(std::string name) {
+        return results_.emplace_back(std::move(name));
+    }
+
+    // Prints every result and writes the JSON file; returns main()'s exit code.
+    int finish() const {
+        for (const auto& result : results_) {
+            std::printf("%-24s", result.name_.c_str());
+            for (const auto& [key, value] : result.metrics_) {
+                std::printf("  %s=%.6g", key.c_str(), value);
+            }
+            std::printf("\n");
+        }
+        if (json_path_.empty()) {
+            return 0;
+        }
+
+        FILE* out = std::fopen(json_path_.c_str(), "w");
+        if (!out) {
+            std::perror(json_path_.c_str());
+            return 1;
+        }
+        struct utsname host{};
+        uname(&host);
+        std::fprintf(out, "{\"benchmark\": \"%s\", \"commit\": \"%s\", \"kernel\": \"%s\", \"machine\": \"%s\",\n",
+                     benchmark_.c_str(), commit().c_str(), host.release, host.machine);
+        std::fprintf(out, " \"cpus\": %ld, \"timestamp\": %lld,\n \"results\": [", sysconf(_SC_NPROCESSORS_ONLN),
+                     static_cast<long long>(std::time(nullptr)));
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const auto& result = results_[i];
+            std::fprintf(out, "%s\n  {\"name\": \"%s\", \"params\": ", i ? "," : "", result.name_.c_str());
+            write_object(out, result.params_);
+            std::fprintf(out, ", \"metrics\": ");
+            write_object(out, result.metrics_);
+            std::fprintf(out, "}");
+        }
+        std::fprintf(out, "\n ]}\n");
+        return std::fclose(out) == 0 ? 0 : 1;
+    }
+
+private:
+    static void write_object(FILE* out, const std::vector<std::pair<std::string, double>>& values) {
+        std::fprintf(out, "{");
+        for (size_t i = 0; i < values.size(); ++i) {
+            std::fprintf(out, "%s\"%s\": %.9g", i ? ", " : "", values[i].first.c_str(), values[i].second);
+        }
+        std::fprintf(out, "}");
+    }
+
+    // The source tree's commit, "-dirty" if it has local changes.
+    static std::string commit() {
+        std::string hash = "unknown";
+#ifdef BENCH_SOURCE_DIR
+        if (FILE* git = popen("git -C " BENCH_SOURCE_DIR " describe --always --dirty 2>/dev/null", "r")) {
+            char line[128];
+            if (std::fgets(line, sizeof(line), git)) {
+                hash.assign(line, std::strcspn(line, "\n"));
+            }
+            pclose(git);
+        }
+#endif
+        return hash;
+    }
+
+    std::string benchmark_;
+    std::string json_path_;
+    std::vector<const char*> args_;
+    std::vector<Result> results_;
+};
+
+// Read syscalls issued by this process so far (/proc/self/io "syscr"), or
+// 0 without task I/O accounting.
+inline unsigned long long read_syscalls() {
+    unsigned long long count = 0;
+    if (FILE* io = std::fopen("/proc/self/io", "re")) {
+        char line[64];
+        while (std::fgets(line, sizeof(line), io)) {
+            if (std::sscanf(line, "syscr: %llu", &count) == 1) {
+                break;
+            }
+        }
+        std::fclose(io);
+    }
+    return count;
+}
+
+// Reads a sample out of Prometheus text from a stats socket; 0 if absent.
+// Quantiles come back in microseconds.
+inline uint64_t prometheus_value(const std::string& text, std::string_view name) {
+    std::string key{"\n"};
+    key.append(name).push_back(' ');
+    const size_t at = text.find(key);
+    return at == std::string::npos ? 0 : std::strtoull(text.c_str() + at + key.size(), nullptr, 10);
+}
+
+inline double prometheus_quantile(const std::string& text, std::string_view name, const char* q) {
+    std::string key{name};
+    key.append("{quantile=\"").append(q).append("\"} ");
+    const size_t at = text.find(key);
+    return at == std::string::npos ? 0.0 : std::strtod(text.c_str() + at + key.size(), nullptr) * 1e6;
+}
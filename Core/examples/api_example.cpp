@@ -54,7 +54,7 @@ private:
             [this](const FileWatcherAPI::FileEvent& event) {
                 std::string msg = "Config file event: " + 
                     FileWatcherAPI::event_type_to_string(event.type) + 
-                    " on " + event.path;
+                    " on " + std::string{event.path};
                 
                 std::cout << msg << std::endl;
                 
@@ -73,7 +73,7 @@ private:
         watcher_.add_watch("data", 
             [this](const FileWatcherAPI::FileEvent& event) {
                 if (!event.filename.empty()) {
-                    std::string msg = "Data file " + event.filename + " was " +
+                    std::string msg = "Data file " + std::string{event.filename} + " was " +
                         FileWatcherAPI::event_type_to_string(event.type);
                     std::cout << msg << std::endl;
                 }
@@ -0,0 +1,291 @@
+#include "dax_document.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+bool is_space(char c) noexcept {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// strtod() needs a terminated string; band values are short.
+bool parse_number(std::string_view text, double& value) noexcept {
+    if (!is_dax_number(text)) {
+        return false;
+    }
+    char buffer[32];
+    std::memcpy(buffer, text.data(), text.size());
+    buffer[text.size()] = '\0';
+    value = std::strtod(buffer, nullptr);
+    return true;
+}
+
+void append_number(std::string& out, double value) {
+    char number[32];
+    std::snprintf(number, sizeof(number), "%.10g", value);
+    out += number;
+}
+
+} // namespace
+
+bool is_dax_number(std::string_view text) noexcept {
+    std::size_t pos = !text.empty() && (text[0] == '-' || text[0] == '+') ? 1 : 0;
+    const std::size_t digits = pos;
+    while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+        ++pos;
+    }
+    if (pos == digits || text.size() >= 32) {
+        return false;
+    }
+    if (pos < text.size() && text[pos] == '.') {
+        const std::size_t fraction = ++pos;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+            ++pos;
+        }
+        if (pos == fraction) {
+            return false;
+        }
+    }
+    return pos == text.size();
+}
+
+bool DaxDocument::open(const char* path, std::string& error) noexcept {
+    presets_.clear();
+    profiles_.clear();
+    patches_.clear();
+    replaced_.clear();
+    path_ = path;
+    return file_.open(path, error) && index(error);
+}
+
+bool DaxDocument::index(std::string& error) noexcept {
+    const std::string_view text = file_.text();
+    XmlScanner scanner(text);
+    XmlTag tag;
+    bool in_preset = false;
+    bool in_profile = false;
+    bool in_endpoint = false;
+
+    auto fail = [&](std::size_t offset, const char* message) {
+        error = path_ + ":" + std::to_string(line_of(text, offset)) + ": " + message;
+        presets_.clear();
+        profiles_.clear();
+        return false;
+    };
+
+    while (scanner.next(tag)) {
+        if (tag.closing) {
+            if (tag.name == "preset") {
+                in_preset = false;
+            } else if (tag.name == "endpoint_type") {
+                in_endpoint = false;
+            } else if (tag.name == "profile") {
+                in_profile = false;
+                in_endpoint = false;
+            }
+            continue;
+        }
+
+        if (tag.name == "preset") {
+            if (in_preset) {
+                return fail(tag.begin, "nested <preset>");
+            }
+            DaxPreset& preset = presets_.emplace_back();
+            preset.id = tag.value("id");
+            preset.type = tag.value("type");
+            preset.geq = preset.type == "geq";
+            in_preset = !tag.self_closing;
+        } else if (in_preset && (tag.name == "band_ieq" || tag.name == "band_geq")) {
+            DaxPreset& preset = presets_.back();
+            const bool geq = tag.name == "band_geq";
+            const XmlAttribute* frequency = tag.find("frequency");
+            const XmlAttribute* value = tag.find(geq ? "gain" : "target");
+            double hz;
+            DaxBand band{};
+            if (!frequency || !value || !parse_number(frequency->value, hz) ||
+                !parse_number(value->value, band.value)) {
+                return fail(tag.begin, geq ? "<band_geq> needs numeric frequency and gain"
+                                           : "<band_ieq> needs numeric frequency and target");
+            }
+            band.frequency = static_cast<int>(std::lround(hz));
+            band.value_offset = value->offset;
+            band.value_length = value->value.size();
+            if (preset.bands.empty()) {
+                // Replacements keep the file's indentation.
+                const std::size_t line = text.rfind('\n', tag.begin - 1) + 1;
+                const std::string_view indent = text.substr(line, tag.begin - line);
+                const bool blank = std::all_of(indent.begin(), indent.end(), is_space);
+                preset.bands_begin = blank ? line : tag.begin;
+                preset.band_indent = blank ? indent : std::string_view{};
+                preset.geq = geq;
+            }
+            preset.bands_end = tag.end;
+            preset.bands.push_back(band);
+        } else if (tag.name == "profile") {
+            DaxProfile& profile = profiles_.emplace_back();
+            profile.id = tag.value("id");
+            profile.name = tag.value("name");
+            profile.group = tag.value("group");
+            in_profile = !tag.self_closing;
+        } else if (in_profile && tag.name == "endpoint_type") {
+            profiles_.back().endpoints.push_back({tag.value("id"), {}});
+            in_endpoint = !tag.self_closing;
+        } else if (in_endpoint && tag.name == "include") {
+            if (const XmlAttribute* preset = tag.find("preset")) {
+                profiles_.back().endpoints.back().presets.push_back(preset->value);
+            }
+        }
+    }
+    return scanner.error() ? fail(scanner.error_offset(), scanner.error()) : true;
+}
+
+const DaxPreset* DaxDocument::find_preset(std::string_view id) const noexcept {
+    for (const auto& preset : presets_) {
+        if (preset.id == id) {
+            return &preset;
+        }
+    }
+    return nullptr;
+}
+
+void DaxDocument::preset_json(const DaxPreset& preset, std::string& out) noexcept {
+    out += "{\"id\":";
+    append_json_string(out, preset.id);
+    out += ",\"type\":";
+    append_json_string(out, preset.type);
+    out += ",\"bands\":[";
+    for (std::size_t i = 0; i < preset.bands.size(); ++i) {
+        out += i ? ",{\"frequency\":" : "{\"frequency\":";
+        append_number(out, preset.bands[i].frequency);
+        out += preset.geq ? ",\"gain\":" : ",\"target\":";
+        append_number(out, preset.bands[i].value);
+        out.push_back('}');
+    }
+    out += "]}";
+}
+
+void DaxDocument::to_json(std::string& out) const noexcept {
+    out = "{\"presets\":[";
+    for (std::size_t i = 0; i < presets_.size(); ++i) {
+        if (i) {
+            out.push_back(',');
+        }
+        preset_json(presets_[i], out);
+    }
+    out += "],\"profiles\":[";
+    for (std::size_t i = 0; i < profiles_.size(); ++i) {
+        const DaxProfile& profile = profiles_[i];
+        out += i ? ",{\"id\":" : "{\"id\":";
+        append_json_string(out, profile.id);
+        out += ",\"name\":";
+        append_json_string(out, profile.name);
+        out += ",\"group\":";
+        append_json_string(out, profile.group);
+        out += ",\"endpoints\":[";
+        for (std::size_t e = 0; e < profile.endpoints.size(); ++e) {
+            out += e ? ",{\"type\":" : "{\"type\":";
+            append_json_string(out, profile.endpoints[e].type);
+            out += ",\"presets\":[";
+            for (std::size_t p = 0; p < profile.endpoints[e].presets.size(); ++p) {
+                if (p) {
+                    out.push_back(',');
+                }
+                append_json_string(out, profile.endpoints[e].presets[p]);
+            }
+            out += "]}";
+        }
+        out += "]}";
+    }
+    out += "]}";
+}
+
+bool DaxDocument::set_band(std::string_view preset_id, int frequency, std::string_view value,
+                           std::string& error) noexcept {
+    const DaxPreset* preset = find_preset(preset_id);
+    if (!preset) {
+        error = "no preset \"" + std::string{preset_id} + "\"";
+        return false;
+    }
+    if (!is_dax_number(value)) {
+        error = "not a number: " + std::string{value};
+        return false;
+    }
+    if (std::find(replaced_.begin(), replaced_.end(), preset) != replaced_.end()) {
+        error = "bands of \"" + std::string{preset_id} + "\" were already replaced";
+        return false;
+    }
+    const auto band = std::find_if(preset->bands.begin(), preset->bands.end(),
+                                   [&](const DaxBand& b) { return b.frequency == frequency; });
+    if (band == preset->bands.end()) {
+        error = "preset \"" + std::string{preset_id} + "\" has no band at " + std::to_string(frequency) + " Hz";
+        return false;
+    }
+    std::erase_if(patches_, [&](const SplicePatch& patch) { return patch.offset == band->value_offset; });
+    patches_.push_back({band->value_offset, band->value_length, std::string{value}});
+    return true;
+}
+
+bool DaxDocument::replace_bands(std::string_view preset_id, const std::vector<std::pair<int, std::string_view>>& bands,
+                                std::string& error) noexcept {
+    const DaxPreset* preset = find_preset(preset_id);
+    if (!preset) {
+        error = "no preset \"" + std::string{preset_id} + "\"";
+        return false;
+    }
+    if (preset->bands.empty() || bands.empty()) {
+        error = "preset \"" + std::string{preset_id} + "\" has no band list to replace";
+        return false;
+    }
+    for (const auto& [frequency, value] : bands) {
+        if (!is_dax_number(value)) {
+            error = "not a number: " + std::string{value};
+            return false;
+        }
+    }
+
+    const bool same_frequencies = std::equal(bands.begin(), bands.end(), preset->bands.begin(), preset->bands.end(),
+                                             [](const auto& wanted, const DaxBand& existing) {
+                                                 return wanted.first == existing.frequency;
+                                             });
+    std::erase_if(patches_, [&](const SplicePatch& patch) {
+        return patch.offset >= preset->bands_begin && patch.offset < preset->bands_end;
+    });
+    std::erase(replaced_, preset);
+    if (same_frequencies) {
+        for (std::size_t i = 0; i < bands.size(); ++i) {
+            patches_.push_back({preset->bands[i].value_offset, preset->bands[i].value_length,
+                                std::string{bands[i].second}});
+        }
+        return true;
+    }
+
+    const char* element = preset->geq ? "<band_geq frequency=\"" : "<band_ieq frequency=\"";
+    const char* attribute = preset->geq ? "\" gain=\"" : "\" target=\"";
+    std::string text;
+    for (std::size_t i = 0; i < bands.size(); ++i) {
+        if (i) {
+            text.push_back('\n');
+        }
+        text.append(preset->band_indent).append(element).append(std::to_string(bands[i].first));
+        text.append(attribute).append(bands[i].second).append("\"/>");
+    }
+    patches_.push_back({preset->bands_begin, preset->bands_end - preset->bands_begin, std::move(text)});
+    replaced_.push_back(preset);
+    return true;
+}
+
+bool DaxDocument::commit(std::string& error) noexcept {
+    if (patches_.empty()) {
+        return true;
+    }
+    std::sort(patches_.begin(), patches_.end(),
+              [](const SplicePatch& a, const SplicePatch& b) { return a.offset < b.offset; });
+    if (!write_spliced(path_, file_.text(), patches_, error)) {
+        return false;
+    }
+    const std::string path = path_;
+    return open(path.c_str(), error);
+}
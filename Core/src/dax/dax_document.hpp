@@ -0,0 +1,91 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include "xml_edit.hpp"
+
+// One <band_ieq frequency=".." target=".."/> or <band_geq frequency=".."
+// gain=".."/>. `value_offset`/`value_length` locate the target or gain
+// attribute's value in the file, so a patch rewrites just those bytes.
+struct DaxBand {
+    int frequency;
+    double value;
+    std::size_t value_offset;
+    std::size_t value_length;
+};
+
+struct DaxPreset {
+    std::string_view id;
+    std::string_view type;              // "ieq" or "geq"
+    std::vector<DaxBand> bands;
+    // From the start of the first band's line to the end of the last band
+    // tag: what replace_bands() rewrites.
+    std::size_t bands_begin = 0;
+    std::size_t bands_end = 0;
+    std::string_view band_indent;
+    bool geq = false;
+};
+
+struct DaxEndpoint {
+    std::string_view type;
+    std::vector<std::string_view> presets;   // <include preset=".."/>
+};
+
+struct DaxProfile {
+    std::string_view id;
+    std::string_view name;
+    std::string_view group;
+    std::vector<DaxEndpoint> endpoints;
+};
+
+// A dax-default.xml mapped read-only and indexed in one pass: presets with
+// their band arrays, profiles with the presets each endpoint includes.
+// Nothing else in the file is interpreted, and nothing is copied: the
+// index holds views into the mapping.
+//
+// Edits are queued as byte-range patches and commit() writes them with
+// write_spliced(): the file is rewritten once per commit, atomically.
+class DaxDocument final {
+public:
+    DaxDocument() = default;
+
+    DaxDocument(const DaxDocument&) = delete;
+    DaxDocument& operator=(const DaxDocument&) = delete;
+
+    bool open(const char* path, std::string& error) noexcept;
+
+    [[nodiscard]] const std::vector<DaxPreset>& presets() const noexcept { return presets_; }
+    [[nodiscard]] const std::vector<DaxProfile>& profiles() const noexcept { return profiles_; }
+    [[nodiscard]] const DaxPreset* find_preset(std::string_view id) const noexcept;
+
+    // {"presets":[{"id":..,"type":..,"bands":[{"frequency":..,"target"|"gain":..}]}],
+    //  "profiles":[{"id":..,"name":..,"group":..,"endpoints":[{"type":..,"presets":[..]}]}]}
+    void to_json(std::string& out) const noexcept;
+    static void preset_json(const DaxPreset& preset, std::string& out) noexcept;
+
+    // Sets the band at `frequency` to `value` (written exactly as given).
+    bool set_band(std::string_view preset, int frequency, std::string_view value, std::string& error) noexcept;
+    // Makes the preset's band list exactly `bands` (frequency, value). Same
+    // frequencies in the same order become per-value patches.
+    bool replace_bands(std::string_view preset, const std::vector<std::pair<int, std::string_view>>& bands,
+                       std::string& error) noexcept;
+
+    [[nodiscard]] bool dirty() const noexcept { return !patches_.empty(); }
+    // Writes the patched file and re-indexes it.
+    bool commit(std::string& error) noexcept;
+
+private:
+    bool index(std::string& error) noexcept;
+
+    std::string path_;
+    MappedFile file_;
+    std::vector<DaxPreset> presets_;
+    std::vector<DaxProfile> profiles_;
+    std::vector<SplicePatch> patches_;
+    std::vector<const DaxPreset*> replaced_;   // presets with a whole-list patch
+};
+
+// "-12", "3.5": what a band value may be set to.
+[[nodiscard]] bool is_dax_number(std::string_view text) noexcept;
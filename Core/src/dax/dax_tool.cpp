@@ -0,0 +1,115 @@
+#include "dax_document.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+void print_usage(std::string_view prog_name) noexcept {
+    std::printf("Usage: %s -f <dax.xml> <command> [args]\n", prog_name.data());
+    std::printf("Commands:\n");
+    std::printf("  list                     Print every preset and profile as JSON\n");
+    std::printf("  get <preset>             Print one preset as JSON\n");
+    std::printf("  set <preset> <hz>=<value>...\n");
+    std::printf("                           Change the target (ieq) or gain (geq) of existing bands\n");
+    std::printf("  replace <preset> <hz>=<value>...\n");
+    std::printf("                           Make the preset's band list exactly these bands\n");
+    std::printf("\nset and replace rewrite the file atomically (temp file, fsync, rename)\n");
+    std::printf("and print the updated preset. Errors go to stderr with exit status 1.\n");
+    std::printf("\nExamples:\n");
+    std::printf("  %s -f /vendor/etc/dolby/dax-default.xml list\n", prog_name.data());
+    std::printf("  %s -f dax-default.xml set ieq_balanced 130=80 156=120\n", prog_name.data());
+    std::printf("  %s -f dax-default.xml replace 0 47=0 141=2 328=-1.5\n", prog_name.data());
+}
+
+bool parse_bands(int argc, char* argv[], int first, std::vector<std::pair<int, std::string_view>>& bands) noexcept {
+    for (int i = first; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const size_t equals = arg.find('=');
+        if (equals == std::string_view::npos || equals == 0) {
+            std::fprintf(stderr, "Expected <hz>=<value>, got: %s\n", argv[i]);
+            return false;
+        }
+        char* end = nullptr;
+        const long hz = std::strtol(argv[i], &end, 10);
+        if (end != argv[i] + equals || hz <= 0) {
+            std::fprintf(stderr, "Bad frequency in: %s\n", argv[i]);
+            return false;
+        }
+        bands.emplace_back(static_cast<int>(hz), arg.substr(equals + 1));
+    }
+    return !bands.empty();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const char* file = nullptr;
+    int arg = 1;
+    for (; arg < argc; ++arg) {
+        const std::string_view option = argv[arg];
+        if (option == "-f" && arg + 1 < argc) {
+            file = argv[++arg];
+        } else if (option == "-h" || option == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            break;
+        }
+    }
+    if (!file || arg >= argc) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    const std::string_view command = argv[arg++];
+
+    DaxDocument document;
+    std::string error;
+    if (!document.open(file, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    std::string json;
+    if (command == "list") {
+        document.to_json(json);
+    } else if (command == "get" && arg + 1 == argc) {
+        const DaxPreset* preset = document.find_preset(argv[arg]);
+        if (!preset) {
+            std::fprintf(stderr, "No preset \"%s\"\n", argv[arg]);
+            return 1;
+        }
+        DaxDocument::preset_json(*preset, json);
+    } else if ((command == "set" || command == "replace") && arg + 1 < argc) {
+        const std::string preset_id = argv[arg];
+        std::vector<std::pair<int, std::string_view>> bands;
+        if (!parse_bands(argc, argv, arg + 1, bands)) {
+            return 1;
+        }
+        bool ok = true;
+        if (command == "replace") {
+            ok = document.replace_bands(preset_id, bands, error);
+        } else {
+            for (const auto& [hz, value] : bands) {
+                if (!(ok = document.set_band(preset_id, hz, value, error))) {
+                    break;
+                }
+            }
+        }
+        if (!ok || !document.commit(error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        DaxDocument::preset_json(*document.find_preset(preset_id), json);
+    } else {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    json.push_back('\n');
+    std::fwrite(json.data(), 1, json.size(), stdout);
+    return 0;
+}
@@ -0,0 +1,268 @@
+#include "command_runner.hpp"
+#include <sys/wait.h>
+#include <unistd.h>
+#include <paths.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#if !defined(__ANDROID__) || __ANDROID_API__ >= 28
+#include <spawn.h>
+#define WATCHER_HAVE_POSIX_SPAWN 1
+#endif
+
+extern char** environ;
+
+namespace {
+constexpr std::string_view kFileToken = "$FILE";
+constexpr std::string_view kEventsToken = "$EVENTS";
+constexpr std::string_view kFileEnv = "FILE=";
+constexpr std::string_view kEventsEnv = "EVENTS=";
+
+void set_env(std::string& out, std::string_view prefix, std::string_view value) noexcept {
+    out.reserve(prefix.size() + value.size());
+    out.assign(prefix);
+    out.append(value);
+}
+constexpr std::string_view kShellMeta = "|&;<>()$`\\\"'*?[]#~=%{}!\n";
+}
+
+CommandTemplate::CommandTemplate(std::string_view command) noexcept
+    : source_(command) {
+    shell_ = needs_shell(command);
+    if (shell_) {
+        program_ = _PATH_BSHELL;
+        return;
+    }
+
+    size_t pos = 0;
+    while (pos < command.size()) {
+        pos = command.find_first_not_of(" \t", pos);
+        if (pos == std::string_view::npos) {
+            break;
+        }
+        const size_t end = std::min(command.find_first_of(" \t", pos), command.size());
+        args_.emplace_back(command.substr(pos, end - pos));
+        pos = end;
+    }
+
+    if (args_.empty()) {
+        shell_ = true;
+        program_ = _PATH_BSHELL;
+        return;
+    }
+    program_ = resolve_program(args_.front());
+}
+
+bool CommandTemplate::needs_shell(std::string_view command) noexcept {
+    size_t pos = 0;
+    while (pos < command.size()) {
+        if (command.substr(pos, kFileToken.size()) == kFileToken) {
+            pos += kFileToken.size();
+            continue;
+        }
+        if (command.substr(pos, kEventsToken.size()) == kEventsToken) {
+            pos += kEventsToken.size();
+            continue;
+        }
+        if (kShellMeta.find(command[pos]) != std::string_view::npos) {
+            return true;
+        }
+        ++pos;
+    }
+    return false;
+}
+
+std::string CommandTemplate::resolve_program(std::string_view name) noexcept {
+    if (name.find('/') != std::string_view::npos) {
+        return std::string{name};
+    }
+
+    const char* env_path = std::getenv("PATH");
+    const std::string_view search = env_path ? env_path : "/system/bin:/usr/bin:/bin";
+
+    std::string candidate;
+    size_t pos = 0;
+    while (pos <= search.size()) {
+        const size_t end = std::min(search.find(':', pos), search.size());
+        const std::string_view dir = search.substr(pos, end - pos);
+        candidate.assign(dir.empty() ? "." : dir);
+        candidate += '/';
+        candidate += name;
+        if (access(candidate.c_str(), X_OK) == 0) {
+            return candidate;
+        }
+        pos = end + 1;
+    }
+
+    // Let execve report ENOENT from the child instead of failing the watch.
+    return std::string{name};
+}
+
+void CommandTemplate::substitute(std::string_view in, std::string_view file, std::string_view events,
+                                 std::string& out) noexcept {
+    out.clear();
+    size_t pos = 0;
+    while (true) {
+        const size_t hit = in.find('$', pos);
+        if (hit == std::string_view::npos) {
+            out.append(in.substr(pos));
+            return;
+        }
+        out.append(in.substr(pos, hit - pos));
+        if (in.substr(hit, kFileToken.size()) == kFileToken) {
+            out.append(file);
+            pos = hit + kFileToken.size();
+        } else if (in.substr(hit, kEventsToken.size()) == kEventsToken) {
+            out.append(events);
+            pos = hit + kEventsToken.size();
+        } else {
+            out += '$';
+            pos = hit + 1;
+        }
+    }
+}
+
+void CommandTemplate::expand(std::string_view file, std::string_view events,
+                             std::vector<std::string>& argv) const noexcept {
+    if (shell_) {
+        // Both reach the script through the environment, never as text.
+        argv.resize(3);
+        argv[0] = "sh";
+        argv[1] = "-c";
+        argv[2] = source_;
+        return;
+    }
+
+    argv.resize(args_.size());
+    for (size_t i = 0; i < args_.size(); ++i) {
+        substitute(args_[i], file, events, argv[i]);
+    }
+}
+
+CommandRunner::CommandRunner() noexcept {
+    sigset_t chld_mask;
+    sigemptyset(&chld_mask);
+    sigaddset(&chld_mask, SIGCHLD);
+    pthread_sigmask(SIG_BLOCK, &chld_mask, &saved_mask_);
+}
+
+CommandRunner::~CommandRunner() noexcept {
+    reap();
+    pthread_sigmask(SIG_SETMASK, &saved_mask_, nullptr);
+}
+
+void CommandRunner::submit(const CommandTemplate& command, std::string_view file, std::string_view events,
+                           std::chrono::steady_clock::time_point since) noexcept {
+    Job job;
+    job.program = command.program();
+    job.since = since;
+    command.expand(file, events, job.argv);
+    set_env(job.file_env, kFileEnv, file);
+    set_env(job.events_env, kEventsEnv, events);
+
+    if (running_ < max_concurrency_ && queue_.empty()) {
+        spawn(job);
+        return;
+    }
+
+    if (queue_.size() >= max_queued_) {
+        if (queue_.empty()) {
+            ++dropped_;
+            return;
+        }
+        queue_.pop_front();
+        ++dropped_;
+    }
+    queue_.push_back(std::move(job));
+}
+
+bool CommandRunner::spawn(const Job& job) noexcept {
+    argv_ptrs_.clear();
+    for (const auto& arg : job.argv) {
+        argv_ptrs_.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv_ptrs_.push_back(nullptr);
+
+    // The inherited environment, with FILE and EVENTS replaced.
+    env_ptrs_.clear();
+    for (char** env = environ; *env; ++env) {
+        if (std::strncmp(*env, kFileEnv.data(), kFileEnv.size()) != 0 &&
+            std::strncmp(*env, kEventsEnv.data(), kEventsEnv.size()) != 0) {
+            env_ptrs_.push_back(*env);
+        }
+    }
+    env_ptrs_.push_back(const_cast<char*>(job.file_env.c_str()));
+    env_ptrs_.push_back(const_cast<char*>(job.events_env.c_str()));
+    env_ptrs_.push_back(nullptr);
+
+    pid_t pid = -1;
+#ifdef WATCHER_HAVE_POSIX_SPAWN
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setsigmask(&attr, &saved_mask_);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+    const int rc = posix_spawn(&pid, job.program.c_str(), nullptr, &attr, argv_ptrs_.data(), env_ptrs_.data());
+    posix_spawnattr_destroy(&attr);
+    if (rc != 0) {
+        ++failed_;
+        return false;
+    }
+#else
+    const char* program = job.program.c_str();
+    char* const* argv = argv_ptrs_.data();
+    char* const* envp = env_ptrs_.data();
+    const sigset_t* mask = &saved_mask_;
+    pid = vfork();
+    if (pid == 0) {
+        sigprocmask(SIG_SETMASK, mask, nullptr);
+        execve(program, argv, envp);
+        _exit(127);
+    }
+    if (pid < 0) {
+        ++failed_;
+        return false;
+    }
+#endif
+
+    ++running_;
+    ++spawned_;
+    if (job.since != std::chrono::steady_clock::time_point{}) {
+        latency_.record_since(job.since);
+    }
+    return true;
+}
+
+void CommandRunner::launch_queued() noexcept {
+    while (running_ < max_concurrency_ && !queue_.empty()) {
+        const Job job = std::move(queue_.front());
+        queue_.pop_front();
+        spawn(job);
+    }
+}
+
+void CommandRunner::reap() noexcept {
+    int status = 0;
+    pid_t pid;
+    while (running_ > 0 && (pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        --running_;
+    }
+
+    launch_queued();
+}
+
+void CommandRunner::wait_all() noexcept {
+    int status = 0;
+    while (running_ > 0 || !queue_.empty()) {
+        launch_queued();
+        if (running_ == 0) {
+            break;
+        }
+        if (waitpid(-1, &status, 0) > 0) {
+            --running_;
+        } else if (errno != EINTR) {
+            running_ = 0;
+        }
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <vector>
+#include <deque>
+#include <cstddef>
+#include <cstdint>
+#include <signal.h>
+#include <sys/types.h>
+#include "metrics.hpp"
+
+// A watch command parsed once at add_watch time. Commands without shell
+// metacharacters are split into argv and exec'd directly, with "$FILE" and
+// "$EVENTS" substituted in each argument; everything else goes through
+// /bin/sh -c unchanged, and the shell expands both from the environment,
+// so a file name is never parsed as script.
+class CommandTemplate final {
+public:
+    CommandTemplate() = default;
+    explicit CommandTemplate(std::string_view command) noexcept;
+
+    [[nodiscard]] bool uses_shell() const noexcept { return shell_; }
+    [[nodiscard]] const std::string& program() const noexcept { return program_; }
+    [[nodiscard]] const std::string& source() const noexcept { return source_; }
+
+    void expand(std::string_view file, std::string_view events, std::vector<std::string>& argv) const noexcept;
+
+private:
+    static bool needs_shell(std::string_view command) noexcept;
+    static std::string resolve_program(std::string_view name) noexcept;
+    static void substitute(std::string_view in, std::string_view file, std::string_view events,
+                           std::string& out) noexcept;
+
+    std::string source_;
+    std::string program_;
+    std::vector<std::string> args_;
+    bool shell_ = true;
+};
+
+// Spawns commands with posix_spawn (vfork on API levels without it), caps
+// the number of live children and queues the overflow. SIGCHLD is blocked
+// for the owner's signalfd, which should call reap() whenever it fires.
+// A submit() given the time its event was seen records how long the
+// command took to start, queueing included, in spawn_latency().
+class CommandRunner final {
+public:
+    static constexpr std::size_t kDefaultMaxConcurrency = 4;
+    static constexpr std::size_t kDefaultMaxQueued = 256;
+
+    CommandRunner() noexcept;
+    ~CommandRunner() noexcept;
+
+    CommandRunner(const CommandRunner&) = delete;
+    CommandRunner& operator=(const CommandRunner&) = delete;
+    CommandRunner(CommandRunner&&) = delete;
+    CommandRunner& operator=(CommandRunner&&) = delete;
+
+    // `events` is what happened to `file`, as format_event_mask() writes it.
+    void submit(const CommandTemplate& command, std::string_view file, std::string_view events = {},
+                std::chrono::steady_clock::time_point since = {}) noexcept;
+    void reap() noexcept;
+    void wait_all() noexcept;
+
+    void set_max_concurrency(std::size_t limit) noexcept { max_concurrency_ = limit ? limit : 1; }
+    void set_max_queued(std::size_t limit) noexcept { max_queued_ = limit; }
+
+    [[nodiscard]] std::size_t running() const noexcept { return running_; }
+    [[nodiscard]] std::size_t queued() const noexcept { return queue_.size(); }
+    [[nodiscard]] std::uint64_t spawned() const noexcept { return spawned_; }
+    [[nodiscard]] std::uint64_t dropped() const noexcept { return dropped_; }
+    [[nodiscard]] std::uint64_t failed() const noexcept { return failed_; }
+    [[nodiscard]] const LatencyHistogram& spawn_latency() const noexcept { return latency_; }
+
+private:
+    struct Job {
+        std::string program;
+        std::vector<std::string> argv;
+        std::string file_env;     // "FILE=<path>"
+        std::string events_env;   // "EVENTS=<list>"
+        std::chrono::steady_clock::time_point since;
+    };
+
+    bool spawn(const Job& job) noexcept;
+    void launch_queued() noexcept;
+
+    std::deque<Job> queue_;
+    std::vector<char*> argv_ptrs_;
+    std::vector<char*> env_ptrs_;
+    sigset_t saved_mask_;
+    std::size_t running_ = 0;
+    std::size_t max_concurrency_ = kDefaultMaxConcurrency;
+    std::size_t max_queued_ = kDefaultMaxQueued;
+    std::uint64_t spawned_ = 0;
+    std::uint64_t dropped_ = 0;
+    std::uint64_t failed_ = 0;
+    LatencyHistogram latency_;
+};
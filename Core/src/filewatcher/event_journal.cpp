@@ -0,0 +1,408 @@
+#include "event_journal.hpp"
+#include "xxhash64.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kMagic[8] = {'A', 'F', 'W', 'J', 'R', 'N', 'L', '\0'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::size_t kPageSize = 4096;
+
+struct JournalHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size;
+    std::uint64_t tail;        // end of the last complete record
+    std::uint64_t reserved[5];
+};
+static_assert(sizeof(JournalHeader) == 64);
+
+// Every record: u32 size (whole record), u32 checksum (of everything after
+// it), u8 kind, u8 0, u16 path length, u32 inotify mask, the directory path.
+// Then, by kind:
+//   ENTRY      u16 name length, name, u8 present, [stat]
+//   DIRECTORY  stat of the directory, u32 count, count x (u16 length, name, stat)
+//   FORGET     nothing
+// A stat is inode, size, mtime, ctime, content hash (8 bytes each) and is_dir.
+constexpr std::size_t kRecordHeaderSize = 16;
+
+enum class RecordKind : std::uint8_t { ENTRY = 1, DIRECTORY = 2, FORGET = 3 };
+
+template <typename T>
+void put(std::string& out, T value) noexcept {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void put_stat(std::string& out, const FileWatcherAPI::StatSnapshot& stat) noexcept {
+    put(out, stat.inode);
+    put(out, stat.size);
+    put(out, stat.mtime_ns);
+    put(out, stat.ctime_ns);
+    put(out, stat.content_hash);
+    put(out, static_cast<std::uint8_t>(stat.is_dir));
+}
+
+void put_name(std::string& out, std::string_view name) noexcept {
+    put(out, static_cast<std::uint16_t>(name.size()));
+    out.append(name);
+}
+
+std::size_t begin_record(std::string& out, RecordKind kind, std::string_view dir, std::uint32_t mask) noexcept {
+    const std::size_t start = out.size();
+    put(out, std::uint32_t{0});
+    put(out, std::uint32_t{0});
+    put(out, static_cast<std::uint8_t>(kind));
+    put(out, std::uint8_t{0});
+    put(out, static_cast<std::uint16_t>(dir.size()));
+    put(out, mask);
+    out.append(dir);
+    return start;
+}
+
+void end_record(std::string& out, std::size_t start) noexcept {
+    const auto size = static_cast<std::uint32_t>(out.size() - start);
+    const auto checksum = static_cast<std::uint32_t>(
+        FileWatcherAPI::XXHash64::hash(out.data() + start + 8, size - 8));
+    std::memcpy(out.data() + start, &size, sizeof(size));
+    std::memcpy(out.data() + start + 4, &checksum, sizeof(checksum));
+}
+
+void put_directory(std::string& out, std::string_view dir, const FileWatcherAPI::DirectorySnapshot& snapshot) noexcept {
+    const std::size_t start = begin_record(out, RecordKind::DIRECTORY, dir, 0);
+    put_stat(out, snapshot.self());
+    put(out, static_cast<std::uint32_t>(snapshot.entry_count()));
+    snapshot.for_each_entry([&](std::string_view name, const FileWatcherAPI::StatSnapshot& stat) {
+        put_name(out, name);
+        put_stat(out, stat);
+    });
+    end_record(out, start);
+}
+
+// Bounds-checked reads over one record; any overrun makes ok() false.
+class Reader {
+public:
+    Reader(const char* data, std::size_t size) noexcept : at_(data), end_(data + size) {}
+
+    template <typename T>
+    T get() noexcept {
+        T value{};
+        if (static_cast<std::size_t>(end_ - at_) < sizeof(T)) {
+            ok_ = false;
+            return value;
+        }
+        std::memcpy(&value, at_, sizeof(T));
+        at_ += sizeof(T);
+        return value;
+    }
+
+    std::string_view bytes(std::size_t size) noexcept {
+        if (static_cast<std::size_t>(end_ - at_) < size) {
+            ok_ = false;
+            return {};
+        }
+        const std::string_view out{at_, size};
+        at_ += size;
+        return out;
+    }
+
+    std::string_view name() noexcept { return bytes(get<std::uint16_t>()); }
+
+    FileWatcherAPI::StatSnapshot stat() noexcept {
+        FileWatcherAPI::StatSnapshot out;
+        out.inode = get<std::uint64_t>();
+        out.size = get<std::uint64_t>();
+        out.mtime_ns = get<std::int64_t>();
+        out.ctime_ns = get<std::int64_t>();
+        out.content_hash = get<std::uint64_t>();
+        out.is_dir = get<std::uint8_t>() != 0;
+        return out;
+    }
+
+    [[nodiscard]] bool ok() const noexcept { return ok_; }
+
+private:
+    const char* at_;
+    const char* end_;
+    bool ok_ = true;
+};
+
+bool write_all(int fd, const char* data, std::size_t size) noexcept {
+    while (size > 0) {
+        const ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+} // namespace
+
+bool EventJournal::open(std::string_view path, std::string& error) noexcept {
+    close();
+    path_ = path;
+
+    const int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return true;
+        }
+        error = path_ + ": " + std::strerror(errno);
+        path_.clear();
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        error = path_ + ": " + std::strerror(errno);
+        ::close(fd);
+        path_.clear();
+        return false;
+    }
+    const auto size = static_cast<std::size_t>(st.st_size);
+    if (size == 0) {
+        ::close(fd);
+        return true;
+    }
+
+    void* mapping = size >= sizeof(JournalHeader) ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    JournalHeader header;
+    if (mapping != MAP_FAILED) {
+        std::memcpy(&header, mapping, sizeof(header));
+    }
+    if (mapping == MAP_FAILED || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        error = path_ + ": not a filewatcher journal";
+        if (mapping != MAP_FAILED) {
+            munmap(mapping, size);
+        }
+        path_.clear();
+        return false;
+    }
+    if (header.version == kVersion && header.header_size == sizeof(JournalHeader)) {
+        const auto tail = static_cast<std::size_t>(std::min<std::uint64_t>(header.tail, size));
+        if (tail > sizeof(JournalHeader)) {
+            replay(static_cast<const char*>(mapping) + sizeof(JournalHeader), tail - sizeof(JournalHeader));
+        }
+    }
+    munmap(mapping, size);
+    return true;
+}
+
+void EventJournal::close() noexcept {
+    unmap();
+    saved_.clear();
+    path_.clear();
+}
+
+void EventJournal::unmap() noexcept {
+    if (map_) {
+        munmap(map_, mapped_);
+        map_ = nullptr;
+        mapped_ = 0;
+    }
+    appended_ = 0;
+}
+
+void EventJournal::replay(const char* data, std::size_t size) noexcept {
+    std::size_t offset = 0;
+    while (size - offset >= kRecordHeaderSize) {
+        std::uint32_t length;
+        std::uint32_t checksum;
+        std::memcpy(&length, data + offset, sizeof(length));
+        std::memcpy(&checksum, data + offset + 4, sizeof(checksum));
+        if (length < kRecordHeaderSize || length > size - offset ||
+            static_cast<std::uint32_t>(FileWatcherAPI::XXHash64::hash(data + offset + 8, length - 8)) != checksum ||
+            !replay_record(data + offset, length)) {
+            return;
+        }
+        offset += length;
+    }
+}
+
+bool EventJournal::replay_record(const char* record, std::size_t size) noexcept {
+    Reader in(record + 8, size - 8);
+    const auto kind = static_cast<RecordKind>(in.get<std::uint8_t>());
+    (void)in.get<std::uint8_t>();
+    const auto dir_length = in.get<std::uint16_t>();
+    (void)in.get<std::uint32_t>();   // the event's mask, for whoever reads the file by hand
+    const std::string_view dir = in.bytes(dir_length);
+    if (!in.ok()) {
+        return false;
+    }
+
+    switch (kind) {
+        case RecordKind::ENTRY: {
+            const std::string_view name = in.name();
+            const bool present = in.get<std::uint8_t>() != 0;
+            const FileWatcherAPI::StatSnapshot stat = present ? in.stat() : FileWatcherAPI::StatSnapshot{};
+            if (!in.ok()) {
+                return false;
+            }
+            // Only directories watched since the checkpoint lack a DIRECTORY
+            // record, and those are written before any of their events.
+            const auto it = saved_.find(dir);
+            if (it == saved_.end()) {
+                return true;
+            }
+            if (name.empty()) {
+                if (present) {
+                    it->second.set_self(stat);
+                }
+            } else {
+                it->second.set_entry(name, present ? &stat : nullptr);
+            }
+            return true;
+        }
+        case RecordKind::DIRECTORY: {
+            FileWatcherAPI::DirectorySnapshot snapshot;
+            snapshot.reset(in.stat());
+            const auto count = in.get<std::uint32_t>();
+            for (std::uint32_t i = 0; i < count && in.ok(); ++i) {
+                const std::string_view name = in.name();
+                const FileWatcherAPI::StatSnapshot stat = in.stat();
+                snapshot.set_entry(name, &stat);
+            }
+            if (!in.ok()) {
+                return false;
+            }
+            if (const auto it = saved_.find(dir); it != saved_.end()) {
+                it->second = std::move(snapshot);
+            } else {
+                saved_.emplace(std::string{dir}, std::move(snapshot));
+            }
+            return true;
+        }
+        case RecordKind::FORGET:
+            if (const auto it = saved_.find(dir); it != saved_.end()) {
+                saved_.erase(it);
+            }
+            return true;
+    }
+    return false;
+}
+
+bool EventJournal::take(const std::string& dir, FileWatcherAPI::DirectorySnapshot& out) noexcept {
+    const auto it = saved_.find(dir);
+    if (it == saved_.end()) {
+        return false;
+    }
+    out = std::move(it->second);
+    saved_.erase(it);
+    return true;
+}
+
+bool EventJournal::checkpoint(
+    const std::vector<std::pair<std::string, const FileWatcherAPI::DirectorySnapshot*>>& dirs,
+    std::string& error) noexcept {
+    if (path_.empty()) {
+        error = "no journal open";
+        return false;
+    }
+
+    std::string buffer(sizeof(JournalHeader), '\0');
+    for (const auto& [dir, snapshot] : dirs) {
+        put_directory(buffer, dir, *snapshot);
+    }
+    JournalHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.header_size = sizeof(JournalHeader);
+    header.tail = buffer.size();
+    std::memcpy(buffer.data(), &header, sizeof(header));
+
+    // The log space past the base stays a hole until events fill it.
+    const std::size_t capacity = (buffer.size() + log_space_ + kPageSize - 1) / kPageSize * kPageSize;
+    const std::string temp = path_ + ".tmp";
+    const int fd = ::open(temp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        error = temp + ": " + std::strerror(errno);
+        unmap();
+        return false;
+    }
+    void* mapping = MAP_FAILED;
+    if (write_all(fd, buffer.data(), buffer.size()) && ftruncate(fd, static_cast<off_t>(capacity)) == 0 &&
+        fdatasync(fd) == 0) {
+        mapping = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (mapping == MAP_FAILED) {
+        error = temp + ": " + std::strerror(errno);
+        ::close(fd);
+        unlink(temp.c_str());
+        unmap();
+        return false;
+    }
+    ::close(fd);
+    if (rename(temp.c_str(), path_.c_str()) != 0) {
+        error = path_ + ": " + std::strerror(errno);
+        munmap(mapping, capacity);
+        unlink(temp.c_str());
+        unmap();
+        return false;
+    }
+
+    unmap();
+    map_ = static_cast<char*>(mapping);
+    mapped_ = capacity;
+    return true;
+}
+
+bool EventJournal::append() noexcept {
+    JournalHeader* header = reinterpret_cast<JournalHeader*>(map_);
+    const auto tail = static_cast<std::size_t>(header->tail);
+    if (record_.size() > mapped_ - tail) {
+        return false;
+    }
+    std::memcpy(map_ + tail, record_.data(), record_.size());
+    // The page cache outlives a crashed process; keep the compiler from
+    // publishing the tail before the record it covers.
+    std::atomic_signal_fence(std::memory_order_release);
+    header->tail = tail + record_.size();
+    ++appended_;
+    return true;
+}
+
+bool EventJournal::record_entry(std::string_view dir, std::string_view name, std::uint32_t mask,
+                                const FileWatcherAPI::StatSnapshot* stat) noexcept {
+    if (!map_) {
+        return true;
+    }
+    record_.clear();
+    const std::size_t start = begin_record(record_, RecordKind::ENTRY, dir, mask);
+    put_name(record_, name);
+    put(record_, static_cast<std::uint8_t>(stat != nullptr));
+    if (stat) {
+        put_stat(record_, *stat);
+    }
+    end_record(record_, start);
+    return append();
+}
+
+bool EventJournal::record_directory(std::string_view dir, const FileWatcherAPI::DirectorySnapshot& snapshot) noexcept {
+    if (!map_) {
+        return true;
+    }
+    record_.clear();
+    put_directory(record_, dir, snapshot);
+    return append();
+}
+
+bool EventJournal::record_forget(std::string_view dir) noexcept {
+    if (!map_) {
+        return true;
+    }
+    record_.clear();
+    end_record(record_, begin_record(record_, RecordKind::FORGET, dir, 0));
+    return append();
+}
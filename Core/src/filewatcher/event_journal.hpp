@@ -0,0 +1,92 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "stat_snapshot.hpp"
+
+// What the watcher knew about its directories, kept on disk so a restarted
+// process can report what changed while it was down.
+//
+// The file is a header followed by records. A checkpoint rewrites it with
+// one DIRECTORY record per watched directory (its DirectorySnapshot); after
+// that, the records for each event, each new watch and each dropped watch
+// are appended in place through a shared mapping, so keeping the journal
+// costs a memcpy per event and no syscall. Appending only stops when the
+// log space after the checkpoint is full, which makes a new checkpoint due.
+//
+// open() replays checkpoint and log into one snapshot per directory path:
+// the state as of the last event the previous run handled. Diffing that
+// against a fresh capture gives exactly the changes nobody saw. Each
+// record carries a checksum, and replay stops at the first one that does
+// not match (a write torn by power loss); the header's tail is only moved
+// after a record is complete.
+class EventJournal final {
+public:
+    static constexpr std::size_t kDefaultLogSpace = 512 * 1024;
+
+    EventJournal() = default;
+    ~EventJournal() noexcept { close(); }
+
+    EventJournal(const EventJournal&) = delete;
+    EventJournal& operator=(const EventJournal&) = delete;
+
+    // Loads the state a previous run left in `path`. A missing file, or one
+    // from another journal version, is a cold start with nothing saved; a
+    // file that is not a journal at all is an error and is left alone.
+    // Nothing is appended until the first checkpoint().
+    bool open(std::string_view path, std::string& error) noexcept;
+    void close() noexcept;
+
+    [[nodiscard]] bool is_open() const noexcept { return !path_.empty(); }
+    [[nodiscard]] const std::string& path() const noexcept { return path_; }
+    // False before the first checkpoint and after one that failed; records
+    // are dropped until the next one succeeds.
+    [[nodiscard]] bool writable() const noexcept { return map_ != nullptr; }
+    void set_log_space(std::size_t bytes) noexcept { log_space_ = bytes; }
+
+    // The saved snapshot of the directory at `dir`, moved out. False if
+    // the previous run did not watch it.
+    bool take(const std::string& dir, FileWatcherAPI::DirectorySnapshot& out) noexcept;
+    [[nodiscard]] std::size_t saved_count() const noexcept { return saved_.size(); }
+    void discard_saved() noexcept { saved_.clear(); }
+
+    // Atomically replaces the file with `dirs` as its new base (written
+    // beside it and renamed over) and maps it for appending.
+    bool checkpoint(const std::vector<std::pair<std::string, const FileWatcherAPI::DirectorySnapshot*>>& dirs,
+                    std::string& error) noexcept;
+
+    // Appends after the last checkpoint. `stat` is the entry's state after
+    // the event, null if it is gone; an empty name is the watched path
+    // itself. False once the log space is full: write a checkpoint.
+    // Before the first checkpoint these do nothing and succeed.
+    bool record_entry(std::string_view dir, std::string_view name, std::uint32_t mask,
+                      const FileWatcherAPI::StatSnapshot* stat) noexcept;
+    bool record_directory(std::string_view dir, const FileWatcherAPI::DirectorySnapshot& snapshot) noexcept;
+    bool record_forget(std::string_view dir) noexcept;
+
+    // Records appended since the last checkpoint.
+    [[nodiscard]] std::size_t appended() const noexcept { return appended_; }
+
+private:
+    void unmap() noexcept;
+    bool append() noexcept;
+    void replay(const char* data, std::size_t size) noexcept;
+    bool replay_record(const char* record, std::size_t size) noexcept;
+
+    std::string path_;
+    std::size_t log_space_ = kDefaultLogSpace;
+    char* map_ = nullptr;
+    std::size_t mapped_ = 0;
+    std::size_t appended_ = 0;
+    std::string record_;   // append scratch
+
+    struct NameHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view name) const noexcept { return std::hash<std::string_view>{}(name); }
+    };
+    std::unordered_map<std::string, FileWatcherAPI::DirectorySnapshot, NameHash, std::equal_to<>> saved_;
+};
@@ -1,80 +1,183 @@
 #include "watcher_core.hpp"
+#include "watch_broker.hpp"
 #include <sys/inotify.h>
-#include <signal.h>
+#include <cerrno>
 #include <cstring>
 #include <cstdio>
 #include <cstdlib>
 #include <string_view>
 #include <memory>
 #include <atomic>
-#include <format>
-
-static std::unique_ptr<WatcherCore> g_watcher;
-
-void signal_handler(int sig) noexcept {
-    (void)sig;
-    if (g_watcher) {
-        g_watcher->stop();
-    }
-}
 
 void print_usage(std::string_view prog_name) noexcept {
     std::printf("Usage: %s [options] <path> <command>\n", prog_name.data());
+    std::printf("       %s [options] -c <rules.conf>\n", prog_name.data());
     std::printf("Options:\n");
+    std::printf("  -c <file>    Serve every [rule] in a rules file from one process;\n");
+    std::printf("               SIGHUP reloads it and re-watches only changed rules\n");
     std::printf("  -e <events>  Event mask (default: modify,create,delete)\n");
-    std::printf("               Available: modify,create,delete,move,attrib,access\n");
-    std::printf("  -p <seconds> Enable periodic check every N seconds (0 to disable)\n");
+    std::printf("               Available:");
+    const char* separator = " ";
+    for (const auto& info : FileWatcherAPI::kEventTypes) {
+        std::printf("%s%.*s", separator, static_cast<int>(info.name.size()), info.name.data());
+        separator = ",";
+    }
+    std::printf("\n               Also: ");
+    separator = "";
+    for (const auto& alias : FileWatcherAPI::kEventAliases) {
+        std::printf("%s%.*s", separator, static_cast<int>(alias.name.size()), alias.name.data());
+        separator = ",";
+    }
+    std::printf("\n");
+    std::printf("  -r           Watch directories recursively, following new subdirectories\n");
+    std::printf("  --depth <n>  Maximum recursion depth for -r (default: unlimited)\n");
+    std::printf("  -p <seconds> Also poll for changes every N seconds (0 to disable)\n");
+    std::printf("  -d <ms>      Debounce: run once per file after <ms> of quiet (0 to disable);\n");
+    std::printf("               the default for rules without their own debounce\n");
+    std::printf("               $EVENTS then lists every event merged, e.g. modify,close_write\n");
+    std::printf("  --backend <name> inotify (default) or fanotify: one mark per filesystem,\n");
+    std::printf("               no per-directory watch limit; needs root and Linux 5.9+;\n");
+    std::printf("               or broker[:<name>]: share the watches of a running --broker\n");
+    std::printf("  --broker [<name>] Run the watch broker on @<name> (default: %.*s): one\n",
+                static_cast<int>(FileWatcherAPI::kDefaultBroker.size()), FileWatcherAPI::kDefaultBroker.data());
+    std::printf("               inotify instance for every --backend broker subscriber\n");
+    std::printf("  --buffer <bytes> Event read buffer size (default: %zu)\n",
+                FileWatcherAPI::EventBuffer::kDefaultSize);
+    std::printf("  --hash       With -p, also fingerprint first/last page of files\n");
     std::printf("  -o           One-shot mode: exit after first event detection\n");
+    std::printf("  --journal <path> Keep what the watched trees looked like in <path>; on the next\n");
+    std::printf("               start, run commands for whatever changed while stopped\n");
+    std::printf("  --stats      Print counters and latency percentiles on SIGUSR1 and at exit\n");
+    std::printf("  --stats-socket <name> Serve Prometheus text on the abstract socket @<name>\n");
+    std::printf("  --stats-file <path>   Keep Prometheus text in <path>, rewritten at most every %llds\n",
+                static_cast<long long>(WatcherCore::kStatsFileInterval.count()));
+    std::printf("  --stats-query <name>  Print the stats of the watcher serving @<name> and exit\n");
+    std::printf("  -j <count>   Maximum concurrently running commands (default: %zu)\n",
+                CommandRunner::kDefaultMaxConcurrency);
     std::printf("  -h           Show this help\n");
     std::printf("\nExamples:\n");
     std::printf("  %s /tmp/test.txt \"echo File changed: $FILE\"\n", prog_name.data());
     std::printf("  %s -e create,delete /tmp/ \"logger_client File event: $FILE\"\n", prog_name.data());
     std::printf("  %s -p 30 /tmp/test.txt \"echo Periodic check: $FILE\"\n", prog_name.data());
+    std::printf("  %s -r --depth 3 /vendor/etc \"echo Changed: $FILE\"\n", prog_name.data());
+    std::printf("  %s --backend fanotify -r /vendor \"echo Changed: $FILE\"\n", prog_name.data());
+    std::printf("  %s --broker &  %s --backend broker -c rules.conf\n", prog_name.data(), prog_name.data());
+    std::printf("  %s -d 200 /vendor/etc/dolby \"echo Settled: $FILE\"\n", prog_name.data());
     std::printf("  %s -o -p 10 /tmp/test.txt \"echo One-time check: $FILE\"\n", prog_name.data());
-}
-
-constexpr std::uint32_t parse_events(std::string_view events_str) noexcept {
-    std::uint32_t events = 0;
-    
-    if (events_str.find("modify") != std::string_view::npos) {
-        events |= IN_MODIFY;
-    }
-    if (events_str.find("create") != std::string_view::npos) {
-        events |= IN_CREATE;
-    }
-    if (events_str.find("delete") != std::string_view::npos) {
-        events |= IN_DELETE;
-    }
-    if (events_str.find("move") != std::string_view::npos) {
-        events |= IN_MOVE;
-    }
-    if (events_str.find("attrib") != std::string_view::npos) {
-        events |= IN_ATTRIB;
-    }
-    if (events_str.find("access") != std::string_view::npos) {
-        events |= IN_ACCESS;
-    }
-    
-    return events ? events : (IN_MODIFY | IN_CREATE | IN_DELETE);
+    std::printf("  %s -j 2 -c /data/adb/modules/aurora/rules.conf\n", prog_name.data());
+    std::printf("  %s --stats-socket aurora_filewatcher -c rules.conf\n", prog_name.data());
+    std::printf("  %s --journal /data/adb/aurora/filewatcher.journal -c rules.conf\n", prog_name.data());
+    std::printf("\nRules file:\n");
+    std::printf("  [dolby]\n");
+    std::printf("  path = /vendor/etc/dolby\n");
+    std::printf("  events = modify,create\n");
+    std::printf("  include = *.xml\n");
+    std::printf("  exclude = .* *.tmp\n");
+    std::printf("  command = echo Changed: $FILE\n");
+    std::printf("  debounce = 200\n");
+    std::printf("  recursive = yes\n");
+    std::printf("  depth = 3\n");
 }
 
 int main(int argc, char* argv[]) {
     std::string_view path;
     std::string_view command;
-    std::uint32_t events = IN_MODIFY | IN_CREATE | IN_DELETE;
+    std::string_view rules_file;
+    std::uint32_t events = kDefaultEvents;
     int periodic_interval = 0;
     bool one_shot = false;
+    int max_concurrency = 0;
+    int debounce_ms = 0;
+    bool recursive = false;
+    int max_depth = -1;
+    long read_buffer = 0;
+    bool hash_content = false;
+    bool stats = false;
+    std::string_view stats_socket;
+    std::string_view stats_file;
+    std::string_view journal;
+    auto backend = FileWatcherAPI::BackendKind::INOTIFY;
+    std::string_view broker_name = FileWatcherAPI::kDefaultBroker;
+    bool run_broker = false;
     
     for (int i = 1; i < argc; i++) {
         const std::string_view arg{argv[i]};
         if (arg == "-e" && i + 1 < argc) {
-            events = parse_events(argv[++i]);
+            std::string_view bad;
+            if (!FileWatcherAPI::parse_event_mask(argv[++i], events, &bad)) {
+                std::fprintf(stderr, "Unknown event '%.*s' in -e %s (see -h for the list)\n",
+                             static_cast<int>(bad.size()), bad.data(), argv[i]);
+                return 1;
+            }
+        } else if (arg == "-c" && i + 1 < argc) {
+            rules_file = argv[++i];
         } else if (arg == "-p" && i + 1 < argc) {
             periodic_interval = std::atoi(argv[++i]);
             if (periodic_interval < 0) {
                 std::fprintf(stderr, "Invalid periodic interval: %d\n", periodic_interval);
                 return 1;
             }
+        } else if (arg == "-d" && i + 1 < argc) {
+            debounce_ms = std::atoi(argv[++i]);
+            if (debounce_ms < 0) {
+                std::fprintf(stderr, "Invalid debounce window: %d\n", debounce_ms);
+                return 1;
+            }
+        } else if (arg == "-j" && i + 1 < argc) {
+            max_concurrency = std::atoi(argv[++i]);
+            if (max_concurrency <= 0) {
+                std::fprintf(stderr, "Invalid concurrency limit: %d\n", max_concurrency);
+                return 1;
+            }
+        } else if (arg == "-r" || arg == "--recursive") {
+            recursive = true;
+        } else if (arg == "--depth" && i + 1 < argc) {
+            max_depth = std::atoi(argv[++i]);
+            if (max_depth < 0) {
+                std::fprintf(stderr, "Invalid recursion depth: %d\n", max_depth);
+                return 1;
+            }
+        } else if (arg == "--buffer" && i + 1 < argc) {
+            read_buffer = std::atol(argv[++i]);
+            if (read_buffer <= 0) {
+                std::fprintf(stderr, "Invalid buffer size: %ld\n", read_buffer);
+                return 1;
+            }
+        } else if (arg == "--backend" && i + 1 < argc) {
+            // broker:<name> picks the broker's socket.
+            std::string_view name{argv[++i]};
+            if (const auto colon = name.find(':'); colon != std::string_view::npos) {
+                broker_name = name.substr(colon + 1);
+                name = name.substr(0, colon);
+            }
+            if (!FileWatcherAPI::parse_backend(name, backend) ||
+                (backend != FileWatcherAPI::BackendKind::BROKER && name.size() != std::strlen(argv[i]))) {
+                std::fprintf(stderr, "Unknown backend: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (arg == "--broker") {
+            run_broker = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                broker_name = argv[++i];
+            }
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (arg == "--stats-socket" && i + 1 < argc) {
+            stats_socket = argv[++i];
+        } else if (arg == "--stats-file" && i + 1 < argc) {
+            stats_file = argv[++i];
+        } else if (arg == "--stats-query" && i + 1 < argc) {
+            std::string text;
+            if (!StatsEndpoint::query(argv[++i], text)) {
+                std::fprintf(stderr, "No stats at @%s: %s\n", argv[i], std::strerror(errno));
+                return 1;
+            }
+            std::fwrite(text.data(), 1, text.size(), stdout);
+            return 0;
+        } else if (arg == "--journal" && i + 1 < argc) {
+            journal = argv[++i];
+        } else if (arg == "--hash") {
+            hash_content = true;
         } else if (arg == "-o") {
             one_shot = true;
         } else if (arg == "-h") {
@@ -87,36 +190,101 @@ int main(int argc, char* argv[]) {
         }
     }
     
-    if (path.empty() || command.empty()) {
+    if (run_broker) {
+        // SIGTERM/SIGINT are consumed by the broker's signalfd.
+        WatchBroker broker;
+        std::string error;
+        if (read_buffer > 0) {
+            broker.set_read_buffer_size(static_cast<size_t>(read_buffer));
+        }
+        if (!broker.listen(broker_name, WatchBroker::kDefaultRingSize, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        std::printf("Watch broker listening on @%.*s\n", static_cast<int>(broker_name.size()), broker_name.data());
+        broker.run();
+        std::printf("Watch broker stopped\n");
+        return 0;
+    }
+    
+    std::vector<WatchRule> rules;
+    if (!rules_file.empty()) {
+        std::string error;
+        if (!load_rules(rules_file.data(), rules, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+    } else if (path.empty() || command.empty()) {
         print_usage(argv[0]);
         return 1;
     }
     
-    signal(SIGTERM, signal_handler);
-    signal(SIGINT, signal_handler);
-    
-    g_watcher = std::make_unique<WatcherCore>();
+    // SIGTERM/SIGINT are consumed by the watcher's signalfd.
+    const auto watcher = std::make_unique<WatcherCore>(backend, broker_name);
     
     if (periodic_interval > 0) {
-        g_watcher->set_periodic_check(periodic_interval);
+        watcher->set_periodic_check(periodic_interval);
+    }
+    if (hash_content) {
+        watcher->set_content_hash(true);
     }
     if (one_shot) {
-        g_watcher->set_one_shot(true);
+        watcher->set_one_shot(true);
     }
-    
-    if (!g_watcher->add_watch(path, command, events)) {
-        std::fprintf(stderr, "Failed to add watch for: %s\n", path.data());
+    if (debounce_ms > 0) {
+        watcher->set_debounce(debounce_ms);
+    }
+    if (read_buffer > 0) {
+        watcher->set_read_buffer_size(static_cast<size_t>(read_buffer));
+    }
+    if (max_concurrency > 0) {
+        watcher->set_max_concurrency(max_concurrency);
+    }
+    if (stats) {
+        watcher->enable_stats_signal();
+    }
+    if (!stats_socket.empty() && !watcher->set_stats_socket(stats_socket)) {
+        std::fprintf(stderr, "Failed to serve stats on @%s: %s\n", stats_socket.data(), std::strerror(errno));
         return 1;
     }
+    if (!stats_file.empty()) {
+        watcher->set_stats_file(stats_file);
+    }
+    if (!journal.empty()) {
+        std::string error;
+        if (!watcher->set_journal(journal, error)) {
+            std::fprintf(stderr, "Cannot use journal: %s\n", error.c_str());
+            return 1;
+        }
+    }
     
-    std::printf("Watching: %s\n", path.data());
-    std::printf("Command: %s\n", command.data());
+    if (!rules_file.empty()) {
+        // Rules that cannot be watched yet are retried on the next SIGHUP.
+        const std::size_t failed = watcher->apply_rules(rules);
+        if (failed == rules.size()) {
+            std::fprintf(stderr, "No rule in %s could be watched (%s backend)\n", rules_file.data(),
+                         FileWatcherAPI::backend_name(backend));
+            return 1;
+        }
+        watcher->set_rules_file(rules_file);
+        std::printf("Watching %zu rules from %s\n", rules.size() - failed, rules_file.data());
+    } else if (!watcher->add_watch(path, command, events, recursive, max_depth)) {
+        std::fprintf(stderr, "Failed to add watch for: %s (%s backend: %s)\n", path.data(),
+                     FileWatcherAPI::backend_name(backend), std::strerror(errno));
+        return 1;
+    } else {
+        std::printf("Watching: %s\n", path.data());
+        std::printf("Command: %s\n", command.data());
+    }
     if (!one_shot) {
         std::printf("Press Ctrl+C to stop\n");
     }
     
-    g_watcher->start();
+    watcher->start();
     
+    if (stats) {
+        watcher->dump_stats(stdout);
+    }
     std::printf("File watcher stopped\n");
     return 0;
 }
\ No newline at end of file
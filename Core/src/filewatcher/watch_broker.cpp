@@ -0,0 +1,415 @@
+#include "watch_broker.hpp"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if __has_include(<linux/memfd.h>)
+#include <linux/memfd.h>
+#endif
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <new>
+
+namespace broker = FileWatcherAPI::broker;
+
+namespace {
+
+// epoll tags: a client's slot number, or one of these.
+constexpr std::uint64_t kInotifyTag = broker::kMaxSubscribers;
+constexpr std::uint64_t kListenTag = broker::kMaxSubscribers + 1;
+constexpr std::uint64_t kSignalTag = broker::kMaxSubscribers + 2;
+constexpr std::uint64_t kWakeTag = broker::kMaxSubscribers + 3;
+
+// Flags that change which inode inotify_add_watch() picks up; the broker
+// keeps the first ones asked for with the watch.
+constexpr std::uint32_t kPathFlags = IN_ONLYDIR | IN_DONT_FOLLOW;
+
+bool add_to_epoll(int epoll_fd, int fd, std::uint32_t events, std::uint64_t tag) noexcept {
+    struct epoll_event ev{};
+    ev.events = events;
+    ev.data.u64 = tag;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+// bionic only wraps memfd_create() from API 30.
+int create_memfd(const char* name) noexcept {
+#if defined(__NR_memfd_create) && defined(MFD_CLOEXEC)
+    return static_cast<int>(syscall(__NR_memfd_create, name, MFD_CLOEXEC | MFD_ALLOW_SEALING));
+#else
+    (void)name;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+std::string system_error(const char* what) {
+    return std::string{what} + ": " + std::strerror(errno);
+}
+
+} // namespace
+
+WatchBroker::WatchBroker() noexcept {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    sigemptyset(&signal_mask_);
+    sigaddset(&signal_mask_, SIGTERM);
+    sigaddset(&signal_mask_, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &signal_mask_, &saved_mask_);
+    signal_fd_ = signalfd(-1, &signal_mask_, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    if (epoll_fd_ >= 0) {
+        for (const auto& [fd, tag] : {std::pair{backend_.fd(), kInotifyTag}, std::pair{signal_fd_, kSignalTag},
+                                      std::pair{wake_fd_, kWakeTag}}) {
+            if (fd >= 0) {
+                add_to_epoll(epoll_fd_, fd, EPOLLIN, tag);
+            }
+        }
+    }
+    request_.resize(sizeof(broker::Request) + PATH_MAX + 1);
+}
+
+WatchBroker::~WatchBroker() noexcept {
+    for (std::uint32_t slot = 0; slot < clients_.size(); ++slot) {
+        if (active_ & (std::uint64_t{1} << slot)) {
+            close(clients_[slot].socket);
+            close(clients_[slot].event_fd);
+        }
+    }
+    for (const int fd : {epoll_fd_, listen_fd_, signal_fd_, wake_fd_, ring_fd_}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    if (map_) {
+        munmap(map_, map_size_);
+    }
+    pthread_sigmask(SIG_SETMASK, &saved_mask_, nullptr);
+}
+
+bool WatchBroker::listen(std::string_view name, std::size_t ring_bytes, std::string& error) noexcept {
+    if (backend_.fd() < 0 || epoll_fd_ < 0) {
+        error = system_error("Cannot create inotify instance");
+        return false;
+    }
+
+    capacity_ = std::bit_ceil(ring_bytes < kMinRingSize ? kMinRingSize : ring_bytes);
+    map_size_ = broker::kRingDataOffset + capacity_;
+    ring_fd_ = create_memfd("aurora_watch_ring");
+    if (ring_fd_ < 0 || ftruncate(ring_fd_, static_cast<off_t>(map_size_)) != 0) {
+        error = system_error("Cannot create event ring");
+        return false;
+    }
+    // Subscribers map it writable (for their cursors); sealing the size
+    // keeps one of them from truncating it under everyone else.
+    fcntl(ring_fd_, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+    void* mapping = mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, ring_fd_, 0);
+    if (mapping == MAP_FAILED) {
+        error = system_error("Cannot map event ring");
+        return false;
+    }
+    map_ = static_cast<char*>(mapping);
+    header_ = new (map_) broker::RingHeader{};
+    header_->magic = broker::kMagic;
+    header_->version = broker::kVersion;
+    header_->capacity = capacity_;
+    data_ = map_ + broker::kRingDataOffset;
+
+    listen_fd_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr;
+    const socklen_t len = broker::abstract_address(name, addr);
+    if (listen_fd_ < 0 || bind(listen_fd_, reinterpret_cast<const struct sockaddr*>(&addr), len) != 0 ||
+        ::listen(listen_fd_, 16) != 0 || !add_to_epoll(epoll_fd_, listen_fd_, EPOLLIN, kListenTag)) {
+        error = system_error(("Cannot listen on @" + std::string{name}).c_str());
+        return false;
+    }
+    return true;
+}
+
+void WatchBroker::run() noexcept {
+    running_.store(true, std::memory_order_relaxed);
+    std::array<struct epoll_event, 16> ready{};
+
+    while (running_.load(std::memory_order_relaxed)) {
+        const int count = epoll_wait(epoll_fd_, ready.data(), static_cast<int>(ready.size()), -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            const std::uint64_t tag = ready[i].data.u64;
+            if (tag < broker::kMaxSubscribers) {
+                serve_client(static_cast<std::uint32_t>(tag));
+            } else if (tag == kInotifyTag) {
+                backend_.drain([this](int wd, std::uint32_t mask, std::string_view name) {
+                    publish(wd, mask, name);
+                });
+            } else if (tag == kListenTag) {
+                accept_clients();
+            } else if (tag == kSignalTag) {
+                signalfd_siginfo info;
+                while (read(signal_fd_, &info, sizeof(info)) == sizeof(info)) {
+                    running_.store(false, std::memory_order_relaxed);
+                }
+            } else {
+                std::uint64_t counter;
+                (void)read(wake_fd_, &counter, sizeof(counter));
+            }
+        }
+        wake_subscribers();
+    }
+    running_.store(false, std::memory_order_relaxed);
+}
+
+void WatchBroker::stop() noexcept {
+    running_.store(false, std::memory_order_relaxed);
+    if (wake_fd_ >= 0) {
+        const std::uint64_t one = 1;
+        (void)write(wake_fd_, &one, sizeof(one));
+    }
+}
+
+void WatchBroker::accept_clients() noexcept {
+    while (true) {
+        const int socket = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (socket < 0) {
+            return;
+        }
+        struct ucred cred{};
+        socklen_t cred_len = sizeof(cred);
+        if (getsockopt(socket, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) != 0 ||
+            (cred.uid != geteuid() && cred.uid != 0) || active_ == ~std::uint64_t{0}) {
+            close(socket);   // the client sees EOF instead of a greeting
+            continue;
+        }
+
+        const auto slot = static_cast<std::uint32_t>(std::countr_zero(~active_));
+        const int event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        broker::RingSlot& ring_slot = header_->slots[slot];
+        ring_slot.cursor.store(head_, std::memory_order_relaxed);
+        ring_slot.state.store(broker::SLOT_ACTIVE, std::memory_order_release);
+        const broker::Hello hello{broker::kMagic, broker::kVersion, slot, 0, map_size_};
+        const int fds[2] = {ring_fd_, event_fd};
+        if (event_fd < 0 || !broker::send_with_fds(socket, &hello, sizeof(hello), fds, 2) ||
+            !add_to_epoll(epoll_fd_, socket, EPOLLIN | EPOLLRDHUP, slot)) {
+            ring_slot.state.store(broker::SLOT_FREE, std::memory_order_release);
+            if (event_fd >= 0) {
+                close(event_fd);
+            }
+            close(socket);
+            continue;
+        }
+        clients_[slot] = Client{socket, event_fd};
+        active_ |= std::uint64_t{1} << slot;
+        ++subscribers_;
+    }
+}
+
+void WatchBroker::serve_client(std::uint32_t slot) noexcept {
+    const int socket = clients_[slot].socket;
+    while (true) {
+        const ssize_t received = recv(socket, request_.data(), request_.size(), MSG_DONTWAIT);
+        if (received < 0 && (errno == EAGAIN || errno == EINTR)) {
+            return;
+        }
+        if (received < static_cast<ssize_t>(sizeof(broker::Request))) {
+            disconnect(slot);   // hung up, or not speaking the protocol
+            return;
+        }
+
+        broker::Request request;
+        std::memcpy(&request, request_.data(), sizeof(request));
+        const std::size_t path_length = static_cast<std::size_t>(received) - sizeof(request);
+        broker::Reply reply{-1, EINVAL};
+        if (request.op == broker::Op::ADD_WATCH) {
+            reply = path_length > PATH_MAX
+                        ? broker::Reply{-1, ENAMETOOLONG}
+                        : add_watch(slot, request.mask, {request_.data() + sizeof(request), path_length});
+        } else if (request.op == broker::Op::REMOVE_WATCH) {
+            reply = remove_watch(slot, request.wd);
+        }
+        // The client waits for each reply before sending again, so this
+        // never finds the socket buffer full.
+        if (send(socket, &reply, sizeof(reply), MSG_DONTWAIT | MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(reply))) {
+            disconnect(slot);
+            return;
+        }
+    }
+}
+
+void WatchBroker::disconnect(std::uint32_t slot) noexcept {
+    for (auto& [wd, watch] : watches_) {
+        unsubscribe(slot, wd, watch);
+    }
+    header_->slots[slot].state.store(broker::SLOT_FREE, std::memory_order_release);
+    close(clients_[slot].socket);   // also leaves the epoll set
+    close(clients_[slot].event_fd);
+    clients_[slot] = Client{};
+    const std::uint64_t bit = std::uint64_t{1} << slot;
+    active_ &= ~bit;
+    pending_ &= ~bit;
+    --subscribers_;
+}
+
+broker::Reply WatchBroker::add_watch(std::uint32_t slot, std::uint32_t mask, std::string_view path) noexcept {
+    if (path.empty() || path.front() != '/') {
+        return {-1, EINVAL};   // relative to whose working directory?
+    }
+    const std::uint32_t events = mask & IN_ALL_EVENTS;
+    const std::string target{path};
+
+    // Adding to the kernel mask first gets us the id without narrowing
+    // anybody else's events in the meantime.
+    const int wd = backend_.add_watch(target.c_str(), events | (mask & kPathFlags) | IN_MASK_ADD);
+    if (wd < 0) {
+        return {-1, errno};
+    }
+    auto [it, inserted] = watches_.try_emplace(wd);
+    Watch& watch = it->second;
+    if (inserted) {
+        watch.path = target;
+        watch.flags = mask & kPathFlags;
+    }
+    watch.kernel_mask |= events;
+
+    auto subscriber = std::find_if(watch.subscribers.begin(), watch.subscribers.end(),
+                                   [slot](const auto& entry) { return entry.first == slot; });
+    if (subscriber == watch.subscribers.end()) {
+        watch.subscribers.emplace_back(slot, events);
+    } else {
+        subscriber->second = (mask & IN_MASK_ADD) ? subscriber->second | events : events;
+    }
+    narrow(wd, watch);
+    return {wd, 0};
+}
+
+broker::Reply WatchBroker::remove_watch(std::uint32_t slot, int wd) noexcept {
+    const auto it = watches_.find(wd);
+    if (it == watches_.end() || !unsubscribe(slot, wd, it->second)) {
+        return {-1, EINVAL};
+    }
+    return {0, 0};
+}
+
+bool WatchBroker::unsubscribe(std::uint32_t slot, int wd, Watch& watch) noexcept {
+    const auto subscriber = std::find_if(watch.subscribers.begin(), watch.subscribers.end(),
+                                         [slot](const auto& entry) { return entry.first == slot; });
+    if (subscriber == watch.subscribers.end()) {
+        return false;
+    }
+    watch.subscribers.erase(subscriber);
+    narrow(wd, watch);
+    return true;
+}
+
+// Brings the kernel mask down to what the subscribers still want. The
+// entry itself goes when the kernel's IN_IGNORED comes back.
+void WatchBroker::narrow(int wd, Watch& watch) noexcept {
+    std::uint32_t wanted = 0;
+    for (const auto& [slot, mask] : watch.subscribers) {
+        wanted |= mask;
+    }
+    if (wanted == watch.kernel_mask) {
+        return;
+    }
+    if (watch.subscribers.empty()) {
+        backend_.remove_watch(wd);
+        watch.kernel_mask = 0;
+        return;
+    }
+    // The path may name another inode by now; that watch is nobody's.
+    const int current = backend_.add_watch(watch.path.c_str(), wanted | watch.flags);
+    if (current == wd) {
+        watch.kernel_mask = wanted;
+    } else if (current >= 0 && !watches_.contains(current)) {
+        backend_.remove_watch(current);
+    }
+}
+
+void WatchBroker::publish(int wd, std::uint32_t mask, std::string_view name) noexcept {
+    if (mask & IN_Q_OVERFLOW) {
+        // Everyone has lost events, whichever watches they were on.
+        append(active_, mask, -1, {});
+        pending_ |= active_;
+        return;
+    }
+    const auto it = watches_.find(wd);
+    if (it == watches_.end()) {
+        return;
+    }
+    std::uint64_t subscribers = 0;
+    for (const auto& [slot, wanted] : it->second.subscribers) {
+        if (mask & (wanted | broker::kAlwaysDelivered)) {
+            subscribers |= std::uint64_t{1} << slot;
+        }
+    }
+    if (subscribers != 0) {
+        append(subscribers, mask, wd, name);
+        pending_ |= subscribers;
+        ++published_;
+    }
+    if (mask & IN_IGNORED) {
+        watches_.erase(it);
+    }
+}
+
+void WatchBroker::append(std::uint64_t subscribers, std::uint32_t mask, int wd, std::string_view name) noexcept {
+    const std::size_t size = (sizeof(broker::RecordHeader) + name.size() + broker::kRecordAlign - 1) &
+                             ~(broker::kRecordAlign - 1);
+    std::size_t offset = static_cast<std::size_t>(head_ & (capacity_ - 1));
+    const std::size_t room = capacity_ - offset;
+    if (room < size) {
+        // Records never wrap; the tail of the ring is skipped.
+        make_room(head_ + room);
+        if (room >= sizeof(broker::RecordHeader)) {
+            const broker::RecordHeader pad{static_cast<std::uint32_t>(room), 0, -1, 0, 0, 0};
+            std::memcpy(data_ + offset, &pad, sizeof(pad));
+        }
+        head_ += room;
+        offset = 0;
+    }
+
+    make_room(head_ + size);
+    const broker::RecordHeader record{static_cast<std::uint32_t>(size), mask, wd,
+                                      static_cast<std::uint16_t>(name.size()), 0, subscribers};
+    char* out = data_ + offset;
+    std::memcpy(out, &record, sizeof(record));
+    std::memcpy(out + sizeof(record), name.data(), name.size());
+    std::memset(out + sizeof(record) + name.size(), 0, size - sizeof(record) - name.size());
+    head_ += size;
+    header_->head.store(head_, std::memory_order_release);
+}
+
+// Marks every subscriber that has not read past `end - capacity` as
+// overrun: writing up to `end` overwrites what it has yet to read.
+void WatchBroker::make_room(std::uint64_t end) noexcept {
+    for (std::uint64_t bits = active_; bits != 0; bits &= bits - 1) {
+        const auto slot = static_cast<std::uint32_t>(std::countr_zero(bits));
+        broker::RingSlot& ring_slot = header_->slots[slot];
+        if (ring_slot.state.load(std::memory_order_acquire) == broker::SLOT_ACTIVE &&
+            end - ring_slot.cursor.load(std::memory_order_acquire) > capacity_) {
+            ring_slot.state.store(broker::SLOT_OVERRUN, std::memory_order_release);
+            pending_ |= std::uint64_t{1} << slot;
+            ++overruns_;
+        }
+    }
+}
+
+void WatchBroker::wake_subscribers() noexcept {
+    const std::uint64_t one = 1;
+    for (std::uint64_t bits = pending_; bits != 0; bits &= bits - 1) {
+        (void)write(clients_[std::countr_zero(bits)].event_fd, &one, sizeof(one));
+    }
+    pending_ = 0;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <signal.h>
+#include "broker_protocol.hpp"
+#include "watch_backend.hpp"
+
+// `filewatcher --broker`: one inotify instance whose watches are shared by
+// every process that subscribes over the abstract socket @<name> (see
+// broker_protocol.hpp for the wire format and BrokerClient for the other
+// end).
+//
+// The watch table is keyed by inotify watch descriptor; each watch keeps
+// the subscribers that asked for it with the mask each one asked for, and
+// the kernel mask is their union. A path watched by ten subscribers is
+// one kernel watch, and a subscriber that narrows its mask only narrows
+// the kernel mask once nobody else needs the difference. The last
+// subscriber to drop a watch (or to disconnect) removes it.
+//
+// Each inotify event is written to the ring once, tagged with the
+// subscribers whose masks match, and each of those gets one eventfd
+// write per batch of events, however many matched.
+class WatchBroker final {
+public:
+    static constexpr std::size_t kDefaultRingSize = 1024 * 1024;
+    static constexpr std::size_t kMinRingSize = 64 * 1024;
+
+    WatchBroker() noexcept;
+    ~WatchBroker() noexcept;
+
+    WatchBroker(const WatchBroker&) = delete;
+    WatchBroker& operator=(const WatchBroker&) = delete;
+
+    // Creates the ring (`ring_bytes`, rounded up to a power of two) and
+    // listens on @name. Only processes of the broker's own user (or root)
+    // may subscribe: they act on the broker's behalf.
+    bool listen(std::string_view name, std::size_t ring_bytes, std::string& error) noexcept;
+
+    // Serves until SIGTERM/SIGINT or stop(). The signals are blocked (for
+    // a signalfd) on the thread that constructs the broker, as WatcherCore
+    // does.
+    void run() noexcept;
+    void stop() noexcept;
+
+    void set_read_buffer_size(std::size_t bytes) noexcept { backend_.set_read_buffer_size(bytes); }
+
+    // For the owner of run(), and for tests once it has returned.
+    [[nodiscard]] std::size_t subscriber_count() const noexcept { return subscribers_; }
+    [[nodiscard]] std::size_t watch_count() const noexcept { return watches_.size(); }
+    [[nodiscard]] std::uint64_t published_count() const noexcept { return published_; }
+    [[nodiscard]] std::uint64_t overrun_count() const noexcept { return overruns_; }
+
+private:
+    struct Watch {
+        std::string path;
+        std::uint32_t kernel_mask = 0;
+        std::uint32_t flags = 0;   // IN_ONLYDIR/IN_DONT_FOLLOW of the first request
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> subscribers;   // slot, mask
+    };
+
+    struct Client {
+        int socket = -1;
+        int event_fd = -1;
+    };
+
+    void accept_clients() noexcept;
+    void serve_client(std::uint32_t slot) noexcept;
+    void disconnect(std::uint32_t slot) noexcept;
+    FileWatcherAPI::broker::Reply add_watch(std::uint32_t slot, std::uint32_t mask, std::string_view path) noexcept;
+    FileWatcherAPI::broker::Reply remove_watch(std::uint32_t slot, int wd) noexcept;
+    bool unsubscribe(std::uint32_t slot, int wd, Watch& watch) noexcept;
+    void narrow(int wd, Watch& watch) noexcept;
+    void publish(int wd, std::uint32_t mask, std::string_view name) noexcept;
+    void append(std::uint64_t subscribers, std::uint32_t mask, int wd, std::string_view name) noexcept;
+    void make_room(std::uint64_t end) noexcept;
+    void wake_subscribers() noexcept;
+
+    FileWatcherAPI::WatchBackend backend_;
+    int epoll_fd_ = -1;
+    int listen_fd_ = -1;
+    int signal_fd_ = -1;
+    int wake_fd_ = -1;
+    int ring_fd_ = -1;
+    sigset_t signal_mask_{};
+    sigset_t saved_mask_{};
+    std::atomic<bool> running_{false};
+
+    char* map_ = nullptr;
+    std::size_t map_size_ = 0;
+    FileWatcherAPI::broker::RingHeader* header_ = nullptr;
+    char* data_ = nullptr;
+    std::uint64_t capacity_ = 0;
+    std::uint64_t head_ = 0;   // bytes ever written, mirrored to header_->head
+
+    std::array<Client, FileWatcherAPI::broker::kMaxSubscribers> clients_{};
+    std::size_t subscribers_ = 0;
+    std::uint64_t active_ = 0;    // slot bits in use
+    std::uint64_t pending_ = 0;   // slot bits to wake after this batch
+    std::unordered_map<int, Watch> watches_;
+    std::uint64_t published_ = 0;
+    std::uint64_t overruns_ = 0;
+    std::vector<char> request_;   // receive scratch
+};
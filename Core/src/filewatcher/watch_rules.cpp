@@ -0,0 +1,270 @@
+#include "watch_rules.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+constexpr std::string_view kBlank = " \t\r\n";
+
+std::string_view trim(std::string_view text) noexcept {
+    const size_t begin = text.find_first_not_of(kBlank);
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    return text.substr(begin, text.find_last_not_of(kBlank) - begin + 1);
+}
+
+bool has_glob_chars(std::string_view text) noexcept {
+    return text.find_first_of("*?[") != std::string_view::npos;
+}
+
+// Matches one character against a '[...]' class starting at pattern[p].
+// Sets `next` past the class; an unterminated '[' is a literal.
+bool match_class(std::string_view pattern, size_t p, char c, size_t& next) noexcept {
+    size_t i = p + 1;
+    const bool negate = i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^');
+    if (negate) {
+        ++i;
+    }
+    bool matched = false;
+    bool first = true;
+    for (; i < pattern.size() && (first || pattern[i] != ']'); ++i, first = false) {
+        if (i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+            matched |= pattern[i] <= c && c <= pattern[i + 2];
+            i += 2;
+        } else {
+            matched |= pattern[i] == c;
+        }
+    }
+    if (i >= pattern.size()) {
+        next = p + 1;
+        return c == '[';
+    }
+    next = i + 1;
+    return matched != negate;
+}
+
+bool parse_int(std::string_view text, int& value) noexcept {
+    if (text.empty() || text.size() > 9) {
+        return false;
+    }
+    int result = 0;
+    for (const char c : text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        result = result * 10 + (c - '0');
+    }
+    value = result;
+    return true;
+}
+
+bool parse_bool(std::string_view text, bool& value) noexcept {
+    if (text == "yes" || text == "true" || text == "1") {
+        value = true;
+    } else if (text == "no" || text == "false" || text == "0") {
+        value = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void split_patterns(std::string_view text, std::vector<std::string>& out) {
+    while (!text.empty()) {
+        const size_t begin = text.find_first_not_of(" \t,");
+        if (begin == std::string_view::npos) {
+            break;
+        }
+        text.remove_prefix(begin);
+        const size_t end = std::min(text.find_first_of(" \t,"), text.size());
+        out.emplace_back(text.substr(0, end));
+        text.remove_prefix(end);
+    }
+}
+
+} // namespace
+
+bool glob_match(std::string_view pattern, std::string_view name) noexcept {
+    // Iterative '*' backtracking: only the most recent star is retried, so
+    // the cost stays O(pattern * name) however many stars there are.
+    size_t p = 0;
+    size_t n = 0;
+    size_t star = std::string_view::npos;
+    size_t resume = 0;
+
+    while (n < name.size()) {
+        if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            resume = n;
+            continue;
+        }
+        size_t next = p + 1;
+        if (p < pattern.size() &&
+            (pattern[p] == '?' || (pattern[p] == '[' ? match_class(pattern, p, name[n], next) : pattern[p] == name[n]))) {
+            p = next;
+            ++n;
+            continue;
+        }
+        if (star == std::string_view::npos) {
+            return false;
+        }
+        p = star + 1;
+        n = ++resume;
+    }
+
+    while (p < pattern.size() && pattern[p] == '*') {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+void FileFilter::PatternSet::add(std::string_view pattern) noexcept {
+    if (pattern == "*") {
+        any_ = true;
+        return;
+    }
+    if (!has_glob_chars(pattern)) {
+        exact_.emplace(pattern);
+    } else if (pattern.back() == '*' && !has_glob_chars(pattern.substr(0, pattern.size() - 1))) {
+        prefixes_.emplace_back(pattern.substr(0, pattern.size() - 1));
+    } else if (pattern.front() == '*' && !has_glob_chars(pattern.substr(1))) {
+        suffixes_.emplace_back(pattern.substr(1));
+    } else {
+        globs_.emplace_back(pattern);
+    }
+}
+
+bool FileFilter::PatternSet::matches(std::string_view name) const noexcept {
+    if (any_ || (!exact_.empty() && exact_.find(name) != exact_.end())) {
+        return true;
+    }
+    for (const auto& prefix : prefixes_) {
+        if (name.starts_with(prefix)) {
+            return true;
+        }
+    }
+    for (const auto& suffix : suffixes_) {
+        if (name.ends_with(suffix)) {
+            return true;
+        }
+    }
+    for (const auto& glob : globs_) {
+        if (glob_match(glob, name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+FileFilter::FileFilter(const std::vector<std::string>& include, const std::vector<std::string>& exclude) noexcept {
+    for (const auto& pattern : include) {
+        if (!pattern.empty()) {
+            include_.add(pattern);
+        }
+    }
+    for (const auto& pattern : exclude) {
+        if (!pattern.empty()) {
+            exclude_.add(pattern);
+        }
+    }
+}
+
+bool load_rules(const char* file, std::vector<WatchRule>& rules, std::string& error) noexcept {
+    FILE* const stream = std::fopen(file, "re");
+    if (!stream) {
+        error = std::string{file} + ": " + std::strerror(errno);
+        return false;
+    }
+
+    std::vector<WatchRule> parsed;
+    char* buffer = nullptr;
+    size_t capacity = 0;
+    int line_number = 0;
+    auto fail = [&](std::string_view message) {
+        error = std::string{file} + ':' + std::to_string(line_number) + ": " + std::string{message};
+        std::free(buffer);
+        std::fclose(stream);
+        return false;
+    };
+
+    while (getline(&buffer, &capacity, stream) >= 0) {
+        ++line_number;
+        const std::string_view line = trim(buffer);
+        if (line.empty() || line.front() == '#' || line.front() == ';') {
+            continue;
+        }
+
+        if (line.front() == '[') {
+            if (line.back() != ']' || trim(line.substr(1, line.size() - 2)).empty()) {
+                return fail("malformed section header");
+            }
+            const std::string_view name = trim(line.substr(1, line.size() - 2));
+            for (const auto& rule : parsed) {
+                if (rule.name == name) {
+                    return fail("duplicate rule [" + std::string{name} + "]");
+                }
+            }
+            parsed.emplace_back().name = name;
+            continue;
+        }
+
+        const size_t equals = line.find('=');
+        if (equals == std::string_view::npos) {
+            return fail("expected key = value");
+        }
+        if (parsed.empty()) {
+            return fail("key outside of a [rule] section");
+        }
+        const std::string_view key = trim(line.substr(0, equals));
+        const std::string_view value = trim(line.substr(equals + 1));
+        WatchRule& rule = parsed.back();
+
+        if (key == "path") {
+            rule.path = value;
+        } else if (key == "command") {
+            rule.command = value;
+        } else if (key == "events") {
+            std::string_view bad;
+            if (!FileWatcherAPI::parse_event_mask(value, rule.events, &bad)) {
+                return fail(bad.empty() ? std::string{"events needs at least one event name"}
+                                        : "unknown event '" + std::string{bad} + "'");
+            }
+        } else if (key == "include") {
+            split_patterns(value, rule.include);
+        } else if (key == "exclude") {
+            split_patterns(value, rule.exclude);
+        } else if (key == "debounce") {
+            if (!parse_int(value, rule.debounce_ms)) {
+                return fail("debounce must be a number of milliseconds");
+            }
+        } else if (key == "recursive") {
+            if (!parse_bool(value, rule.recursive)) {
+                return fail("recursive must be yes or no");
+            }
+        } else if (key == "depth") {
+            if (!parse_int(value, rule.max_depth)) {
+                return fail("depth must be a non-negative number");
+            }
+        } else {
+            return fail("unknown key '" + std::string{key} + "'");
+        }
+    }
+
+    for (const auto& rule : parsed) {
+        if (rule.path.empty() || rule.command.empty()) {
+            error = std::string{file} + ": rule [" + rule.name + "] needs a path and a command";
+            std::free(buffer);
+            std::fclose(stream);
+            return false;
+        }
+    }
+
+    std::free(buffer);
+    std::fclose(stream);
+    rules = std::move(parsed);
+    return true;
+}
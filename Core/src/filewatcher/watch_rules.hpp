@@ -0,0 +1,85 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include <cstdint>
+#include <sys/inotify.h>
+#include "event_mask.hpp"
+
+constexpr std::uint32_t kDefaultEvents = IN_MODIFY | IN_CREATE | IN_DELETE;
+
+// One [section] of a rules file. Compared field by field on reload to
+// decide which watches have to change.
+struct WatchRule {
+    std::string name;
+    std::string path;
+    std::string command;
+    std::uint32_t events = kDefaultEvents;
+    std::vector<std::string> include;
+    std::vector<std::string> exclude;
+    int debounce_ms = -1;   // -1: the watcher's -d setting
+    bool recursive = false;
+    int max_depth = -1;
+
+    bool operator==(const WatchRule&) const noexcept = default;
+};
+
+// Parses a rules file:
+//
+//   [dolby]
+//   path = /vendor/etc/dolby
+//   events = modify,create
+//   include = *.xml *.conf
+//   exclude = *.tmp .*
+//   command = logger_client "Changed: $FILE"
+//   debounce = 200
+//   recursive = yes
+//   depth = 3
+//
+// '#' and ';' start comment lines; include/exclude may repeat. On failure
+// `error` holds "file:line: message" and `rules` is left untouched.
+bool load_rules(const char* file, std::vector<WatchRule>& rules, std::string& error) noexcept;
+
+// Include/exclude globs ('*', '?', '[a-z]', '[!...]') over an event's file
+// name, sorted once into exact names, prefixes ("name*"), suffixes ("*.xml")
+// and general globs so that most patterns cost one hash lookup or one
+// compare per event. With no include patterns every name is included.
+class FileFilter final {
+public:
+    FileFilter() = default;
+    FileFilter(const std::vector<std::string>& include, const std::vector<std::string>& exclude) noexcept;
+
+    [[nodiscard]] bool matches(std::string_view name) const noexcept {
+        return (include_.empty() || include_.matches(name)) && !exclude_.matches(name);
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return include_.empty() && exclude_.empty(); }
+
+private:
+    class PatternSet final {
+    public:
+        void add(std::string_view pattern) noexcept;
+        [[nodiscard]] bool matches(std::string_view name) const noexcept;
+        [[nodiscard]] bool empty() const noexcept {
+            return !any_ && exact_.empty() && prefixes_.empty() && suffixes_.empty() && globs_.empty();
+        }
+
+    private:
+        struct Hash {
+            using is_transparent = void;
+            std::size_t operator()(std::string_view name) const noexcept { return std::hash<std::string_view>{}(name); }
+        };
+
+        bool any_ = false;   // a bare "*"
+        std::unordered_set<std::string, Hash, std::equal_to<>> exact_;
+        std::vector<std::string> prefixes_;
+        std::vector<std::string> suffixes_;
+        std::vector<std::string> globs_;
+    };
+
+    PatternSet include_;
+    PatternSet exclude_;
+};
+
+bool glob_match(std::string_view pattern, std::string_view name) noexcept;
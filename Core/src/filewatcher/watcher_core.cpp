@@ -1,152 +1,968 @@
 #include "watcher_core.hpp"
+#include "tree_walker.hpp"
 #include <sys/inotify.h>
 #include <sys/stat.h>
 #include <unistd.h>
-#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#ifdef ANDROID_DOZE_AWARE
+#include <sys/prctl.h>
+#endif
+#include <signal.h>
+#include <array>
+#include <cerrno>
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
-#include <format>
 #include <string_view>
 #include <algorithm>
-#include <thread>
+#include <mutex>
 
-WatcherCore::WatcherCore() noexcept {
-    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+WatcherCore::WatcherCore(FileWatcherAPI::BackendKind backend, std::string_view broker) noexcept
+    : backend_(backend, broker) {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    
+    // SIGCHLD is already blocked by runner_; route termination through the
+    // same signalfd so the loop never has to poll a flag.
+    sigemptyset(&signal_mask_);
+    sigaddset(&signal_mask_, SIGTERM);
+    sigaddset(&signal_mask_, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &signal_mask_, &saved_mask_);
+    sigaddset(&signal_mask_, SIGCHLD);
+    signal_fd_ = signalfd(-1, &signal_mask_, SFD_NONBLOCK | SFD_CLOEXEC);
+    
+    for (const int fd : {backend_.fd(), timer_fd_, wake_fd_, signal_fd_}) {
+        if (fd >= 0 && epoll_fd_ >= 0) {
+            struct epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+        }
+    }
+    
 #ifdef ANDROID_DOZE_AWARE
-    setup_doze_protection();
+    // Let the kernel batch our debounce/periodic expiries with other wakeups.
+    prctl(PR_SET_TIMERSLACK, 50UL * 1000 * 1000);
 #endif
+    
+    register_metrics();
+}
+
+void WatcherCore::register_metrics() noexcept {
+    using Self = const WatcherCore*;
+    metrics_.add_counter("aurora_filewatcher_events_total", "Events read from the watch backend.", this,
+                         [](const void* self) { return static_cast<Self>(self)->events_; });
+    metrics_.add_counter("aurora_filewatcher_events_coalesced_total",
+                         "Events merged into an already pending debounced event.", this,
+                         [](const void* self) { return static_cast<Self>(self)->coalesced_; });
+    metrics_.add_counter("aurora_filewatcher_overflows_total", "Kernel event queue overflows.", overflows_);
+    metrics_.add_counter("aurora_filewatcher_resyncs_total", "Rescans after an overflow.", resyncs_);
+    metrics_.add_counter("aurora_filewatcher_commands_spawned_total", "Commands started.", this,
+                         [](const void* self) { return static_cast<Self>(self)->runner_.spawned(); });
+    metrics_.add_counter("aurora_filewatcher_commands_failed_total", "Commands that could not be started.", this,
+                         [](const void* self) { return static_cast<Self>(self)->runner_.failed(); });
+    metrics_.add_counter("aurora_filewatcher_commands_dropped_total",
+                         "Commands dropped because the queue was full.", this,
+                         [](const void* self) { return static_cast<Self>(self)->runner_.dropped(); });
+    metrics_.add_counter("aurora_filewatcher_journal_replayed_total",
+                         "Events reconstructed at startup from the journal of the previous run.", this,
+                         [](const void* self) { return static_cast<Self>(self)->replayed_; });
+    metrics_.add_counter("aurora_filewatcher_journal_checkpoints_total", "Journal checkpoints written.", this,
+                         [](const void* self) { return static_cast<Self>(self)->checkpoints_; });
+    metrics_.add_gauge("aurora_filewatcher_watches", "Watched directories and files.", this,
+                       [](const void* self) { return std::uint64_t{static_cast<Self>(self)->watches_.size()}; });
+    metrics_.add_gauge("aurora_filewatcher_events_pending", "Debounced events waiting for quiet.", this,
+                       [](const void* self) { return std::uint64_t{static_cast<Self>(self)->pending_.size()}; });
+    metrics_.add_gauge("aurora_filewatcher_commands_running", "Commands currently running.", this,
+                       [](const void* self) { return std::uint64_t{static_cast<Self>(self)->runner_.running()}; });
+    metrics_.add_gauge("aurora_filewatcher_commands_queued", "Commands waiting for a free slot.", this,
+                       [](const void* self) { return std::uint64_t{static_cast<Self>(self)->runner_.queued()}; });
+    metrics_.add_histogram("aurora_filewatcher_event_to_command_seconds",
+                           "Time from reading an event to starting its command, debounce and queueing included.",
+                           runner_.spawn_latency());
 }
 
 WatcherCore::~WatcherCore() noexcept {
     stop();
-    if (inotify_fd_ >= 0) {
-        close(inotify_fd_);
-    }
-#ifdef ANDROID_DOZE_AWARE
-    if (wake_fd_ != -1) {
-        close(wake_fd_);
+    for (const int fd : {epoll_fd_, timer_fd_, wake_fd_, signal_fd_}) {
+        if (fd >= 0) {
+            close(fd);
+        }
     }
-#endif
+    pthread_sigmask(SIG_SETMASK, &saved_mask_, nullptr);
 }
 
-bool WatcherCore::add_watch(std::string_view path, std::string_view command, std::uint32_t events) noexcept {
-    if (inotify_fd_ < 0) {
+bool WatcherCore::add_watch(std::string_view path, std::string_view command, std::uint32_t events,
+                            bool recursive, int max_depth) noexcept {
+    return add_root(WatchRoot{CommandTemplate{command}, FileFilter{}, events, recursive, recursive ? max_depth : 0},
+                    path);
+}
+
+bool WatcherCore::add_root(WatchRoot root, std::string_view path) noexcept {
+    if (backend_.fd() < 0) {
         return false;
     }
     
-    const int wd = inotify_add_watch(inotify_fd_, path.data(), events);
+    // IN_MASK_ADD: another rule may already watch this directory.
+    const std::uint32_t mask = kernel_mask(root) | IN_MASK_ADD;
+    const std::string root_path{path};
+    
+    const int wd = backend_.add_watch(root_path.c_str(), mask);
     if (wd < 0) {
         return false;
     }
     
-    watches_.emplace(wd, WatchInfo{std::string{path}, std::string{command}, events});
+    const auto root_index = static_cast<std::uint32_t>(roots_.size());
+    const bool recursive = root.recursive;
+    const int max_depth = root.max_depth;
+    roots_.push_back(std::move(root));
+    
+    std::vector<int> captured;
+    auto [watch, inserted] = watches_.try_emplace(wd);
+    if (inserted) {
+        watch->second.node = paths_.add_root(root_path);
+        snapshots_[wd].capture(root_path, hash_content_);
+        captured.push_back(wd);
+    }
+    watch->second.bindings.push_back(WatchBinding{root_index, 0});
+    const auto root_node = watch->second.node;
+    
+    if (!recursive) {
+        journal_directories(captured);
+        return true;
+    }
+    
+    // Snapshots are taken on the walker threads too; only the hand-off is locked.
+    std::mutex snapshot_mutex;
+    const auto dirs = FileWatcherAPI::walk_directories(root_path, max_depth, [&](const std::string& dir) {
+        const int child_wd = backend_.add_watch(dir.c_str(), mask | IN_ONLYDIR);
+        if (child_wd >= 0) {
+            FileWatcherAPI::DirectorySnapshot snapshot;
+            snapshot.capture(dir, hash_content_);
+            std::lock_guard<std::mutex> lock(snapshot_mutex);
+            if (snapshots_.try_emplace(child_wd, std::move(snapshot)).second) {
+                captured.push_back(child_wd);
+            }
+        }
+        return child_wd;
+    });
+    attach_subtree(dirs, root_node, root_index, 0);
+    journal_directories(captured);
+    
     return true;
 }
 
+void WatcherCore::attach_subtree(const std::vector<FileWatcherAPI::WalkedDir>& dirs,
+                                 FileWatcherAPI::PathTable::NodeId top, std::uint32_t root, int depth) noexcept {
+    std::vector<FileWatcherAPI::PathTable::NodeId> nodes(dirs.size(), FileWatcherAPI::PathTable::kInvalid);
+    for (size_t i = 0; i < dirs.size(); ++i) {
+        const auto& dir = dirs[i];
+        if (const auto existing = watches_.find(dir.wd); existing != watches_.end()) {
+            // Already watched for another rule (or reached twice): share it.
+            nodes[i] = existing->second.node;
+            auto& bindings = existing->second.bindings;
+            if (std::none_of(bindings.begin(), bindings.end(), [&](const WatchBinding& b) { return b.root == root; })) {
+                bindings.push_back(WatchBinding{root, depth + dir.depth});
+            }
+            continue;
+        }
+        const auto parent = dir.parent == FileWatcherAPI::WalkedDir::kRoot ? top : nodes[dir.parent];
+        nodes[i] = paths_.add_child(parent, dir.name);
+        if (nodes[i] != FileWatcherAPI::PathTable::kInvalid) {
+            watches_.emplace(dir.wd, WatchInfo{nodes[i], {WatchBinding{root, depth + dir.depth}}});
+        }
+    }
+}
+
+std::uint32_t WatcherCore::kernel_mask(const WatchRoot& root) const noexcept {
+    // Recursive roots always need directory lifecycle events to keep the
+    // watch tree in sync; they are filtered out before commands run.
+    return root.recursive ? root.events | IN_CREATE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF
+                          : root.events;
+}
+
+void WatcherCore::watch_subtree(int parent_wd, WatchBinding binding, std::string_view name) noexcept {
+    const auto parent = watches_.find(parent_wd);
+    if (parent == watches_.end()) {
+        return;
+    }
+    
+    const auto parent_node = parent->second.node;
+    const WatchRoot& root = roots_[binding.root];
+    if (root.max_depth >= 0 && binding.depth >= root.max_depth) {
+        return;
+    }
+    
+    const std::uint32_t mask = kernel_mask(root) | IN_ONLYDIR | IN_MASK_ADD;
+    std::string dir_path;
+    build_path(parent_node, name, dir_path);
+    
+    const int wd = backend_.add_watch(dir_path.c_str(), mask);
+    if (wd < 0) {
+        return;
+    }
+    
+    FileWatcherAPI::PathTable::NodeId node;
+    std::vector<int> captured;
+    if (const auto existing = watches_.find(wd); existing != watches_.end()) {
+        auto& bindings = existing->second.bindings;
+        if (std::any_of(bindings.begin(), bindings.end(), [&](const WatchBinding& b) { return b.root == binding.root; })) {
+            return;
+        }
+        bindings.push_back(WatchBinding{binding.root, binding.depth + 1});
+        node = existing->second.node;
+    } else {
+        node = paths_.add_child(parent_node, name);
+        watches_.emplace(wd, WatchInfo{node, {WatchBinding{binding.root, binding.depth + 1}}});
+        snapshots_[wd].capture(dir_path, hash_content_);
+        captured.push_back(wd);
+    }
+    
+    // The directory may already have contents (mkdir -p, mv into the tree).
+    const int remaining = root.max_depth < 0 ? -1 : root.max_depth - binding.depth - 1;
+    const auto dirs = FileWatcherAPI::walk_directories(dir_path, remaining, [&](const std::string& dir) {
+        const int child_wd = backend_.add_watch(dir.c_str(), mask);
+        if (child_wd >= 0 && !snapshots_.contains(child_wd)) {
+            snapshots_[child_wd].capture(dir, hash_content_);
+            captured.push_back(child_wd);
+        }
+        return child_wd;
+    }, 1);
+    attach_subtree(dirs, node, binding.root, binding.depth + 1);
+    journal_directories(captured);
+}
+
+void WatcherCore::unwatch_subtree(int parent_wd, std::string_view name) noexcept {
+    const auto parent = watches_.find(parent_wd);
+    if (parent == watches_.end()) {
+        return;
+    }
+    const auto parent_node = parent->second.node;
+    
+    // A directory moved out of the tree keeps its watches; drop what the
+    // recursive rules added so later events are not reported under the
+    // stale path. A rule watching one of them by path keeps its binding.
+    // IN_IGNORED for each removed wd finishes the cleanup in forget_watch().
+    for (auto& [wd, info] : watches_) {
+        auto node = info.node;
+        while (node != FileWatcherAPI::PathTable::kInvalid && paths_.parent(node) != parent_node) {
+            node = paths_.parent(node);
+        }
+        if (node == FileWatcherAPI::PathTable::kInvalid || node == parent_node || paths_.name(node) != name) {
+            continue;
+        }
+        const auto followed = std::remove_if(info.bindings.begin(), info.bindings.end(),
+                                             [](const WatchBinding& b) { return b.depth > 0; });
+        if (followed == info.bindings.end()) {
+            continue;
+        }
+        info.bindings.erase(followed, info.bindings.end());
+        if (info.bindings.empty()) {
+            backend_.remove_watch(wd);
+        } else {
+            refresh_mask(wd, info);
+        }
+    }
+}
+
+void WatcherCore::forget_watch(int wd) noexcept {
+    if (const auto it = watches_.find(wd); it != watches_.end()) {
+        std::string path;
+        if (journal_.is_open()) {
+            paths_.build(it->second.node, path);
+        }
+        paths_.release(it->second.node);
+        watches_.erase(it);
+        snapshots_.erase(wd);
+        std::erase_if(unjournaled_, [wd](const auto& entry) { return entry.first.wd == wd; });
+        if (journal_.is_open() && !journal_.record_forget(path)) {
+            write_checkpoint();
+        }
+    }
+}
+
+// Narrows the kernel mask to what the remaining bindings need.
+void WatcherCore::refresh_mask(int wd, const WatchInfo& watch) noexcept {
+    std::uint32_t mask = 0;
+    for (const auto& binding : watch.bindings) {
+        mask |= kernel_mask(roots_[binding.root]);
+    }
+    std::string path;
+    paths_.build(watch.node, path);
+    const int current = backend_.add_watch(path.c_str(), mask);
+    if (current >= 0 && current != wd && !watches_.contains(current)) {
+        // The path names something else by now; don't start watching it.
+        backend_.remove_watch(current);
+    }
+}
+
+void WatcherCore::build_path(FileWatcherAPI::PathTable::NodeId node, std::string_view name,
+                             std::string& out) const noexcept {
+    paths_.build(node, out);
+    if (!name.empty()) {
+        if (out.empty() || out.back() != '/') {
+            out += '/';
+        }
+        out += name;
+    }
+}
+
+std::size_t WatcherCore::apply_rules(const std::vector<WatchRule>& rules) noexcept {
+    std::vector<ActiveRule> next;
+    std::vector<const WatchRule*> added;
+    std::vector<bool> kept(rules_.size(), false);
+    
+    for (const auto& rule : rules) {
+        const auto old = std::find_if(rules_.begin(), rules_.end(),
+                                      [&](const ActiveRule& active) { return active.rule.name == rule.name; });
+        if (old == rules_.end()) {
+            added.push_back(&rule);
+            continue;
+        }
+        const bool same_watch = old->rule.path == rule.path && old->rule.events == rule.events &&
+                                old->rule.recursive == rule.recursive && old->rule.max_depth == rule.max_depth;
+        if (!same_watch) {
+            added.push_back(&rule);
+            continue;
+        }
+        if (!(old->rule == rule)) {
+            WatchRoot& root = roots_[old->root];
+            root.command = CommandTemplate{rule.command};
+            root.filter = FileFilter{rule.include, rule.exclude};
+            root.debounce_ms = rule.debounce_ms;
+        }
+        kept[static_cast<size_t>(old - rules_.begin())] = true;
+        next.push_back(ActiveRule{rule, old->root});
+    }
+    
+    // Drop first: a reshaped rule on the same path then starts from a
+    // clean kernel mask.
+    for (size_t i = 0; i < rules_.size(); ++i) {
+        if (!kept[i]) {
+            remove_root(rules_[i].root);
+        }
+    }
+    
+    std::size_t failed = 0;
+    for (const WatchRule* rule : added) {
+        WatchRoot root{CommandTemplate{rule->command}, FileFilter{rule->include, rule->exclude}, rule->events,
+                       rule->recursive, rule->recursive ? rule->max_depth : 0, rule->debounce_ms};
+        if (add_root(std::move(root), rule->path)) {
+            next.push_back(ActiveRule{*rule, static_cast<std::uint32_t>(roots_.size() - 1)});
+        } else {
+            std::fprintf(stderr, "Failed to add watch for rule [%s]: %s: %s\n", rule->name.c_str(),
+                         rule->path.c_str(), std::strerror(errno));
+            ++failed;
+        }
+    }
+    
+    rules_ = std::move(next);
+    return failed;
+}
+
+void WatcherCore::remove_root(std::uint32_t root) noexcept {
+    roots_[root].active = false;
+    roots_[root].command = CommandTemplate{};
+    roots_[root].filter = FileFilter{};
+    
+    for (auto& [wd, info] : watches_) {
+        const auto bound = std::remove_if(info.bindings.begin(), info.bindings.end(),
+                                          [&](const WatchBinding& b) { return b.root == root; });
+        if (bound == info.bindings.end()) {
+            continue;
+        }
+        info.bindings.erase(bound, info.bindings.end());
+        if (info.bindings.empty()) {
+            backend_.remove_watch(wd);   // IN_IGNORED -> forget_watch()
+        } else {
+            refresh_mask(wd, info);
+        }
+    }
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        if (it->first.root != root) {
+            ++it;
+            continue;
+        }
+        if (it->second.held) {
+            release_entry(it->first.wd, it->first.name);
+        }
+        it = pending_.erase(it);
+    }
+}
+
+void WatcherCore::set_rules_file(std::string_view file) noexcept {
+    rules_file_ = file;
+    watch_signal(SIGHUP);
+}
+
+// Takes a signal that would otherwise terminate us through the signalfd.
+void WatcherCore::watch_signal(int signo) noexcept {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, signo);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+    sigaddset(&signal_mask_, signo);
+    if (signal_fd_ >= 0) {
+        signalfd(signal_fd_, &signal_mask_, 0);
+    }
+}
+
+void WatcherCore::enable_stats_signal() noexcept {
+    watch_signal(SIGUSR1);
+}
+
+bool WatcherCore::set_stats_socket(std::string_view name) noexcept {
+    if (epoll_fd_ < 0 || !stats_endpoint_.listen(name)) {
+        return false;
+    }
+    struct epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = stats_endpoint_.fd();
+    return epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, stats_endpoint_.fd(), &ev) == 0;
+}
+
+void WatcherCore::set_stats_file(std::string_view path) noexcept {
+    stats_file_ = path;
+}
+
+void WatcherCore::dump_stats(std::FILE* stream) const noexcept {
+    std::string text;
+    metrics_.render_text(text);
+    std::fwrite(text.data(), 1, text.size(), stream);
+    std::fflush(stream);
+}
+
+// Anything that moves when the watcher does work; an unchanged version
+// means the stats file is still current.
+std::uint64_t WatcherCore::stats_version() const noexcept {
+    return events_ + runner_.spawned() + runner_.failed() + runner_.dropped() + watches_.size() +
+           overflows_.load(std::memory_order_relaxed);
+}
+
+// Writes the stats file if it is stale and the interval allows; otherwise
+// returns when it should be written so a burst's final state still lands.
+std::chrono::steady_clock::time_point WatcherCore::update_stats_file(std::chrono::steady_clock::time_point now) noexcept {
+    const auto never = std::chrono::steady_clock::time_point::max();
+    if (stats_file_.empty()) {
+        return never;
+    }
+    const std::uint64_t version = stats_version();
+    if (version == stats_file_version_) {
+        return never;
+    }
+    if (now < next_stats_write_) {
+        return next_stats_write_;
+    }
+    if (!metrics_.write_file(stats_file_.c_str())) {
+        std::fprintf(stderr, "Failed to write stats to %s: %s\n", stats_file_.c_str(), std::strerror(errno));
+    }
+    stats_file_version_ = version;
+    next_stats_write_ = now + kStatsFileInterval;
+    return never;
+}
+
+bool WatcherCore::set_journal(std::string_view path, std::string& error) noexcept {
+    return journal_.open(path, error);
+}
+
+// Reports what changed since the previous run stopped: its last known
+// snapshot of each directory that is watched again, diffed against the one
+// add_root() just captured. Directories it did not watch have nothing to
+// compare against and start fresh, as on a cold start.
+void WatcherCore::replay_journal() noexcept {
+    if (!journal_.is_open()) {
+        return;
+    }
+    if (journal_.saved_count() > 0) {
+        std::vector<int> wds;
+        wds.reserve(watches_.size());
+        for (const auto& [wd, watch] : watches_) {
+            wds.push_back(wd);
+        }
+        
+        std::string path;
+        FileWatcherAPI::DirectorySnapshot saved;
+        for (const int wd : wds) {
+            const auto watch = watches_.find(wd);
+            const auto cached = snapshots_.find(wd);
+            if (watch == watches_.end() || cached == snapshots_.end()) {
+                continue;
+            }
+            paths_.build(watch->second.node, path);
+            if (!journal_.take(path, saved)) {
+                continue;
+            }
+            // handle_event() refreshes the live snapshot while this walks it.
+            const FileWatcherAPI::DirectorySnapshot current = cached->second;
+            saved.diff(current, [&](std::string_view name, std::uint32_t mask) {
+                ++replayed_;
+                handle_event(wd, mask, name);
+            });
+        }
+        journal_.discard_saved();
+        std::printf("Replayed %llu events missed since the last run\n", static_cast<unsigned long long>(replayed_));
+        std::fflush(stdout);
+    }
+    write_checkpoint();
+}
+
+void WatcherCore::write_checkpoint() noexcept {
+    // Entries still waiting for their debounced command go in as they were
+    // before, so a run killed before the command starts replays them.
+    std::unordered_map<int, FileWatcherAPI::DirectorySnapshot> held;
+    for (const auto& [key, entry] : unjournaled_) {
+        const auto snapshot = snapshots_.find(key.wd);
+        if (snapshot == snapshots_.end()) {
+            continue;
+        }
+        FileWatcherAPI::DirectorySnapshot& copy = held.try_emplace(key.wd, snapshot->second).first->second;
+        if (key.name.empty() || !copy.self().is_dir) {
+            copy.set_self(entry.before);
+        } else {
+            copy.set_entry(key.name, entry.existed ? &entry.before : nullptr);
+        }
+    }
+    
+    std::vector<std::pair<std::string, const FileWatcherAPI::DirectorySnapshot*>> dirs;
+    dirs.reserve(snapshots_.size());
+    for (const auto& [wd, snapshot] : snapshots_) {
+        if (const auto watch = watches_.find(wd); watch != watches_.end()) {
+            const auto copy = held.find(wd);
+            dirs.emplace_back(std::string{}, copy != held.end() ? &copy->second : &snapshot);
+            paths_.build(watch->second.node, dirs.back().first);
+        }
+    }
+    std::string error;
+    if (journal_.checkpoint(dirs, error)) {
+        ++checkpoints_;
+    } else {
+        std::fprintf(stderr, "Failed to checkpoint journal: %s\n", error.c_str());
+    }
+    next_checkpoint_ = std::chrono::steady_clock::now() + kJournalCheckpointInterval;
+}
+
+// Checkpoints once the interval allows, if anything was appended since the
+// last one (or the last one failed); otherwise returns when it is due.
+std::chrono::steady_clock::time_point WatcherCore::update_journal(std::chrono::steady_clock::time_point now) noexcept {
+    const auto never = std::chrono::steady_clock::time_point::max();
+    if (!journal_.is_open() || (journal_.writable() && journal_.appended() == 0)) {
+        return never;
+    }
+    if (now < next_checkpoint_) {
+        return next_checkpoint_;
+    }
+    write_checkpoint();
+    return never;
+}
+
+// Mirrors DirectorySnapshot::refresh(): a watched file, or a directory's
+// own event, updates the watched path itself.
+void WatcherCore::journal_event(std::string_view dir, std::string_view name, std::uint32_t mask,
+                                const FileWatcherAPI::DirectorySnapshot& snapshot) noexcept {
+    if (!journal_.is_open()) {
+        return;
+    }
+    const bool self = name.empty() || !snapshot.self().is_dir;
+    if (!journal_.record_entry(dir, self ? std::string_view{} : name, mask,
+                               self ? &snapshot.self() : snapshot.find(name))) {
+        write_checkpoint();
+    }
+}
+
+void WatcherCore::journal_directories(const std::vector<int>& wds) noexcept {
+    if (!journal_.is_open()) {
+        return;
+    }
+    std::string path;
+    for (const int wd : wds) {
+        const auto watch = watches_.find(wd);
+        const auto snapshot = snapshots_.find(wd);
+        if (watch == watches_.end() || snapshot == snapshots_.end()) {
+            continue;
+        }
+        paths_.build(watch->second.node, path);
+        if (!journal_.record_directory(path, snapshot->second)) {
+            // The checkpoint includes this one and the rest.
+            write_checkpoint();
+            return;
+        }
+    }
+}
+
+void WatcherCore::reload_rules() noexcept {
+    reload_pending_ = false;
+    std::vector<WatchRule> rules;
+    std::string error;
+    if (!load_rules(rules_file_.c_str(), rules, error)) {
+        std::fprintf(stderr, "Reload failed, keeping current rules: %s\n", error.c_str());
+        return;
+    }
+    const std::size_t failed = apply_rules(rules);
+    std::printf("Reloaded %zu rules from %s\n", rules.size() - failed, rules_file_.c_str());
+    std::fflush(stdout);
+}
+
 void WatcherCore::start() noexcept {
+    if (epoll_fd_ < 0) {
+        return;
+    }
     running_.store(true, std::memory_order_relaxed);
     
-    std::array<char, 4096> buffer{};
-    struct pollfd pfd = {inotify_fd_, POLLIN, 0};
+    event_time_ = std::chrono::steady_clock::now();
+    replay_journal();
     
-#ifdef ANDROID_DOZE_AWARE
-    const int timeout_ms = 2000;
-#else
-    const int timeout_ms = 1000;
-#endif
+    const int interval = periodic_interval_.load(std::memory_order_relaxed);
+    if (interval > 0) {
+        next_periodic_ = std::chrono::steady_clock::now() + std::chrono::seconds(interval);
+    }
+    arm_timer(std::min(next_periodic_, update_stats_file(std::chrono::steady_clock::now())));
+    
+    std::array<struct epoll_event, 4> ready{};
     
     while (running_.load(std::memory_order_relaxed)) {
-        const int poll_result = poll(&pfd, 1, timeout_ms);
+        const int count = epoll_wait(epoll_fd_, ready.data(), static_cast<int>(ready.size()), -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        event_time_ = std::chrono::steady_clock::now();
         
-        if (poll_result > 0 && (pfd.revents & POLLIN)) {
-            const ssize_t len = read(inotify_fd_, buffer.data(), buffer.size());
-            if (len > 0) {
-                process_events(std::string_view{buffer.data(), static_cast<size_t>(len)});
-                
-                if (one_shot_.load(std::memory_order_relaxed)) {
-                    break;
+        for (int i = 0; i < count; ++i) {
+            const int fd = ready[i].data.fd;
+            if (fd == backend_.fd()) {
+                backend_.drain([this](int wd, std::uint32_t mask, std::string_view name) {
+                    if (mask & IN_Q_OVERFLOW) {
+                        overflows_.fetch_add(1, std::memory_order_relaxed);
+                        resync_pending_ = true;
+                        return;
+                    }
+                    ++events_;
+                    handle_event(wd, mask, name);
+                });
+                if (resync_pending_) {
+                    resync();
+                }
+            } else if (fd == signal_fd_) {
+                handle_signals();
+                if (reload_pending_) {
+                    reload_rules();
+                }
+            } else if (fd == stats_endpoint_.fd()) {
+                stats_endpoint_.serve(metrics_);
+            } else {
+                std::uint64_t counter;
+                (void)read(fd, &counter, sizeof(counter));
+                if (fd == timer_fd_) {
+                    armed_deadline_ = std::chrono::steady_clock::time_point::max();
                 }
             }
-        } else if (poll_result == 0) {
-            const int interval = periodic_interval_.load(std::memory_order_relaxed);
-            if (interval > 0) {
-                periodic_check();
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
+        
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= next_periodic_) {
+            periodic_check();
+            next_periodic_ = now + std::chrono::seconds(periodic_interval_.load(std::memory_order_relaxed));
+        }
+        
+        const auto next_pending = flush_pending();
+        
+        if (fired_ > 0 && one_shot_.load(std::memory_order_relaxed)) {
+            runner_.wait_all();
+            break;
+        }
+        
+        const auto next_stats = update_stats_file(std::chrono::steady_clock::now());
+        const auto next_checkpoint = update_journal(std::chrono::steady_clock::now());
+        arm_timer(std::min({next_pending, next_periodic_, next_stats, next_checkpoint}));
+    }
+    
+    // Debounced commands still waiting run now rather than being lost with
+    // the process; once they and the queue behind them are done, a clean
+    // exit leaves a bare checkpoint: the next start has no log to replay,
+    // only the diff against the tree.
+    flush_pending(true);
+    runner_.wait_all();
+    if (journal_.appended() > 0 || !unjournaled_.empty()) {
+        write_checkpoint();
     }
+    
+    // Leave the final numbers behind for whoever reads the file next.
+    next_stats_write_ = {};
+    update_stats_file(std::chrono::steady_clock::now());
+    running_.store(false, std::memory_order_relaxed);
 }
 
 void WatcherCore::stop() noexcept {
     running_.store(false, std::memory_order_relaxed);
+    if (wake_fd_ >= 0) {
+        const std::uint64_t one = 1;
+        (void)write(wake_fd_, &one, sizeof(one));
+    }
 }
 
-void WatcherCore::process_events(std::string_view buffer) noexcept {
-    size_t offset = 0;
+void WatcherCore::handle_signals() noexcept {
+    signalfd_siginfo info;
+    bool child_exited = false;
     
-    while (offset < buffer.size()) {
-        const auto* event = reinterpret_cast<const struct inotify_event*>(buffer.data() + offset);
-        
-        if (const auto it = watches_.find(event->wd); it != watches_.end()) {
-            execute_command(it->second.command, it->second.path, event);
+    while (read(signal_fd_, &info, sizeof(info)) == sizeof(info)) {
+        if (info.ssi_signo == SIGCHLD) {
+            child_exited = true;
+        } else if (info.ssi_signo == SIGHUP) {
+            reload_pending_ = !rules_file_.empty();
+        } else if (info.ssi_signo == SIGUSR1) {
+            dump_stats(stdout);
+        } else {
+            running_.store(false, std::memory_order_relaxed);
         }
-        
-        offset += sizeof(struct inotify_event) + event->len;
+    }
+    
+    if (child_exited) {
+        runner_.reap();
     }
 }
 
-void WatcherCore::execute_command(std::string_view command, const std::string& path, 
-                                 const struct inotify_event* event) noexcept {
-    std::string cmd{command};
+void WatcherCore::arm_timer(std::chrono::steady_clock::time_point deadline) noexcept {
+    if (timer_fd_ < 0 || deadline == armed_deadline_) {
+        return;
+    }
+    armed_deadline_ = deadline;
     
-    if (const auto pos = cmd.find("$FILE"); pos != std::string::npos) {
-        std::string filename = path;
-        if (event && event->len > 0) {
-            filename += "/";
-            filename += event->name;
+    // steady_clock is CLOCK_MONOTONIC on Linux, so deadlines can be armed as
+    // absolute expiries. A zeroed itimerspec disarms the timer when idle.
+    struct itimerspec spec{};
+    if (deadline != std::chrono::steady_clock::time_point::max()) {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+        spec.it_value.tv_sec = static_cast<time_t>(ns / 1000000000);
+        spec.it_value.tv_nsec = static_cast<long>(ns % 1000000000);
+        if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+            spec.it_value.tv_nsec = 1;
         }
-        cmd.replace(pos, 5, filename);
     }
+    timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+void WatcherCore::handle_event(int wd, std::uint32_t mask, std::string_view name) noexcept {
+    const auto it = watches_.find(wd);
+    if (it == watches_.end()) {
+        return;
+    }
+    
+    // Copies: watch_subtree() may rehash watches_ under us.
+    const auto node = it->second.node;
+    bindings_.assign(it->second.bindings.begin(), it->second.bindings.end());
     
-    if (const pid_t pid = fork(); pid == 0) {
-        std::system(cmd.c_str());
-        std::exit(0);
+    // The entry as journaled so far, kept if a command for it is debounced.
+    const bool tracked = !(mask & IN_IGNORED) && snapshots_.contains(wd);
+    FileWatcherAPI::StatSnapshot before;
+    bool existed = false;
+    if (tracked) {
+        FileWatcherAPI::DirectorySnapshot& snapshot = snapshots_.find(wd)->second;
+        if (journal_.is_open()) {
+            const bool self = name.empty() || !snapshot.self().is_dir;
+            if (const auto* prior = self ? &snapshot.self() : snapshot.find(name)) {
+                before = *prior;
+                existed = true;
+            }
+        }
+        paths_.build(node, dir_arg_);
+        snapshot.refresh(dir_arg_, name, hash_content_);
+    }
+    
+    if ((mask & IN_ISDIR) && (mask & IN_MOVED_FROM)) {
+        unwatch_subtree(wd, name);
+    }
+    
+    // Filters see the file name; a watch on a single file reports none.
+    std::string_view filter_name = name;
+    if (filter_name.empty()) {
+        filter_name = paths_.name(node);
+        filter_name.remove_prefix(filter_name.find_last_of('/') + 1);
+    }
+    
+    int held = 0;
+    for (const auto& binding : bindings_) {
+        const WatchRoot& root = roots_[binding.root];
+        if (!root.active) {
+            continue;
+        }
+        if (root.recursive && (mask & IN_ISDIR) && (mask & (IN_CREATE | IN_MOVED_TO))) {
+            watch_subtree(wd, binding, name);
+        }
+        if (!(mask & root.events) || !root.filter.matches(filter_name)) {
+            continue;
+        }
+        const int debounce_ms = root.debounce_ms >= 0 ? root.debounce_ms : debounce_ms_.load(std::memory_order_relaxed);
+        if (debounce_ms > 0) {
+            held += queue_event(wd, binding.root, name, mask, debounce_ms) && tracked && journal_.is_open();
+        } else {
+            execute_command(binding.root, node, name, mask, event_time_);
+        }
+    }
+    
+    if (tracked && journal_.is_open()) {
+        // Journaled now unless a command for the entry is still debounced;
+        // then release_entry() records it once the last one is submitted.
+        const auto hold = held > 0 || !unjournaled_.empty() ? unjournaled_.find(DebounceKey{wd, 0, std::string{name}})
+                                                            : unjournaled_.end();
+        if (held > 0 || hold != unjournaled_.end()) {
+            auto& entry = hold != unjournaled_.end()
+                              ? hold->second
+                              : unjournaled_.try_emplace(DebounceKey{wd, 0, std::string{name}},
+                                                         UnjournaledEntry{before, existed, 0, 0}).first->second;
+            entry.mask |= mask;
+            entry.pending += held;
+        } else if (const auto snapshot = snapshots_.find(wd); snapshot != snapshots_.end()) {
+            paths_.build(node, dir_arg_);
+            journal_event(dir_arg_, name, mask, snapshot->second);
+        }
+    }
+    
+    if (mask & IN_IGNORED) {
+        forget_watch(wd);
     }
 }
 
-void WatcherCore::set_periodic_check(int interval_seconds) noexcept {
-    periodic_interval_.store(interval_seconds, std::memory_order_relaxed);
+void WatcherCore::resync() noexcept {
+    resync_pending_ = false;
+    resyncs_.fetch_add(1, std::memory_order_relaxed);
+    rescan();
 }
 
-void WatcherCore::set_one_shot(bool enabled) noexcept {
-    one_shot_.store(enabled, std::memory_order_relaxed);
+void WatcherCore::rescan() noexcept {
+    // Events synthesized below can add watches (new subdirectories), so
+    // work from a copy of the current wd list.
+    std::vector<int> wds;
+    wds.reserve(watches_.size());
+    for (const auto& [wd, watch] : watches_) {
+        wds.push_back(wd);
+    }
+    
+    std::string path;
+    for (const int wd : wds) {
+        const auto watch = watches_.find(wd);
+        const auto cached = snapshots_.find(wd);
+        if (watch == watches_.end() || cached == snapshots_.end()) {
+            continue;
+        }
+        
+        paths_.build(watch->second.node, path);
+        FileWatcherAPI::DirectorySnapshot current;
+        if (!current.capture(path, hash_content_)) {
+            continue;
+        }
+        
+        const FileWatcherAPI::DirectorySnapshot previous = std::move(cached->second);
+        cached->second = std::move(current);
+        previous.diff(cached->second, [&](std::string_view name, std::uint32_t mask) {
+            handle_event(wd, mask, name);
+        });
+    }
 }
 
-void WatcherCore::periodic_check() noexcept {
-    for (auto& [wd, watch_info] : watches_) {
-        if (file_changed(watch_info.path, watch_info.last_check)) {
-            execute_command(watch_info.command, watch_info.path, nullptr);
-        }
+// True when this starts a new pending command rather than joining one.
+bool WatcherCore::queue_event(int wd, std::uint32_t root, std::string_view name, std::uint32_t mask,
+                              int debounce_ms) noexcept {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(debounce_ms);
+    
+    auto [it, inserted] = pending_.try_emplace(DebounceKey{wd, root, std::string{name}},
+                                               PendingEvent{mask, deadline, event_time_});
+    if (!inserted) {
+        it->second.mask |= mask;
+        it->second.deadline = deadline;
+        ++coalesced_;
+        return false;
     }
+    it->second.held = journal_.is_open() && snapshots_.contains(wd);
+    return true;
 }
 
-bool WatcherCore::file_changed(const std::string& path, std::chrono::steady_clock::time_point& last_check) noexcept {
-    struct stat file_stat;
+// Submits the pending commands that are due, or all of them.
+std::chrono::steady_clock::time_point WatcherCore::flush_pending(bool all) noexcept {
+    auto next = std::chrono::steady_clock::time_point::max();
+    if (pending_.empty()) {
+        return next;
+    }
+    
     const auto now = std::chrono::steady_clock::now();
     
-    if (stat(path.c_str(), &file_stat) == 0) {
-        if (now - last_check > std::chrono::seconds(periodic_interval_.load(std::memory_order_relaxed))) {
-            last_check = now;
-            return true;
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        if (!all && it->second.deadline > now) {
+            next = std::min(next, it->second.deadline);
+            ++it;
+            continue;
+        }
+        
+        if (const auto watch = watches_.find(it->first.wd); watch != watches_.end() && roots_[it->first.root].active) {
+            execute_command(it->first.root, watch->second.node, it->first.name, it->second.mask,
+                            it->second.first_seen);
+        }
+        if (it->second.held) {
+            release_entry(it->first.wd, it->first.name);
         }
+        it = pending_.erase(it);
     }
     
-    return false;
+    return next;
 }
 
-#ifdef ANDROID_DOZE_AWARE
-void WatcherCore::setup_doze_protection() noexcept {
-    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+// One of the entry's pending commands is submitted or dropped; after the
+// last, the entry's state goes into the journal.
+void WatcherCore::release_entry(int wd, const std::string& name) noexcept {
+    const auto it = unjournaled_.find(DebounceKey{wd, 0, name});
+    if (it == unjournaled_.end() || --it->second.pending > 0) {
+        return;
+    }
+    const std::uint32_t mask = it->second.mask;
+    unjournaled_.erase(it);
+    const auto watch = watches_.find(wd);
+    const auto snapshot = snapshots_.find(wd);
+    if (watch != watches_.end() && snapshot != snapshots_.end()) {
+        paths_.build(watch->second.node, dir_arg_);
+        journal_event(dir_arg_, name, mask, snapshot->second);
+    }
+}
+
+void WatcherCore::execute_command(std::uint32_t root, FileWatcherAPI::PathTable::NodeId node,
+                                  std::string_view name, std::uint32_t mask,
+                                  std::chrono::steady_clock::time_point since) noexcept {
+    build_path(node, name, file_arg_);
+    FileWatcherAPI::format_event_mask(mask & roots_[root].events, events_arg_);
+    runner_.submit(roots_[root].command, file_arg_, events_arg_, since);
+    ++fired_;
+}
+
+void WatcherCore::set_content_hash(bool enabled) noexcept {
+    hash_content_ = enabled;
+}
+
+void WatcherCore::set_periodic_check(int interval_seconds) noexcept {
+    periodic_interval_.store(interval_seconds, std::memory_order_relaxed);
+}
+
+void WatcherCore::set_one_shot(bool enabled) noexcept {
+    one_shot_.store(enabled, std::memory_order_relaxed);
+}
+
+void WatcherCore::set_debounce(int milliseconds) noexcept {
+    debounce_ms_.store(milliseconds > 0 ? milliseconds : 0, std::memory_order_relaxed);
+}
+
+void WatcherCore::set_read_buffer_size(size_t bytes) noexcept {
+    backend_.set_read_buffer_size(bytes);
+}
+
+void WatcherCore::set_max_concurrency(int limit) noexcept {
+    runner_.set_max_concurrency(limit > 0 ? static_cast<size_t>(limit) : 1);
+}
+
+void WatcherCore::periodic_check() noexcept {
+    // Polling fallback for mounts where inotify misses changes (overlays,
+    // FUSE): only snapshots that actually differ produce events.
+    rescan();
 }
-#endif
@@ -2,33 +2,90 @@
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <vector>
 #include <cstdint>
 #include <chrono>
 #include <atomic>
 #include <memory>
+#include <cstdio>
+#include <signal.h>
 #include <sys/stat.h>
-#ifdef ANDROID_DOZE_AWARE
-#include <sys/eventfd.h>
-#include <android/log.h>
-#endif
+#include "command_runner.hpp"
+#include "event_journal.hpp"
+#include "metrics.hpp"
+#include "watch_rules.hpp"
+#include "path_table.hpp"
+#include "tree_walker.hpp"
+#include "watch_backend.hpp"
+#include "stat_snapshot.hpp"
 
-struct inotify_event;
+// One add_watch() call or rules-file rule. Recursive roots fan out into
+// many watched directories that all share this command and mask.
+struct WatchRoot {
+    CommandTemplate command;
+    FileFilter filter;
+    std::uint32_t events;
+    bool recursive;
+    int max_depth;
+    int debounce_ms = -1;   // -1: set_debounce()
+    bool active = true;     // cleared when its rule is dropped; slots are not reused
+};
+
+// One root's claim on a watched directory.
+struct WatchBinding {
+    std::uint32_t root;
+    int depth;
+};
 
+// Rules that overlap share the kernel watch: one wd, one binding per root.
 struct WatchInfo {
-    std::string path;
-    std::string command;
-    std::uint32_t events;
-    std::chrono::steady_clock::time_point last_check;
+    FileWatcherAPI::PathTable::NodeId node;
+    std::vector<WatchBinding> bindings;
+};
+
+struct DebounceKey {
+    int wd;
+    std::uint32_t root;
+    std::string name;
     
-    WatchInfo() = default;
-    WatchInfo(std::string p, std::string cmd, std::uint32_t ev) noexcept
-        : path(std::move(p)), command(std::move(cmd)), events(ev), 
-          last_check(std::chrono::steady_clock::now()) {}
+    bool operator==(const DebounceKey&) const noexcept = default;
+};
+
+struct DebounceKeyHash {
+    std::size_t operator()(const DebounceKey& key) const noexcept {
+        return std::hash<std::string>{}(key.name) ^
+               (((static_cast<std::size_t>(key.wd) << 20) ^ key.root) * 0x9e3779b97f4a7c15ULL);
+    }
+};
+
+struct PendingEvent {
+    std::uint32_t mask;   // everything seen in the window, for $EVENTS
+    std::chrono::steady_clock::time_point deadline;
+    std::chrono::steady_clock::time_point first_seen;   // start of the burst, for latency
+    bool held = false;   // counted in an UnjournaledEntry
+};
+
+// A journaled directory entry whose debounced command has not been
+// submitted yet. The journal keeps `before` for it until then, so a run
+// killed inside the debounce window replays the change on the next start.
+struct UnjournaledEntry {
+    FileWatcherAPI::StatSnapshot before;
+    bool existed;
+    std::uint32_t mask;   // merged, for the record written on release
+    int pending;          // PendingEvents still waiting on it
 };
 
 class WatcherCore final {
 public:
-    WatcherCore() noexcept;
+    // The stats file is rewritten at most this often, and only after a change.
+    static constexpr std::chrono::seconds kStatsFileInterval{10};
+    // The journal is rewritten from the snapshots at most this often, and
+    // only after a change; in between, events are appended to it.
+    static constexpr std::chrono::seconds kJournalCheckpointInterval{60};
+    
+    // `broker` names the socket of `filewatcher --broker` for BackendKind::BROKER.
+    explicit WatcherCore(FileWatcherAPI::BackendKind backend = FileWatcherAPI::BackendKind::INOTIFY,
+                         std::string_view broker = FileWatcherAPI::kDefaultBroker) noexcept;
     ~WatcherCore() noexcept;
     
     WatcherCore(const WatcherCore&) = delete;
@@ -36,29 +93,130 @@ public:
     WatcherCore(WatcherCore&&) = delete;
     WatcherCore& operator=(WatcherCore&&) = delete;
     
-    bool add_watch(std::string_view path, std::string_view command, std::uint32_t events) noexcept;
+    bool add_watch(std::string_view path, std::string_view command, std::uint32_t events,
+                   bool recursive = false, int max_depth = -1) noexcept;
+    
+    // Makes `rules` the watched set, matching rules by name: unchanged rules
+    // keep their watches, rules that only changed their command, filters or
+    // debounce are updated in place, and everything else is re-added or
+    // dropped. Returns how many rules could not be watched.
+    std::size_t apply_rules(const std::vector<WatchRule>& rules) noexcept;
+    
+    // Reloads the file with load_rules() and applies it on every SIGHUP.
+    void set_rules_file(std::string_view file) noexcept;
     
     void start() noexcept;
     void stop() noexcept;
     
     void set_periodic_check(int interval_seconds) noexcept;
     void set_one_shot(bool enabled) noexcept;
+    void set_content_hash(bool enabled) noexcept;
+    void set_max_concurrency(int limit) noexcept;
+    void set_debounce(int milliseconds) noexcept;
+    void set_read_buffer_size(size_t bytes) noexcept;
+    
+    [[nodiscard]] std::uint64_t overflow_count() const noexcept { return overflows_.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::uint64_t resync_count() const noexcept { return resyncs_.load(std::memory_order_relaxed); }
+    
+    // Counters and the event-to-command latency histogram. They cost a few
+    // increments per event; rendering happens only when asked for: on
+    // SIGUSR1 (to stdout), per connection to the abstract socket @<name>,
+    // or into a Prometheus text file for the WebUI.
+    [[nodiscard]] const MetricsRegistry& metrics() const noexcept { return metrics_; }
+    void dump_stats(std::FILE* stream) const noexcept;
+    void enable_stats_signal() noexcept;
+    bool set_stats_socket(std::string_view name) noexcept;
+    void set_stats_file(std::string_view path) noexcept;
+    
+    // Keeps every watched directory's snapshot in an EventJournal at
+    // `path`. Call before adding watches: start() then diffs what a
+    // previous run left there against the tree as it is now, handles the
+    // differences as ordinary events, and checkpoints. On a cold start
+    // (no file yet) nothing is replayed.
+    bool set_journal(std::string_view path, std::string& error) noexcept;
+    [[nodiscard]] std::uint64_t replayed_count() const noexcept { return replayed_; }
     
 private:
-    void process_events(std::string_view buffer) noexcept;
-    void execute_command(std::string_view command, const std::string& path, 
-                        const struct inotify_event* event) noexcept;
+    void handle_event(int wd, std::uint32_t mask, std::string_view name) noexcept;
+    void resync() noexcept;
+    bool queue_event(int wd, std::uint32_t root, std::string_view name, std::uint32_t mask, int debounce_ms) noexcept;
+    std::chrono::steady_clock::time_point flush_pending(bool all = false) noexcept;
+    void release_entry(int wd, const std::string& name) noexcept;
+    void handle_signals() noexcept;
+    void watch_signal(int signo) noexcept;
+    void register_metrics() noexcept;
+    [[nodiscard]] std::uint64_t stats_version() const noexcept;
+    std::chrono::steady_clock::time_point update_stats_file(std::chrono::steady_clock::time_point now) noexcept;
+    void arm_timer(std::chrono::steady_clock::time_point deadline) noexcept;
+    void replay_journal() noexcept;
+    void write_checkpoint() noexcept;
+    std::chrono::steady_clock::time_point update_journal(std::chrono::steady_clock::time_point now) noexcept;
+    void journal_event(std::string_view dir, std::string_view name, std::uint32_t mask,
+                       const FileWatcherAPI::DirectorySnapshot& snapshot) noexcept;
+    void journal_directories(const std::vector<int>& wds) noexcept;
+    void execute_command(std::uint32_t root, FileWatcherAPI::PathTable::NodeId node, std::string_view name,
+                         std::uint32_t mask, std::chrono::steady_clock::time_point since) noexcept;
+    bool add_root(WatchRoot root, std::string_view path) noexcept;
+    void remove_root(std::uint32_t root) noexcept;
+    void reload_rules() noexcept;
+    void attach_subtree(const std::vector<FileWatcherAPI::WalkedDir>& dirs, FileWatcherAPI::PathTable::NodeId top,
+                        std::uint32_t root, int depth) noexcept;
+    void watch_subtree(int parent_wd, WatchBinding binding, std::string_view name) noexcept;
+    void unwatch_subtree(int parent_wd, std::string_view name) noexcept;
+    void forget_watch(int wd) noexcept;
+    void refresh_mask(int wd, const WatchInfo& watch) noexcept;
+    [[nodiscard]] std::uint32_t kernel_mask(const WatchRoot& root) const noexcept;
     void periodic_check() noexcept;
-    bool file_changed(const std::string& path, std::chrono::steady_clock::time_point& last_check) noexcept;
+    void rescan() noexcept;
+    void build_path(FileWatcherAPI::PathTable::NodeId node, std::string_view name, std::string& out) const noexcept;
     
-#ifdef ANDROID_DOZE_AWARE
-    void setup_doze_protection() noexcept;
+    FileWatcherAPI::WatchBackend backend_;
+    int epoll_fd_ = -1;
+    int timer_fd_ = -1;
     int wake_fd_ = -1;
-#endif
-    
-    int inotify_fd_ = -1;
+    int signal_fd_ = -1;
     std::atomic<bool> running_{false};
     std::atomic<bool> one_shot_{false};
     std::atomic<int> periodic_interval_{0};
+    std::atomic<int> debounce_ms_{0};
+    std::uint64_t fired_ = 0;
+    std::uint64_t events_ = 0;
+    std::uint64_t coalesced_ = 0;
+    std::chrono::steady_clock::time_point event_time_;   // when the current batch was read
+    std::atomic<std::uint64_t> overflows_{0};
+    std::atomic<std::uint64_t> resyncs_{0};
+    bool resync_pending_ = false;
+    bool reload_pending_ = false;
+    bool hash_content_ = false;
+    std::chrono::steady_clock::time_point next_periodic_ = std::chrono::steady_clock::time_point::max();
+    std::chrono::steady_clock::time_point armed_deadline_ = std::chrono::steady_clock::time_point::max();
+    std::vector<WatchRoot> roots_;
     std::unordered_map<int, WatchInfo> watches_;
+    FileWatcherAPI::PathTable paths_;
+    std::unordered_map<int, FileWatcherAPI::DirectorySnapshot> snapshots_;
+    std::unordered_map<DebounceKey, PendingEvent, DebounceKeyHash> pending_;
+    std::unordered_map<DebounceKey, UnjournaledEntry, DebounceKeyHash> unjournaled_;   // root is always 0
+    
+    struct ActiveRule {
+        WatchRule rule;
+        std::uint32_t root;
+    };
+    std::vector<ActiveRule> rules_;
+    std::string rules_file_;
+    std::vector<WatchBinding> bindings_;   // handle_event() scratch
+    CommandRunner runner_;
+    MetricsRegistry metrics_;
+    StatsEndpoint stats_endpoint_;
+    std::string stats_file_;
+    std::uint64_t stats_file_version_ = ~std::uint64_t{0};
+    std::chrono::steady_clock::time_point next_stats_write_{};
+    EventJournal journal_;
+    std::chrono::steady_clock::time_point next_checkpoint_{};
+    std::uint64_t replayed_ = 0;
+    std::uint64_t checkpoints_ = 0;
+    sigset_t signal_mask_;
+    sigset_t saved_mask_;
+    std::string file_arg_;
+    std::string events_arg_;
+    std::string dir_arg_;   // handle_event()'s directory, which execute_command() must not clobber
 };
\ No newline at end of file
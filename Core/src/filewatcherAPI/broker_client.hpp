@@ -0,0 +1,326 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "broker_protocol.hpp"
+
+namespace FileWatcherAPI {
+
+// A subscription to the watch broker, with the interface of an inotify
+// instance: add_watch()/remove_watch() by path and id, one fd to poll,
+// and drain() to read events. WatchBackend uses it for
+// BackendKind::BROKER, so WatcherCore and FileWatcher share the broker's
+// single inotify instance (and its watches) without other changes.
+//
+// Ids are the broker's, so two subscribers watching one path get the same
+// id, as two inotify_add_watch() calls on one instance would. drain()
+// hands out names that point straight into the shared ring; like the
+// read buffer of a plain inotify fd, they are only valid until on_event
+// returns. A subscriber that stays inside on_event while the broker
+// writes a whole ring of events is overrun: it gets IN_Q_OVERFLOW, and
+// the name it was handed may have been overwritten.
+//
+// If the broker goes away, every watch ends with IN_IGNORED, as on an
+// unmount, and later add_watch() calls fail with ENOTCONN.
+class BrokerClient {
+public:
+    BrokerClient() = default;
+    ~BrokerClient() { disconnect(); }
+
+    BrokerClient(const BrokerClient&) = delete;
+    BrokerClient& operator=(const BrokerClient&) = delete;
+
+    // Connects to @name and maps the ring. False with errno on failure.
+    bool connect(std::string_view name) noexcept {
+        disconnect();
+        socket_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        struct sockaddr_un addr;
+        const socklen_t len = broker::abstract_address(name, addr);
+        if (socket_ < 0 || ::connect(socket_, reinterpret_cast<const struct sockaddr*>(&addr), len) != 0) {
+            return fail(errno);
+        }
+
+        broker::Hello hello{};
+        int fds[2];
+        const ssize_t received = broker::receive_with_fds(socket_, &hello, sizeof(hello), fds, 2);
+        event_fd_ = fds[1];
+        if (received != static_cast<ssize_t>(sizeof(hello)) || fds[0] < 0 || fds[1] < 0 ||
+            hello.magic != broker::kMagic || hello.version != broker::kVersion ||
+            hello.slot >= broker::kMaxSubscribers || hello.map_size <= broker::kRingDataOffset) {
+            if (fds[0] >= 0) {
+                close(fds[0]);
+            }
+            // The broker closes the connection when all slots are taken.
+            return fail(received == 0 ? EUSERS : EPROTO);
+        }
+        void* mapping = mmap(nullptr, hello.map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+        const int map_errno = errno;
+        close(fds[0]);
+        if (mapping == MAP_FAILED) {
+            return fail(map_errno);
+        }
+        map_ = static_cast<char*>(mapping);
+        map_size_ = hello.map_size;
+        header_ = reinterpret_cast<broker::RingHeader*>(map_);
+        if (header_->magic != broker::kMagic ||
+            header_->capacity + broker::kRingDataOffset > map_size_ ||
+            (header_->capacity & (header_->capacity - 1)) != 0) {
+            return fail(EPROTO);
+        }
+        data_ = map_ + broker::kRingDataOffset;
+        capacity_ = header_->capacity;
+        slot_ = &header_->slots[hello.slot];
+        bit_ = std::uint64_t{1} << hello.slot;
+        cursor_ = slot_->cursor.load(std::memory_order_acquire);
+
+        // One fd for the owner to poll: the eventfd for events, the socket
+        // only for the broker hanging up (replies are read synchronously).
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        struct epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = event_fd_;
+        if (epoll_fd_ < 0 || epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &ev) != 0) {
+            return fail(errno);
+        }
+        ev.events = EPOLLRDHUP;
+        ev.data.fd = socket_;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket_, &ev) != 0) {
+            return fail(errno);
+        }
+        connected_ = true;
+        return true;
+    }
+
+    void disconnect() noexcept {
+        for (int* fd : {&epoll_fd_, &event_fd_, &socket_}) {
+            if (*fd >= 0) {
+                close(*fd);
+                *fd = -1;
+            }
+        }
+        if (map_) {
+            munmap(map_, map_size_);
+            map_ = nullptr;
+        }
+        connected_ = false;
+        watches_.clear();
+        ignored_.clear();
+    }
+
+    // Poll for EPOLLIN, then drain(). -1 when not connected.
+    [[nodiscard]] int fd() const noexcept { return epoll_fd_; }
+
+    // inotify_add_watch() semantics, answered by the broker. Thread-safe.
+    // A relative path is resolved against our working directory, not the
+    // broker's.
+    int add_watch(const char* path, std::uint32_t mask) noexcept {
+        char absolute[PATH_MAX];
+        std::size_t length = 0;
+        if (path[0] != '/') {
+            if (!getcwd(absolute, sizeof(absolute))) {
+                return -1;
+            }
+            length = std::strlen(absolute);
+            absolute[length++] = '/';
+        }
+        const std::size_t relative = std::strlen(path);
+        if (length + relative >= sizeof(absolute)) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        std::memcpy(absolute + length, path, relative);
+        length += relative;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        broker::Reply reply;
+        if (!request(broker::Request{broker::Op::ADD_WATCH, mask, -1, 0}, {absolute, length}, reply)) {
+            return -1;
+        }
+        if (reply.wd < 0) {
+            errno = reply.error;
+            return -1;
+        }
+        // Removed and re-added before the IN_IGNORED went out: other
+        // subscribers kept the broker's id alive, so it is the same watch.
+        if (const auto it = std::find(ignored_.begin(), ignored_.end(), reply.wd); it != ignored_.end()) {
+            ignored_.erase(it);
+        }
+        watches_.insert(reply.wd);
+        return reply.wd;
+    }
+
+    // Thread-safe. Its IN_IGNORED follows through drain().
+    void remove_watch(int id) noexcept {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (watches_.erase(id) == 0) {
+            return;
+        }
+        broker::Reply reply;
+        (void)request(broker::Request{broker::Op::REMOVE_WATCH, 0, id, 0}, {}, reply);
+        ignored_.push_back(id);
+        const std::uint64_t one = 1;
+        (void)!write(event_fd_, &one, sizeof(one));
+    }
+
+    // Calls on_event(int id, uint32_t mask, std::string_view name) for each
+    // event the broker published for this subscriber since the last call.
+    // on_event may call add_watch()/remove_watch().
+    template <typename OnEvent>
+    void drain(OnEvent&& on_event) {
+        if (!map_) {
+            return;
+        }
+        struct epoll_event ready[2];
+        bool hung_up = false;
+        const int count = epoll_wait(epoll_fd_, ready, 2, 0);
+        for (int i = 0; i < count; ++i) {
+            if (ready[i].data.fd == event_fd_) {
+                std::uint64_t counter;
+                (void)!read(event_fd_, &counter, sizeof(counter));
+            } else {
+                hung_up = true;
+            }
+        }
+
+        read_ring(on_event);
+        deliver_ignored(on_event);
+        if (hung_up) {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, socket_, nullptr);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                connected_ = false;
+                ignored_.assign(watches_.begin(), watches_.end());
+                watches_.clear();
+            }
+            deliver_ignored(on_event);
+        }
+    }
+
+private:
+    bool fail(int error) noexcept {
+        disconnect();
+        errno = error;
+        return false;
+    }
+
+    // Caller holds mutex_.
+    bool request(const broker::Request& header, std::string_view path, broker::Reply& reply) noexcept {
+        if (!connected_) {
+            errno = ENOTCONN;
+            return false;
+        }
+        char packet[sizeof(broker::Request) + PATH_MAX];
+        std::memcpy(packet, &header, sizeof(header));
+        std::memcpy(packet + sizeof(header), path.data(), path.size());
+        const std::size_t size = sizeof(header) + path.size();
+        if (send(socket_, packet, size, MSG_NOSIGNAL) != static_cast<ssize_t>(size)) {
+            return false;
+        }
+        ssize_t received;
+        do {
+            received = recv(socket_, &reply, sizeof(reply), 0);
+        } while (received < 0 && errno == EINTR);
+        if (received != static_cast<ssize_t>(sizeof(reply))) {
+            errno = received == 0 ? ENOTCONN : errno;
+            return false;
+        }
+        return true;
+    }
+
+    template <typename OnEvent>
+    void read_ring(OnEvent& on_event) {
+        std::uint64_t head = header_->head.load(std::memory_order_acquire);
+        while (cursor_ != head) {
+            if (slot_->state.load(std::memory_order_acquire) == broker::SLOT_OVERRUN || head - cursor_ > capacity_) {
+                // Lapped: skip to the present and let the owner resync.
+                cursor_ = header_->head.load(std::memory_order_acquire);
+                slot_->cursor.store(cursor_, std::memory_order_release);
+                std::uint32_t expected = broker::SLOT_OVERRUN;
+                slot_->state.compare_exchange_strong(expected, broker::SLOT_ACTIVE, std::memory_order_acq_rel);
+                on_event(-1, static_cast<std::uint32_t>(IN_Q_OVERFLOW), std::string_view{});
+                head = header_->head.load(std::memory_order_acquire);
+                continue;
+            }
+
+            const std::size_t offset = static_cast<std::size_t>(cursor_ & (capacity_ - 1));
+            if (capacity_ - offset < sizeof(broker::RecordHeader)) {
+                advance(capacity_ - offset);
+                continue;
+            }
+            broker::RecordHeader record;
+            std::memcpy(&record, data_ + offset, sizeof(record));
+            if (record.size < sizeof(record) || record.size > capacity_ - offset ||
+                record.name_length > record.size - sizeof(record)) {
+                // Only a record being overwritten under us looks like this.
+                slot_->state.store(broker::SLOT_OVERRUN, std::memory_order_release);
+                continue;
+            }
+            if (record.subscribers & bit_) {
+                bool watched = record.wd < 0;
+                if (!watched) {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    watched = (record.mask & IN_IGNORED) ? watches_.erase(record.wd) > 0 : watches_.contains(record.wd);
+                }
+                if (watched) {
+                    on_event(record.wd, record.mask,
+                             std::string_view{data_ + offset + sizeof(record), record.name_length});
+                }
+            }
+            advance(record.size);
+        }
+    }
+
+    void advance(std::size_t bytes) noexcept {
+        cursor_ += bytes;
+        slot_->cursor.store(cursor_, std::memory_order_release);
+    }
+
+    template <typename OnEvent>
+    void deliver_ignored(OnEvent& on_event) {
+        // on_event may remove watches and queue more.
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (ignored_.empty()) {
+                    return;
+                }
+                delivering_.swap(ignored_);
+            }
+            for (const int id : delivering_) {
+                on_event(id, static_cast<std::uint32_t>(IN_IGNORED), std::string_view{});
+            }
+            delivering_.clear();
+        }
+    }
+
+    int socket_ = -1;
+    int event_fd_ = -1;
+    int epoll_fd_ = -1;
+    char* map_ = nullptr;
+    std::size_t map_size_ = 0;
+    broker::RingHeader* header_ = nullptr;
+    const char* data_ = nullptr;
+    std::uint64_t capacity_ = 0;
+    broker::RingSlot* slot_ = nullptr;
+    std::uint64_t bit_ = 0;
+    std::uint64_t cursor_ = 0;   // drain() thread only
+
+    std::mutex mutex_;   // the socket, watches_ and ignored_
+    bool connected_ = false;
+    std::unordered_set<int> watches_;
+    std::vector<int> ignored_;
+    std::vector<int> delivering_;   // drain() thread only
+};
+
+} // namespace FileWatcherAPI
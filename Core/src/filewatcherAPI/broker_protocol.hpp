@@ -0,0 +1,164 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace FileWatcherAPI {
+
+// The abstract socket `filewatcher --broker` listens on unless told otherwise.
+inline constexpr std::string_view kDefaultBroker = "aurora_watch_broker";
+
+// Wire format between the watch broker (one inotify instance, owned by
+// `filewatcher --broker`) and its subscribers (BrokerClient).
+//
+// Control goes over a SOCK_SEQPACKET socket, one message per packet:
+// the broker greets each connection with a Hello carrying two fds (the
+// ring's memfd and the subscriber's eventfd), then answers every Request
+// with a Reply, in order.
+//
+// Events go through the ring: a memfd both sides map, which the broker
+// appends to once per event and every subscriber reads in place. Each
+// record names the subscribers it is for in a 64-bit mask, so a
+// subscriber skips the rest with one test, and the broker signals only
+// the eventfds of subscribers that got something. The broker never waits
+// for a reader: a subscriber a whole ring behind is marked overrun and
+// told so with an IN_Q_OVERFLOW, exactly like a full inotify queue.
+namespace broker {
+
+constexpr std::uint32_t kMagic = 0x4b525742;   // "BWRK"
+constexpr std::uint32_t kVersion = 1;
+constexpr std::size_t kMaxSubscribers = 64;
+constexpr std::size_t kRecordAlign = 8;
+
+// Sent to every subscriber of a watch whatever mask it asked for, as the
+// kernel does.
+constexpr std::uint32_t kAlwaysDelivered = IN_IGNORED | IN_UNMOUNT | IN_Q_OVERFLOW;
+// What a request may carry besides events. IN_ONLYDIR and IN_DONT_FOLLOW
+// reach inotify_add_watch(); IN_MASK_ADD merges with the subscriber's own
+// earlier mask; IN_EXCL_UNLINK is accepted and ignored, since it would
+// change what the other subscribers of the watch see.
+constexpr std::uint32_t kRequestFlags = IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK | IN_MASK_ADD;
+
+enum SlotState : std::uint32_t { SLOT_FREE = 0, SLOT_ACTIVE = 1, SLOT_OVERRUN = 2 };
+
+// One per connected subscriber. The subscriber advances `cursor` as it
+// reads; the broker only compares it, to find readers it is about to lap.
+struct alignas(64) RingSlot {
+    std::atomic<std::uint64_t> cursor;
+    std::atomic<std::uint32_t> state;
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free,
+              "ring atomics are shared between processes");
+
+struct RingHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t capacity;                        // data bytes, a power of two
+    alignas(64) std::atomic<std::uint64_t> head;   // bytes ever written; records end here
+    RingSlot slots[kMaxSubscribers];
+};
+
+constexpr std::size_t kRingDataOffset = (sizeof(RingHeader) + 4095) & ~static_cast<std::size_t>(4095);
+
+// Followed by the name (no NUL), padded to kRecordAlign. A record never
+// wraps: when the rest of the ring is too short, the broker pads it with a
+// record for nobody, or leaves it for both sides to skip when not even a
+// header fits.
+struct RecordHeader {
+    std::uint32_t size;          // header, name and padding
+    std::uint32_t mask;          // as inotify reported it
+    std::int32_t wd;             // the broker's watch id, -1 with IN_Q_OVERFLOW
+    std::uint16_t name_length;
+    std::uint16_t reserved;
+    std::uint64_t subscribers;   // bit n: slot n
+};
+static_assert(sizeof(RecordHeader) == 24);
+
+struct Hello {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t slot;
+    std::uint32_t reserved;
+    std::uint64_t map_size;   // of the memfd, header included
+};
+
+enum class Op : std::uint32_t { ADD_WATCH = 1, REMOVE_WATCH = 2 };
+
+// Followed by the path (no NUL) for ADD_WATCH.
+struct Request {
+    Op op;
+    std::uint32_t mask;   // inotify_add_watch() mask, kRequestFlags included
+    std::int32_t wd;      // REMOVE_WATCH
+    std::uint32_t reserved;
+};
+
+struct Reply {
+    std::int32_t wd;      // -1 on failure
+    std::int32_t error;   // errno
+};
+
+inline socklen_t abstract_address(std::string_view name, struct sockaddr_un& addr) noexcept {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    const std::size_t length = name.size() < sizeof(addr.sun_path) - 1 ? name.size() : sizeof(addr.sun_path) - 1;
+    std::memcpy(addr.sun_path + 1, name.data(), length);
+    return static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + 1 + length);
+}
+
+// One packet carrying up to two fds; the broker's greeting.
+inline bool send_with_fds(int socket, const void* data, std::size_t size, const int* fds, std::size_t count) noexcept {
+    struct iovec iov{const_cast<void*>(data), size};
+    alignas(struct cmsghdr) char control[CMSG_SPACE(2 * sizeof(int))] = {};
+    struct msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = CMSG_SPACE(count * sizeof(int));
+    struct cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(count * sizeof(int));
+    std::memcpy(CMSG_DATA(header), fds, count * sizeof(int));
+    return sendmsg(socket, &message, MSG_NOSIGNAL) == static_cast<ssize_t>(size);
+}
+
+// Receives one packet; `fds` gets what came with it, -1 for the rest.
+inline ssize_t receive_with_fds(int socket, void* data, std::size_t size, int* fds, std::size_t count) noexcept {
+    struct iovec iov{data, size};
+    alignas(struct cmsghdr) char control[CMSG_SPACE(2 * sizeof(int))] = {};
+    struct msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    for (std::size_t i = 0; i < count; ++i) {
+        fds[i] = -1;
+    }
+    const ssize_t received = recvmsg(socket, &message, MSG_CMSG_CLOEXEC);
+    for (struct cmsghdr* header = received >= 0 ? CMSG_FIRSTHDR(&message) : nullptr; header;
+         header = CMSG_NXTHDR(&message, header)) {
+        if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+            const std::size_t received_fds = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (std::size_t i = 0; i < received_fds; ++i) {
+                int fd;
+                std::memcpy(&fd, CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+                if (i < count) {
+                    fds[i] = fd;
+                } else {
+                    close(fd);
+                }
+            }
+        }
+    }
+    return received;
+}
+
+} // namespace broker
+} // namespace FileWatcherAPI
@@ -0,0 +1,299 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace FileWatcherAPI {
+
+// What submit() does when the strand a job maps to is full.
+enum class Backpressure {
+    BLOCK,        // wait for the strand's workers to make room
+    DROP_OLDEST,  // discard the strand's oldest pending job
+    COALESCE      // merge into the key's latest pending job if identical; drop-oldest if full
+};
+
+struct DispatchOptions {
+    unsigned threads = 0;          // 0: hardware_concurrency(), at most 8
+    size_t strands = 64;           // serialization lanes, rounded up to a power of two
+    size_t queue_capacity = 256;   // pending jobs per strand
+    Backpressure policy = Backpressure::BLOCK;
+};
+
+struct DispatchStats {
+    uint64_t submitted = 0;
+    uint64_t executed = 0;
+    uint64_t dropped = 0;
+    uint64_t coalesced = 0;
+    uint64_t stolen = 0;       // strands a worker took from another's deque
+    size_t queued = 0;         // jobs waiting right now
+    size_t max_queued = 0;     // high-water mark of `queued`
+};
+
+// Work-stealing pool with keyed serialization. Jobs with the same key hash
+// to the same strand, and a strand is only ever in one worker's deque (or
+// running) at a time, so jobs for one key run in submission order while
+// different keys run in parallel. Idle workers steal whole strands from the
+// back of other workers' deques.
+//
+// Job needs `uint64_t key() const`, `bool coalesces_with(const Job&) const`
+// and `void operator()()`.
+template <typename Job>
+class DispatchExecutor {
+public:
+    explicit DispatchExecutor(const DispatchOptions& options = {}) : options_(options) {
+        size_t strands = 1;
+        while (strands < std::max<size_t>(options.strands, 1)) {
+            strands <<= 1;
+        }
+        strands_ = std::make_unique<Strand[]>(strands);
+        strand_mask_ = strands - 1;
+        options_.queue_capacity = std::max<size_t>(options.queue_capacity, 1);
+
+        unsigned threads = options.threads ? options.threads : std::min(std::thread::hardware_concurrency(), 8u);
+        threads = std::max(threads, 1u);
+        for (unsigned i = 0; i < threads; ++i) {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+    }
+
+    ~DispatchExecutor() {
+        stop();
+    }
+
+    DispatchExecutor(const DispatchExecutor&) = delete;
+    DispatchExecutor& operator=(const DispatchExecutor&) = delete;
+
+    void start() {
+        std::lock_guard<std::mutex> lock(idle_mutex_);
+        if (running_) {
+            return;
+        }
+        running_ = true;
+        accepting_.store(true, std::memory_order_release);
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            workers_[i]->thread = std::thread(&DispatchExecutor::worker_loop, this, i);
+        }
+    }
+
+    // Runs whatever is still queued, then joins the workers.
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex_);
+            if (!running_) {
+                return;
+            }
+            running_ = false;
+        }
+        accepting_.store(false, std::memory_order_release);
+        idle_cv_.notify_all();
+        for (size_t i = 0; i <= strand_mask_; ++i) {
+            std::lock_guard<std::mutex> lock(strands_[i].mutex);
+            strands_[i].space.notify_all();
+        }
+        for (auto& worker : workers_) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+    }
+
+    // Returns false when the job was discarded (BLOCK while stopping).
+    bool submit(Job job) {
+        submitted_.fetch_add(1, std::memory_order_relaxed);
+        const size_t index = static_cast<size_t>(mix(job.key())) & strand_mask_;
+        Strand& strand = strands_[index];
+
+        std::unique_lock<std::mutex> lock(strand.mutex);
+        if (options_.policy == Backpressure::COALESCE) {
+            // Only the latest pending job for this key may absorb it: merging
+            // past a different one ([MODIFY f, DELETE f] + MODIFY f) would
+            // reorder the key's events.
+            const uint64_t key = job.key();
+            for (auto it = strand.queue.rbegin(); it != strand.queue.rend(); ++it) {
+                if (it->key() != key) {
+                    continue;
+                }
+                if (it->coalesces_with(job)) {
+                    coalesced_.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+                break;
+            }
+        }
+        if (strand.queue.size() >= options_.queue_capacity) {
+            if (options_.policy == Backpressure::BLOCK) {
+                strand.space.wait(lock, [&] {
+                    return strand.queue.size() < options_.queue_capacity || !accepting_.load(std::memory_order_acquire);
+                });
+                if (strand.queue.size() >= options_.queue_capacity) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+            } else {
+                strand.queue.pop_front();
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                queued_.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+        strand.queue.push_back(std::move(job));
+        const size_t depth = queued_.fetch_add(1, std::memory_order_relaxed) + 1;
+        size_t high = max_queued_.load(std::memory_order_relaxed);
+        while (depth > high && !max_queued_.compare_exchange_weak(high, depth, std::memory_order_relaxed)) {
+        }
+
+        if (!strand.scheduled) {
+            strand.scheduled = true;
+            lock.unlock();
+            schedule(index % workers_.size(), index);
+        }
+        return true;
+    }
+
+    DispatchStats stats() const {
+        DispatchStats stats;
+        stats.submitted = submitted_.load(std::memory_order_relaxed);
+        stats.executed = executed_.load(std::memory_order_relaxed);
+        stats.dropped = dropped_.load(std::memory_order_relaxed);
+        stats.coalesced = coalesced_.load(std::memory_order_relaxed);
+        stats.stolen = stolen_.load(std::memory_order_relaxed);
+        stats.queued = queued_.load(std::memory_order_relaxed);
+        stats.max_queued = max_queued_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    size_t thread_count() const {
+        return workers_.size();
+    }
+
+private:
+    // Jobs a worker runs from one strand before yielding it, so one busy
+    // key cannot monopolize a thread while other strands wait behind it.
+    static constexpr size_t kStrandBatch = 16;
+
+    struct Strand {
+        std::mutex mutex;
+        std::condition_variable space;
+        std::deque<Job> queue;
+        bool scheduled = false;   // sitting in a worker deque or being run
+    };
+
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        std::deque<size_t> ready;   // strand indices
+        std::thread thread;
+    };
+
+    static uint64_t mix(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return key;
+    }
+
+    void schedule(size_t worker, size_t strand) {
+        {
+            std::lock_guard<std::mutex> lock(workers_[worker]->mutex);
+            workers_[worker]->ready.push_back(strand);
+        }
+        // Taking idle_mutex_ orders this against a worker that has just
+        // found every deque empty and is about to sleep.
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex_);
+            ++pending_strands_;
+        }
+        idle_cv_.notify_one();
+    }
+
+    bool take(size_t self, size_t& strand) {
+        {
+            Worker& own = *workers_[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.ready.empty()) {
+                strand = own.ready.front();
+                own.ready.pop_front();
+                return true;
+            }
+        }
+        for (size_t offset = 1; offset < workers_.size(); ++offset) {
+            Worker& victim = *workers_[(self + offset) % workers_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.ready.empty()) {
+                strand = victim.ready.back();
+                victim.ready.pop_back();
+                stolen_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run_strand(size_t self, size_t index) {
+        Strand& strand = strands_[index];
+        std::unique_lock<std::mutex> lock(strand.mutex);
+        for (size_t n = 0; n < kStrandBatch && !strand.queue.empty(); ++n) {
+            Job job = std::move(strand.queue.front());
+            strand.queue.pop_front();
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            strand.space.notify_one();
+            lock.unlock();
+            job();
+            executed_.fetch_add(1, std::memory_order_relaxed);
+            lock.lock();
+        }
+        if (strand.queue.empty()) {
+            strand.scheduled = false;
+            return;
+        }
+        // Still busy: requeue behind whatever else this worker has.
+        lock.unlock();
+        schedule(self, index);
+    }
+
+    void worker_loop(size_t self) {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(idle_mutex_);
+                idle_cv_.wait(lock, [&] { return pending_strands_ > 0 || !running_; });
+                if (pending_strands_ == 0) {
+                    break;   // stopped and fully drained
+                }
+                --pending_strands_;
+            }
+            size_t strand;
+            while (!take(self, strand)) {
+                // Counted but not yet pushed by a racing schedule(); rare.
+                std::this_thread::yield();
+            }
+            run_strand(self, strand);
+        }
+    }
+
+    DispatchOptions options_;
+    std::unique_ptr<Strand[]> strands_;
+    size_t strand_mask_ = 0;
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    std::mutex idle_mutex_;
+    std::condition_variable idle_cv_;
+    size_t pending_strands_ = 0;   // strand entries across all worker deques
+    bool running_ = false;
+    std::atomic<bool> accepting_{false};   // BLOCK submitters give up once cleared
+
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> executed_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> coalesced_{0};
+    std::atomic<uint64_t> stolen_{0};
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> max_queued_{0};
+};
+
+} // namespace FileWatcherAPI
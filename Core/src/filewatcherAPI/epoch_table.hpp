@@ -0,0 +1,104 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace FileWatcherAPI {
+
+// Copy-on-write map for one reader thread and any number of writers.
+//
+// The reader calls read() for a consistent version without taking a lock
+// and calls quiescent() whenever it holds no reference from an earlier
+// read() (FileWatcher does it before every epoll_wait()). Writers are
+// serialized by the caller; update() copies the live version, applies the
+// change and publishes the copy. The version it replaced is retired under
+// a new epoch and freed by a later writer once the reader has passed a
+// quiescent point in that epoch. defer() holds back other cleanup the
+// same way, for example strings the reader may still be looking at.
+template <typename Key, typename Value>
+class EpochTable {
+public:
+    using Map = std::unordered_map<Key, Value>;
+
+    EpochTable() : current_(new Map()) {}
+
+    ~EpochTable() {
+        delete current_.load(std::memory_order_relaxed);
+        reader_seen_.store(UINT64_MAX, std::memory_order_relaxed);
+        reclaim();
+    }
+
+    EpochTable(const EpochTable&) = delete;
+    EpochTable& operator=(const EpochTable&) = delete;
+
+    // Reader side.
+    const Map& read() const noexcept {
+        return *current_.load(std::memory_order_acquire);
+    }
+
+    void quiescent() noexcept {
+        reader_seen_.store(epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+
+    // With no reader thread running, retired versions can go immediately.
+    void set_reader_active(bool active) noexcept {
+        reader_seen_.store(active ? epoch_.load(std::memory_order_seq_cst) : UINT64_MAX,
+                           std::memory_order_seq_cst);
+    }
+
+    // Writer side; callers hold their own writer lock.
+    template <typename Mutate>
+    void update(Mutate&& mutate) {
+        Map* old_map = current_.load(std::memory_order_relaxed);
+        auto next = std::make_unique<Map>(*old_map);
+        mutate(*next);
+        current_.store(next.release(), std::memory_order_release);
+        const uint64_t epoch = epoch_.fetch_add(1, std::memory_order_seq_cst) + 1;
+        retired_.push_back({epoch, [old_map] { delete old_map; }});
+        reclaim();
+    }
+
+    // Runs `cleanup` once the reader can no longer see anything that was
+    // removed before this call.
+    void defer(std::function<void()> cleanup) {
+        const uint64_t epoch = epoch_.fetch_add(1, std::memory_order_seq_cst) + 1;
+        retired_.push_back({epoch, std::move(cleanup)});
+    }
+
+    void reclaim() {
+        const uint64_t seen = reader_seen_.load(std::memory_order_seq_cst);
+        size_t kept = 0;
+        for (auto& retired : retired_) {
+            if (retired.epoch <= seen) {
+                retired.cleanup();
+            } else {
+                retired_[kept++] = std::move(retired);
+            }
+        }
+        retired_.resize(kept);
+    }
+
+    // Read from a writer: the version it is about to replace.
+    const Map& latest() const noexcept {
+        return *current_.load(std::memory_order_relaxed);
+    }
+
+    size_t retired_count() const noexcept { return retired_.size(); }
+
+private:
+    struct Retired {
+        uint64_t epoch;
+        std::function<void()> cleanup;
+    };
+
+    std::atomic<Map*> current_;
+    std::atomic<uint64_t> epoch_{0};
+    std::atomic<uint64_t> reader_seen_{UINT64_MAX};
+    std::vector<Retired> retired_;
+};
+
+} // namespace FileWatcherAPI
@@ -0,0 +1,132 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "event_mask.hpp"
+#include "xxhash64.hpp"
+
+namespace FileWatcherAPI {
+
+struct BatchOptions {
+    // Merge the events for one file within a batch into one FileEvent,
+    // in the position of its first event, with the masks OR'd together.
+    bool dedup = false;
+    // How long a batch may stay open after its first event, collecting
+    // the events of later wakeups too. Zero: one batch per wakeup.
+    std::chrono::milliseconds max_latency{0};
+};
+
+// The events of one batch watch (FileWatcher::add_batch_watch()), held
+// until the batch is due; Event is FileEvent. They outlive the read
+// buffer, so their names are copied into one arena per batch rather than
+// into a string each, and the FileEvent views are built over it once, at
+// flush time.
+template <typename Event>
+class EventBatch {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void(std::span<const Event>)>;
+
+    EventBatch(Callback callback, const BatchOptions& options)
+        : callback_(std::move(callback)), options_(options) {}
+
+    EventBatch(const EventBatch&) = delete;
+    EventBatch& operator=(const EventBatch&) = delete;
+
+    // True when this event opened the batch: the caller schedules it.
+    bool add(const Event& event) {
+        const bool opened = entries_.empty();
+        if (opened) {
+            deadline_ = Clock::now() + options_.max_latency;
+        }
+        uint64_t hash = 0;
+        if (options_.dedup) {
+            hash = XXHash64::hash(event.path.data(), event.path.size());
+            hash = XXHash64::hash(event.filename.data(), event.filename.size(), hash);
+            if (auto it = index_.find(hash); it != index_.end()) {
+                Entry& entry = entries_[it->second];
+                if (name_of(entry.path) == event.path && name_of(entry.filename) == event.filename) {
+                    entry.mask |= event.mask;
+                    entry.types = EventSet::from_mask(entry.types.mask() | event.types.mask());
+                    return opened;
+                }
+            }
+        }
+        Entry entry{store(event.path), store(event.filename), event.mask, event.types};
+        if (options_.dedup) {
+            index_.try_emplace(hash, entries_.size());
+        }
+        entries_.push_back(entry);
+        return opened;
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return entries_.empty(); }
+
+    // From any thread: the watch is gone, so nothing more is delivered.
+    void cancel() noexcept { cancelled_.store(true, std::memory_order_relaxed); }
+    [[nodiscard]] Clock::time_point deadline() const noexcept { return deadline_; }
+
+    // Delivers and empties the batch.
+    void flush() {
+        if (entries_.empty()) {
+            return;
+        }
+        if (cancelled_.load(std::memory_order_relaxed)) {
+            entries_.clear();
+            index_.clear();
+            arena_.clear();
+            return;
+        }
+        views_.clear();
+        views_.reserve(entries_.size());
+        for (const Entry& entry : entries_) {
+            views_.push_back(Event{name_of(entry.path), name_of(entry.filename), entry.types.first(), entry.mask,
+                                   entry.types});
+        }
+        callback_(std::span<const Event>{views_});
+        entries_.clear();
+        index_.clear();
+        views_.clear();
+        arena_.clear();
+    }
+
+private:
+    struct Name {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    struct Entry {
+        Name path;
+        Name filename;
+        uint32_t mask;
+        EventSet types;
+    };
+
+    Name store(std::string_view text) {
+        const Name name{static_cast<uint32_t>(arena_.size()), static_cast<uint32_t>(text.size())};
+        arena_.append(text);
+        return name;
+    }
+
+    std::string_view name_of(Name name) const noexcept { return {arena_.data() + name.offset, name.size}; }
+
+    Callback callback_;
+    BatchOptions options_;
+    std::atomic<bool> cancelled_{false};
+    Clock::time_point deadline_{};
+    std::string arena_;
+    std::vector<Entry> entries_;
+    std::unordered_map<uint64_t, size_t> index_;   // file hash -> entry, with dedup
+    std::vector<Event> views_;
+};
+
+} // namespace FileWatcherAPI
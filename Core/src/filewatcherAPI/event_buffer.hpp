@@ -0,0 +1,76 @@
+#pragma once
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <string_view>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace FileWatcherAPI {
+
+// Cache-line aligned inotify read buffer. drain() keeps reading until the
+// kernel queue is empty so one wakeup picks up a whole burst instead of 4 KB.
+class EventBuffer {
+public:
+    static constexpr size_t kDefaultSize = 64 * 1024;
+    static constexpr size_t kMinSize = sizeof(struct inotify_event) + NAME_MAX + 1;
+    // Bounds one drain() so a flood on one fd cannot starve the rest of the
+    // loop; epoll is level-triggered and will report the fd again.
+    static constexpr int kMaxReadsPerDrain = 64;
+
+    explicit EventBuffer(size_t size = kDefaultSize) noexcept { resize(size); }
+
+    void resize(size_t size) noexcept {
+        size = size < kMinSize ? kMinSize : size;
+        size = (size + 63) & ~static_cast<size_t>(63);
+        void* memory = nullptr;
+        if (posix_memalign(&memory, 64, size) != 0) {
+            return;
+        }
+        data_.reset(static_cast<char*>(memory));
+        size_ = size;
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+
+    // Calls on_chunk(std::string_view) for every successful read. Returns the
+    // number of bytes consumed.
+    template <typename OnChunk>
+    size_t drain(int fd, OnChunk&& on_chunk) noexcept {
+        size_t total = 0;
+        for (int i = 0; i < kMaxReadsPerDrain && data_; ++i) {
+            const ssize_t len = read(fd, data_.get(), size_);
+            if (len <= 0) {
+                if (len < 0 && errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            total += static_cast<size_t>(len);
+            on_chunk(std::string_view{data_.get(), static_cast<size_t>(len)});
+        }
+        return total;
+    }
+
+private:
+    struct Free {
+        void operator()(char* ptr) const noexcept { std::free(ptr); }
+    };
+
+    std::unique_ptr<char, Free> data_;
+    size_t size_ = 0;
+};
+
+template <typename OnEvent>
+inline void for_each_event(std::string_view chunk, OnEvent&& on_event) noexcept {
+    size_t offset = 0;
+    while (offset + sizeof(struct inotify_event) <= chunk.size()) {
+        const auto* event = reinterpret_cast<const struct inotify_event*>(chunk.data() + offset);
+        on_event(event);
+        offset += sizeof(struct inotify_event) + event->len;
+    }
+}
+
+} // namespace FileWatcherAPI
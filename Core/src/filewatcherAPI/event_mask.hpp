@@ -0,0 +1,203 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <sys/inotify.h>
+
+namespace FileWatcherAPI {
+
+// Values are the inotify bits, so a type can still be or-ed into a mask.
+// MOVE covers both halves of a rename.
+enum class EventType : uint32_t {
+    MODIFY = IN_MODIFY,
+    CREATE = IN_CREATE,
+    DELETE = IN_DELETE,
+    MOVE = IN_MOVE,
+    ATTRIB = IN_ATTRIB,
+    ACCESS = IN_ACCESS,
+    CLOSE_WRITE = IN_CLOSE_WRITE,
+    CLOSE_NOWRITE = IN_CLOSE_NOWRITE,
+    OPEN = IN_OPEN,
+    DELETE_SELF = IN_DELETE_SELF,
+    MOVE_SELF = IN_MOVE_SELF
+};
+
+struct EventTypeInfo {
+    EventType type;
+    std::string_view name;    // as accepted by parse_event_mask()
+    std::string_view label;   // as printed by event_type_to_string()
+};
+
+// Position in this table is the type's bit in an EventSet.
+inline constexpr EventTypeInfo kEventTypes[] = {
+    {EventType::MODIFY, "modify", "MODIFY"},
+    {EventType::CREATE, "create", "CREATE"},
+    {EventType::DELETE, "delete", "DELETE"},
+    {EventType::MOVE, "move", "MOVE"},
+    {EventType::ATTRIB, "attrib", "ATTRIB"},
+    {EventType::ACCESS, "access", "ACCESS"},
+    {EventType::CLOSE_WRITE, "close_write", "CLOSE_WRITE"},
+    {EventType::CLOSE_NOWRITE, "close_nowrite", "CLOSE_NOWRITE"},
+    {EventType::OPEN, "open", "OPEN"},
+    {EventType::DELETE_SELF, "delete_self", "DELETE_SELF"},
+    {EventType::MOVE_SELF, "move_self", "MOVE_SELF"},
+};
+
+inline constexpr size_t kEventTypeCount = std::size(kEventTypes);
+
+// Names that are not a single type: halves of MOVE and combinations.
+struct EventAlias {
+    std::string_view name;
+    uint32_t mask;
+};
+
+inline constexpr EventAlias kEventAliases[] = {
+    {"moved_from", IN_MOVED_FROM},
+    {"moved_to", IN_MOVED_TO},
+    {"close", IN_CLOSE},
+    {"all", IN_ALL_EVENTS},
+};
+
+namespace detail {
+
+// inotify bit number -> index into kEventTypes, or kNoType.
+inline constexpr uint8_t kNoType = 0xff;
+
+inline constexpr std::array<uint8_t, 32> kTypeOfBit = [] {
+    std::array<uint8_t, 32> table{};
+    table.fill(kNoType);
+    for (size_t i = 0; i < kEventTypeCount; ++i) {
+        for (uint32_t bits = static_cast<uint32_t>(kEventTypes[i].type); bits; bits &= bits - 1) {
+            table[static_cast<size_t>(std::countr_zero(bits))] = static_cast<uint8_t>(i);
+        }
+    }
+    return table;
+}();
+
+} // namespace detail
+
+// The event types present in an inotify mask, one bit per kEventTypes entry.
+class EventSet {
+public:
+    constexpr EventSet() = default;
+
+    static constexpr EventSet from_mask(uint32_t mask) noexcept {
+        EventSet set;
+        for (; mask; mask &= mask - 1) {
+            const uint8_t index = detail::kTypeOfBit[static_cast<size_t>(std::countr_zero(mask))];
+            if (index != detail::kNoType) {
+                set.bits_ |= static_cast<uint16_t>(1u << index);
+            }
+        }
+        return set;
+    }
+
+    static constexpr size_t index_of(EventType type) noexcept {
+        for (size_t i = 0; i < kEventTypeCount; ++i) {
+            if (kEventTypes[i].type == type) {
+                return i;
+            }
+        }
+        return kEventTypeCount;
+    }
+
+    constexpr EventSet& add(EventType type) noexcept {
+        bits_ |= static_cast<uint16_t>(1u << index_of(type));
+        return *this;
+    }
+
+    [[nodiscard]] constexpr bool contains(EventType type) const noexcept {
+        return bits_ & (1u << index_of(type));
+    }
+
+    [[nodiscard]] constexpr bool empty() const noexcept { return bits_ == 0; }
+    [[nodiscard]] constexpr size_t size() const noexcept { return static_cast<size_t>(std::popcount(bits_)); }
+    [[nodiscard]] constexpr uint16_t bits() const noexcept { return bits_; }
+
+    // The first type in table order; only meaningful when !empty().
+    [[nodiscard]] constexpr EventType first() const noexcept {
+        return kEventTypes[static_cast<size_t>(std::countr_zero(bits_)) % kEventTypeCount].type;
+    }
+
+    [[nodiscard]] constexpr uint32_t mask() const noexcept {
+        uint32_t mask = 0;
+        for_each_index([&](size_t index) { mask |= static_cast<uint32_t>(kEventTypes[index].type); });
+        return mask;
+    }
+
+    // Calls f(size_t index) for each type present, lowest index first.
+    template <typename F>
+    constexpr void for_each_index(F&& f) const {
+        for (uint32_t bits = bits_; bits; bits &= bits - 1) {
+            f(static_cast<size_t>(std::countr_zero(bits)));
+        }
+    }
+
+    constexpr bool operator==(const EventSet&) const noexcept = default;
+
+private:
+    uint16_t bits_ = 0;
+};
+
+static_assert(kEventTypeCount <= 16, "EventSet holds one bit per event type");
+
+// Parses a list such as "modify,create" or "close_write|moved_to" into
+// `mask`. Names must match a kEventTypes or kEventAliases entry exactly.
+// On failure `mask` is untouched and, if given, `bad` names the offending
+// token (empty for an empty list).
+constexpr bool parse_event_mask(std::string_view list, uint32_t& mask, std::string_view* bad = nullptr) noexcept {
+    uint32_t parsed = 0;
+    bool any = false;
+    while (!list.empty()) {
+        const size_t end = list.find_first_of(",| ");
+        const std::string_view token = list.substr(0, end);
+        list.remove_prefix(end == std::string_view::npos ? list.size() : end + 1);
+        if (token.empty()) {
+            continue;
+        }
+        uint32_t bits = 0;
+        for (const auto& info : kEventTypes) {
+            if (info.name == token) {
+                bits = static_cast<uint32_t>(info.type);
+            }
+        }
+        for (const auto& alias : kEventAliases) {
+            if (alias.name == token) {
+                bits = alias.mask;
+            }
+        }
+        if (!bits) {
+            if (bad) {
+                *bad = token;
+            }
+            return false;
+        }
+        parsed |= bits;
+        any = true;
+    }
+    if (!any) {
+        if (bad) {
+            *bad = {};
+        }
+        return false;
+    }
+    mask = parsed;
+    return true;
+}
+
+// The types in `mask` as a list parse_event_mask() accepts, in table
+// order: "modify,close_write". Both halves of a rename print as "move".
+inline void format_event_mask(uint32_t mask, std::string& out) {
+    out.clear();
+    EventSet::from_mask(mask).for_each_index([&](size_t index) {
+        if (!out.empty()) {
+            out += ',';
+        }
+        out += kEventTypes[index].name;
+    });
+}
+
+} // namespace FileWatcherAPI
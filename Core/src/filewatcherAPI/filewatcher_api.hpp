@@ -1,135 +1,878 @@
 #pragma once
+#include <array>
 #include <string>
 #include <functional>
 #include <thread>
 #include <atomic>
+#include <coroutine>
+#include <deque>
 #include <unordered_map>
 #include <sys/inotify.h>
 #include <unistd.h>
-#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <memory>
+#include "dispatch_executor.hpp"
+#include "event_batch.hpp"
+#include "epoch_table.hpp"
+#include "event_mask.hpp"
+#include "path_table.hpp"
+#include "tree_walker.hpp"
+#include "watch_backend.hpp"
+#include "stat_snapshot.hpp"
+#include "xxhash64.hpp"
+#include <mutex>
 
 namespace FileWatcherAPI {
 
-enum class EventType {
-    MODIFY = IN_MODIFY,
-    CREATE = IN_CREATE,
-    DELETE = IN_DELETE,
-    MOVE = IN_MOVE,
-    ATTRIB = IN_ATTRIB,
-    ACCESS = IN_ACCESS
+// Delivered by reference and only valid for the duration of the callback:
+// `path` is the watch's interned directory path and `filename` points into
+// the backend's read buffer. Copy them if they are needed later.
+// `types` holds every watched type in the event; `type` is the first of
+// them, so it is always a valid enumerator even when several bits are set.
+struct FileEvent {
+    std::string_view path;
+    std::string_view filename;
+    EventType type;
+    uint32_t mask;
+    EventSet types;
 };
 
-struct FileEvent {
+using EventCallback = std::function<void(const FileEvent&)>;
+
+// A FileEvent that owns its names, for delivery after the read buffer has
+// moved on; what co_await FileWatcher::next() gives back.
+struct OwnedFileEvent {
     std::string path;
     std::string filename;
     EventType type;
     uint32_t mask;
+    EventSet types;
+    
+    FileEvent view() const { return FileEvent{path, filename, type, mask, types}; }
 };
 
-using EventCallback = std::function<void(const FileEvent&)>;
+// Owns a watch callback in its concrete type and calls it through a plain
+// function pointer made for that type, so add_watch() with a lambda skips
+// std::function entirely. Its one allocation happens in add_watch().
+class WatchCallback {
+public:
+    WatchCallback() = default;
+    
+    template <typename F>
+    static WatchCallback make(F&& callback) {
+        using Fn = std::decay_t<F>;
+        WatchCallback holder;
+        holder.object_ = new (std::nothrow) Fn(std::forward<F>(callback));
+        if (holder.object_) {
+            holder.invoke_ = [](void* object, const FileEvent& event) { (*static_cast<Fn*>(object))(event); };
+            holder.destroy_ = [](void* object) { delete static_cast<Fn*>(object); };
+        }
+        return holder;
+    }
+    
+    WatchCallback(WatchCallback&& other) noexcept
+        : object_(std::exchange(other.object_, nullptr)), invoke_(other.invoke_), destroy_(other.destroy_) {}
+    
+    WatchCallback& operator=(WatchCallback&& other) noexcept {
+        if (this != &other) {
+            reset();
+            object_ = std::exchange(other.object_, nullptr);
+            invoke_ = other.invoke_;
+            destroy_ = other.destroy_;
+        }
+        return *this;
+    }
+    
+    WatchCallback(const WatchCallback&) = delete;
+    WatchCallback& operator=(const WatchCallback&) = delete;
+    
+    ~WatchCallback() { reset(); }
+    
+    explicit operator bool() const { return object_ != nullptr; }
+    
+    void operator()(const FileEvent& event) const { invoke_(object_, event); }
+    
+private:
+    void reset() {
+        if (object_) {
+            destroy_(object_);
+            object_ = nullptr;
+        }
+    }
+    
+    void* object_ = nullptr;
+    void (*invoke_)(void*, const FileEvent&) = nullptr;
+    void (*destroy_)(void*) = nullptr;
+};
+
+// A callback per event type, usable wherever a watch callback is:
+//
+//   EventDispatch dispatch;
+//   dispatch.on(EventType::MODIFY, reload).on(EventType::DELETE, forget);
+//   const uint32_t events = dispatch.mask();
+//   watcher.add_watch(path, std::move(dispatch), events);
+//
+// An event carrying several types calls each handler once, with `type` set
+// to that handler's type. Handlers are found by indexing an array with the
+// event's EventSet bits, so delivery does no comparisons or lookups.
+class EventDispatch {
+public:
+    template <typename F>
+    EventDispatch& on(EventType type, F&& handler) {
+        const size_t index = EventSet::index_of(type);
+        if (index < kEventTypeCount) {
+            handlers_[index] = WatchCallback::make(std::forward<F>(handler));
+            handled_.add(type);
+        }
+        return *this;
+    }
+    
+    // The inotify events the registered handlers need.
+    uint32_t mask() const { return handled_.mask(); }
+    
+    void operator()(const FileEvent& event) const {
+        FileEvent single = event;
+        event.types.for_each_index([&](size_t index) {
+            if (handlers_[index]) {
+                single.type = kEventTypes[index].type;
+                handlers_[index](single);
+            }
+        });
+    }
+    
+private:
+    std::array<WatchCallback, kEventTypeCount> handlers_;
+    EventSet handled_;
+};
 
 class FileWatcher {
 public:
-    FileWatcher() : inotify_fd_(-1), running_(false) {
-        inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // BackendKind::FANOTIFY needs CAP_SYS_ADMIN; without it every
+    // add_watch() fails. BackendKind::BROKER subscribes to the watch broker
+    // listening on @broker (`filewatcher --broker`) instead of creating an
+    // inotify instance; if none is running, every add_watch() fails.
+    explicit FileWatcher(BackendKind backend = BackendKind::INOTIFY, std::string_view broker = kDefaultBroker)
+        : backend_(backend, broker), running_(false) {
+        wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        
+        for (int fd : {backend_.fd(), wake_fd_, timer_fd_}) {
+            if (fd >= 0 && epoll_fd_ >= 0) {
+                struct epoll_event ev{};
+                ev.events = EPOLLIN;
+                ev.data.fd = fd;
+                epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+            }
+        }
     }
     
     ~FileWatcher() {
         stop();
-        if (inotify_fd_ >= 0) {
-            close(inotify_fd_);
+        for (int fd : {wake_fd_, timer_fd_, epoll_fd_}) {
+            if (fd >= 0) {
+                close(fd);
+            }
         }
     }
     
-    bool add_watch(const std::string& path, EventCallback callback, 
-                   uint32_t events = IN_MODIFY | IN_CREATE | IN_DELETE) {
-        if (inotify_fd_ < 0) {
-            return false;
+    // With `recursive`, every directory below `path` (up to `max_depth`
+    // levels, -1 for unlimited) is watched too, including ones created later.
+    // `callback` is any void(const FileEvent&) callable; it is stored in its
+    // own type, so lambdas and function pointers never go through
+    // std::function (an EventCallback still works). Safe to call while the
+    // watcher is running.
+    template <typename F>
+    bool add_watch(const std::string& path, F&& callback,
+                   uint32_t events = IN_MODIFY | IN_CREATE | IN_DELETE,
+                   bool recursive = false, int max_depth = -1) {
+        auto root = std::make_shared<WatchRoot>();
+        root->callback = WatchCallback::make(std::forward<F>(callback));
+        root->events = events;
+        root->recursive = recursive;
+        root->max_depth = recursive ? max_depth : 0;
+        return add_root(path, std::move(root));
+    }
+    
+    // Like add_watch(), but `callback` is a void(std::span<const FileEvent>)
+    // callable that gets every matching event of one wakeup in one call, or
+    // with options.max_latency, every one until that long after the first.
+    // With options.dedup, a file appears once per batch with its masks
+    // merged. The span and its names are valid for the call only. Batches
+    // are delivered on the watcher's thread (drain()'s caller), never
+    // through set_dispatch()'s pool. stop() and the destructor deliver what
+    // is still open; remove_watch() drops it.
+    template <typename F>
+    bool add_batch_watch(const std::string& path, F&& callback,
+                         uint32_t events = IN_MODIFY | IN_CREATE | IN_DELETE,
+                         const BatchOptions& options = {}, bool recursive = false, int max_depth = -1) {
+        auto batch = std::make_shared<Batch>(Batch::Callback{std::forward<F>(callback)}, options);
+        auto root = std::make_shared<WatchRoot>();
+        root->callback = WatchCallback::make([this, batch](const FileEvent& event) {
+            if (batch->add(event)) {
+                open_batches_.push_back(batch);
+            }
+        });
+        root->events = events;
+        root->recursive = recursive;
+        root->max_depth = recursive ? max_depth : 0;
+        root->batch = batch;
+        return add_root(path, std::move(root));
+    }
+    
+    // Stops watching a path given to add_watch(), including every directory
+    // a recursive watch added below it. Safe to call while running; events
+    // already queued for it are dropped and its IN_IGNORED is absorbed.
+    bool remove_watch(const std::string& path) {
+        std::vector<int> wds;
+        {
+            std::lock_guard<std::mutex> lock(watch_mutex_);
+            const WatchRoot* root = nullptr;
+            for (const auto& [wd, info] : table_.latest()) {
+                if (info.depth == 0 && info.path == path) {
+                    root = info.root.get();
+                    break;
+                }
+            }
+            if (!root) {
+                return false;
+            }
+            if (root->batch) {
+                root->batch->cancel();
+            }
+            for (const auto& [wd, info] : table_.latest()) {
+                if (info.root.get() == root) {
+                    wds.push_back(wd);
+                }
+            }
+            erase_watches_locked(wds);
         }
-        
-        int wd = inotify_add_watch(inotify_fd_, path.c_str(), events);
-        if (wd < 0) {
-            return false;
+        for (int wd : wds) {
+            backend_.remove_watch(wd);
         }
-        
-        watches_[wd] = {path, callback, events};
         return true;
     }
     
+    size_t watch_count() const {
+        std::lock_guard<std::mutex> lock(watch_mutex_);
+        return table_.latest().size();
+    }
+    
+    // For an application that already runs an event loop: instead of
+    // start(), add fd() to it (readable means events are pending) and call
+    // drain() whenever it fires. drain() never blocks; it handles what is
+    // pending on the calling thread, callbacks included, and returns how
+    // many backend events that was. Always drain from the same thread, and
+    // not while start()ed.
+    int fd() const {
+        return epoll_fd_;
+    }
+    
+    size_t drain() {
+        if (running_) {
+            return 0;
+        }
+        if (!loop_attached_) {
+            // The caller is now the table's reader, as the worker would be.
+            std::lock_guard<std::mutex> lock(watch_mutex_);
+            table_.set_reader_active(true);
+            loop_attached_ = true;
+        }
+        const int handled = pump(0);
+        return handled > 0 ? static_cast<size_t>(handled) : 0;
+    }
+    
+    // Like add_watch(), but the events are queued for next() rather than
+    // passed to a callback. Up to kMaxQueuedEvents wait; past that, events
+    // are dropped and the last queued one becomes an IN_Q_OVERFLOW marker.
+    bool add_queued_watch(const std::string& path, uint32_t events = IN_MODIFY | IN_CREATE | IN_DELETE,
+                          bool recursive = false, int max_depth = -1) {
+        return add_watch(path, [this](const FileEvent& event) { enqueue(event); }, events, recursive, max_depth);
+    }
+    
+    static constexpr size_t kMaxQueuedEvents = 4096;
+    
+    // co_await watcher.next() yields the next event of a queued watch. With
+    // nothing queued the coroutine is parked, costing no thread, and is
+    // resumed from drain() (or the worker thread after start()) once an
+    // event arrives. Several coroutines may wait; each event goes to one of
+    // them. stop() (and so the destructor) resumes every coroutine still
+    // parked, on the calling thread, with an event whose mask is IN_IGNORED
+    // and whose path is empty: the watcher is closing, and the coroutine
+    // should return rather than await next() again. The event is taken off
+    // the queue under the lock, either here or by whoever resumes the
+    // coroutine, so consumers on different threads never race for the same
+    // one.
+    class NextEvent {
+    public:
+        explicit NextEvent(FileWatcher& watcher) : watcher_(watcher) {}
+        
+        bool await_ready() { return watcher_.take_queued(event_); }
+        bool await_suspend(std::coroutine_handle<> waiter) { return watcher_.park(waiter, event_); }
+        OwnedFileEvent await_resume() { return std::move(event_); }
+        
+    private:
+        FileWatcher& watcher_;
+        OwnedFileEvent event_{};
+    };
+    
+    NextEvent next() {
+        return NextEvent{*this};
+    }
+    
+    size_t queued_count() const {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        return queued_.size();
+    }
+    
     void start() {
         if (running_.exchange(true)) {
             return; // Already running
         }
         
+        if (dispatcher_) {
+            dispatcher_->start();
+        }
+        table_.set_reader_active(true);
         worker_thread_ = std::thread(&FileWatcher::worker_loop, this);
     }
     
     void stop() {
         if (running_.exchange(false)) {
+            // Wake the worker out of epoll_wait; it sleeps with no timeout.
+            const uint64_t one = 1;
+            (void)write(wake_fd_, &one, sizeof(one));
             if (worker_thread_.joinable()) {
                 worker_thread_.join();
             }
+            {
+                std::lock_guard<std::mutex> lock(watch_mutex_);
+                table_.set_reader_active(false);
+                table_.reclaim();
+            }
+            if (dispatcher_) {
+                dispatcher_->stop();
+            }
+        } else if (loop_attached_) {
+            // drain() mode has no worker to flush on its way out; this must
+            // run on the loop's thread, as drain() does.
+            flush_batches(true);
         }
+        // Nothing resumes waiters any more: end them, handing out what is
+        // still queued first.
+        resume_waiters();
+        cancel_waiters();
     }
     
     bool is_running() const {
         return running_;
     }
     
+    BackendKind backend() const {
+        return backend_.kind();
+    }
+    
+    // Call before start(); the buffer is owned by the worker thread.
+    void set_read_buffer_size(size_t bytes) {
+        backend_.set_read_buffer_size(bytes);
+    }
+    
+    // Run callbacks on a work-stealing pool instead of the watcher thread, so
+    // a slow callback only holds up later events for the same file. Call
+    // before start(); stop() runs whatever is still queued.
+    void set_dispatch(const DispatchOptions& options) {
+        dispatcher_ = std::make_unique<DispatchExecutor<DispatchedEvent>>(options);
+    }
+    
+    DispatchStats dispatch_stats() const {
+        return dispatcher_ ? dispatcher_->stats() : DispatchStats{};
+    }
+    
+    // Kernel queue overflows seen, and rescans run to recover from them.
+    uint64_t overflow_count() const {
+        return overflows_.load(std::memory_order_relaxed);
+    }
+    
+    uint64_t resync_count() const {
+        return resyncs_.load(std::memory_order_relaxed);
+    }
+    
 private:
+    struct WatchRoot {
+        WatchCallback callback;
+        uint32_t events;
+        bool recursive;
+        int max_depth;
+        std::shared_ptr<EventBatch<FileEvent>> batch;   // add_batch_watch(): fed by callback, never dispatched
+    };
+    
+    using Batch = EventBatch<FileEvent>;
+    
+    // Entries are immutable once published; the snapshot is the exception,
+    // and only the worker thread touches it.
     struct WatchInfo {
+        PathTable::NodeId node;
+        std::shared_ptr<const WatchRoot> root;   // outlives the entry while events are queued
+        int depth;
+        std::string_view path;                   // interned_, for allocation-free delivery
+        std::shared_ptr<DirectorySnapshot> snapshot;
+    };
+    
+    using WatchTable = EpochTable<int, WatchInfo>;
+    
+    // One callback invocation queued on the dispatch executor. It outlives the
+    // read buffer, so unlike inline delivery it owns copies of both names. The
+    // key is the hash of the full file path, so events for one file stay in order.
+    struct DispatchedEvent {
+        std::shared_ptr<const WatchRoot> root;
         std::string path;
-        EventCallback callback;
-        uint32_t events;
+        std::string filename;
+        EventType type;
+        uint32_t mask;
+        EventSet types;
+        uint64_t hash;
+        
+        uint64_t key() const { return hash; }
+        
+        bool coalesces_with(const DispatchedEvent& other) const {
+            return hash == other.hash && root == other.root && mask == other.mask &&
+                   filename == other.filename && path == other.path;
+        }
+        
+        void operator()() { root->callback(FileEvent{path, filename, type, mask, types}); }
     };
     
-    void worker_loop() {
-        char buffer[4096];
-        struct pollfd pfd = {inotify_fd_, POLLIN, 0};
+    bool add_root(const std::string& path, std::shared_ptr<WatchRoot> root) {
+        if (backend_.fd() < 0 || !root->callback) {
+            return false;
+        }
+        int wd = backend_.add_watch(path.c_str(), kernel_mask(*root));
+        if (wd < 0) {
+            return false;
+        }
         
-        while (running_) {
-            // Poll with timeout for power saving
-            int poll_result = poll(&pfd, 1, 1000); // 1 second timeout
-            
-            if (poll_result > 0 && (pfd.revents & POLLIN)) {
-                ssize_t len = read(inotify_fd_, buffer, sizeof(buffer));
-                if (len > 0) {
-                    process_events(buffer, len);
+        auto snapshot = std::make_shared<DirectorySnapshot>();
+        snapshot->capture(path);
+        PathTable::NodeId node;
+        {
+            std::lock_guard<std::mutex> lock(watch_mutex_);
+            // Watching a path again replaces the earlier watch, as the
+            // kernel has just done with its mask.
+            if (table_.latest().count(wd)) {
+                erase_watches_locked({wd});
+            }
+            node = paths_.add_root(path);
+            insert_watches_locked({{wd, WatchInfo{node, root, 0, interned_.intern(path), std::move(snapshot)}}});
+        }
+        
+        if (root->recursive) {
+            add_subtree(path, node, root, 0, 4);
+        }
+        return true;
+    }
+    
+    static uint32_t kernel_mask(const WatchRoot& root) {
+        // Recursive roots need directory lifecycle events to track the tree
+        return root.recursive ? root.events | IN_CREATE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF
+                              : root.events;
+    }
+    
+    // Writers: add_watch()/remove_watch() on any thread and the worker when
+    // it follows the tree. All of them hold watch_mutex_; the worker reads
+    // table_ without it.
+    void insert_watches_locked(std::vector<std::pair<int, WatchInfo>> entries) {
+        std::vector<WatchInfo> duplicates;
+        table_.update([&](WatchTable::Map& watches) {
+            for (auto& [wd, info] : entries) {
+                if (!watches.try_emplace(wd, info).second) {
+                    duplicates.push_back(std::move(info));
                 }
-            } else if (poll_result == 0) {
-                // Timeout - power saving sleep
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+        });
+        // Never published, so no grace period needed.
+        for (const auto& info : duplicates) {
+            paths_.release(info.node);
+            interned_.release(info.path);
+        }
+    }
+    
+    void erase_watches_locked(const std::vector<int>& wds) {
+        std::vector<WatchInfo> removed;
+        table_.update([&](WatchTable::Map& watches) {
+            for (int wd : wds) {
+                if (auto it = watches.find(wd); it != watches.end()) {
+                    removed.push_back(std::move(it->second));
+                    watches.erase(it);
+                }
+            }
+        });
+        for (const auto& info : removed) {
+            paths_.release(info.node);
+            // The worker may be delivering an event with this path right now.
+            table_.defer([this, path = info.path] { interned_.release(path); });
+        }
+    }
+    
+    void add_subtree(const std::string& dir_path, PathTable::NodeId node, const std::shared_ptr<const WatchRoot>& root,
+                     int depth, unsigned threads) {
+        int remaining = root->max_depth < 0 ? -1 : root->max_depth - depth;
+        uint32_t mask = kernel_mask(*root) | IN_ONLYDIR;
+        
+        std::mutex snapshot_mutex;
+        std::unordered_map<int, std::shared_ptr<DirectorySnapshot>> snapshots;
+        auto dirs = walk_directories(dir_path, remaining, [&](const std::string& dir) {
+            int wd = backend_.add_watch(dir.c_str(), mask);
+            if (wd >= 0) {
+                auto snapshot = std::make_shared<DirectorySnapshot>();
+                snapshot->capture(dir);
+                std::lock_guard<std::mutex> lock(snapshot_mutex);
+                snapshots.try_emplace(wd, std::move(snapshot));
+            }
+            return wd;
+        }, threads);
+        if (dirs.empty()) {
+            return;
+        }
+        
+        // One published version for the whole subtree.
+        std::lock_guard<std::mutex> lock(watch_mutex_);
+        const auto& current = table_.latest();
+        std::vector<PathTable::NodeId> nodes(dirs.size(), PathTable::kInvalid);
+        std::vector<std::pair<int, WatchInfo>> added;
+        for (size_t i = 0; i < dirs.size(); ++i) {
+            if (current.count(dirs[i].wd)) {
+                continue;
+            }
+            PathTable::NodeId parent = dirs[i].parent == WalkedDir::kRoot ? node : nodes[dirs[i].parent];
+            nodes[i] = paths_.add_child(parent, dirs[i].name);
+            if (nodes[i] != PathTable::kInvalid) {
+                added.push_back({dirs[i].wd, WatchInfo{nodes[i], root, depth + dirs[i].depth,
+                                                       interned_.intern(dirs[i].path), snapshots[dirs[i].wd]}});
             }
         }
+        insert_watches_locked(std::move(added));
     }
     
-    void process_events(const char* buffer, ssize_t len) {
-        const struct inotify_event* event;
-        ssize_t offset = 0;
+    void track_directory(int parent_wd, const WatchInfo& parent, uint32_t mask, std::string_view name) {
+        const WatchRoot& root = *parent.root;
         
-        while (offset < len) {
-            event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+        if (mask & (IN_CREATE | IN_MOVED_TO)) {
+            if (root.max_depth >= 0 && parent.depth >= root.max_depth) {
+                return;
+            }
+            std::string dir_path{parent.path};
+            dir_path += '/';
+            dir_path += name;
+            int wd = backend_.add_watch(dir_path.c_str(), kernel_mask(root) | IN_ONLYDIR);
+            if (wd < 0) {
+                return;
+            }
+            auto snapshot = std::make_shared<DirectorySnapshot>();
+            snapshot->capture(dir_path);
             
-            auto it = watches_.find(event->wd);
-            if (it != watches_.end()) {
-                FileEvent file_event;
-                file_event.path = it->second.path;
-                file_event.filename = event->len > 0 ? event->name : "";
-                file_event.type = static_cast<EventType>(event->mask & it->second.events);
-                file_event.mask = event->mask;
-                
+            PathTable::NodeId node;
+            {
+                std::lock_guard<std::mutex> lock(watch_mutex_);
+                const auto& current = table_.latest();
+                if (current.count(wd)) {
+                    return;
+                }
+                // remove_watch() got to the parent first.
+                node = current.count(parent_wd) ? paths_.add_child(parent.node, name) : PathTable::kInvalid;
+                if (node == PathTable::kInvalid) {
+                    backend_.remove_watch(wd);
+                    return;
+                }
+                insert_watches_locked({{wd, WatchInfo{node, parent.root, parent.depth + 1, interned_.intern(dir_path),
+                                                      std::move(snapshot)}}});
+            }
+            // It may already have contents (mkdir -p, mv into the tree)
+            add_subtree(dir_path, node, parent.root, parent.depth + 1, 1);
+        } else if (mask & IN_MOVED_FROM) {
+            // Moved out of the tree: drop its watches so events stop being
+            // reported under the old path. IN_IGNORED cleans up the entries.
+            std::lock_guard<std::mutex> lock(watch_mutex_);
+            for (const auto& [wd, info] : table_.latest()) {
+                PathTable::NodeId node = info.node;
+                while (node != PathTable::kInvalid && paths_.parent(node) != parent.node) {
+                    node = paths_.parent(node);
+                }
+                if (node != PathTable::kInvalid && paths_.name(node) == name) {
+                    backend_.remove_watch(wd);
+                }
+            }
+        }
+    }
+    
+    void worker_loop() {
+        // Block until the backend or stop() has something for us: no idle wakeups
+        while (running_) {
+            if (pump(-1) < 0) {
+                break;
+            }
+        }
+        flush_batches(true);
+    }
+    
+    // One round of the loop, for the worker and for drain(): waits up to
+    // `timeout_ms` and handles what is ready. Returns the backend events
+    // handled, or -1 if epoll failed.
+    int pump(int timeout_ms) {
+        // Nothing from the last batch is referenced past this point, so
+        // writers may free table versions retired before it.
+        table_.quiescent();
+        
+        struct epoll_event ready[3];
+        int count = epoll_wait(epoll_fd_, ready, 3, timeout_ms);
+        if (count < 0) {
+            return errno == EINTR ? 0 : -1;
+        }
+        
+        int handled = 0;
+        for (int i = 0; i < count; ++i) {
+            if (ready[i].data.fd == backend_.fd()) {
+                backend_.drain([this, &handled](int wd, uint32_t mask, std::string_view name) {
+                    ++handled;
+                    if (mask & IN_Q_OVERFLOW) {
+                        overflows_.fetch_add(1, std::memory_order_relaxed);
+                        resync_pending_ = true;
+                        return;
+                    }
+                    handle_event(wd, mask, name);
+                });
+                if (resync_pending_) {
+                    resync();
+                }
+            } else {
+                // wake_fd_ or timer_fd_; either way, see what is due.
+                uint64_t counter;
+                (void)read(ready[i].data.fd, &counter, sizeof(counter));
+            }
+        }
+        flush_batches(false);
+        resume_waiters();
+        return handled;
+    }
+    
+    // Delivers the batches that are due (all of them with `all`) and arms
+    // timer_fd_ for the next deadline among the rest.
+    void flush_batches(bool all) {
+        if (open_batches_.empty()) {
+            return;
+        }
+        const auto now = Batch::Clock::now();
+        auto next = Batch::Clock::time_point::max();
+        size_t kept = 0;
+        for (size_t i = 0; i < open_batches_.size(); ++i) {
+            const std::shared_ptr<Batch> batch = open_batches_[i].lock();
+            if (!batch || batch->empty()) {
+                continue;
+            }
+            if (all || batch->deadline() <= now) {
+                batch->flush();
+                continue;
+            }
+            next = std::min(next, batch->deadline());
+            if (kept != i) {
+                open_batches_[kept] = std::move(open_batches_[i]);
+            }
+            ++kept;
+        }
+        open_batches_.resize(kept);
+        arm_timer(next);
+    }
+    
+    void arm_timer(Batch::Clock::time_point deadline) {
+        if (timer_fd_ < 0 || deadline == armed_deadline_) {
+            return;
+        }
+        armed_deadline_ = deadline;
+        
+        // steady_clock is CLOCK_MONOTONIC on Linux; a zeroed itimerspec disarms.
+        struct itimerspec spec{};
+        if (deadline != Batch::Clock::time_point::max()) {
+            const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+            spec.it_value.tv_sec = static_cast<time_t>(ns / 1000000000);
+            spec.it_value.tv_nsec = static_cast<long>(ns % 1000000000);
+        }
+        timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+    }
+    
+    void enqueue(const FileEvent& event) {
+        bool wake = false;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            if (queued_.size() >= kMaxQueuedEvents) {
+                // Whatever comes after the last queued event is lost.
+                queued_.back() = OwnedFileEvent{{}, {}, event.type, static_cast<uint32_t>(IN_Q_OVERFLOW), {}};
+                return;
+            }
+            queued_.push_back(OwnedFileEvent{std::string{event.path}, std::string{event.filename}, event.type,
+                                             event.mask, event.types});
+            // From a dispatch pool thread: get the loop to resume the waiter.
+            wake = dispatcher_ && !waiters_.empty();
+        }
+        if (wake) {
+            const uint64_t one = 1;
+            (void)write(wake_fd_, &one, sizeof(one));
+        }
+    }
+    
+    // A parked next(): resume_waiters() moves its event into `slot` before
+    // resuming it.
+    struct Waiter {
+        std::coroutine_handle<> handle;
+        OwnedFileEvent* slot;
+    };
+    
+    // False when an event came in since await_ready(): it is in `slot`
+    // already, no need to suspend.
+    bool park(std::coroutine_handle<> waiter, OwnedFileEvent& slot) {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (pop_queued(slot)) {
+            return false;
+        }
+        waiters_.push_back(Waiter{waiter, &slot});
+        return true;
+    }
+    
+    bool take_queued(OwnedFileEvent& slot) {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        return pop_queued(slot);
+    }
+    
+    // Caller holds queue_mutex_.
+    bool pop_queued(OwnedFileEvent& slot) {
+        if (queued_.empty()) {
+            return false;
+        }
+        slot = std::move(queued_.front());
+        queued_.pop_front();
+        return true;
+    }
+    
+    // Each round hands one event to one waiter, under the lock, and then
+    // resumes it outside it.
+    void resume_waiters() {
+        while (true) {
+            std::coroutine_handle<> handle;
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex_);
+                if (queued_.empty() || waiters_.empty()) {
+                    return;
+                }
+                const Waiter waiter = waiters_.front();
+                waiters_.pop_front();
+                pop_queued(*waiter.slot);
+                handle = waiter.handle;
+            }
+            handle.resume();
+        }
+    }
+    
+    // Resumes the coroutines parked when it was called with the IN_IGNORED
+    // event next() documents; one that parks again meanwhile stays parked.
+    void cancel_waiters() {
+        std::deque<Waiter> parked;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            parked.swap(waiters_);
+        }
+        for (const Waiter& waiter : parked) {
+            *waiter.slot = OwnedFileEvent{{}, {}, EventType::DELETE_SELF, static_cast<uint32_t>(IN_IGNORED), {}};
+            waiter.handle.resume();
+        }
+    }
+    
+    void handle_event(int wd, uint32_t mask, std::string_view name) {
+        // Lock-free: this version stays alive until the next quiescent(),
+        // even if a writer (including this thread) replaces it meanwhile.
+        const auto& watches = table_.read();
+        auto it = watches.find(wd);
+        if (it == watches.end()) {
+            return;   // removed, or the IN_IGNORED of a removed watch
+        }
+        
+        const WatchInfo& watch = it->second;
+        const WatchRoot& root = *watch.root;
+        
+        if (!(mask & IN_IGNORED)) {
+            watch.snapshot->mark_dirty(watch.path, name);
+        }
+        
+        if (root.recursive && (mask & IN_ISDIR) && !name.empty()) {
+            track_directory(wd, watch, mask, name);
+        }
+        
+        if (const EventSet types = EventSet::from_mask(mask & root.events); !types.empty()) {
+            if (dispatcher_ && !root.batch) {
+                uint64_t hash = XXHash64::hash(watch.path.data(), watch.path.size());
+                hash = XXHash64::hash(name.data(), name.size(), hash);
+                dispatcher_->submit(DispatchedEvent{watch.root, std::string{watch.path}, std::string{name},
+                                                    types.first(), mask, types, hash});
+            } else {
                 // Call user callback
-                it->second.callback(file_event);
+                root.callback(FileEvent{watch.path, name, types.first(), mask, types});
+            }
+        }
+        
+        if (mask & IN_IGNORED) {
+            std::lock_guard<std::mutex> lock(watch_mutex_);
+            erase_watches_locked({wd});
+        }
+    }
+    
+    // After IN_Q_OVERFLOW the kernel has dropped events; rescan every watched
+    // path and report whatever differs from the cached snapshots, except
+    // names that were delivered since they were taken.
+    void resync() {
+        resync_pending_ = false;
+        resyncs_.fetch_add(1, std::memory_order_relaxed);
+        
+        for (const auto& [wd, watch] : table_.read()) {
+            DirectorySnapshot current;
+            if (!current.capture(std::string{watch.path})) {
+                continue;
             }
             
-            offset += sizeof(struct inotify_event) + event->len;
+            DirectorySnapshot previous = std::move(*watch.snapshot);
+            *watch.snapshot = std::move(current);
+            previous.diff_missed(*watch.snapshot, [&, wd = wd](std::string_view name, uint32_t mask) {
+                handle_event(wd, mask, name);
+            });
         }
     }
     
-    int inotify_fd_;
+    WatchBackend backend_;
+    int wake_fd_ = -1;
+    int timer_fd_ = -1;
+    int epoll_fd_ = -1;
     std::atomic<bool> running_;
     std::thread worker_thread_;
-    std::unordered_map<int, WatchInfo> watches_;
+    mutable std::mutex watch_mutex_;
+    PathTable paths_;
+    PathInterner interned_;
+    WatchTable table_;   // after interned_: its deferred releases run on destruction
+    bool resync_pending_ = false;
+    std::atomic<uint64_t> overflows_{0};
+    std::atomic<uint64_t> resyncs_{0};
+    std::unique_ptr<DispatchExecutor<DispatchedEvent>> dispatcher_;
+    bool loop_attached_ = false;   // drain() has made its caller the reader
+    std::vector<std::weak_ptr<Batch>> open_batches_;   // loop thread only
+    Batch::Clock::time_point armed_deadline_ = Batch::Clock::time_point::max();
+    mutable std::mutex queue_mutex_;
+    std::deque<OwnedFileEvent> queued_;
+    std::deque<Waiter> waiters_;
 };
 
 // Utility functions
@@ -142,15 +885,8 @@ inline uint32_t make_event_mask(std::initializer_list<EventType> events) {
 }
 
 inline std::string event_type_to_string(EventType type) {
-    switch (type) {
-        case EventType::MODIFY: return "MODIFY";
-        case EventType::CREATE: return "CREATE";
-        case EventType::DELETE: return "DELETE";
-        case EventType::MOVE: return "MOVE";
-        case EventType::ATTRIB: return "ATTRIB";
-        case EventType::ACCESS: return "ACCESS";
-        default: return "UNKNOWN";
-    }
+    const size_t index = EventSet::index_of(type);
+    return std::string{index < kEventTypeCount ? kEventTypes[index].label : "UNKNOWN"};
 }
 
 } // namespace FileWatcherAPI
\ No newline at end of file
@@ -0,0 +1,189 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace FileWatcherAPI {
+
+// Parent-pointer trie of watched directories. Each node stores one path
+// component in a shared arena, so a tree of N directories costs one short
+// append per directory instead of a full path string per watch. Full paths
+// are rebuilt on demand by walking up to the root.
+class PathTable {
+public:
+    using NodeId = std::uint32_t;
+    static constexpr NodeId kInvalid = UINT32_MAX;
+
+    NodeId add_root(std::string_view path) noexcept {
+        return allocate(kInvalid, path);
+    }
+
+    NodeId add_child(NodeId parent, std::string_view name) noexcept {
+        if (!alive(parent)) {
+            return kInvalid;
+        }
+        ++nodes_[parent].refs;
+        return allocate(parent, name);
+    }
+
+    // Drops the watch reference on a node. Nodes stay alive while any child
+    // still points at them, so paths of deeper watches remain resolvable.
+    void release(NodeId id) noexcept {
+        while (alive(id)) {
+            Node& node = nodes_[id];
+            if (--node.refs > 0) {
+                break;
+            }
+            dead_bytes_ += node.length;
+            free_.push_back(id);
+            id = node.parent;
+        }
+
+        if (dead_bytes_ > 4096 && dead_bytes_ * 2 > arena_.size()) {
+            compact();
+        }
+    }
+
+    [[nodiscard]] bool alive(NodeId id) const noexcept {
+        return id < nodes_.size() && nodes_[id].refs > 0;
+    }
+
+    [[nodiscard]] NodeId parent(NodeId id) const noexcept {
+        return alive(id) ? nodes_[id].parent : kInvalid;
+    }
+
+    [[nodiscard]] std::string_view name(NodeId id) const noexcept {
+        if (!alive(id)) {
+            return {};
+        }
+        return std::string_view{arena_}.substr(nodes_[id].offset, nodes_[id].length);
+    }
+
+    // True if `id` is `ancestor` or lies somewhere below it.
+    [[nodiscard]] bool is_within(NodeId id, NodeId ancestor) const noexcept {
+        for (; alive(id); id = nodes_[id].parent) {
+            if (id == ancestor) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void build(NodeId id, std::string& out) const noexcept {
+        out.clear();
+        if (!alive(id)) {
+            return;
+        }
+
+        size_t total = 0;
+        for (NodeId cur = id; cur != kInvalid; cur = nodes_[cur].parent) {
+            total += nodes_[cur].length + (nodes_[cur].parent != kInvalid ? 1 : 0);
+        }
+
+        out.resize(total);
+        size_t pos = total;
+        for (NodeId cur = id; cur != kInvalid; cur = nodes_[cur].parent) {
+            const Node& node = nodes_[cur];
+            pos -= node.length;
+            arena_.copy(out.data() + pos, node.length, node.offset);
+            if (node.parent != kInvalid) {
+                out[--pos] = '/';
+            }
+        }
+
+        // Roots given with a trailing slash ("/") would otherwise yield "//x".
+        if (const size_t dup = out.find("//"); dup != std::string::npos) {
+            out.erase(dup, 1);
+        }
+    }
+
+    [[nodiscard]] std::string path(NodeId id) const {
+        std::string out;
+        build(id, out);
+        return out;
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return nodes_.size() - free_.size(); }
+    [[nodiscard]] size_t arena_bytes() const noexcept { return arena_.size(); }
+
+private:
+    struct Node {
+        NodeId parent;
+        std::uint32_t offset;
+        std::uint32_t length;
+        std::uint32_t refs;
+    };
+
+    NodeId allocate(NodeId parent, std::string_view name) noexcept {
+        const Node node{parent, static_cast<std::uint32_t>(arena_.size()),
+                        static_cast<std::uint32_t>(name.size()), 1};
+        arena_.append(name);
+
+        if (!free_.empty()) {
+            const NodeId id = free_.back();
+            free_.pop_back();
+            nodes_[id] = node;
+            return id;
+        }
+        nodes_.push_back(node);
+        return static_cast<NodeId>(nodes_.size() - 1);
+    }
+
+    void compact() noexcept {
+        std::string packed;
+        packed.reserve(arena_.size() - dead_bytes_);
+        for (Node& node : nodes_) {
+            if (node.refs == 0) {
+                node.length = 0;
+                node.offset = 0;
+                continue;
+            }
+            const auto offset = static_cast<std::uint32_t>(packed.size());
+            packed.append(arena_, node.offset, node.length);
+            node.offset = offset;
+        }
+        arena_.swap(packed);
+        dead_bytes_ = 0;
+    }
+
+    std::vector<Node> nodes_;
+    std::vector<NodeId> free_;
+    std::string arena_;
+    size_t dead_bytes_ = 0;
+};
+
+// Full paths of live watches, stored once and shared by every watch on the
+// same path. Map nodes never move, so a string_view handed out by intern()
+// stays valid (and NUL-terminated) until the last reference is released;
+// event delivery can pass it to callbacks without building a string.
+class PathInterner {
+public:
+    std::string_view intern(std::string_view path) {
+        if (auto it = refs_.find(path); it != refs_.end()) {
+            ++it->second;
+            return it->first;
+        }
+        return refs_.emplace(std::string{path}, 1).first->first;
+    }
+
+    void release(std::string_view path) noexcept {
+        if (auto it = refs_.find(path); it != refs_.end() && --it->second == 0) {
+            refs_.erase(it);
+        }
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return refs_.size(); }
+
+private:
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view path) const noexcept { return std::hash<std::string_view>{}(path); }
+    };
+
+    std::unordered_map<std::string, std::uint32_t, Hash, std::equal_to<>> refs_;
+};
+
+} // namespace FileWatcherAPI
\ No newline at end of file
@@ -0,0 +1,296 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "xxhash64.hpp"
+
+namespace FileWatcherAPI {
+
+struct StatSnapshot {
+    std::uint64_t inode = 0;
+    std::uint64_t size = 0;
+    std::int64_t mtime_ns = 0;
+    std::int64_t ctime_ns = 0;
+    std::uint64_t content_hash = 0;
+    bool is_dir = false;
+
+    bool operator==(const StatSnapshot&) const noexcept = default;
+
+    // statx() with AT_STATX_DONT_SYNC where the kernel has it, so polling a
+    // FUSE/overlay tree never forces a round trip to the backing store.
+    // `hash_content` adds an XXH64 of the first and last page of regular
+    // files, which catches same-size rewrites within one mtime tick.
+    static bool capture(int dir_fd, const char* name, StatSnapshot& out, bool hash_content = false) noexcept {
+        bool is_regular = false;
+        if (!capture_statx(dir_fd, name, out, is_regular)) {
+            struct stat st;
+            if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                return false;
+            }
+            out.inode = st.st_ino;
+            out.size = static_cast<std::uint64_t>(st.st_size);
+            out.mtime_ns = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+            out.ctime_ns = static_cast<std::int64_t>(st.st_ctim.tv_sec) * 1000000000 + st.st_ctim.tv_nsec;
+            out.is_dir = S_ISDIR(st.st_mode);
+            is_regular = S_ISREG(st.st_mode);
+        }
+
+        out.content_hash = hash_content && is_regular ? hash_pages(dir_fd, name, out.size) : 0;
+        return true;
+    }
+
+    // The inotify mask a watcher would have seen going from `before` to `after`.
+    static std::uint32_t diff(const StatSnapshot& before, const StatSnapshot& after) noexcept {
+        if (before.inode != after.inode) {
+            return IN_CREATE;
+        }
+        if (before.size != after.size || before.mtime_ns != after.mtime_ns ||
+            before.content_hash != after.content_hash) {
+            return IN_MODIFY;
+        }
+        if (before.ctime_ns != after.ctime_ns) {
+            return IN_ATTRIB;
+        }
+        return 0;
+    }
+
+private:
+    static constexpr size_t kPageSize = 4096;
+
+    static bool capture_statx(int dir_fd, const char* name, StatSnapshot& out, bool& is_regular) noexcept {
+#if defined(__NR_statx) && defined(STATX_BASIC_STATS) && defined(AT_STATX_DONT_SYNC)
+        // Many Android kernels predate statx (4.11); remember ENOSYS once.
+        static std::atomic<bool> unsupported{false};
+        if (unsupported.load(std::memory_order_relaxed)) {
+            return false;
+        }
+
+        struct statx stx;
+        const unsigned mask = STATX_TYPE | STATX_INO | STATX_SIZE | STATX_MTIME | STATX_CTIME;
+        if (syscall(__NR_statx, dir_fd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, mask, &stx) != 0) {
+            if (errno == ENOSYS) {
+                unsupported.store(true, std::memory_order_relaxed);
+            }
+            return false;
+        }
+
+        out.inode = stx.stx_ino;
+        out.size = stx.stx_size;
+        out.mtime_ns = static_cast<std::int64_t>(stx.stx_mtime.tv_sec) * 1000000000 + stx.stx_mtime.tv_nsec;
+        out.ctime_ns = static_cast<std::int64_t>(stx.stx_ctime.tv_sec) * 1000000000 + stx.stx_ctime.tv_nsec;
+        out.is_dir = S_ISDIR(stx.stx_mode);
+        is_regular = S_ISREG(stx.stx_mode);
+        return true;
+#else
+        (void)dir_fd;
+        (void)name;
+        (void)out;
+        (void)is_regular;
+        return false;
+#endif
+    }
+
+    static std::uint64_t hash_pages(int dir_fd, const char* name, std::uint64_t size) noexcept {
+        const int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC | O_NOFOLLOW | O_NONBLOCK);
+        if (fd < 0) {
+            return 0;
+        }
+
+        unsigned char page[kPageSize];
+        std::uint64_t hash = 0;
+        ssize_t len = pread(fd, page, sizeof(page), 0);
+        if (len > 0) {
+            hash = XXHash64::hash(page, static_cast<size_t>(len));
+        }
+        if (size > kPageSize) {
+            len = pread(fd, page, sizeof(page), static_cast<off_t>(size - kPageSize));
+            if (len > 0) {
+                hash = XXHash64::hash(page, static_cast<size_t>(len), hash);
+            }
+        }
+        close(fd);
+        return hash;
+    }
+};
+
+// Last known state of one watched path: the path itself plus, for
+// directories, every entry in it. Used to reconstruct the events lost when
+// the inotify queue overflows, and as the change detector for polling.
+class DirectorySnapshot {
+public:
+    bool capture(const std::string& path, bool hash_content = false) noexcept {
+        entries_.clear();
+        dirty_.clear();
+        if (!StatSnapshot::capture(AT_FDCWD, path.c_str(), self_, hash_content)) {
+            return false;
+        }
+        if (!self_.is_dir) {
+            return true;
+        }
+
+        DIR* dir = opendir(path.c_str());
+        if (!dir) {
+            return true;
+        }
+        const int dir_fd = dirfd(dir);
+        while (const struct dirent* entry = readdir(dir)) {
+            const std::string_view name{entry->d_name};
+            if (name == "." || name == "..") {
+                continue;
+            }
+            StatSnapshot snap;
+            if (StatSnapshot::capture(dir_fd, entry->d_name, snap, hash_content)) {
+                entries_.emplace(std::string{name}, snap);
+            }
+        }
+        closedir(dir);
+        return true;
+    }
+
+    // Keeps the cache current as ordinary events arrive, so a later resync
+    // only reports what was actually missed. Runs once per event, so the
+    // path is built in a per-thread scratch buffer and an existing entry is
+    // updated in place: no allocation unless a new name appears.
+    void refresh(std::string_view dir_path, std::string_view name, bool hash_content = false) noexcept {
+        thread_local std::string path;
+        path.assign(dir_path);
+        if (name.empty() || !self_.is_dir) {
+            StatSnapshot::capture(AT_FDCWD, path.c_str(), self_, hash_content);
+            return;
+        }
+        path += '/';
+        path += name;
+        StatSnapshot snap;
+        const auto it = entries_.find(name);
+        if (StatSnapshot::capture(AT_FDCWD, path.c_str(), snap, hash_content)) {
+            if (it != entries_.end()) {
+                it->second = snap;
+            } else {
+                entries_.emplace(std::string{name}, snap);
+            }
+        } else if (it != entries_.end()) {
+            entries_.erase(it);
+        }
+    }
+
+    // The cheap alternative to refresh() for a cache that is only read
+    // after events were lost (FileWatcher's resync): notes that `name` was
+    // reported, with no stat and, once the list has grown, no allocation.
+    // Past a bound the list is deduplicated, and if it is still long the
+    // directory is recaptured, which empties it.
+    void mark_dirty(std::string_view dir_path, std::string_view name) noexcept {
+        const size_t bound = std::max(kMaxDirty, entries_.size());
+        if (dirty_.size() >= bound) {
+            std::sort(dirty_.begin(), dirty_.end());
+            dirty_.erase(std::unique(dirty_.begin(), dirty_.end()), dirty_.end());
+            if (dirty_.size() >= bound / 2) {
+                capture(std::string{dir_path});
+            }
+        }
+        dirty_.push_back(std::hash<std::string_view>{}(name));
+    }
+
+    // diff() without the names mark_dirty() noted: those were reported as
+    // they happened, and `now` is taken as their state.
+    template <typename Emit>
+    void diff_missed(const DirectorySnapshot& now, Emit&& emit) {
+        std::sort(dirty_.begin(), dirty_.end());
+        diff(now, [&](std::string_view name, std::uint32_t mask) {
+            if (!std::binary_search(dirty_.begin(), dirty_.end(), std::hash<std::string_view>{}(name))) {
+                emit(name, mask);
+            }
+        });
+    }
+
+    // Calls emit(name, mask) for every difference between this (older)
+    // snapshot and `now`. An empty name refers to the watched path itself.
+    template <typename Emit>
+    void diff(const DirectorySnapshot& now, Emit&& emit) const {
+        if (const std::uint32_t mask = StatSnapshot::diff(self_, now.self_); mask && !self_.is_dir) {
+            emit(std::string_view{}, mask);
+            return;
+        }
+
+        for (const auto& [name, before] : entries_) {
+            const auto it = now.entries_.find(name);
+            if (it == now.entries_.end()) {
+                emit(std::string_view{name}, IN_DELETE | (before.is_dir ? IN_ISDIR : 0));
+            } else if (before.is_dir && it->second.is_dir && before.inode == it->second.inode) {
+                // A subdirectory's mtime moves with its contents; those
+                // changes are reported by the subdirectory's own watch.
+                continue;
+            } else if (const std::uint32_t mask = StatSnapshot::diff(before, it->second); mask) {
+                emit(std::string_view{name}, mask | (it->second.is_dir ? IN_ISDIR : 0));
+            }
+        }
+        for (const auto& [name, after] : now.entries_) {
+            if (!entries_.contains(name)) {
+                emit(std::string_view{name}, IN_CREATE | (after.is_dir ? IN_ISDIR : 0));
+            }
+        }
+    }
+
+    [[nodiscard]] const StatSnapshot& self() const noexcept { return self_; }
+    [[nodiscard]] size_t entry_count() const noexcept { return entries_.size(); }
+
+    [[nodiscard]] const StatSnapshot* find(std::string_view name) const noexcept {
+        const auto it = entries_.find(name);
+        return it != entries_.end() ? &it->second : nullptr;
+    }
+
+    template <typename Visit>
+    void for_each_entry(Visit&& visit) const {
+        for (const auto& [name, snap] : entries_) {
+            visit(std::string_view{name}, snap);
+        }
+    }
+
+    // Rebuilding a snapshot from saved state (the filewatcher's journal)
+    // rather than from the filesystem: reset() then set_entry() per name.
+    // A null `snap` drops the entry.
+    void reset(const StatSnapshot& self) noexcept {
+        self_ = self;
+        entries_.clear();
+    }
+
+    void set_self(const StatSnapshot& self) noexcept { self_ = self; }
+
+    void set_entry(std::string_view name, const StatSnapshot* snap) noexcept {
+        const auto it = entries_.find(name);
+        if (!snap) {
+            if (it != entries_.end()) {
+                entries_.erase(it);
+            }
+        } else if (it != entries_.end()) {
+            it->second = *snap;
+        } else {
+            entries_.emplace(std::string{name}, *snap);
+        }
+    }
+
+private:
+    static constexpr size_t kMaxDirty = 1024;
+
+    StatSnapshot self_;
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const noexcept { return std::hash<std::string_view>{}(name); }
+    };
+
+    std::unordered_map<std::string, StatSnapshot, NameHash, std::equal_to<>> entries_;
+    std::vector<size_t> dirty_;   // name hashes, for mark_dirty()
+};
+
+} // namespace FileWatcherAPI
@@ -0,0 +1,144 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace FileWatcherAPI {
+
+struct WalkedDir {
+    static constexpr size_t kRoot = static_cast<size_t>(-1);
+
+    size_t parent;      // index into the result vector, or kRoot
+    std::string name;   // component below the parent
+    std::string path;   // full path, needed while the walk is running
+    int depth;          // 1 for direct children of the root
+    int wd;
+};
+
+// Walks every directory below `root` (not the root itself) with a small
+// pool of threads and calls `add_watch(path)` for each one as soon as it is
+// found, so inotify coverage grows while the walk is still in progress.
+// Results come back parents-first; `max_depth` < 0 means unlimited.
+template <typename AddWatch>
+std::vector<WalkedDir> walk_directories(std::string_view root, int max_depth, AddWatch&& add_watch,
+                                        unsigned max_threads = 4) {
+    std::vector<WalkedDir> results;
+    if (max_depth == 0) {
+        return results;
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<size_t> queue;
+    size_t active = 0;
+    bool root_pending = true;
+
+    auto scan = [&](size_t index) {
+        std::string dir_path;
+        int depth = 0;
+        if (index == WalkedDir::kRoot) {
+            dir_path.assign(root);
+        } else {
+            std::lock_guard<std::mutex> lock(mutex);
+            dir_path = results[index].path;
+            depth = results[index].depth;
+        }
+
+        DIR* dir = opendir(dir_path.c_str());
+        if (!dir) {
+            return;
+        }
+
+        const int dir_fd = dirfd(dir);
+        std::string child_path;
+        while (const struct dirent* entry = readdir(dir)) {
+            const std::string_view name{entry->d_name};
+            if (name == "." || name == "..") {
+                continue;
+            }
+
+            bool is_dir = entry->d_type == DT_DIR;
+            if (entry->d_type == DT_UNKNOWN) {
+                struct stat st;
+                is_dir = fstatat(dir_fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+            }
+            if (!is_dir) {
+                continue;
+            }
+
+            child_path = dir_path;
+            if (child_path.empty() || child_path.back() != '/') {
+                child_path += '/';
+            }
+            child_path += name;
+
+            const int wd = add_watch(child_path);
+            if (wd < 0) {
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            results.push_back(WalkedDir{index, std::string{name}, child_path, depth + 1, wd});
+            if (max_depth < 0 || depth + 1 < max_depth) {
+                queue.push_back(results.size() - 1);
+                cv.notify_one();
+            }
+        }
+        closedir(dir);
+    };
+
+    auto worker = [&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            cv.wait(lock, [&] { return root_pending || !queue.empty() || active == 0; });
+            size_t index;
+            if (root_pending) {
+                root_pending = false;
+                index = WalkedDir::kRoot;
+            } else if (!queue.empty()) {
+                index = queue.front();
+                queue.pop_front();
+            } else {
+                cv.notify_all();
+                return;
+            }
+
+            ++active;
+            lock.unlock();
+            scan(index);
+            lock.lock();
+            --active;
+            if (active == 0 && queue.empty()) {
+                cv.notify_all();
+            }
+        }
+    };
+
+    const unsigned threads = std::clamp(std::min(max_threads, std::thread::hardware_concurrency()), 1u, 16u);
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    {
+        // Hold the lock so helpers cannot observe "idle" before the root scan starts.
+        std::lock_guard<std::mutex> lock(mutex);
+        for (unsigned i = 1; i < threads; ++i) {
+            pool.emplace_back(worker);
+        }
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    return results;
+}
+
+} // namespace FileWatcherAPI
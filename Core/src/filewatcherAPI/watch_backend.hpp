@@ -0,0 +1,618 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+#include "broker_client.hpp"
+#include "event_buffer.hpp"
+
+// bionic has no fanotify or file handle wrappers at the API levels we
+// target; they go through the raw syscalls. FAN_REPORT_DFID_NAME needs
+// Linux 5.9.
+#if __has_include(<linux/fanotify.h>)
+#include <linux/fanotify.h>
+#endif
+#if defined(FAN_REPORT_DFID_NAME) && defined(FAN_MARK_FILESYSTEM) && defined(__NR_fanotify_init) && \
+    defined(__NR_fanotify_mark) && defined(__NR_name_to_handle_at) && defined(__NR_open_by_handle_at)
+#define FILEWATCHER_HAVE_FANOTIFY 1
+#endif
+
+namespace FileWatcherAPI {
+
+enum class BackendKind {
+    INOTIFY,    // one kernel watch per directory; works unprivileged
+    FANOTIFY,   // one filesystem mark for every watch on it; needs CAP_SYS_ADMIN
+    BROKER      // a subscription to `filewatcher --broker`, which owns the inotify instance
+};
+
+inline const char* backend_name(BackendKind kind) noexcept {
+    switch (kind) {
+    case BackendKind::FANOTIFY:
+        return "fanotify";
+    case BackendKind::BROKER:
+        return "broker";
+    default:
+        return "inotify";
+    }
+}
+
+inline bool parse_backend(std::string_view name, BackendKind& kind) noexcept {
+    if (name == "inotify") {
+        kind = BackendKind::INOTIFY;
+    } else if (name == "fanotify") {
+        kind = BackendKind::FANOTIFY;
+    } else if (name == "broker") {
+        kind = BackendKind::BROKER;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Source of (watch id, inotify mask, name) events for WatcherCore and
+// FileWatcher. Ids, masks and IN_IGNORED behave like inotify watch
+// descriptors whichever backend is in use, so the watchers keep one event
+// path and one watch table.
+//
+// The fanotify backend puts a single FAN_MARK_FILESYSTEM mark on each
+// filesystem and reports events as (parent directory handle, name). Every
+// add_watch() caches the handle of the watched directory against its id,
+// so an event is routed with one hash lookup on the handle bytes; events
+// from directories nobody watches are dropped there. Events a directory
+// reports about itself (attribute changes, opens) carry its own handle, so
+// for its parent's watch the backend maps the handle back to a path with
+// open_by_handle_at() once and caches the answer. Watching a directory
+// costs no kernel watch, so deep trees are not bounded by
+// max_user_watches. Differences from inotify: a watched directory's
+// IN_DELETE_SELF/IN_MOVE_SELF come from the parent's IN_DELETE/
+// IN_MOVED_FROM (only when those are in the mask), and a watch on a plain
+// file is keyed by its name, so it ends when the file is renamed or
+// deleted.
+//
+// The broker backend forwards to a BrokerClient: processes that would each
+// hold an inotify instance over the same trees share the broker's one, and
+// a directory two of them watch costs one kernel watch.
+class WatchBackend {
+public:
+    // `broker` names the broker's socket; only BackendKind::BROKER uses it.
+    explicit WatchBackend(BackendKind kind = BackendKind::INOTIFY,
+                          std::string_view broker = kDefaultBroker) noexcept : kind_(kind) {
+        if (kind == BackendKind::INOTIFY) {
+            fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        } else if (kind == BackendKind::BROKER) {
+            if (broker_.connect(broker)) {
+                fd_ = broker_.fd();
+            }
+        } else {
+#ifdef FILEWATCHER_HAVE_FANOTIFY
+            fd_ = static_cast<int>(syscall(__NR_fanotify_init,
+                                           FAN_CLASS_NOTIF | FAN_REPORT_DFID_NAME | FAN_CLOEXEC | FAN_NONBLOCK,
+                                           O_RDONLY | O_LARGEFILE));
+            set_read_buffer_size(read_buffer_.size());
+#else
+            errno = ENOSYS;
+#endif
+        }
+    }
+
+    ~WatchBackend() {
+#ifdef FILEWATCHER_HAVE_FANOTIFY
+        for (const auto& [fsid, filesystem] : filesystems_) {
+            close(filesystem.mount_fd);
+        }
+#endif
+        if (fd_ >= 0 && kind_ != BackendKind::BROKER) {
+            close(fd_);
+        }
+    }
+
+    WatchBackend(const WatchBackend&) = delete;
+    WatchBackend& operator=(const WatchBackend&) = delete;
+
+    [[nodiscard]] BackendKind kind() const noexcept { return kind_; }
+
+    // -1 when the backend could not be created; poll it for EPOLLIN.
+    [[nodiscard]] int fd() const noexcept { return fd_; }
+
+    // inotify_add_watch() semantics: returns the id (the same one again for a
+    // path that is already watched, with its mask replaced, or extended with
+    // IN_MASK_ADD) or -1 with errno. Thread-safe.
+    int add_watch(const char* path, uint32_t mask) {
+        if (fd_ < 0) {
+            errno = EBADF;
+            return -1;
+        }
+        if (kind_ == BackendKind::INOTIFY) {
+            return inotify_add_watch(fd_, path, mask);
+        }
+        if (kind_ == BackendKind::BROKER) {
+            return broker_.add_watch(path, mask);
+        }
+#ifdef FILEWATCHER_HAVE_FANOTIFY
+        return fanotify_add(path, mask);
+#else
+        errno = ENOSYS;
+        return -1;
+#endif
+    }
+
+    // Thread-safe. The id's IN_IGNORED follows through drain().
+    void remove_watch(int id) {
+        if (kind_ == BackendKind::INOTIFY) {
+            inotify_rm_watch(fd_, id);
+            return;
+        }
+        if (kind_ == BackendKind::BROKER) {
+            broker_.remove_watch(id);
+            return;
+        }
+#ifdef FILEWATCHER_HAVE_FANOTIFY
+        std::lock_guard<std::mutex> lock(mutex_);
+        forget_locked(id);
+#endif
+    }
+
+    // Owned by the thread that calls drain().
+    void set_read_buffer_size(size_t bytes) noexcept {
+        // A fanotify read fails with EINVAL unless a whole event fits.
+        read_buffer_.resize(kind_ == BackendKind::FANOTIFY && bytes < kMinFanotifyBuffer ? kMinFanotifyBuffer : bytes);
+    }
+
+    // Reads what the kernel has queued and calls on_event(int id, uint32_t
+    // mask, std::string_view name) for each event, in order. A queue overflow
+    // arrives as (-1, IN_Q_OVERFLOW, {}). `name` points into the read buffer.
+    // on_event may call add_watch()/remove_watch().
+    template <typename OnEvent>
+    void drain(OnEvent&& on_event) {
+        if (kind_ == BackendKind::INOTIFY) {
+            read_buffer_.drain(fd_, [&](std::string_view chunk) {
+                for_each_event(chunk, [&](const struct inotify_event* event) {
+                    on_event(event->mask & IN_Q_OVERFLOW ? -1 : event->wd, event->mask,
+                             event->len > 0 ? std::string_view{event->name} : std::string_view{});
+                });
+            });
+            return;
+        }
+        if (kind_ == BackendKind::BROKER) {
+            broker_.drain(on_event);
+            return;
+        }
+#ifdef FILEWATCHER_HAVE_FANOTIFY
+        read_buffer_.drain(fd_, [&](std::string_view chunk) {
+            fanotify_decode(chunk, on_event);
+        });
+        flush_synthesized(on_event);
+#endif
+    }
+
+private:
+    static constexpr size_t kMinFanotifyBuffer = 4096;
+
+    BackendKind kind_;
+    int fd_ = -1;
+    EventBuffer read_buffer_;
+    BrokerClient broker_;
+
+#ifdef FILEWATCHER_HAVE_FANOTIFY
+    // Event bits fanotify reports with FAN_REPORT_DFID_NAME. They share
+    // their values with the IN_* bits, as does FAN_ONDIR with IN_ISDIR.
+    static constexpr uint32_t kDirentEvents = IN_ACCESS | IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CLOSE_NOWRITE |
+                                              IN_OPEN | IN_MOVED_FROM | IN_MOVED_TO | IN_CREATE | IN_DELETE;
+
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view key) const noexcept { return std::hash<std::string_view>{}(key); }
+    };
+
+    using KeyMap = std::unordered_map<std::string, int, Hash, std::equal_to<>>;
+
+    struct Mark {
+        std::string dir_key;     // the directory's handle; a file's parent handle
+        std::string entry_key;   // parent handle + '/' + name; empty for a root directory
+        uint32_t mask;
+        bool directory;
+        uint64_t fsid;
+    };
+
+    struct Filesystem {
+        uint64_t mask = 0;       // what the kernel mark reports
+        size_t marks = 0;
+        int mount_fd = -1;       // any directory or file on it, opened (not O_PATH) for
+                                 // open_by_handle_at() and FAN_MARK_REMOVE
+    };
+
+    // Where a directory handle sits: its parent's handle and its name. An
+    // empty key caches a handle that could not be resolved.
+    struct Parent {
+        std::string key;
+        std::string name;
+    };
+
+    // Resolved handles kept before the cache starts over.
+    static constexpr size_t kMaxParents = 4096;
+
+    // struct file_handle, laid out as fanotify reports it after the fsid.
+    struct Handle {
+        uint32_t bytes;
+        int32_t type;
+        unsigned char data[128];   // MAX_HANDLE_SZ
+    };
+
+    // fsid + handle header + handle bytes: the exact byte range an event's
+    // DFID_NAME record carries, so lookups can use it in place.
+    static bool handle_key(const char* path, std::string& key, uint64_t& fsid) {
+        struct statfs fs;
+        Handle handle{};
+        handle.bytes = sizeof(handle.data);
+        int mount_id;
+        if (statfs(path, &fs) != 0 ||
+            syscall(__NR_name_to_handle_at, AT_FDCWD, path, &handle, &mount_id, 0) != 0) {
+            return false;
+        }
+        std::memcpy(&fsid, &fs.f_fsid, sizeof(fsid));
+        key.assign(reinterpret_cast<const char*>(&fsid), sizeof(fsid));
+        key.append(reinterpret_cast<const char*>(&handle), offsetof(Handle, data) + handle.bytes);
+        return true;
+    }
+
+    // `path` relative to `dirfd`, or with a null `path` the object `dirfd` is open on.
+    static long mark_filesystem(int fd, unsigned flags, uint64_t mask, int dirfd, const char* path) {
+#if defined(__LP64__)
+        return syscall(__NR_fanotify_mark, fd, flags | FAN_MARK_FILESYSTEM, mask, dirfd, path);
+#else
+        // The 64-bit mask takes a register pair on 32-bit ABIs.
+        return syscall(__NR_fanotify_mark, fd, flags | FAN_MARK_FILESYSTEM, static_cast<uint32_t>(mask),
+                       static_cast<uint32_t>(mask >> 32), dirfd, path);
+#endif
+    }
+
+    static uint64_t fanotify_mask(uint32_t mask) {
+        uint64_t bits = mask & kDirentEvents;
+        // Self events are derived from the parent's directory entry events.
+        if (mask & IN_DELETE_SELF) {
+            bits |= IN_DELETE;
+        }
+        if (mask & IN_MOVE_SELF) {
+            bits |= IN_MOVED_FROM;
+        }
+        return bits | FAN_ONDIR;
+    }
+
+    int fanotify_add(const char* path, uint32_t mask) {
+        const bool merge = mask & IN_MASK_ADD;
+        mask &= ~static_cast<uint32_t>(IN_MASK_ADD);
+        struct stat st;
+        if (stat(path, &st) != 0) {
+            return -1;
+        }
+        const bool directory = S_ISDIR(st.st_mode);
+        if ((mask & IN_ONLYDIR) && !directory) {
+            errno = ENOTDIR;
+            return -1;
+        }
+
+        // A directory is found by its own handle; a file by its entry in
+        // the parent, which is also how a directory's removal is noticed.
+        std::string key;
+        uint64_t fsid;
+        if (!handle_key(path, key, fsid)) {
+            return -1;
+        }
+        std::string entry_key;
+        const std::string_view full{path};
+        const size_t slash = full.find_last_of('/');
+        const std::string parent = slash == std::string_view::npos ? std::string{"."}
+                                   : slash == 0                    ? std::string{"/"}
+                                                                   : std::string{full.substr(0, slash)};
+        const std::string_view name = slash == std::string_view::npos ? full : full.substr(slash + 1);
+        uint64_t parent_fsid;
+        if (!name.empty() && full != "/" && handle_key(parent.c_str(), entry_key, parent_fsid)) {
+            entry_key += '/';
+            entry_key += name;
+        } else if (!directory) {
+            return -1;
+        } else {
+            entry_key.clear();
+        }
+        if (!directory) {
+            key.assign(entry_key, 0, entry_key.rfind('/'));
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        Filesystem& filesystem = filesystems_[fsid];
+        const uint64_t wanted = fanotify_mask(mask);
+        if (filesystem.mount_fd < 0) {
+            // Before the mark, so the watch does not see its own open().
+            filesystem.mount_fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+            if (filesystem.mount_fd < 0) {
+                filesystems_.erase(fsid);
+                return -1;
+            }
+        }
+        if ((filesystem.mask & wanted) != wanted) {
+            if (mark_filesystem(fd_, FAN_MARK_ADD, wanted, AT_FDCWD, path) != 0) {
+                if (filesystem.marks == 0) {
+                    close(filesystem.mount_fd);
+                    filesystems_.erase(fsid);
+                }
+                return -1;
+            }
+            filesystem.mask |= wanted;
+        }
+
+        KeyMap& index = directory ? directories_ : files_;
+        const std::string& lookup = directory ? key : entry_key;
+        if (auto it = index.find(lookup); it != index.end()) {
+            marks_[it->second].mask = merge ? marks_[it->second].mask | mask : mask;
+            return it->second;
+        }
+        const int id = next_id_++;
+        index.emplace(lookup, id);
+        if (directory && !entry_key.empty()) {
+            entries_.emplace(entry_key, id);
+            const size_t separator = entry_key.rfind('/');
+            parents_.insert_or_assign(key, Parent{entry_key.substr(0, separator), entry_key.substr(separator + 1)});
+        }
+        marks_.emplace(id, Mark{std::move(key), std::move(entry_key), mask, directory, fsid});
+        ++filesystem.marks;
+        return id;
+    }
+
+    // Drops the mark and queues its IN_IGNORED; the last mark on a
+    // filesystem takes the kernel mark with it.
+    void forget_locked(int id) {
+        const auto it = marks_.find(id);
+        if (it == marks_.end()) {
+            return;
+        }
+        const Mark& mark = it->second;
+        if (mark.directory) {
+            directories_.erase(mark.dir_key);
+            if (auto entry = entries_.find(mark.entry_key); entry != entries_.end() && entry->second == id) {
+                entries_.erase(entry);
+            }
+        } else {
+            files_.erase(mark.entry_key);
+        }
+        if (auto fs = filesystems_.find(mark.fsid); fs != filesystems_.end() && --fs->second.marks == 0) {
+            // By the open fd: the path it was opened by may be gone by now.
+            mark_filesystem(fd_, FAN_MARK_REMOVE, fs->second.mask, fs->second.mount_fd, nullptr);
+            close(fs->second.mount_fd);
+            filesystems_.erase(fs);
+        }
+        marks_.erase(it);
+        synthesized_.push_back({id, IN_IGNORED});
+    }
+
+    // The path cache: the first event a directory reports about itself
+    // resolves its handle; later ones are a lookup.
+    const Parent& parent_of_locked(std::string_view dir_key) {
+        if (auto it = parents_.find(dir_key); it != parents_.end()) {
+            return it->second;
+        }
+        if (parents_.size() >= kMaxParents) {
+            parents_.clear();
+        }
+        Parent parent;
+        uint64_t fsid;
+        std::memcpy(&fsid, dir_key.data(), sizeof(fsid));
+        Handle handle{};
+        std::memcpy(&handle, dir_key.data() + sizeof(fsid),
+                    std::min(dir_key.size() - sizeof(fsid), sizeof(handle)));
+        const auto fs = filesystems_.find(fsid);
+        const int fd = fs == filesystems_.end() ? -1
+                       : static_cast<int>(syscall(__NR_open_by_handle_at, fs->second.mount_fd, &handle,
+                                                  O_PATH | O_CLOEXEC));
+        if (fd >= 0) {
+            char link[32];
+            char path[PATH_MAX];
+            snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+            const ssize_t len = readlink(link, path, sizeof(path) - 1);
+            close(fd);
+            const std::string_view resolved{path, len > 0 ? static_cast<size_t>(len) : 0};
+            const size_t slash = resolved.find_last_of('/');
+            uint64_t parent_fsid;
+            if (slash != std::string_view::npos && slash > 0 && resolved.back() != ')') {
+                path[slash] = '\0';
+                if (handle_key(path, parent.key, parent_fsid)) {
+                    parent.name = resolved.substr(slash + 1);
+                }
+            }
+        }
+        return parents_.emplace(std::string{dir_key}, std::move(parent)).first->second;
+    }
+
+    // `name` in `dir_key` was a directory and is gone: drop the cached
+    // place of its handle. Directories below it keep theirs; they name
+    // their parent by handle, which a move does not change.
+    void forget_parent_locked(std::string_view dir_key, std::string_view name) {
+        for (auto it = parents_.begin(); it != parents_.end(); ++it) {
+            if (it->second.name == name && it->second.key == dir_key) {
+                parents_.erase(it);
+                return;
+            }
+        }
+    }
+
+    struct Delivery {
+        int id;
+        uint32_t mask;
+        std::string_view name;
+    };
+
+    // Looks up where one event goes; at most three deliveries (the
+    // directory itself, its parent's watch, a watched file in it).
+    size_t route_locked(std::string_view dir_key, std::string_view name, uint32_t mask, Delivery* out) {
+        size_t count = 0;
+        const bool self = name.empty() || name == ".";
+        if (auto it = directories_.find(dir_key); it != directories_.end()) {
+            if (mask & marks_[it->second].mask) {
+                out[count++] = {it->second, mask, self ? std::string_view{} : name};
+            }
+        }
+        if (self) {
+            // inotify also reports it to the parent's watch, by name.
+            const Parent& parent = parent_of_locked(dir_key);
+            if (auto it = directories_.find(parent.key); it != directories_.end() && (mask & marks_[it->second].mask)) {
+                parent_name_ = parent.name;
+                out[count++] = {it->second, mask, parent_name_};
+            }
+            return count;
+        }
+        if ((mask & IN_ISDIR) && (mask & (IN_DELETE | IN_MOVED_FROM))) {
+            forget_parent_locked(dir_key, name);
+        }
+        if (files_.empty() && entries_.empty()) {
+            return count;
+        }
+
+        scratch_.assign(dir_key);
+        scratch_ += '/';
+        scratch_ += name;
+        if (auto it = files_.find(scratch_); it != files_.end()) {
+            const int id = it->second;
+            uint32_t file_mask = mask & ~static_cast<uint32_t>(IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CREATE);
+            if (mask & IN_DELETE) {
+                file_mask |= IN_DELETE_SELF;
+            } else if (mask & IN_MOVED_FROM) {
+                file_mask |= IN_MOVE_SELF;
+            }
+            if (file_mask & marks_[id].mask) {
+                out[count++] = {id, file_mask, {}};
+            }
+            if (mask & (IN_DELETE | IN_MOVED_FROM)) {
+                forget_locked(id);
+            }
+        }
+        if (mask & IN_ISDIR) {
+            if (auto it = entries_.find(scratch_); it != entries_.end()) {
+                const int id = it->second;
+                if (mask & IN_DELETE) {
+                    if (marks_[id].mask & IN_DELETE_SELF) {
+                        out[count++] = {id, IN_DELETE_SELF, {}};
+                    }
+                    forget_locked(id);
+                } else if (mask & IN_MOVED_FROM) {
+                    // The handle still finds it; only the entry is stale.
+                    if (marks_[id].mask & IN_MOVE_SELF) {
+                        out[count++] = {id, IN_MOVE_SELF, {}};
+                    }
+                    entries_.erase(it);
+                }
+            }
+        }
+        return count;
+    }
+
+    template <typename OnEvent>
+    void fanotify_decode(std::string_view chunk, OnEvent& on_event) {
+        const char* const end = chunk.data() + chunk.size();
+        const char* cursor = chunk.data();
+        while (cursor + sizeof(fanotify_event_metadata) <= end) {
+            const auto* event = reinterpret_cast<const fanotify_event_metadata*>(cursor);
+            if (event->event_len < sizeof(fanotify_event_metadata) || cursor + event->event_len > end) {
+                break;
+            }
+            cursor += event->event_len;
+            if (event->fd >= 0) {
+                close(event->fd);
+            }
+            if (event->mask & FAN_Q_OVERFLOW) {
+                on_event(-1, static_cast<uint32_t>(IN_Q_OVERFLOW), std::string_view{});
+                continue;
+            }
+
+            const char* info = reinterpret_cast<const char*>(event) + event->metadata_len;
+            const char* const info_end = reinterpret_cast<const char*>(event) + event->event_len;
+            while (info + sizeof(fanotify_event_info_header) <= info_end) {
+                const auto* header = reinterpret_cast<const fanotify_event_info_header*>(info);
+                if (header->len == 0 || info + header->len > info_end) {
+                    break;
+                }
+                if (header->info_type == FAN_EVENT_INFO_TYPE_DFID_NAME) {
+                    dispatch_record(info, header->len, static_cast<uint32_t>(event->mask), on_event);
+                    break;
+                }
+                info += header->len;
+            }
+        }
+    }
+
+    template <typename OnEvent>
+    void dispatch_record(const char* record, size_t length, uint32_t mask, OnEvent& on_event) {
+        // header, fsid, struct file_handle, then the NUL-terminated name.
+        const char* key = record + sizeof(fanotify_event_info_header);
+        const size_t prefix = sizeof(fanotify_event_info_header) + sizeof(uint64_t) + offsetof(Handle, data);
+        if (length < prefix) {
+            return;
+        }
+        uint32_t handle_bytes;
+        std::memcpy(&handle_bytes, key + sizeof(uint64_t), sizeof(handle_bytes));
+        if (prefix + handle_bytes >= length) {
+            return;
+        }
+        const std::string_view dir_key{key, sizeof(uint64_t) + offsetof(Handle, data) + handle_bytes};
+        const char* name = key + dir_key.size();
+        const std::string_view entry{name, strnlen(name, static_cast<size_t>(record + length - name))};
+
+        mask &= kDirentEvents | IN_ISDIR;
+        Delivery deliveries[3];
+        size_t count;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            count = route_locked(dir_key, entry, mask, deliveries);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            on_event(deliveries[i].id, deliveries[i].mask, deliveries[i].name);
+        }
+    }
+
+    template <typename OnEvent>
+    void flush_synthesized(OnEvent& on_event) {
+        // on_event may remove watches and queue more.
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (synthesized_.empty()) {
+                    return;
+                }
+                delivering_.swap(synthesized_);
+            }
+            for (const auto& [id, mask] : delivering_) {
+                on_event(id, mask, std::string_view{});
+            }
+            delivering_.clear();
+        }
+    }
+
+    std::mutex mutex_;   // guards everything below but the drain() thread's scratch
+    int next_id_ = 1;
+    std::unordered_map<int, Mark> marks_;
+    KeyMap directories_;   // directory handle -> id
+    KeyMap files_;         // parent handle + '/' + name -> id of a file watch
+    KeyMap entries_;       // parent handle + '/' + name -> id of a directory watch
+    std::unordered_map<uint64_t, Filesystem> filesystems_;
+    std::unordered_map<std::string, Parent, Hash, std::equal_to<>> parents_;   // directory handle -> parent
+    std::vector<std::pair<int, uint32_t>> synthesized_;
+    std::vector<std::pair<int, uint32_t>> delivering_;   // drain() thread only
+    std::string scratch_;                                // drain() thread only
+    std::string parent_name_;                            // drain() thread only
+#endif
+};
+
+} // namespace FileWatcherAPI
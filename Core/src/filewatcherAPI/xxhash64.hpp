@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace FileWatcherAPI {
+
+// Minimal XXH64 (xxHash by Yann Collet, BSD-2). Used to fingerprint file
+// pages for change detection, not for anything security related.
+class XXHash64 {
+public:
+    static std::uint64_t hash(const void* input, size_t length, std::uint64_t seed = 0) noexcept {
+        const auto* p = static_cast<const unsigned char*>(input);
+        const unsigned char* const end = p + length;
+        std::uint64_t h;
+
+        if (length >= 32) {
+            std::uint64_t v1 = seed + kPrime1 + kPrime2;
+            std::uint64_t v2 = seed + kPrime2;
+            std::uint64_t v3 = seed;
+            std::uint64_t v4 = seed - kPrime1;
+            const unsigned char* const limit = end - 32;
+            do {
+                v1 = round(v1, read64(p));
+                v2 = round(v2, read64(p + 8));
+                v3 = round(v3, read64(p + 16));
+                v4 = round(v4, read64(p + 24));
+                p += 32;
+            } while (p <= limit);
+
+            h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            h = merge_round(h, v1);
+            h = merge_round(h, v2);
+            h = merge_round(h, v3);
+            h = merge_round(h, v4);
+        } else {
+            h = seed + kPrime5;
+        }
+
+        h += static_cast<std::uint64_t>(length);
+
+        while (p + 8 <= end) {
+            h ^= round(0, read64(p));
+            h = rotl(h, 27) * kPrime1 + kPrime4;
+            p += 8;
+        }
+        if (p + 4 <= end) {
+            h ^= static_cast<std::uint64_t>(read32(p)) * kPrime1;
+            h = rotl(h, 23) * kPrime2 + kPrime3;
+            p += 4;
+        }
+        while (p < end) {
+            h ^= static_cast<std::uint64_t>(*p) * kPrime5;
+            h = rotl(h, 11) * kPrime1;
+            ++p;
+        }
+
+        h ^= h >> 33;
+        h *= kPrime2;
+        h ^= h >> 29;
+        h *= kPrime3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static constexpr std::uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+    static constexpr std::uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+    static constexpr std::uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+    static constexpr std::uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+    static constexpr std::uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+    static constexpr std::uint64_t rotl(std::uint64_t x, int r) noexcept {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    static constexpr std::uint64_t round(std::uint64_t acc, std::uint64_t input) noexcept {
+        acc += input * kPrime2;
+        acc = rotl(acc, 31);
+        return acc * kPrime1;
+    }
+
+    static constexpr std::uint64_t merge_round(std::uint64_t acc, std::uint64_t val) noexcept {
+        acc ^= round(0, val);
+        return acc * kPrime1 + kPrime4;
+    }
+
+    static std::uint64_t read64(const unsigned char* p) noexcept {
+        std::uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    static std::uint32_t read32(const unsigned char* p) noexcept {
+        std::uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+};
+
+} // namespace FileWatcherAPI
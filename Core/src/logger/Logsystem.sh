@@ -11,12 +11,9 @@ MAX_FILES=3
 DAEMON_INSTANCE_ID=0
 MAX_DAEMON_INSTANCES=3
 
-SHELL_BUFFER_ENABLED=1
-SHELL_BUFFER_SIZE=20
-SHELL_BUFFER_TIMEOUT=10
-SHELL_BUFFER_COUNT=0
-SHELL_BUFFER_LAST_FLUSH=0
-SHELL_BUFFER_FILE="/tmp/logger_buffer_${DAEMON_INSTANCE_ID}.tmp"
+STREAM_FIFO="/tmp/logger_stream_$$.fifo"
+STREAM_PID=""
+STREAM_FAILED=""
 
 get_daemon_pid() {
     instance_id="${1:-$DAEMON_INSTANCE_ID}"
@@ -58,35 +55,42 @@ init_logger() {
     fi
 }
 
-add_to_buffer() {
-    level="$1"
-    message="$2"
+start_stream() {
+    daemon_pid="$1"
+    
+    # A client that cannot run would leave fd 3 with no reader, and the
+    # first write would kill the calling script with SIGPIPE.
+    "$LOGGER_CLIENT_PATH" -h >/dev/null 2>&1 || return 1
+    
+    rm -f "$STREAM_FIFO"
+    mkfifo "$STREAM_FIFO" 2>/dev/null || return 1
     
-    echo "$level $message" >> "$SHELL_BUFFER_FILE"
-    SHELL_BUFFER_COUNT=$((SHELL_BUFFER_COUNT + 1))
+    "$LOGGER_CLIENT_PATH" -s -p "$daemon_pid" < "$STREAM_FIFO" &
+    STREAM_PID=$!
+    exec 3>"$STREAM_FIFO"
+    rm -f "$STREAM_FIFO"
 }
 
-check_buffer_flush() {
-    current_time=$(date +%s)
-    time_diff=$((current_time - SHELL_BUFFER_LAST_FLUSH))
-    
-    if [ "$SHELL_BUFFER_COUNT" -ge "$SHELL_BUFFER_SIZE" ] || [ "$time_diff" -ge "$SHELL_BUFFER_TIMEOUT" ]; then
-        flush_buffer
+# The client exits at EOF, or once the daemon has refused a few batches
+# in a row (it died, or was restarted under a new pid). A zombie still
+# passes kill -0, so its state is read from /proc as well.
+stream_alive() {
+    kill -0 "$STREAM_PID" 2>/dev/null || return 1
+    state=""
+    if [ -r "/proc/$STREAM_PID/stat" ]; then
+        read -r _ _ state _ < "/proc/$STREAM_PID/stat"
     fi
+    [ "$state" != "Z" ]
 }
 
-flush_buffer() {
-    if [ "$SHELL_BUFFER_COUNT" -eq 0 ] || [ ! -f "$SHELL_BUFFER_FILE" ]; then
+stop_stream() {
+    if [ -z "$STREAM_PID" ]; then
         return 0
     fi
     
-    daemon_pid=$(get_daemon_pid "$DAEMON_INSTANCE_ID")
-    if [ -n "$daemon_pid" ]; then
-        "$LOGGER_CLIENT_PATH" -p "$daemon_pid" -b "$SHELL_BUFFER_FILE"
-        rm -f "$SHELL_BUFFER_FILE"
-        SHELL_BUFFER_COUNT=0
-        SHELL_BUFFER_LAST_FLUSH=$(date +%s)
-    fi
+    exec 3>&-
+    wait "$STREAM_PID" 2>/dev/null
+    STREAM_PID=""
 }
 
 log() {
@@ -97,22 +101,25 @@ log() {
         return 1
     fi
     
-    daemon_pid=$(get_daemon_pid "$DAEMON_INSTANCE_ID")
-    if [ -z "$daemon_pid" ]; then
-        return 1
+    if [ -n "$STREAM_PID" ] && ! stream_alive; then
+        stop_stream
+        STREAM_FAILED=1
     fi
     
-    if [ "$level" = "critical" ] || [ "$level" = "error" ]; then
-        "$LOGGER_CLIENT_PATH" -p "$daemon_pid" -l "$level" "$message"
-        return $?
+    if [ -z "$STREAM_PID" ]; then
+        daemon_pid=$(get_daemon_pid "$DAEMON_INSTANCE_ID")
+        if [ -z "$daemon_pid" ]; then
+            return 1
+        fi
+        # Once a stream has died, stay with the one-shot client rather
+        # than restarting a coprocess for every message.
+        if [ -n "$STREAM_FAILED" ] || ! start_stream "$daemon_pid"; then
+            "$LOGGER_CLIENT_PATH" -p "$daemon_pid" -l "$level" "$message"
+            return $?
+        fi
     fi
     
-    if [ "$SHELL_BUFFER_ENABLED" = "1" ]; then
-        add_to_buffer "$level" "$message"
-        check_buffer_flush
-    else
-        "$LOGGER_CLIENT_PATH" -p "$daemon_pid" -l "$level" "$message"
-    fi
+    printf '%s %s\n' "$level" "$message" >&3
 }
 
 log_debug() { log "debug" "$1"; }
@@ -122,14 +129,14 @@ log_error() { log "error" "$1"; }
 log_critical() { log "critical" "$1"; }
 
 flush_logs() {
-    flush_buffer
+    stop_stream
 }
 
 stop_logger() {
     daemon_pid=$(get_daemon_pid "$DAEMON_INSTANCE_ID")
     
     if [ -n "$daemon_pid" ]; then
-        flush_buffer
+        stop_stream
         kill "$daemon_pid"
         rm -f "/tmp/logger_daemon_${DAEMON_INSTANCE_ID}.pid"
     fi
@@ -163,8 +170,8 @@ status() {
 }
 
 cleanup() {
-    flush_buffer
-    rm -f "$SHELL_BUFFER_FILE"
+    stop_stream
+    rm -f "$STREAM_FIFO"
 }
 
 trap cleanup EXIT
@@ -0,0 +1,120 @@
+#include "buffer_manager.hpp"
+#include <cstring>
+#include <thread>
+
+BufferManager::BufferManager(size_t buffer_size) noexcept
+    : buffer_(new (std::nothrow) char[buffer_size]),
+      buffer_size_(buffer_ ? buffer_size : 0),
+      half_size_(buffer_size_ / 2),
+      flush_threshold_(half_size_ / 2),
+      last_flush_time_(std::chrono::steady_clock::now()) {
+    halves_[0].data = buffer_.get();
+    halves_[1].data = buffer_.get() + half_size_;
+}
+
+BufferManager::~BufferManager() noexcept = default;
+
+bool BufferManager::add_log(std::string_view data, LogLevel level) noexcept {
+    const size_t len = data.size();
+    if (len == 0) {
+        return true;
+    }
+    if (len > half_size_) {
+        rejected_.add();
+        return false;
+    }
+
+    while (true) {
+        const std::uint32_t index = active_.load(std::memory_order_seq_cst);
+        Half& half = halves_[index];
+
+        // Announce ourselves before re-checking the active index; get_data()
+        // does the mirror image (swap, then read writers), so either it sees
+        // us or we see the swap.
+        half.writers.fetch_add(1, std::memory_order_seq_cst);
+        if (active_.load(std::memory_order_seq_cst) != index) {
+            half.writers.fetch_sub(1, std::memory_order_release);
+            continue;
+        }
+
+        const size_t offset = half.write_pos.fetch_add(len, std::memory_order_relaxed);
+        const bool fits = offset + len <= half_size_;
+        if (fits) {
+            std::memcpy(half.data + offset, data.data(), len);
+
+            // Offsets are handed out monotonically, so successful writes form
+            // one contiguous prefix; publish its end.
+            size_t end = half.committed_end.load(std::memory_order_relaxed);
+            while (end < offset + len &&
+                   !half.committed_end.compare_exchange_weak(end, offset + len, std::memory_order_relaxed)) {
+            }
+        }
+        half.writers.fetch_sub(1, std::memory_order_release);
+
+        if (!fits) {
+            rejected_.add();
+            return false;
+        }
+        appended_lines_.add();
+        appended_bytes_.add(len);
+        if (level >= LogLevel::ERROR) {
+            has_critical_logs_.store(true, std::memory_order_release);
+        }
+        return true;
+    }
+}
+
+bool BufferManager::should_flush() const noexcept {
+    const size_t pending = get_pending_size();
+    if (pending == 0) {
+        return false;
+    }
+    if (pending >= flush_threshold_ || has_critical_logs_.load(std::memory_order_acquire)) {
+        return true;
+    }
+    return std::chrono::steady_clock::now() - last_flush_time_ >= std::chrono::milliseconds(flush_interval_ms_);
+}
+
+bool BufferManager::should_force_flush() const noexcept {
+    return has_critical_logs_.load(std::memory_order_acquire) ||
+           get_pending_size() >= half_size_ - half_size_ / 10;
+}
+
+std::span<const char> BufferManager::get_data() noexcept {
+    if (!buffer_) {
+        return {};
+    }
+
+    Half& retired = halves_[retired_];
+    if (retired.committed_end.load(std::memory_order_relaxed) == 0) {
+        // The previous batch was cleared: retire the active half. Drop the
+        // critical flag first so one raised after the swap is not lost.
+        has_critical_logs_.store(false, std::memory_order_relaxed);
+        retired_ = active_.load(std::memory_order_relaxed);
+        active_.store(retired_ ^ 1u, std::memory_order_seq_cst);
+    }
+
+    Half& half = halves_[retired_];
+    while (half.writers.load(std::memory_order_seq_cst) != 0) {
+        std::this_thread::yield();
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    return {half.data, half.committed_end.load(std::memory_order_relaxed)};
+}
+
+void BufferManager::clear() noexcept {
+    Half& half = halves_[retired_];
+    half.write_pos.store(0, std::memory_order_relaxed);
+    half.committed_end.store(0, std::memory_order_relaxed);
+    last_flush_time_ = std::chrono::steady_clock::now();
+}
+
+bool BufferManager::is_empty() const noexcept {
+    return get_pending_size() == 0;
+}
+
+size_t BufferManager::get_pending_size() const noexcept {
+    const Half& half = halves_[active_.load(std::memory_order_relaxed)];
+    return half.committed_end.load(std::memory_order_relaxed);
+}
@@ -1,20 +1,20 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <chrono>
 #include <memory>
 #include <atomic>
 #include <string_view>
 #include <span>
 
-enum class LogLevel : std::uint8_t {
-    DEBUG = 1,
-    INFO = 2,
-    WARNING = 3,
-    ERROR = 4,
-    CRITICAL = 5
-};
+#include "log_level.hpp"
+#include "metrics.hpp"
 
+// Double-buffered, lock-free multi-producer log buffer. Producers reserve
+// space in the active half with a fetch_add and copy without locking; the
+// single flusher swaps halves in get_data(), waits for in-flight writers on
+// the retired half and hands it out as a span without copying.
 class BufferManager final {
 public:
     explicit BufferManager(size_t buffer_size = 262144) noexcept; // 256KB for better batching
@@ -32,14 +32,33 @@ public:
     void clear() noexcept;
     [[nodiscard]] bool is_empty() const noexcept;
     [[nodiscard]] size_t get_pending_size() const noexcept;
+    [[nodiscard]] size_t capacity() const noexcept { return half_size_; }
+    
+    // Lines and bytes accepted, and add_log() calls refused for lack of room.
+    [[nodiscard]] std::uint64_t appended_lines() const noexcept { return appended_lines_.value(); }
+    [[nodiscard]] std::uint64_t appended_bytes() const noexcept { return appended_bytes_.value(); }
+    [[nodiscard]] std::uint64_t rejected() const noexcept { return rejected_.value(); }
     
 private:
+    struct alignas(64) Half {
+        char* data = nullptr;
+        std::atomic<size_t> write_pos{0};
+        std::atomic<size_t> committed_end{0};
+        std::atomic<std::uint32_t> writers{0};
+    };
+    
     std::unique_ptr<char[]> buffer_;
-    std::atomic<size_t> write_pos_{0};
+    Half halves_[2];
+    std::atomic<std::uint32_t> active_{0};
     size_t buffer_size_;
+    size_t half_size_;
     size_t flush_threshold_;
     std::atomic<bool> has_critical_logs_{false};
+    std::uint32_t retired_ = 1;
     mutable std::chrono::steady_clock::time_point last_flush_time_;
+    ShardedCounter appended_lines_;
+    ShardedCounter appended_bytes_;
+    ShardedCounter rejected_;
     
 #ifdef ANDROID_DOZE_AWARE
     static constexpr int flush_interval_ms_ = 60000; // 1 minute for power saving
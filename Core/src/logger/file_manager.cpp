@@ -0,0 +1,251 @@
+#include "file_manager.hpp"
+#include "uring_writer.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <new>
+#include <string>
+#include <linux/falloc.h>
+#include <sys/syscall.h>
+
+#ifndef RENAME_EXCHANGE
+#define RENAME_EXCHANGE (1 << 1)
+#endif
+
+namespace {
+
+constexpr int kMaxIov = 64;
+
+// renameat2() is only in bionic from API 30; the syscall is much older.
+bool exchange_paths(const char* a, const char* b) noexcept {
+#ifdef __NR_renameat2
+    return syscall(__NR_renameat2, AT_FDCWD, a, AT_FDCWD, b, RENAME_EXCHANGE) == 0;
+#else
+    (void)a;
+    (void)b;
+    errno = ENOSYS;
+    return false;
+#endif
+}
+
+} // namespace
+
+FileManager::FileManager(std::string_view base_path, size_t max_size, int max_files) noexcept
+    : base_path_(base_path), spare_path_(base_path_ + ".next"), fd_(-1), max_file_size_(max_size),
+      max_files_(max_files < 1 ? 1 : max_files) {
+    (void)open_file();
+}
+
+FileManager::~FileManager() noexcept {
+    if (fd_ >= 0) {
+        flush();
+        // Give back the preallocated tail past what was actually written.
+        (void)!ftruncate(fd_, static_cast<off_t>(current_size_.load(std::memory_order_relaxed)));
+        close(fd_);
+    }
+    if (spare_fd_ >= 0) {
+        close(spare_fd_);
+        unlink(spare_path_.c_str());
+    }
+}
+
+bool FileManager::enable_io_uring() noexcept {
+    if (!uring_) {
+        uring_.reset(new (std::nothrow) UringWriter());
+    }
+    if (!uring_ || !uring_->init()) {
+        uring_.reset();
+        return false;
+    }
+    return true;
+}
+
+bool FileManager::using_io_uring() const noexcept {
+    return uring_ && uring_->available();
+}
+
+bool FileManager::write(std::string_view data) noexcept {
+    return write_batch(std::span<const std::string_view>{&data, 1});
+}
+
+bool FileManager::write_batch(std::span<const std::string_view> chunks, bool sync) noexcept {
+    size_t total = 0;
+    for (const auto& chunk : chunks) {
+        total += chunk.size();
+    }
+    if (total == 0) {
+        return true;
+    }
+    if (fd_ < 0 && !open_file()) {
+        return false;
+    }
+
+    const size_t current = current_size_.load(std::memory_order_relaxed);
+    if (current > 0 && current + total > max_file_size_) {
+        rotate_file();
+        if (fd_ < 0) {
+            return false;
+        }
+    } else if (spare_fd_ < 0 && current + total >= max_file_size_ / 2) {
+        // Half way through the segment: get the next one ready so the
+        // rotation itself does no allocation.
+        prepare_spare();
+    }
+
+    struct iovec iov[kMaxIov];
+    int count = 0;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        if (chunks[i].empty()) {
+            continue;
+        }
+        iov[count].iov_base = const_cast<char*>(chunks[i].data());
+        iov[count].iov_len = chunks[i].size();
+        if (++count == kMaxIov) {
+            if (!write_all(iov, count, false)) {
+                return false;
+            }
+            count = 0;
+        }
+    }
+    if (count > 0) {
+        return write_all(iov, count, sync);
+    }
+    if (sync) {
+        flush();
+    }
+    return true;
+}
+
+bool FileManager::write_all(struct iovec* iov, int count, bool sync) noexcept {
+    const bool uring = using_io_uring();
+    while (count > 0) {
+        ssize_t written;
+        if (uring) {
+            written = uring_->writev(fd_, iov, count, current_size_.load(std::memory_order_relaxed), sync);
+            if (written < 0) {
+                errno = static_cast<int>(-written);
+                written = -1;
+            }
+        } else {
+            written = ::writev(fd_, iov, count);
+        }
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        current_size_.fetch_add(static_cast<size_t>(written), std::memory_order_relaxed);
+
+        // Drop what went out and resubmit the remainder of a short write.
+        auto remaining = static_cast<size_t>(written);
+        while (count > 0 && remaining >= iov->iov_len) {
+            remaining -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + remaining;
+            iov->iov_len -= remaining;
+        }
+    }
+
+    // The io_uring path linked its fdatasync to the final write already.
+    if (sync && !uring) {
+        fdatasync(fd_);
+    }
+    return true;
+}
+
+void FileManager::flush() noexcept {
+    if (fd_ < 0) {
+        return;
+    }
+    if (!using_io_uring() || uring_->fdatasync(fd_) < 0) {
+        fdatasync(fd_);
+    }
+}
+
+void FileManager::preallocate(int fd) const noexcept {
+    // KEEP_SIZE reserves blocks without moving EOF, so readers still see
+    // only what was written. Filesystems without support (FUSE, sdcardfs)
+    // just skip it.
+    (void)fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(max_file_size_));
+}
+
+void FileManager::prepare_spare() noexcept {
+    if (spare_fd_ >= 0) {
+        return;
+    }
+    spare_fd_ = open(spare_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (spare_fd_ >= 0) {
+        preallocate(spare_fd_);
+    }
+}
+
+void FileManager::rotate_file() noexcept {
+    prepare_spare();
+
+    // base.log.(n-2) -> base.log.(n-1), ..., base.log.1 -> base.log.2; the
+    // oldest one is overwritten by the rename.
+    std::string from;
+    std::string to;
+    for (int i = max_files_ - 1; i > 1; --i) {
+        from = base_path_ + '.' + std::to_string(i - 1);
+        to = base_path_ + '.' + std::to_string(i);
+        std::rename(from.c_str(), to.c_str());
+    }
+    const std::string first = base_path_ + ".1";
+
+    if (spare_fd_ < 0) {
+        // No spare segment (e.g. out of fds): classic close/rename/reopen.
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+        if (max_files_ > 1) {
+            std::rename(base_path_.c_str(), first.c_str());
+        } else {
+            unlink(base_path_.c_str());
+        }
+        (void)open_file();
+        return;
+    }
+
+    // Swap the empty spare in under the live name in one step, so the log
+    // path never goes missing for anyone tailing it, then file the old
+    // segment away under .1.
+    if (exchange_paths(spare_path_.c_str(), base_path_.c_str())) {
+        if (max_files_ > 1) {
+            std::rename(spare_path_.c_str(), first.c_str());
+        } else {
+            unlink(spare_path_.c_str());
+        }
+    } else {
+        if (max_files_ > 1) {
+            std::rename(base_path_.c_str(), first.c_str());
+        } else {
+            unlink(base_path_.c_str());
+        }
+        std::rename(spare_path_.c_str(), base_path_.c_str());
+    }
+
+    const int old_fd = fd_;
+    const size_t old_size = current_size_.exchange(0, std::memory_order_relaxed);
+    fd_ = spare_fd_;
+    spare_fd_ = -1;
+    if (old_fd >= 0) {
+        (void)!ftruncate(old_fd, static_cast<off_t>(old_size));
+        close(old_fd);
+    }
+}
+
+bool FileManager::open_file() noexcept {
+    fd_ = open(base_path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        return false;
+    }
+    struct stat st;
+    current_size_.store(fstat(fd_, &st) == 0 ? static_cast<size_t>(st.st_size) : 0, std::memory_order_relaxed);
+    preallocate(fd_);
+    return true;
+}
@@ -4,30 +4,52 @@
 #include <string_view>
 #include <cstddef>
 #include <atomic>
+#include <memory>
+#include <span>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 
+class UringWriter;
+
+// Append-only segment writer. Every batch goes out in one writev() (or one
+// io_uring submission when enabled). Segments are fallocate()d to max_size
+// up front so appends never allocate blocks, and the next segment is opened
+// and preallocated ahead of time so rotation is a pair of renames plus an fd
+// swap.
 class FileManager final {
 public:
     explicit FileManager(std::string_view base_path, size_t max_size = 5242880, int max_files = 3) noexcept;
     ~FileManager() noexcept;
-    
+
     FileManager(const FileManager&) = delete;
     FileManager& operator=(const FileManager&) = delete;
     FileManager(FileManager&&) = delete;
     FileManager& operator=(FileManager&&) = delete;
-    
+
     [[nodiscard]] bool write(std::string_view data) noexcept;
+    [[nodiscard]] bool write_batch(std::span<const std::string_view> chunks, bool sync = false) noexcept;
     void flush() noexcept;
-    
+
+    // Opt in to the io_uring path; returns false (and keeps writev) when the
+    // kernel or its seccomp policy does not allow it.
+    bool enable_io_uring() noexcept;
+    [[nodiscard]] bool using_io_uring() const noexcept;
+
 private:
     std::string base_path_;
+    std::string spare_path_;
     int fd_;
+    int spare_fd_ = -1;
     std::atomic<size_t> current_size_{0};
     size_t max_file_size_;
     int max_files_;
-    
+    std::unique_ptr<UringWriter> uring_;
+
     void rotate_file() noexcept;
     [[nodiscard]] bool open_file() noexcept;
+    void prepare_spare() noexcept;
+    void preallocate(int fd) const noexcept;
+    [[nodiscard]] bool write_all(struct iovec* iov, int count, bool sync) noexcept;
 };
\ No newline at end of file
@@ -0,0 +1,331 @@
+#include "ipc_client.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#define F_SEAL_SEAL 0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#endif
+
+namespace {
+
+constexpr size_t kMaxPacketIov = 128;
+
+// memfd_create() is only in bionic from API 30; the syscall is 3.17+.
+int create_memfd(const char* name) noexcept {
+#ifdef __NR_memfd_create
+    return static_cast<int>(syscall(__NR_memfd_create, name, MFD_CLOEXEC | MFD_ALLOW_SEALING));
+#else
+    (void)name;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+} // namespace
+
+IPCClient::IPCClient(int daemon_pid) noexcept
+    : daemon_pid_(daemon_pid), pid_(static_cast<std::uint32_t>(getpid())), socket_path_{} {
+#ifdef ANDROID_DOZE_AWARE
+    wake_fd_ = -1;
+#endif
+    generate_socket_path();
+}
+
+IPCClient::~IPCClient() noexcept {
+    flush();
+    release_ring();
+    const int fd = sock_fd_.exchange(-1);
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+void IPCClient::set_daemon_pid(int pid) {
+    daemon_pid_ = pid;
+    generate_socket_path();
+    const int fd = sock_fd_.exchange(-1);
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+void IPCClient::generate_socket_path() noexcept {
+    // Abstract namespace: leading NUL, nothing left behind on disk. Without a
+    // pid, talk to whichever daemon claimed the shared default name.
+    socket_path_.fill('\0');
+    if (daemon_pid_ > 0) {
+        std::snprintf(socket_path_.data() + 1, socket_path_.size() - 1, "aurora_logger_%d", daemon_pid_);
+    } else {
+        std::snprintf(socket_path_.data() + 1, socket_path_.size() - 1, "aurora_logger");
+    }
+}
+
+bool IPCClient::ensure_connection() noexcept {
+    if (sock_fd_.load(std::memory_order_acquire) >= 0) {
+        return true;
+    }
+
+    const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    const size_t name_len = 1 + std::strlen(socket_path_.data() + 1);
+    std::memcpy(addr.sun_path, socket_path_.data(), name_len);
+    const auto addr_len = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + name_len);
+    if (connect(fd, reinterpret_cast<const struct sockaddr*>(&addr), addr_len) != 0) {
+        close(fd);
+        return false;
+    }
+
+    // A new daemon (or a restarted one) needs the ring again; it picks up
+    // from the dequeue position stored in the ring itself.
+    if (ring_mem_fd_ >= 0 && !attach_ring(fd)) {
+        close(fd);
+        return false;
+    }
+
+    int expected = -1;
+    if (!sock_fd_.compare_exchange_strong(expected, fd, std::memory_order_acq_rel)) {
+        close(fd);
+        return true;
+    }
+#ifdef ANDROID_DOZE_AWARE
+    setup_doze_protection();
+#endif
+    return true;
+}
+
+#ifdef ANDROID_DOZE_AWARE
+void IPCClient::setup_doze_protection() noexcept {
+    // A daemon frozen by Doze must not wedge its clients: bound every send.
+    const int fd = sock_fd_.load(std::memory_order_relaxed);
+    struct timeval timeout{0, 200000};
+    if (fd >= 0) {
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    }
+}
+#endif
+
+LogFrameHeader IPCClient::make_header(LogLevel level, size_t length, std::uint64_t timestamp_ns) const noexcept {
+    if (timestamp_ns == 0) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        timestamp_ns = static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<std::uint64_t>(ts.tv_nsec);
+    }
+    LogFrameHeader header{};
+    header.timestamp_ns = timestamp_ns;
+    header.pid = pid_;
+    header.length = static_cast<std::uint16_t>(length);
+    header.level = static_cast<std::uint8_t>(level);
+    return header;
+}
+
+bool IPCClient::enable_shared_ring(std::uint32_t slots) noexcept {
+    if (ring_) {
+        return true;
+    }
+
+    std::uint32_t count = 16;
+    while (count < slots && count < 65536) {
+        count <<= 1;
+    }
+    const size_t bytes = SharedLogRing::bytes_for(count);
+
+    const int mem_fd = create_memfd("aurora_logger_ring");
+    if (mem_fd < 0) {
+        return false;
+    }
+    if (ftruncate(mem_fd, static_cast<off_t>(bytes)) != 0) {
+        close(mem_fd);
+        return false;
+    }
+    // The daemon maps this too; sealing the size means we cannot SIGBUS it
+    // by truncating the file underneath it.
+    fcntl(mem_fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd, 0);
+    const int event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (memory == MAP_FAILED || event_fd < 0) {
+        if (memory != MAP_FAILED) {
+            munmap(memory, bytes);
+        }
+        if (event_fd >= 0) {
+            close(event_fd);
+        }
+        close(mem_fd);
+        return false;
+    }
+
+    ring_ = SharedLogRing::create(memory, count);
+    ring_bytes_ = bytes;
+    ring_mem_fd_ = mem_fd;
+    ring_event_fd_ = event_fd;
+
+    const int fd = sock_fd_.load(std::memory_order_acquire);
+    if (fd >= 0 ? attach_ring(fd) : ensure_connection()) {
+        return true;
+    }
+    release_ring();
+    return false;
+}
+
+bool IPCClient::attach_ring(int fd) noexcept {
+    LogFrameHeader header = make_header(LogLevel::INFO, 0);
+    header.flags = kFrameAttachRing;
+    struct iovec iov{&header, sizeof(header)};
+
+    const int fds[2] = {ring_mem_fd_, ring_event_fd_};
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(fds))];
+    std::memset(control, 0, sizeof(control));
+
+    struct msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    while (sendmsg(fd, &msg, MSG_NOSIGNAL) < 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void IPCClient::release_ring() noexcept {
+    if (ring_) {
+        munmap(ring_, ring_bytes_);
+        ring_ = nullptr;
+    }
+    if (ring_mem_fd_ >= 0) {
+        close(ring_mem_fd_);
+        ring_mem_fd_ = -1;
+    }
+    if (ring_event_fd_ >= 0) {
+        close(ring_event_fd_);
+        ring_event_fd_ = -1;
+    }
+}
+
+void IPCClient::flush() noexcept {
+    if (ring_ && !ring_->empty()) {
+        const std::uint64_t one = 1;
+        (void)!write(ring_event_fd_, &one, sizeof(one));
+    }
+}
+
+bool IPCClient::send(std::string_view message, LogLevel level) noexcept {
+    if (ring_) {
+        message = message.substr(0, kLogMaxMessage);
+        bool wake = false;
+        if (ring_->push(make_header(level, message.size()), message, wake)) {
+            if (wake) {
+                const std::uint64_t one = 1;
+                (void)!write(ring_event_fd_, &one, sizeof(one));
+            }
+            return true;
+        }
+    }
+
+    const LogRecord record{level, message};
+    return batch_send(std::span<const LogRecord>{&record, 1});
+}
+
+bool IPCClient::send_packet(int fd, struct iovec* iov, size_t count) noexcept {
+    struct msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    while (sendmsg(fd, &msg, MSG_NOSIGNAL) < 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool IPCClient::batch_send(std::span<const LogRecord> records) noexcept {
+    if (records.empty()) {
+        return true;
+    }
+
+    std::vector<LogFrameHeader> headers(records.size());
+    std::vector<struct iovec> iov;
+    iov.reserve(std::min(records.size() * 2, kMaxPacketIov));
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (!ensure_connection()) {
+            return false;
+        }
+        const int fd = sock_fd_.load(std::memory_order_acquire);
+
+        // A SEQPACKET send is all-or-nothing and frames never straddle two
+        // packets, so delivery only has to be tracked per packet.
+        bool sent_any = false;
+        bool failed = false;
+        size_t packet_bytes = 0;
+        iov.clear();
+        for (size_t index = 0; index < records.size() && !failed; ++index) {
+            const std::string_view message = records[index].message.substr(0, kLogMaxMessage);
+            const size_t frame_bytes = sizeof(LogFrameHeader) + message.size();
+            if (!iov.empty() && (packet_bytes + frame_bytes > kLogMaxPacket || iov.size() + 2 > kMaxPacketIov)) {
+                failed = !send_packet(fd, iov.data(), iov.size());
+                sent_any = sent_any || !failed;
+                packet_bytes = 0;
+                iov.clear();
+            }
+            headers[index] = make_header(records[index].level, message.size(), records[index].timestamp_ns);
+            if (records[index].pid != 0) {
+                headers[index].pid = records[index].pid;
+            }
+            iov.push_back({&headers[index], sizeof(LogFrameHeader)});
+            if (!message.empty()) {
+                iov.push_back({const_cast<char*>(message.data()), message.size()});
+            }
+            packet_bytes += frame_bytes;
+        }
+        if (!failed && send_packet(fd, iov.data(), iov.size())) {
+            return true;
+        }
+
+        // Daemon restarted or went away. Resending from the start would
+        // duplicate the packets that did get through, so only retry when
+        // nothing was delivered yet.
+        const int stale = sock_fd_.exchange(-1);
+        if (stale >= 0) {
+            close(stale);
+        }
+        if (sent_any) {
+            return false;
+        }
+    }
+    return false;
+}
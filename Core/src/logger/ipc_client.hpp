@@ -6,52 +6,67 @@
 #include <array>
 #include <span>
 #include <atomic>
+#include <sys/uio.h>
 
-#ifdef ANDROID_DOZE_AWARE
-#include <sys/timerfd.h>
-#include <sys/eventfd.h>
-#endif
+#include "log_level.hpp"
+#include "log_protocol.hpp"
 
-enum class LogLevel : std::uint8_t {
-    DEBUG = 1,
-    INFO = 2,
-    WARNING = 3,
-    ERROR = 4,
-    CRITICAL = 5
+struct LogRecord {
+    LogLevel level;
+    std::string_view message;
+    std::uint64_t timestamp_ns = 0;   // CLOCK_REALTIME; 0 stamps at send time
+    std::uint32_t pid = 0;            // 0 means this process
 };
 
 class IPCClient final {
 public:
     explicit IPCClient(int daemon_pid = 0) noexcept;
     ~IPCClient() noexcept;
-    
+
     IPCClient(const IPCClient&) = delete;
     IPCClient& operator=(const IPCClient&) = delete;
     IPCClient(IPCClient&&) = delete;
     IPCClient& operator=(IPCClient&&) = delete;
-    
+
     [[nodiscard]] bool send(std::string_view message, LogLevel level = LogLevel::INFO) noexcept;
-    [[nodiscard]] bool batch_send(std::span<const std::string_view> messages, std::span<const LogLevel> levels) noexcept;
-    
+    // Packs as many records per SOCK_SEQPACKET packet as fit in kLogMaxPacket.
+    [[nodiscard]] bool batch_send(std::span<const LogRecord> records) noexcept;
+
+    // Maps a memfd ring of `slots` entries and hands it to the daemon, after
+    // which send() normally costs no syscall at all. Lines that do not fit a
+    // slot, or arrive while the ring is full, still go over the socket.
+    [[nodiscard]] bool enable_shared_ring(std::uint32_t slots = 1024) noexcept;
+    // Wakes the daemon if the ring holds lines below the watermark.
+    void flush() noexcept;
+
     void debug(std::string_view message) noexcept { (void)send(message, LogLevel::DEBUG); }
     void info(std::string_view message) noexcept { (void)send(message, LogLevel::INFO); }
     void warning(std::string_view message) noexcept { (void)send(message, LogLevel::WARNING); }
     void error(std::string_view message) noexcept { (void)send(message, LogLevel::ERROR); }
     void critical(std::string_view message) noexcept { (void)send(message, LogLevel::CRITICAL); }
-    
+
     void set_daemon_pid(int pid);
-    
+
 private:
     std::atomic<int> sock_fd_{-1};
     int daemon_pid_;
+    std::uint32_t pid_;
     std::array<char, 64> socket_path_;
-    
+
+    SharedLogRing* ring_ = nullptr;
+    size_t ring_bytes_ = 0;
+    int ring_mem_fd_ = -1;      // kept so a reconnect can hand the ring over again
+    int ring_event_fd_ = -1;
+
 #ifdef ANDROID_DOZE_AWARE
     int wake_fd_;
     void setup_doze_protection() noexcept;
 #endif
-    
+
     [[nodiscard]] bool ensure_connection() noexcept;
     void generate_socket_path() noexcept;
-    [[nodiscard]] static constexpr char level_to_char(LogLevel level) noexcept;
+    [[nodiscard]] bool attach_ring(int fd) noexcept;
+    [[nodiscard]] bool send_packet(int fd, struct iovec* iov, size_t count) noexcept;
+    void release_ring() noexcept;
+    [[nodiscard]] LogFrameHeader make_header(LogLevel level, size_t length, std::uint64_t timestamp_ns = 0) const noexcept;
 };
\ No newline at end of file
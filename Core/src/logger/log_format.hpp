@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+#include "log_level.hpp"
+#include "log_protocol.hpp"
+
+// Level words accepted from the command line and from streamed records.
+inline bool parse_level_name(std::string_view name, LogLevel& level) noexcept {
+    if (name == "debug") {
+        level = LogLevel::DEBUG;
+    } else if (name == "info") {
+        level = LogLevel::INFO;
+    } else if (name == "warning" || name == "warn") {
+        level = LogLevel::WARNING;
+    } else if (name == "error") {
+        level = LogLevel::ERROR;
+    } else if (name == "critical") {
+        level = LogLevel::CRITICAL;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline constexpr std::string_view level_name(std::uint8_t level) noexcept {
+    switch (static_cast<LogLevel>(level)) {
+        case LogLevel::DEBUG: return "DEBUG";
+        case LogLevel::INFO: return "INFO";
+        case LogLevel::WARNING: return "WARN";
+        case LogLevel::ERROR: return "ERROR";
+        case LogLevel::CRITICAL: return "CRIT";
+    }
+    return "INFO";
+}
+
+// Formats "YYYY-MM-DD HH:MM:SS.mmm [LEVEL] [pid] message\n" from the client's
+// own timestamp. Shared by logger_daemon and logger_client -o so both write
+// identical files. The seconds part is cached per instance; localtime_r is
+// far more expensive than the copy.
+class LineFormatter {
+public:
+    std::string_view format(const LogFrameHeader& frame, std::string_view message) noexcept {
+        const auto sec = static_cast<time_t>(frame.timestamp_ns / 1000000000ULL);
+        if (sec != cached_sec_) {
+            cached_sec_ = sec;
+            struct tm tm;
+            localtime_r(&sec, &tm);
+            strftime(prefix_, sizeof(prefix_), "%Y-%m-%d %H:%M:%S", &tm);
+        }
+
+        line_.clear();
+        line_.append(prefix_);
+        char fields[48];
+        const int len = std::snprintf(fields, sizeof(fields), ".%03u [%.*s] [%u] ",
+                                      static_cast<unsigned>(frame.timestamp_ns % 1000000000ULL / 1000000ULL),
+                                      static_cast<int>(level_name(frame.level).size()), level_name(frame.level).data(),
+                                      frame.pid);
+        line_.append(fields, static_cast<size_t>(len > 0 ? len : 0));
+        line_.append(message.substr(0, kLogMaxMessage));
+        line_.push_back('\n');
+        return line_;
+    }
+
+private:
+    time_t cached_sec_ = -1;
+    char prefix_[32] = {};
+    std::string line_;
+};
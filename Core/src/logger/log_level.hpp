@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+enum class LogLevel : std::uint8_t {
+    DEBUG = 1,
+    INFO = 2,
+    WARNING = 3,
+    ERROR = 4,
+    CRITICAL = 5
+};
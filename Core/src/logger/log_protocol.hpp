@@ -0,0 +1,178 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include "log_level.hpp"
+
+// Wire format between IPCClient and logger_daemon. The socket is
+// SOCK_SEQPACKET: one packet carries one or more frames back to back and is
+// delivered whole, so a batch of lines costs one sendmsg()/recvmsg().
+struct LogFrameHeader {
+    std::uint64_t timestamp_ns;   // CLOCK_REALTIME at the client
+    std::uint32_t pid;
+    std::uint16_t length;         // payload bytes following the header
+    std::uint8_t level;           // LogLevel
+    std::uint8_t flags;
+};
+static_assert(sizeof(LogFrameHeader) == 16);
+
+inline constexpr std::uint8_t kFrameAttachRing = 0x01;   // SCM_RIGHTS: memfd, eventfd
+inline constexpr size_t kLogMaxPacket = 64 * 1024;
+inline constexpr size_t kLogMaxMessage = 4096;
+
+// Decodes every complete frame of one packet.
+template <typename OnFrame>
+inline void for_each_frame(std::string_view packet, OnFrame&& on_frame) noexcept {
+    while (packet.size() >= sizeof(LogFrameHeader)) {
+        LogFrameHeader header;
+        std::memcpy(&header, packet.data(), sizeof(header));
+        packet.remove_prefix(sizeof(header));
+        if (header.length > packet.size()) {
+            return;
+        }
+        on_frame(header, packet.substr(0, header.length));
+        packet.remove_prefix(header.length);
+    }
+}
+
+// Shared-memory ring in a memfd that a client maps and hands to the daemon.
+// It is a bounded MPSC queue of fixed-size slots (Vyukov style: each slot
+// carries a sequence number), so client threads enqueue with one CAS and no
+// syscall; the daemon is only kicked through the eventfd when the depth
+// reaches the watermark or an ERROR line goes in, and otherwise drains the
+// ring on its periodic tick. Everything in here is position independent.
+class SharedLogRing {
+public:
+    static constexpr std::uint32_t kMagic = 0x41524c47;   // "ARLG"
+    static constexpr std::uint32_t kSlotSize = 512;
+    static constexpr size_t kSlotPayload = kSlotSize - sizeof(std::uint64_t) - sizeof(LogFrameHeader);
+
+    struct Header {
+        std::uint32_t magic;
+        std::uint32_t slot_count;   // power of two
+        std::uint32_t watermark;
+        std::uint32_t reserved;
+        alignas(64) std::atomic<std::uint64_t> enqueue_pos;
+        alignas(64) std::atomic<std::uint64_t> dequeue_pos;
+        std::atomic<std::uint32_t> signalled;   // a wakeup is already in flight
+    };
+
+    struct Slot {
+        std::atomic<std::uint64_t> sequence;
+        LogFrameHeader header;
+        char payload[kSlotPayload];
+    };
+    static_assert(sizeof(Slot) == kSlotSize);
+
+    static constexpr size_t bytes_for(std::uint32_t slot_count) noexcept {
+        return sizeof(Header) + static_cast<size_t>(slot_count) * sizeof(Slot);
+    }
+
+    // Formats fresh memory (client side).
+    static SharedLogRing* create(void* memory, std::uint32_t slot_count) noexcept {
+        auto* ring = static_cast<SharedLogRing*>(memory);
+        Header& header = ring->header_;
+        header.magic = kMagic;
+        header.slot_count = slot_count;
+        header.watermark = slot_count / 4 ? slot_count / 4 : 1;
+        header.enqueue_pos.store(0, std::memory_order_relaxed);
+        header.dequeue_pos.store(0, std::memory_order_relaxed);
+        header.signalled.store(0, std::memory_order_relaxed);
+        for (std::uint32_t i = 0; i < slot_count; ++i) {
+            ring->slot(i).sequence.store(i, std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        return ring;
+    }
+
+    // Validates memory handed over by a client (daemon side). The client can
+    // still scribble on the header afterwards, so the consumer keeps using
+    // the slot count checked here rather than re-reading it.
+    static SharedLogRing* attach(void* memory, size_t size, std::uint32_t& slot_count) noexcept {
+        if (size < sizeof(Header)) {
+            return nullptr;
+        }
+        auto* ring = static_cast<SharedLogRing*>(memory);
+        const std::uint32_t count = ring->header_.slot_count;
+        if (ring->header_.magic != kMagic || count == 0 || (count & (count - 1)) != 0 || bytes_for(count) > size) {
+            return nullptr;
+        }
+        slot_count = count;
+        return ring;
+    }
+
+    // Producer. Returns false when the ring is full or the line does not fit
+    // a slot; the caller then falls back to the socket. `wake` is set when
+    // the daemon should be kicked.
+    bool push(const LogFrameHeader& frame, std::string_view payload, bool& wake) noexcept {
+        if (payload.size() > kSlotPayload) {
+            return false;
+        }
+        const std::uint64_t mask = header_.slot_count - 1;
+        std::uint64_t pos = header_.enqueue_pos.load(std::memory_order_relaxed);
+        Slot* target;
+        while (true) {
+            target = &slot(pos & mask);
+            const std::uint64_t seq = target->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::int64_t>(seq - pos);
+            if (diff == 0) {
+                if (header_.enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = header_.enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        target->header = frame;
+        target->header.length = static_cast<std::uint16_t>(payload.size());
+        std::memcpy(target->payload, payload.data(), payload.size());
+        target->sequence.store(pos + 1, std::memory_order_release);
+
+        const std::uint64_t depth = pos + 1 - header_.dequeue_pos.load(std::memory_order_relaxed);
+        wake = (depth >= header_.watermark || frame.level >= static_cast<std::uint8_t>(LogLevel::ERROR)) &&
+               header_.signalled.exchange(1, std::memory_order_acq_rel) == 0;
+        return true;
+    }
+
+    // Single consumer. Calls on_frame(header, payload) for every ready slot;
+    // `slot_count` is the value attach() validated.
+    template <typename OnFrame>
+    size_t drain(std::uint32_t slot_count, OnFrame&& on_frame) noexcept {
+        header_.signalled.store(0, std::memory_order_release);
+        const std::uint64_t mask = slot_count - 1;
+        std::uint64_t pos = header_.dequeue_pos.load(std::memory_order_relaxed);
+        size_t count = 0;
+        while (true) {
+            Slot& current = slot(pos & mask);
+            if (current.sequence.load(std::memory_order_acquire) != pos + 1) {
+                break;
+            }
+            LogFrameHeader frame = current.header;
+            const size_t length = frame.length < kSlotPayload ? frame.length : kSlotPayload;
+            on_frame(frame, std::string_view{current.payload, length});
+            current.sequence.store(pos + slot_count, std::memory_order_release);
+            header_.dequeue_pos.store(++pos, std::memory_order_relaxed);
+            ++count;
+        }
+        return count;
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return header_.enqueue_pos.load(std::memory_order_relaxed) ==
+               header_.dequeue_pos.load(std::memory_order_relaxed);
+    }
+
+private:
+    Header header_;
+
+    Slot& slot(std::uint64_t index) noexcept {
+        return reinterpret_cast<Slot*>(reinterpret_cast<char*>(this) + sizeof(Header))[index];
+    }
+};
\ No newline at end of file
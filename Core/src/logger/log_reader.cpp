@@ -0,0 +1,268 @@
+#include "log_reader.hpp"
+#include "log_level.hpp"
+#include "log_scan.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// "YYYY-MM-DD HH:MM:SS.mmm [" before the level.
+constexpr std::size_t kTimeLength = 23;
+constexpr std::size_t kLevelOffset = kTimeLength + 2;
+
+bool parse_level_word(std::string_view word, std::uint8_t& level) noexcept {
+    LogLevel parsed;
+    if (word == "DEBUG") {
+        parsed = LogLevel::DEBUG;
+    } else if (word == "INFO") {
+        parsed = LogLevel::INFO;
+    } else if (word == "WARN") {
+        parsed = LogLevel::WARNING;
+    } else if (word == "ERROR") {
+        parsed = LogLevel::ERROR;
+    } else if (word == "CRIT") {
+        parsed = LogLevel::CRITICAL;
+    } else {
+        return false;
+    }
+    level = static_cast<std::uint8_t>(parsed);
+    return true;
+}
+
+std::string_view last_line(const LogSegments::Segment& segment) noexcept {
+    if (segment.size == 0) {
+        return {};
+    }
+    const auto* newline = static_cast<const char*>(memrchr(segment.data, '\n', segment.size - 1));
+    const std::size_t begin = newline ? static_cast<std::size_t>(newline - segment.data) + 1 : 0;
+    return {segment.data + begin, segment.size - 1 - begin};
+}
+
+} // namespace
+
+LogLine parse_log_line(std::string_view text) noexcept {
+    LogLine line{text, {}, 0, {}, text};
+    if (text.size() < kLevelOffset + 4 || text[4] != '-' || text[10] != ' ' || text[19] != '.' ||
+        text[kTimeLength] != ' ' || text[kTimeLength + 1] != '[') {
+        return line;
+    }
+    const std::size_t level_end = text.find(']', kLevelOffset);
+    if (level_end == std::string_view::npos ||
+        !parse_level_word(text.substr(kLevelOffset, level_end - kLevelOffset), line.level)) {
+        return line;
+    }
+    line.time = text.substr(0, kTimeLength);
+    std::size_t message = level_end + 1;
+    if (text.compare(message, 2, " [") == 0) {
+        const std::size_t pid_end = text.find(']', message + 2);
+        if (pid_end != std::string_view::npos) {
+            line.pid = text.substr(message + 2, pid_end - message - 2);
+            message = pid_end + 1;
+        }
+    }
+    if (message < text.size() && text[message] == ' ') {
+        ++message;
+    }
+    line.message = text.substr(std::min(message, text.size()));
+    return line;
+}
+
+bool LogFilter::matches(const LogLine& line) const noexcept {
+    const std::uint8_t level = line.level ? line.level : static_cast<std::uint8_t>(LogLevel::INFO);
+    if (level < min_level) {
+        return false;
+    }
+    if (!since.empty() && (line.time.empty() || line.time.substr(0, since.size()) < since)) {
+        return false;
+    }
+    if (!until.empty() && (line.time.empty() || line.time.substr(0, until.size()) > until)) {
+        return false;
+    }
+    return pattern.empty() || find_bytes(line.text.data(), line.text.size(), pattern) != nullptr;
+}
+
+std::string format_cursor(const LogCursor& cursor) {
+    return std::to_string(cursor.inode) + ":" + std::to_string(cursor.offset);
+}
+
+bool parse_cursor(std::string_view text, LogCursor& cursor) noexcept {
+    const std::size_t colon = text.find(':');
+    if (colon == 0 || colon == std::string_view::npos || colon + 1 == text.size()) {
+        return false;
+    }
+    std::uint64_t values[2] = {0, 0};
+    const std::string_view parts[2] = {text.substr(0, colon), text.substr(colon + 1)};
+    for (int i = 0; i < 2; ++i) {
+        if (parts[i].size() > 19) {
+            return false;
+        }
+        for (const char c : parts[i]) {
+            if (c < '0' || c > '9') {
+                return false;
+            }
+            values[i] = values[i] * 10 + static_cast<std::uint64_t>(c - '0');
+        }
+    }
+    cursor.inode = values[0];
+    cursor.offset = static_cast<std::size_t>(values[1]);
+    return true;
+}
+
+bool LogSegments::open(std::string_view base_path, int max_files, std::string& error) noexcept {
+    close();
+    const std::string base{base_path};
+    int missing_errno = 0;
+    for (int i = max_files - 1; i >= 0; --i) {
+        const std::string path = i == 0 ? base : base + '.' + std::to_string(i);
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            if (errno != ENOENT) {
+                error = path + ": " + std::strerror(errno);
+                close();
+                return false;
+            }
+            missing_errno = errno;
+            continue;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            error = path + ": " + std::strerror(errno);
+            ::close(fd);
+            close();
+            return false;
+        }
+        // A rotation between two opens can show one segment under two names.
+        const auto inode = static_cast<std::uint64_t>(st.st_ino);
+        bool seen = false;
+        for (const auto& segment : segments_) {
+            seen = seen || segment.inode == inode;
+        }
+        if (seen) {
+            ::close(fd);
+            continue;
+        }
+
+        Segment segment{path, inode, nullptr, 0, static_cast<std::size_t>(st.st_size)};
+        if (segment.mapped > 0) {
+            void* mapping = mmap(nullptr, segment.mapped, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                error = path + ": " + std::strerror(errno);
+                ::close(fd);
+                close();
+                return false;
+            }
+            (void)madvise(mapping, segment.mapped, MADV_SEQUENTIAL);
+            segment.data = static_cast<const char*>(mapping);
+            const auto* newline = static_cast<const char*>(memrchr(segment.data, '\n', segment.mapped));
+            segment.size = newline ? static_cast<std::size_t>(newline - segment.data) + 1 : 0;
+        }
+        ::close(fd);
+        segments_.push_back(std::move(segment));
+    }
+    if (segments_.empty()) {
+        error = base + ": " + std::strerror(missing_errno ? missing_errno : ENOENT);
+        return false;
+    }
+    return true;
+}
+
+void LogSegments::close() noexcept {
+    for (const auto& segment : segments_) {
+        if (segment.data) {
+            munmap(const_cast<char*>(segment.data), segment.mapped);
+        }
+    }
+    segments_.clear();
+}
+
+LogSegments::Position LogSegments::end() const noexcept {
+    if (segments_.empty()) {
+        return {};
+    }
+    return {segments_.size() - 1, segments_.back().size};
+}
+
+bool LogSegments::find(const LogCursor& cursor, Position& position) const noexcept {
+    for (std::size_t i = 0; i < segments_.size(); ++i) {
+        if (segments_[i].inode == cursor.inode && cursor.offset <= segments_[i].size) {
+            position = {i, cursor.offset};
+            return true;
+        }
+    }
+    return false;
+}
+
+LogCursor LogSegments::cursor(const Position& position) const noexcept {
+    if (position.segment >= segments_.size()) {
+        return {};
+    }
+    return {segments_[position.segment].inode, position.offset};
+}
+
+bool LogSegments::next_match(Position& position, const LogFilter& filter, LogLine& line) const noexcept {
+    for (; position.segment < segments_.size(); ++position.segment, position.offset = 0) {
+        const Segment& segment = segments_[position.segment];
+        // Lines are appended in time order, so a segment that ends before
+        // `since` has nothing to offer.
+        if (!filter.since.empty() && position.offset < segment.size) {
+            const LogLine tail = parse_log_line(last_line(segment));
+            if (!tail.time.empty() && tail.time.substr(0, filter.since.size()) < filter.since) {
+                continue;
+            }
+        }
+
+        const char* data = segment.data;
+        while (position.offset < segment.size) {
+            std::size_t begin = position.offset;
+            if (!filter.pattern.empty()) {
+                const char* hit = find_bytes(data + begin, segment.size - begin, filter.pattern);
+                if (!hit) {
+                    break;
+                }
+                const auto* newline = static_cast<const char*>(
+                    memrchr(data + begin, '\n', static_cast<std::size_t>(hit - data) - begin));
+                begin = newline ? static_cast<std::size_t>(newline - data) + 1 : begin;
+            }
+            // segment.size always ends just past a '\n'.
+            const auto* newline = static_cast<const char*>(std::memchr(data + begin, '\n', segment.size - begin));
+            const auto end = static_cast<std::size_t>(newline - data);
+            position.offset = end + 1;
+            line = parse_log_line({data + begin, end - begin});
+            if (filter.matches(line)) {
+                return true;
+            }
+        }
+    }
+    position = end();
+    return false;
+}
+
+bool LogSegments::prev_match(Position& position, const LogFilter& filter, LogLine& line) const noexcept {
+    while (true) {
+        if (position.segment >= segments_.size()) {
+            return false;
+        }
+        if (position.offset == 0) {
+            if (position.segment == 0) {
+                return false;
+            }
+            --position.segment;
+            position.offset = segments_[position.segment].size;
+            continue;
+        }
+        const char* data = segments_[position.segment].data;
+        const std::size_t end = position.offset - 1;   // the previous line's '\n'
+        const auto* newline = end ? static_cast<const char*>(memrchr(data, '\n', end)) : nullptr;
+        const std::size_t begin = newline ? static_cast<std::size_t>(newline - data) + 1 : 0;
+        position.offset = begin;
+        line = parse_log_line({data + begin, end - begin});
+        if (filter.matches(line)) {
+            return true;
+        }
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One line of a log written by LineFormatter:
+// "YYYY-MM-DD HH:MM:SS.mmm [LEVEL] [pid] message". Lines in any other
+// shape keep `time` and `pid` empty, `level` 0 and the whole text as
+// `message`.
+struct LogLine {
+    std::string_view text;       // without the '\n'
+    std::string_view time;
+    std::uint8_t level;          // LogLevel, 0 if unknown
+    std::string_view pid;
+    std::string_view message;
+};
+
+[[nodiscard]] LogLine parse_log_line(std::string_view text) noexcept;
+
+// Filters combine: a line must pass all that are set.
+struct LogFilter {
+    std::uint8_t min_level = 0;   // lines without a level count as INFO
+    // Compared as text against the same-length prefix of the line's time,
+    // so "2024-05-01 10" matches a whole hour; both ends are inclusive.
+    std::string_view since;
+    std::string_view until;
+    std::string_view pattern;     // plain substring, case sensitive
+
+    [[nodiscard]] bool matches(const LogLine& line) const noexcept;
+};
+
+// Names a line across rotations: the segment's inode stays the same as
+// FileManager renames it from base to base.1, base.2, ...
+struct LogCursor {
+    std::uint64_t inode = 0;
+    std::size_t offset = 0;       // of the line's first byte
+};
+
+// "inode:offset"
+[[nodiscard]] std::string format_cursor(const LogCursor& cursor);
+[[nodiscard]] bool parse_cursor(std::string_view text, LogCursor& cursor) noexcept;
+
+// The rotated segments of one FileManager log, mapped read-only, oldest
+// first: base.(n-1), ..., base.1, base. A trailing line without its '\n'
+// (a write still in progress) is left out of every scan.
+//
+// Queries step a Position through the segments. next_match() scans
+// forward; with a pattern it searches whole segments with find_bytes()
+// and only then finds the line around each hit, so sparse matches cost
+// one pass over the text. prev_match() walks lines backwards with
+// memrchr(), for "the last N lines" without reading what comes before.
+class LogSegments final {
+public:
+    struct Segment {
+        std::string path;
+        std::uint64_t inode;
+        const char* data;
+        std::size_t size;         // up to and including the last '\n'
+        std::size_t mapped;
+    };
+
+    struct Position {
+        std::size_t segment = 0;
+        std::size_t offset = 0;
+    };
+
+    LogSegments() = default;
+    ~LogSegments() noexcept { close(); }
+
+    LogSegments(const LogSegments&) = delete;
+    LogSegments& operator=(const LogSegments&) = delete;
+
+    // Maps base and base.1 .. base.(max_files - 1) that exist. Only a
+    // missing base is an error, and only if no older segment exists either.
+    bool open(std::string_view base_path, int max_files, std::string& error) noexcept;
+    void close() noexcept;
+
+    [[nodiscard]] const std::vector<Segment>& segments() const noexcept { return segments_; }
+
+    [[nodiscard]] Position begin() const noexcept { return {}; }
+    [[nodiscard]] Position end() const noexcept;
+    // The position of the line `cursor` names, false if its segment has
+    // rotated away.
+    bool find(const LogCursor& cursor, Position& position) const noexcept;
+    [[nodiscard]] LogCursor cursor(const Position& position) const noexcept;
+
+    // The first matching line at or after `position`; `position` moves
+    // past it. False at the end.
+    bool next_match(Position& position, const LogFilter& filter, LogLine& line) const noexcept;
+    // The last matching line before `position`; `position` moves to its
+    // start. False at the beginning.
+    bool prev_match(Position& position, const LogFilter& filter, LogLine& line) const noexcept;
+
+private:
+    std::vector<Segment> segments_;
+};
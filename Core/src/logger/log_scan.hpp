@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// Substring search for logger_query. A 16-byte block is compared against
+// the needle's first and last byte at once, and only positions where both
+// match get a memcmp() of the middle, so a scan over megabytes of log text
+// touches each byte about twice instead of restarting per line. Newlines
+// are found with memchr()/memrchr(), which bionic and glibc already
+// vectorize.
+
+namespace log_scan_detail {
+
+inline const char* verify(const char* at, std::string_view needle) noexcept {
+    return std::memcmp(at + 1, needle.data() + 1, needle.size() - 2) == 0 ? at : nullptr;
+}
+
+} // namespace log_scan_detail
+
+// First occurrence of `needle` in [data, data + size), or nullptr.
+inline const char* find_bytes(const char* data, std::size_t size, std::string_view needle) noexcept {
+    const std::size_t n = needle.size();
+    if (n == 0) {
+        return data;
+    }
+    if (n > size) {
+        return nullptr;
+    }
+    if (n == 1) {
+        return static_cast<const char*>(std::memchr(data, needle[0], size));
+    }
+
+    std::size_t i = 0;
+    const std::size_t last_start = size - n;
+#if defined(__SSE2__)
+    const __m128i first = _mm_set1_epi8(needle.front());
+    const __m128i last = _mm_set1_epi8(needle.back());
+    for (; i + 16 <= last_start + 1; i += 16) {
+        const __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + n - 1));
+        auto mask = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last))));
+        while (mask != 0) {
+            const auto bit = static_cast<std::size_t>(__builtin_ctz(mask));
+            if (const char* found = log_scan_detail::verify(data + i + bit, needle)) {
+                return found;
+            }
+            mask &= mask - 1;
+        }
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const uint8x16_t first = vdupq_n_u8(static_cast<std::uint8_t>(needle.front()));
+    const uint8x16_t last = vdupq_n_u8(static_cast<std::uint8_t>(needle.back()));
+    for (; i + 16 <= last_start + 1; i += 16) {
+        const uint8x16_t block_first = vld1q_u8(reinterpret_cast<const std::uint8_t*>(data + i));
+        const uint8x16_t block_last = vld1q_u8(reinterpret_cast<const std::uint8_t*>(data + i + n - 1));
+        const uint8x16_t eq = vandq_u8(vceqq_u8(block_first, first), vceqq_u8(block_last, last));
+        // Narrow each byte to a nibble: a 64-bit mask with 4 bits per lane.
+        std::uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+        while (mask != 0) {
+            const auto bit = static_cast<std::size_t>(__builtin_ctzll(mask)) / 4;
+            if (const char* found = log_scan_detail::verify(data + i + bit, needle)) {
+                return found;
+            }
+            mask &= ~(std::uint64_t{0xF} << (bit * 4));
+        }
+    }
+#endif
+    for (; i <= last_start; ++i) {
+        if (data[i] == needle.front() && data[i + n - 1] == needle.back() &&
+            log_scan_detail::verify(data + i, needle)) {
+            return data + i;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,339 @@
+#include "file_manager.hpp"
+#include "ipc_client.hpp"
+#include "log_format.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <poll.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kBatchLines = 256;
+constexpr size_t kStreamBufferSize = 64 * 1024;
+constexpr std::uint64_t kStreamMaxLatencyNs = 50000000ULL;   // 50 ms
+// Batches in a row the daemon refused before -s gives up: it is gone (a
+// restarted daemon has a new pid, so a new socket name), and exiting lets
+// the shell loggers notice and fall back to one-shot sends.
+constexpr int kStreamMaxSendFailures = 3;
+
+std::uint64_t clock_ns(clockid_t clock) noexcept {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<std::uint64_t>(ts.tv_nsec);
+}
+
+// Sends a file of "<level> <message>" lines, as written by Logsystem.sh's
+// shell buffer, in batches of kBatchLines (a packet or two each).
+bool send_file(IPCClient& client, const char* path) noexcept {
+    FILE* file = std::fopen(path, "re");
+    if (!file) {
+        return false;
+    }
+
+    std::vector<std::string> lines;
+    std::vector<LogRecord> records;
+    lines.reserve(kBatchLines);
+
+    auto send_batch = [&] {
+        records.clear();
+        for (const auto& line : lines) {
+            std::string_view text{line};
+            LogLevel level = LogLevel::INFO;
+            const size_t space = text.find(' ');
+            if (space != std::string_view::npos && parse_level_name(text.substr(0, space), level)) {
+                text.remove_prefix(space + 1);
+            }
+            records.push_back({level, text});
+        }
+        const bool ok = client.batch_send(records);
+        lines.clear();
+        return ok;
+    };
+
+    bool ok = true;
+    char* buffer = nullptr;
+    size_t capacity = 0;
+    ssize_t len;
+    while ((len = getline(&buffer, &capacity, file)) > 0) {
+        while (len > 0 && (buffer[len - 1] == '\n' || buffer[len - 1] == '\r')) {
+            --len;
+        }
+        if (len == 0) {
+            continue;
+        }
+        lines.emplace_back(buffer, static_cast<size_t>(len));
+        if (lines.size() == kBatchLines) {
+            ok = send_batch() && ok;
+        }
+    }
+    if (!lines.empty()) {
+        ok = send_batch() && ok;
+    }
+
+    std::free(buffer);
+    std::fclose(file);
+    return ok;
+}
+
+// Streaming mode: reads "[level] message" lines from a pipe until EOF (or
+// kStreamMaxSendFailures refused batches) and ships them in batches,
+// either over one IPCClient connection or straight into a FileManager when
+// no daemon is running (module install). Lines are stamped when read;
+// wall-clock time is derived from a single CLOCK_REALTIME/CLOCK_MONOTONIC
+// anchor taken at startup, so one read() costs one clock call however many
+// lines it carried, and stamps stay in order even if the wall clock is
+// stepped mid-stream. A batch goes out at kBatchLines, after
+// kStreamMaxLatencyNs, or right away for ERROR and up.
+class LineStreamer {
+public:
+    LineStreamer(IPCClient* client, FileManager* file, LogLevel default_level) noexcept
+        : client_(client), file_(file), default_level_(default_level),
+          pid_(static_cast<std::uint32_t>(getppid())),
+          mono_anchor_(clock_ns(CLOCK_MONOTONIC)), wall_anchor_(clock_ns(CLOCK_REALTIME)), input_(kStreamBufferSize) {
+        pending_.reserve(kBatchLines);
+        records_.reserve(kBatchLines);
+    }
+
+    bool run(int fd) noexcept {
+        size_t used = 0;
+        while (send_failures_ < kStreamMaxSendFailures) {
+            int timeout = -1;
+            if (!pending_.empty()) {
+                const std::uint64_t now = clock_ns(CLOCK_MONOTONIC);
+                const std::uint64_t deadline = first_pending_mono_ + kStreamMaxLatencyNs;
+                timeout = now >= deadline ? 0 : static_cast<int>((deadline - now + 999999) / 1000000);
+            }
+            struct pollfd pfd{fd, POLLIN, 0};
+            const int ready = poll(&pfd, 1, timeout);
+            if (ready < 0 && errno != EINTR) {
+                break;
+            }
+            if (ready <= 0) {
+                flush_batch();
+                continue;
+            }
+
+            const ssize_t len = read(fd, input_.data() + used, kStreamBufferSize - used);
+            if (len < 0) {
+                if (errno == EINTR || errno == EAGAIN) {
+                    continue;
+                }
+                break;
+            }
+            if (len == 0) {
+                break;
+            }
+
+            const std::uint64_t mono = clock_ns(CLOCK_MONOTONIC);
+            used += static_cast<size_t>(len);
+            std::string_view chunk{input_.data(), used};
+            size_t newline;
+            while ((newline = chunk.find('\n')) != std::string_view::npos) {
+                add_line(chunk.substr(0, newline), mono);
+                chunk.remove_prefix(newline + 1);
+            }
+            if (chunk.size() == kStreamBufferSize) {
+                // One line filled the whole buffer: cut it here.
+                add_line(chunk, mono);
+                chunk = {};
+            }
+            used = chunk.size();
+            if (used > 0 && chunk.data() != input_.data()) {
+                std::memmove(input_.data(), chunk.data(), used);
+            }
+
+            if (urgent_ || pending_.size() >= kBatchLines ||
+                (!pending_.empty() && mono - first_pending_mono_ >= kStreamMaxLatencyNs)) {
+                flush_batch();
+            }
+        }
+
+        if (used > 0) {
+            add_line(std::string_view{input_.data(), used}, clock_ns(CLOCK_MONOTONIC));
+        }
+        flush_batch();
+        return ok_;
+    }
+
+private:
+    struct PendingLine {
+        std::uint64_t timestamp_ns;
+        size_t offset;
+        size_t length;
+        LogLevel level;
+    };
+
+    IPCClient* client_;
+    FileManager* file_;
+    LogLevel default_level_;
+    std::uint32_t pid_;
+    std::uint64_t mono_anchor_;
+    std::uint64_t wall_anchor_;
+    std::vector<char> input_;
+
+    // Text of the pending lines; records refer to it by offset because it
+    // may reallocate while the batch fills.
+    std::string text_;
+    std::vector<PendingLine> pending_;
+    std::vector<LogRecord> records_;
+    std::string output_;
+    LineFormatter formatter_;
+    std::uint64_t first_pending_mono_ = 0;
+    bool urgent_ = false;
+    bool ok_ = true;
+    int send_failures_ = 0;   // consecutive
+
+    void add_line(std::string_view line, std::uint64_t mono) noexcept {
+        while (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty()) {
+            return;
+        }
+        LogLevel level = default_level_;
+        const size_t space = line.find(' ');
+        if (space != std::string_view::npos && parse_level_name(line.substr(0, space), level)) {
+            line.remove_prefix(space + 1);
+        }
+        line = line.substr(0, kLogMaxMessage);
+
+        if (pending_.empty()) {
+            first_pending_mono_ = mono;
+        }
+        pending_.push_back({wall_anchor_ + (mono - mono_anchor_), text_.size(), line.size(), level});
+        text_.append(line);
+        urgent_ = urgent_ || level >= LogLevel::ERROR;
+    }
+
+    void flush_batch() noexcept {
+        if (pending_.empty()) {
+            return;
+        }
+        if (file_) {
+            output_.clear();
+            for (const auto& line : pending_) {
+                const LogFrameHeader frame{line.timestamp_ns, pid_, static_cast<std::uint16_t>(line.length),
+                                           static_cast<std::uint8_t>(line.level), 0};
+                output_.append(formatter_.format(frame, std::string_view{text_}.substr(line.offset, line.length)));
+            }
+            const std::string_view chunk{output_};
+            ok_ = file_->write_batch(std::span<const std::string_view>{&chunk, 1}, urgent_) && ok_;
+        } else {
+            records_.clear();
+            for (const auto& line : pending_) {
+                records_.push_back({line.level, std::string_view{text_}.substr(line.offset, line.length),
+                                    line.timestamp_ns, pid_});
+            }
+            if (client_->batch_send(records_)) {
+                send_failures_ = 0;
+            } else {
+                ok_ = false;
+                ++send_failures_;
+            }
+            if (urgent_) {
+                client_->flush();
+            }
+        }
+        pending_.clear();
+        text_.clear();
+        urgent_ = false;
+    }
+};
+
+void print_usage(const char* program_name) noexcept {
+    std::cout << "Usage: " << program_name << " [-p <daemon_pid>] [-l <level>] <message>\n";
+    std::cout << "       " << program_name << " [-p <daemon_pid>] -b <file>\n";
+    std::cout << "       " << program_name << " [-p <daemon_pid> | -o <file>] [-l <level>] -s\n";
+    std::cout << "Options:\n";
+    std::cout << "  -p <pid>      PID of the logger_daemon to send to (default: the first daemon)\n";
+    std::cout << "  -l <level>    debug, info, warning, error or critical (default: info)\n";
+    std::cout << "  -b <file>     Send every \"<level> <message>\" line of a file\n";
+    std::cout << "  -s            Stream \"[level] <message>\" lines from stdin (or a FIFO on stdin) until EOF,\n"
+              << "                or until the daemon has refused three batches in a row\n";
+    std::cout << "  -o <file>     With -s, write the log file directly instead of sending to a daemon\n";
+    std::cout << "  -S <size>     With -o, maximum file size in bytes (default: 5242880)\n";
+    std::cout << "  -n <count>    With -o, number of rotated files to keep (default: 3)\n";
+    std::cout << "  -h            Show this help message\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int daemon_pid = 0;
+    LogLevel level = LogLevel::INFO;
+    const char* batch_file = nullptr;
+    const char* output_file = nullptr;
+    size_t max_size = 5242880;
+    int max_files = 3;
+    bool stream = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:l:b:so:S:n:h")) != -1) {
+        switch (opt) {
+            case 'p':
+                daemon_pid = std::atoi(optarg);
+                break;
+            case 'l':
+                if (!parse_level_name(optarg, level)) {
+                    std::cerr << "Unknown level: " << optarg << '\n';
+                    return 1;
+                }
+                break;
+            case 'b':
+                batch_file = optarg;
+                break;
+            case 's':
+                stream = true;
+                break;
+            case 'o':
+                output_file = optarg;
+                break;
+            case 'S':
+                max_size = std::strtoull(optarg, nullptr, 10);
+                break;
+            case 'n':
+                max_files = std::atoi(optarg);
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (daemon_pid < 0 || (!batch_file && !stream && optind >= argc) || (output_file && !stream)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (output_file) {
+        FileManager file(output_file, max_size, max_files);
+        LineStreamer streamer(nullptr, &file, level);
+        return streamer.run(STDIN_FILENO) ? 0 : 1;
+    }
+
+    IPCClient client(daemon_pid);
+    if (stream) {
+        LineStreamer streamer(&client, nullptr, level);
+        return streamer.run(STDIN_FILENO) ? 0 : 1;
+    }
+    if (batch_file) {
+        return send_file(client, batch_file) ? 0 : 1;
+    }
+
+    std::string message = argv[optind];
+    for (int i = optind + 1; i < argc; ++i) {
+        message += ' ';
+        message += argv[i];
+    }
+    return client.send(message, level) ? 0 : 1;
+}
@@ -0,0 +1,597 @@
+#include "buffer_manager.hpp"
+#include "file_manager.hpp"
+#include "log_format.hpp"
+#include "log_protocol.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstddef>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifndef F_GET_SEALS
+#define F_GET_SEALS 1034
+#define F_SEAL_SHRINK 0x0002
+#endif
+
+namespace {
+
+constexpr int kMaxEvents = 32;
+constexpr std::chrono::milliseconds kRingSweepInterval{1000};
+constexpr std::chrono::seconds kStatsFileInterval{10};
+
+struct DaemonState {
+    BufferManager buffer;
+    FileManager file;
+    int listen_fd = -1;                  // @aurora_logger_<pid>
+    int default_fd = -1;                 // @aurora_logger, if no other daemon holds it
+    int stop_fd = -1;                    // level-triggered, seen by every reader
+    int flush_fd = -1;                   // producers -> flusher
+    std::atomic<bool> flush_requested{false};
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<std::uint64_t> flushes{0};
+    std::atomic<std::uint64_t> bytes_flushed{0};
+    LatencyHistogram flush_latency;
+    MetricsRegistry metrics;
+    StatsEndpoint stats;                 // served by the flusher
+    std::string stats_file;
+
+    DaemonState(std::string_view path, size_t max_size, int max_files, size_t buffer_size) noexcept
+        : buffer(buffer_size), file(path, max_size, max_files) {
+        register_metrics();
+    }
+
+    void register_metrics() noexcept {
+        using Self = const DaemonState*;
+        metrics.add_counter("aurora_logger_lines_total", "Lines accepted into the buffer.", this,
+                            [](const void* self) { return static_cast<Self>(self)->buffer.appended_lines(); });
+        metrics.add_counter("aurora_logger_bytes_total", "Formatted bytes accepted into the buffer.", this,
+                            [](const void* self) { return static_cast<Self>(self)->buffer.appended_bytes(); });
+        metrics.add_counter("aurora_logger_buffer_full_total", "Appends that found the buffer full and waited.",
+                            this, [](const void* self) { return static_cast<Self>(self)->buffer.rejected(); });
+        metrics.add_counter("aurora_logger_lines_dropped_total", "Lines dropped after the flusher stalled.", dropped);
+        metrics.add_counter("aurora_logger_flushes_total", "Batches written to the log file.", flushes);
+        metrics.add_counter("aurora_logger_bytes_flushed_total", "Bytes written to the log file.", bytes_flushed);
+        metrics.add_gauge("aurora_logger_buffer_pending_bytes", "Bytes waiting in the active buffer half.", this,
+                          [](const void* self) {
+                              return std::uint64_t{static_cast<Self>(self)->buffer.get_pending_size()};
+                          });
+        metrics.add_histogram("aurora_logger_flush_seconds", "Time to write one batch to the log file.",
+                              flush_latency);
+    }
+
+    void request_flush() noexcept {
+        if (!flush_requested.exchange(true, std::memory_order_acq_rel)) {
+            const std::uint64_t one = 1;
+            (void)!write(flush_fd, &one, sizeof(one));
+        }
+    }
+};
+
+void append_frame(DaemonState& state, LineFormatter& formatter, const LogFrameHeader& frame,
+                  std::string_view message) noexcept {
+    while (!message.empty() && (message.back() == '\n' || message.back() == '\r')) {
+        message.remove_suffix(1);
+    }
+    if (message.empty()) {
+        return;
+    }
+
+    const auto level = static_cast<LogLevel>(frame.level);
+    const std::string_view formatted = formatter.format(frame, message);
+    // A full half means the flusher is behind; hand it the batch and wait
+    // for room. Stalling here pushes back on clients through their socket
+    // buffers; only a flusher stuck for seconds makes us drop.
+    for (int attempt = 0; !state.buffer.add_log(formatted, level); ++attempt) {
+        state.request_flush();
+        if (attempt < 64) {
+            std::this_thread::yield();
+        } else if (attempt < 64 + 2000) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        } else {
+            state.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    if (level >= LogLevel::ERROR || state.buffer.get_pending_size() >= state.buffer.capacity() / 2) {
+        state.request_flush();
+    }
+}
+
+// Per-client state owned by one reader: the socket plus, optionally, the
+// shared-memory ring the client attached with its wakeup eventfd.
+struct Connection {
+    SharedLogRing* ring = nullptr;
+    size_t ring_bytes = 0;
+    std::uint32_t slot_count = 0;
+    int event_fd = -1;
+};
+
+class Reader {
+public:
+    Reader(DaemonState& state, int epoll_fd) noexcept : state_(state), epoll_fd_(epoll_fd) {}
+
+    ~Reader() noexcept {
+        for (auto& [fd, connection] : connections_) {
+            detach_ring(connection);
+            close(fd);
+        }
+    }
+
+    void accept_client(int listen_fd) noexcept {
+        const int client = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client < 0) {
+            return;
+        }
+        struct epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = client;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, client, &ev);
+        connections_[client];
+    }
+
+    // Returns false if `fd` is not one of this reader's ring eventfds.
+    bool handle_ring_event(int fd) noexcept {
+        const auto owner = ring_owner_.find(fd);
+        if (owner == ring_owner_.end()) {
+            return false;
+        }
+        std::uint64_t value;
+        (void)!read(fd, &value, sizeof(value));
+        drain(connections_[owner->second]);
+        return true;
+    }
+
+    void handle_client(int fd) noexcept {
+        auto it = connections_.find(fd);
+        if (it == connections_.end()) {
+            return;
+        }
+
+        bool closed = false;
+        // Bounded so one chatty client cannot starve the others; epoll is
+        // level-triggered and will come back.
+        for (int packets = 0; packets < 64; ++packets) {
+            struct iovec iov{packet_, sizeof(packet_)};
+            alignas(struct cmsghdr) char control[CMSG_SPACE(2 * sizeof(int))];
+            struct msghdr msg{};
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+
+            const ssize_t len = recvmsg(fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+            if (len < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                closed = errno != EAGAIN && errno != EWOULDBLOCK;
+                break;
+            }
+            if (len == 0) {
+                closed = true;
+                break;
+            }
+
+            int fds[2] = {-1, -1};
+            size_t fd_count = 0;
+            for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+                    const size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                    int received[2] = {-1, -1};
+                    std::memcpy(received, CMSG_DATA(cmsg), std::min(count, size_t{2}) * sizeof(int));
+                    for (size_t i = 0; i < count && i < 2; ++i) {
+                        fds[fd_count++] = received[i];
+                    }
+                }
+            }
+
+            for_each_frame(std::string_view{packet_, static_cast<size_t>(len)},
+                           [&](const LogFrameHeader& frame, std::string_view payload) {
+                if (frame.flags & kFrameAttachRing) {
+                    if (fd_count == 2 && attach_ring(fd, it->second, fds[0], fds[1])) {
+                        fds[1] = -1;   // now owned by the connection
+                    }
+                    fd_count = 0;
+                    return;
+                }
+                append_frame(state_, formatter_, frame, payload);
+            });
+            for (const int extra : fds) {
+                if (extra >= 0) {
+                    close(extra);
+                }
+            }
+        }
+
+        if (closed) {
+            detach_ring(it->second);
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+            close(fd);
+            connections_.erase(it);
+        }
+    }
+
+    // Picks up lines that stayed below a ring's watermark.
+    void sweep_rings() noexcept {
+        for (auto& [fd, connection] : connections_) {
+            drain(connection);
+        }
+    }
+
+    [[nodiscard]] bool has_rings() const noexcept { return !ring_owner_.empty(); }
+
+private:
+    DaemonState& state_;
+    int epoll_fd_;
+    std::unordered_map<int, Connection> connections_;
+    std::unordered_map<int, int> ring_owner_;   // eventfd -> client fd
+    LineFormatter formatter_;
+    char packet_[kLogMaxPacket];
+
+    bool attach_ring(int client_fd, Connection& connection, int mem_fd, int event_fd) noexcept {
+        // Only accept rings whose size is sealed: a client truncating the
+        // memfd under our mapping would otherwise SIGBUS the daemon.
+        struct stat st;
+        const int seals = fcntl(mem_fd, F_GET_SEALS);
+        if (connection.ring || fstat(mem_fd, &st) != 0 || seals < 0 || !(seals & F_SEAL_SHRINK)) {
+            return false;
+        }
+
+        const auto size = static_cast<size_t>(st.st_size);
+        void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd, 0);
+        if (memory == MAP_FAILED) {
+            return false;
+        }
+        std::uint32_t slot_count = 0;
+        SharedLogRing* ring = SharedLogRing::attach(memory, size, slot_count);
+        if (!ring) {
+            munmap(memory, size);
+            return false;
+        }
+
+        struct epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = event_fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd, &ev) != 0) {
+            munmap(memory, size);
+            return false;
+        }
+        connection.ring = ring;
+        connection.ring_bytes = size;
+        connection.slot_count = slot_count;
+        connection.event_fd = event_fd;
+        ring_owner_[event_fd] = client_fd;
+
+        // Lines queued before a reconnect are still in there.
+        drain(connection);
+        return true;
+    }
+
+    void detach_ring(Connection& connection) noexcept {
+        if (!connection.ring) {
+            return;
+        }
+        drain(connection);
+        munmap(connection.ring, connection.ring_bytes);
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, connection.event_fd, nullptr);
+        ring_owner_.erase(connection.event_fd);
+        close(connection.event_fd);
+        connection = Connection{};
+    }
+
+    void drain(Connection& connection) noexcept {
+        if (connection.ring) {
+            connection.ring->drain(connection.slot_count, [&](const LogFrameHeader& frame, std::string_view payload) {
+                append_frame(state_, formatter_, frame, payload);
+            });
+        }
+    }
+};
+
+// One reader per thread, each with its own epoll set. The listening socket is
+// registered EPOLLEXCLUSIVE in all of them so a new connection wakes one
+// reader, which then owns that client (and its ring) for its lifetime.
+void reader_loop(DaemonState& state) noexcept {
+    const int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        return;
+    }
+
+    struct epoll_event ev{};
+    for (const int listen_fd : {state.listen_fd, state.default_fd}) {
+        if (listen_fd < 0) {
+            continue;
+        }
+        ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+        ev.data.fd = listen_fd;
+        // Pre-4.5 kernels reject EPOLLEXCLUSIVE; accept4 on a non-blocking
+        // socket copes with the resulting thundering herd.
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev) != 0 && errno == EINVAL) {
+            ev.events = EPOLLIN;
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+        }
+    }
+    ev.events = EPOLLIN;
+    ev.data.fd = state.stop_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, state.stop_fd, &ev);
+
+    std::unique_ptr<Reader> reader(new (std::nothrow) Reader(state, epoll_fd));
+    struct epoll_event events[kMaxEvents];
+    bool running = reader != nullptr;
+    auto next_sweep = std::chrono::steady_clock::now() + kRingSweepInterval;
+
+    while (running) {
+        const int timeout = reader->has_rings() ? static_cast<int>(kRingSweepInterval.count()) : -1;
+        const int n = epoll_wait(epoll_fd, events, kMaxEvents, timeout);
+        if (n < 0 && errno != EINTR) {
+            break;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == state.stop_fd) {
+                running = false;
+            } else if (fd == state.listen_fd || fd == state.default_fd) {
+                reader->accept_client(fd);
+            } else if (!reader->handle_ring_event(fd)) {
+                reader->handle_client(fd);
+            }
+        }
+
+        if (reader->has_rings()) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= next_sweep) {
+                reader->sweep_rings();
+                next_sweep = now + kRingSweepInterval;
+            }
+        }
+    }
+
+    // Destroying the reader drains every ring before the final flush, and
+    // takes the ring eventfds out of epoll_fd, so it goes first.
+    reader.reset();
+    close(epoll_fd);
+}
+
+void write_batch(DaemonState& state) noexcept {
+    const bool critical = state.buffer.should_force_flush();
+    const std::span<const char> data = state.buffer.get_data();
+    if (!data.empty()) {
+        // Critical batches go out with their fdatasync in the same submission.
+        const auto start = std::chrono::steady_clock::now();
+        const std::string_view chunk{data.data(), data.size()};
+        (void)state.file.write_batch(std::span<const std::string_view>{&chunk, 1}, critical);
+        state.flush_latency.record_since(start);
+        state.flushes.fetch_add(1, std::memory_order_relaxed);
+        state.bytes_flushed.fetch_add(data.size(), std::memory_order_relaxed);
+    }
+    state.buffer.clear();
+}
+
+// The single consumer. Sleeps on an eventfd that producers poke when a half
+// crosses its threshold or an ERROR/CRITICAL line arrives; otherwise wakes
+// once a second to honour the time-based flush interval. It also answers
+// stats queries and refreshes the stats file on those same wakeups.
+void flusher_loop(DaemonState& state, const std::atomic<bool>& running) noexcept {
+    struct pollfd pfds[2] = {{state.flush_fd, POLLIN, 0}, {state.stats.fd(), POLLIN, 0}};
+    const nfds_t count = state.stats.fd() >= 0 ? 2 : 1;
+    auto next_stats_write = std::chrono::steady_clock::now();
+    std::uint64_t stats_written = ~std::uint64_t{0};
+    while (running.load(std::memory_order_acquire)) {
+        if (poll(pfds, count, 1000) > 0) {
+            if (pfds[0].revents & POLLIN) {
+                std::uint64_t value;
+                (void)!read(state.flush_fd, &value, sizeof(value));
+            }
+            if (count > 1 && (pfds[1].revents & POLLIN)) {
+                state.stats.serve(state.metrics);
+            }
+        }
+        if (!state.stats_file.empty()) {
+            const auto now = std::chrono::steady_clock::now();
+            const std::uint64_t version = state.buffer.appended_lines() + state.flushes.load(std::memory_order_relaxed);
+            if (now >= next_stats_write && version != stats_written) {
+                (void)state.metrics.write_file(state.stats_file.c_str());
+                stats_written = version;
+                next_stats_write = now + kStatsFileInterval;
+            }
+        }
+        // An explicit request (threshold, ERROR line, SIGHUP) flushes
+        // whatever is there; otherwise defer to the buffer's own policy.
+        const bool requested = state.flush_requested.exchange(false, std::memory_order_acq_rel);
+        if (requested ? !state.buffer.is_empty() : state.buffer.should_flush()) {
+            write_batch(state);
+        }
+    }
+
+    // Both halves may hold data: the one just retired and the active one.
+    write_batch(state);
+    write_batch(state);
+    state.file.flush();
+    if (!state.stats_file.empty()) {
+        (void)state.metrics.write_file(state.stats_file.c_str());
+    }
+}
+
+int create_listen_socket(int pid) noexcept {
+    const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    const int name_len = pid > 0
+        ? std::snprintf(addr.sun_path + 1, sizeof(addr.sun_path) - 1, "aurora_logger_%d", pid)
+        : std::snprintf(addr.sun_path + 1, sizeof(addr.sun_path) - 1, "aurora_logger");
+    const auto addr_len = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + 1 + name_len);
+    if (bind(fd, reinterpret_cast<const struct sockaddr*>(&addr), addr_len) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void print_usage(const char* program_name) noexcept {
+    std::cout << "Usage: " << program_name << " -f <log_file> [options]\n";
+    std::cout << "Options:\n";
+    std::cout << "  -f <path>     Log file path\n";
+    std::cout << "  -s <bytes>    Rotate when the file reaches this size (default: 5242880)\n";
+    std::cout << "  -n <count>    Number of files to keep, including the live one (default: 3)\n";
+    std::cout << "  -b <bytes>    In-memory buffer size (default: 262144)\n";
+    std::cout << "  -t <threads>  Reader threads (default: 2)\n";
+    std::cout << "  -u            Write through io_uring when the kernel allows it\n";
+    std::cout << "  -q <name>     Serve Prometheus stats on the abstract socket @<name>\n";
+    std::cout << "  -m <path>     Keep Prometheus stats in <path>, rewritten at most every "
+              << kStatsFileInterval.count() << "s\n";
+    std::cout << "  -h            Show this help message\n";
+    std::cout << "\nClients connect to the abstract socket @aurora_logger_<pid>; the first\n";
+    std::cout << "daemon also answers on @aurora_logger for clients started without -p.\n";
+    std::cout << "SIGHUP flushes; SIGUSR1 prints counters and flush latency to stderr.\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string log_path;
+    size_t max_size = 5242880;
+    int max_files = 3;
+    size_t buffer_size = 262144;
+    int reader_threads = 2;
+    bool use_io_uring = false;
+    const char* stats_socket = nullptr;
+    const char* stats_file = nullptr;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:s:n:b:t:uq:m:h")) != -1) {
+        switch (opt) {
+            case 'f':
+                log_path = optarg;
+                break;
+            case 's':
+                max_size = std::strtoull(optarg, nullptr, 10);
+                break;
+            case 'n':
+                max_files = std::atoi(optarg);
+                break;
+            case 'b':
+                buffer_size = std::strtoull(optarg, nullptr, 10);
+                break;
+            case 't':
+                reader_threads = std::clamp(std::atoi(optarg), 1, 16);
+                break;
+            case 'u':
+                use_io_uring = true;
+                break;
+            case 'q':
+                stats_socket = optarg;
+                break;
+            case 'm':
+                stats_file = optarg;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (log_path.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // Block before any thread exists so only sigwait() below sees them.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGHUP);
+    sigaddset(&signals, SIGUSR1);
+    sigprocmask(SIG_BLOCK, &signals, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    const auto state = std::make_unique<DaemonState>(log_path, max_size, max_files, std::max<size_t>(buffer_size, 8192));
+    if (use_io_uring && !state->file.enable_io_uring()) {
+        std::cerr << "io_uring unavailable, using writev\n";
+    }
+    state->listen_fd = create_listen_socket(getpid());
+    state->default_fd = create_listen_socket(0);
+    state->stop_fd = eventfd(0, EFD_CLOEXEC);
+    state->flush_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (state->listen_fd < 0 || state->stop_fd < 0 || state->flush_fd < 0) {
+        std::cerr << "Failed to create daemon socket: " << std::strerror(errno) << '\n';
+        return 1;
+    }
+    if (stats_socket && !state->stats.listen(stats_socket)) {
+        std::cerr << "Failed to serve stats on @" << stats_socket << ": " << std::strerror(errno) << '\n';
+        return 1;
+    }
+    if (stats_file) {
+        state->stats_file = stats_file;
+    }
+
+    std::atomic<bool> running{true};
+    std::thread flusher(flusher_loop, std::ref(*state), std::cref(running));
+    std::vector<std::thread> readers;
+    for (int i = 0; i < reader_threads; ++i) {
+        readers.emplace_back(reader_loop, std::ref(*state));
+    }
+
+    int sig = 0;
+    std::string stats;
+    while (sigwait(&signals, &sig) == 0 && (sig == SIGHUP || sig == SIGUSR1)) {
+        if (sig == SIGUSR1) {
+            state->metrics.render_text(stats);
+            std::cerr << stats << std::flush;
+            continue;
+        }
+        // SIGHUP: flush now, keep running.
+        state->request_flush();
+    }
+
+    const std::uint64_t one = 1;
+    (void)!write(state->stop_fd, &one, sizeof(one));
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    running.store(false, std::memory_order_release);
+    state->request_flush();
+    flusher.join();
+
+    if (const auto dropped = state->dropped.load(); dropped > 0) {
+        std::cerr << "Dropped " << dropped << " log lines\n";
+    }
+    close(state->listen_fd);
+    if (state->default_fd >= 0) {
+        close(state->default_fd);
+    }
+    close(state->stop_fd);
+    close(state->flush_fd);
+    return 0;
+}
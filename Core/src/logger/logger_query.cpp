@@ -0,0 +1,343 @@
+#include "log_format.hpp"
+#include "log_reader.hpp"
+#include "watch_backend.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kFollowReadSize = 64 * 1024;
+// Re-checks the file this often even without an event, in case one was
+// lost to a queue overflow or the directory watch could not be set.
+constexpr int kFollowPollMs = 1000;
+constexpr size_t kOutputFlushBytes = 64 * 1024;
+
+class Printer {
+public:
+    explicit Printer(bool json) noexcept : json_(json) {}
+
+    ~Printer() { flush(); }
+
+    void line(const LogLine& line, const LogCursor& cursor) {
+        if (!json_) {
+            out_.append(line.text).push_back('\n');
+        } else {
+            out_.append("{\"cursor\":\"").append(format_cursor(cursor)).append("\",\"time\":");
+            append_string(line.time);
+            out_.append(",\"level\":");
+            append_string(line.level ? level_name(line.level) : std::string_view{});
+            out_.append(",\"pid\":");
+            if (line.pid.empty() || line.pid.find_first_not_of("0123456789") != std::string_view::npos) {
+                out_.append("null");
+            } else {
+                out_.append(line.pid);
+            }
+            out_.append(",\"message\":");
+            append_string(line.message);
+            out_.append("}\n");
+        }
+        if (out_.size() >= kOutputFlushBytes) {
+            flush();
+        }
+    }
+
+    void flush() noexcept {
+        if (!out_.empty()) {
+            std::fwrite(out_.data(), 1, out_.size(), stdout);
+            std::fflush(stdout);
+            out_.clear();
+        }
+    }
+
+private:
+    void append_string(std::string_view text) {
+        out_.push_back('"');
+        for (const char c : text) {
+            if (c == '"' || c == '\\') {
+                out_.push_back('\\');
+                out_.push_back(c);
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out_.append(escaped);
+            } else {
+                out_.push_back(c);
+            }
+        }
+        out_.push_back('"');
+    }
+
+    bool json_;
+    std::string out_;
+};
+
+// Streams lines appended to the live segment. The segment is read through
+// an fd held open across rotation: when the name points at a new inode,
+// whatever was still appended to the old one is read first, then the new
+// one from its start.
+class Follower {
+public:
+    Follower(std::string path, const LogFilter& filter, Printer& printer) noexcept
+        : path_(std::move(path)), filter_(filter), printer_(printer), buffer_(kFollowReadSize) {}
+
+    ~Follower() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    bool run(const LogCursor& from) {
+        const size_t slash = path_.find_last_of('/');
+        const std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path_.substr(0, slash);
+
+        FileWatcherAPI::WatchBackend backend;
+        if (backend.add_watch(dir.c_str(), IN_MODIFY | IN_CREATE | IN_MOVED_TO | IN_CLOSE_WRITE) < 0) {
+            std::cerr << "Cannot watch " << dir << ": " << std::strerror(errno) << ", polling\n";
+        }
+        reopen(from);
+        while (true) {
+            pump();
+            struct pollfd pfd{backend.fd(), POLLIN, 0};
+            const int ready = poll(&pfd, backend.fd() >= 0 ? 1 : 0, kFollowPollMs);
+            if (ready < 0 && errno != EINTR) {
+                return false;
+            }
+            if (ready > 0) {
+                // Every event for the log's name just means "look again".
+                backend.drain([](int, uint32_t, std::string_view) {});
+            }
+        }
+    }
+
+private:
+    void reopen(const LogCursor& from) noexcept {
+        const int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            return;
+        }
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+        fd_ = fd;
+        inode_ = static_cast<std::uint64_t>(st.st_ino);
+        offset_ = inode_ == from.inode ? from.offset : 0;
+        pending_.clear();
+    }
+
+    void pump() {
+        read_new();
+        struct stat st;
+        if (stat(path_.c_str(), &st) == 0 && static_cast<std::uint64_t>(st.st_ino) != inode_) {
+            // Rotated: the old segment may have grown after the read above
+            // and before the rename; it cannot grow any more now.
+            read_new();
+            reopen({});
+            read_new();
+        } else if (fd_ < 0) {
+            reopen({});
+            read_new();
+        }
+        printer_.flush();
+    }
+
+    void read_new() {
+        if (fd_ < 0) {
+            return;
+        }
+        while (true) {
+            const ssize_t len =
+                pread(fd_, buffer_.data(), buffer_.size(), static_cast<off_t>(offset_ + pending_.size()));
+            if (len < 0 && errno == EINTR) {
+                continue;
+            }
+            if (len <= 0) {
+                return;
+            }
+            pending_.append(buffer_.data(), static_cast<size_t>(len));
+            size_t begin = 0;
+            size_t newline;
+            while ((newline = pending_.find('\n', begin)) != std::string::npos) {
+                const LogLine line = parse_log_line(std::string_view{pending_}.substr(begin, newline - begin));
+                if (filter_.matches(line)) {
+                    printer_.line(line, {inode_, offset_ + begin});
+                }
+                begin = newline + 1;
+            }
+            offset_ += begin;
+            pending_.erase(0, begin);
+        }
+    }
+
+    std::string path_;
+    const LogFilter& filter_;
+    Printer& printer_;
+    std::vector<char> buffer_;
+    std::string pending_;   // a line still being written
+    int fd_ = -1;
+    std::uint64_t inode_ = 0;
+    size_t offset_ = 0;
+};
+
+void print_usage(const char* program_name) noexcept {
+    std::cout << "Usage: " << program_name << " -f <log_file> [options]\n";
+    std::cout << "Options:\n";
+    std::cout << "  -f <path>     Log file path, as given to logger_daemon -f\n";
+    std::cout << "  -n <count>    Number of rotated files to read, including the live one (default: 3)\n";
+    std::cout << "  -l <level>    Only lines at this level or above (debug, info, warning, error, critical)\n";
+    std::cout << "  -g <text>     Only lines containing <text>\n";
+    std::cout << "  -S <time>     Only lines at or after <time> (\"YYYY-MM-DD HH:MM:SS\", any prefix)\n";
+    std::cout << "  -U <time>     Only lines at or before <time>\n";
+    std::cout << "  -L <lines>    At most <lines> lines: the last ones, or the first ones after -a\n";
+    std::cout << "  -b <cursor>   Only lines before <cursor>\n";
+    std::cout << "  -a <cursor>   Only lines after <cursor>\n";
+    std::cout << "  -F            Keep printing lines as they are written (follows rotation)\n";
+    std::cout << "  -j            One JSON object per line: cursor, time, level, pid, message\n";
+    std::cout << "  -h            Show this help message\n";
+    std::cout << "\nA cursor (\"<inode>:<offset>\", from -j output) names a line and stays valid\n";
+    std::cout << "while its file is rotated, until it is deleted. Page backwards with\n";
+    std::cout << "-L 200 -b <cursor of the first line shown>.\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const char* log_path = nullptr;
+    int max_files = 3;
+    LogFilter filter;
+    size_t limit = 0;
+    const char* before = nullptr;
+    const char* after = nullptr;
+    bool follow = false;
+    bool json = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:n:l:g:S:U:L:b:a:Fjh")) != -1) {
+        switch (opt) {
+            case 'f':
+                log_path = optarg;
+                break;
+            case 'n':
+                max_files = std::atoi(optarg);
+                break;
+            case 'l': {
+                LogLevel level;
+                if (!parse_level_name(optarg, level)) {
+                    std::cerr << "Unknown level: " << optarg << '\n';
+                    return 1;
+                }
+                filter.min_level = static_cast<std::uint8_t>(level);
+                break;
+            }
+            case 'g':
+                filter.pattern = optarg;
+                break;
+            case 'S':
+                filter.since = optarg;
+                break;
+            case 'U':
+                filter.until = optarg;
+                break;
+            case 'L':
+                limit = std::strtoull(optarg, nullptr, 10);
+                break;
+            case 'b':
+                before = optarg;
+                break;
+            case 'a':
+                after = optarg;
+                break;
+            case 'F':
+                follow = true;
+                break;
+            case 'j':
+                json = true;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    LogCursor before_cursor;
+    LogCursor after_cursor;
+    if (!log_path || max_files < 1 || (before && after) || (before && follow) ||
+        (before && !parse_cursor(before, before_cursor)) || (after && !parse_cursor(after, after_cursor))) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    LogSegments segments;
+    std::string error;
+    if (!segments.open(log_path, max_files, error)) {
+        if (!follow) {
+            std::cerr << error << '\n';
+            return 1;
+        }
+    }
+
+    Printer printer(json);
+    LogLine line;
+    LogSegments::Position position;
+    if (after || (!before && limit == 0)) {
+        // Forward: everything, or what follows a cursor. A cursor whose file
+        // has rotated away is older than all that is left. With -F the scan
+        // runs to the end and following takes over from there.
+        if (follow) {
+            limit = 0;
+        }
+        if (after && segments.find(after_cursor, position)) {
+            LogSegments::Position skip = position;
+            if (segments.next_match(skip, LogFilter{}, line)) {
+                position = skip;
+            }
+        }
+        for (size_t count = 0; (limit == 0 || count < limit) && segments.next_match(position, filter, line);) {
+            LogSegments::Position start = position;
+            start.offset -= line.text.size() + 1;
+            printer.line(line, segments.cursor(start));
+            ++count;
+        }
+    } else {
+        // Backward: the last `limit` lines (all, without -L) before the end or
+        // the cursor, printed oldest first.
+        position = segments.end();
+        if (before && !segments.find(before_cursor, position)) {
+            position = LogSegments::Position{segments.segments().size(), 0};
+        }
+        std::vector<std::pair<LogLine, LogSegments::Position>> lines;
+        while ((limit == 0 || lines.size() < limit) && segments.prev_match(position, filter, line)) {
+            lines.emplace_back(line, position);
+        }
+        for (auto it = lines.rbegin(); it != lines.rend(); ++it) {
+            printer.line(it->first, segments.cursor(it->second));
+        }
+    }
+    printer.flush();
+
+    if (follow) {
+        // Carry on from the end of what was mapped.
+        const LogCursor from = segments.cursor(segments.end());
+        segments.close();
+        Follower follower(log_path, filter, printer);
+        return follower.run(from) ? 0 : 1;
+    }
+    return 0;
+}
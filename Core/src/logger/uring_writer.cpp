@@ -0,0 +1,217 @@
+#include "uring_writer.hpp"
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define LOGGER_HAVE_IO_URING 1
+#endif
+
+UringWriter::~UringWriter() noexcept {
+    release();
+}
+
+void UringWriter::release() noexcept {
+    if (sqes_) {
+        munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ && cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_) {
+        munmap(sq_ring_, sq_ring_size_);
+    }
+    if (ring_fd_ >= 0) {
+        close(ring_fd_);
+    }
+    sqes_ = cq_ring_ = sq_ring_ = nullptr;
+    ring_fd_ = -1;
+}
+
+#ifdef LOGGER_HAVE_IO_URING
+
+namespace {
+
+template <typename T>
+T* at(void* base, unsigned offset) noexcept {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+} // namespace
+
+bool UringWriter::init(unsigned entries) noexcept {
+    if (ring_fd_ >= 0) {
+        return true;
+    }
+
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    const int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0) {
+        return false;
+    }
+    ring_fd_ = fd;
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = false;
+#ifdef IORING_FEAT_SINGLE_MMAP
+    single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+#endif
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = sq_ring_size_ > cq_ring_size_ ? sq_ring_size_ : cq_ring_size_;
+    }
+
+    void* sq = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) {
+        release();
+        return false;
+    }
+    sq_ring_ = sq;
+
+    if (single_mmap) {
+        cq_ring_ = sq_ring_;
+    } else {
+        void* cq = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                        IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) {
+            release();
+            return false;
+        }
+        cq_ring_ = cq;
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        release();
+        return false;
+    }
+    sqes_ = sqes;
+
+    sq_tail_ = at<unsigned>(sq_ring_, params.sq_off.tail);
+    sq_mask_ = at<unsigned>(sq_ring_, params.sq_off.ring_mask);
+    sq_array_ = at<unsigned>(sq_ring_, params.sq_off.array);
+    cq_head_ = at<unsigned>(cq_ring_, params.cq_off.head);
+    cq_tail_ = at<unsigned>(cq_ring_, params.cq_off.tail);
+    cq_mask_ = at<unsigned>(cq_ring_, params.cq_off.ring_mask);
+    cqes_ = at<void>(cq_ring_, params.cq_off.cqes);
+    return true;
+}
+
+ssize_t UringWriter::writev(int fd, const struct iovec* iov, int iovcnt, std::uint64_t offset,
+                            bool datasync) noexcept {
+    if (ring_fd_ < 0) {
+        return -ENOSYS;
+    }
+
+    const unsigned tail = *sq_tail_;
+    auto* sqes = static_cast<struct io_uring_sqe*>(sqes_);
+
+    struct io_uring_sqe* sqe = &sqes[tail & *sq_mask_];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<std::uint64_t>(iov);
+    sqe->len = static_cast<std::uint32_t>(iovcnt);
+    sq_array_[tail & *sq_mask_] = tail & *sq_mask_;
+    unsigned count = 1;
+
+    if (datasync) {
+        // Linked: the sync only runs if the write fully succeeded.
+        sqe->flags = IOSQE_IO_LINK;
+        struct io_uring_sqe* sync = &sqes[(tail + 1) & *sq_mask_];
+        std::memset(sync, 0, sizeof(*sync));
+        sync->opcode = IORING_OP_FSYNC;
+        sync->fd = fd;
+        sync->fsync_flags = IORING_FSYNC_DATASYNC;
+        sq_array_[(tail + 1) & *sq_mask_] = (tail + 1) & *sq_mask_;
+        count = 2;
+    }
+    __atomic_store_n(sq_tail_, tail + count, __ATOMIC_RELEASE);
+
+    std::int32_t results[2] = {0, 0};
+    if (!submit_and_wait(count, results)) {
+        return -EIO;
+    }
+    return results[0];
+}
+
+int UringWriter::fdatasync(int fd) noexcept {
+    if (ring_fd_ < 0) {
+        return -ENOSYS;
+    }
+
+    const unsigned tail = *sq_tail_;
+    auto* sqes = static_cast<struct io_uring_sqe*>(sqes_);
+    struct io_uring_sqe* sqe = &sqes[tail & *sq_mask_];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_FSYNC;
+    sqe->fd = fd;
+    sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+    sq_array_[tail & *sq_mask_] = tail & *sq_mask_;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+    std::int32_t result = 0;
+    return submit_and_wait(1, &result) ? result : -EIO;
+}
+
+bool UringWriter::submit_and_wait(unsigned count, std::int32_t* results) noexcept {
+    unsigned submitted = 0;
+    while (submitted < count) {
+        const long ret = syscall(__NR_io_uring_enter, ring_fd_, count - submitted, count - submitted,
+                                 IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        submitted += static_cast<unsigned>(ret);
+    }
+
+    // Completions arrive in submission order for a linked pair; reap exactly
+    // as many as were submitted, waiting again if the kernel is still busy.
+    auto* cqes = static_cast<struct io_uring_cqe*>(cqes_);
+    unsigned reaped = 0;
+    while (reaped < count) {
+        unsigned head = *cq_head_;
+        const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            if (syscall(__NR_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+                errno != EINTR) {
+                return false;
+            }
+            continue;
+        }
+        for (; head != tail && reaped < count; ++head) {
+            results[reaped++] = cqes[head & *cq_mask_].res;
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+    return true;
+}
+
+#else
+
+bool UringWriter::init(unsigned) noexcept {
+    return false;
+}
+
+ssize_t UringWriter::writev(int, const struct iovec*, int, std::uint64_t, bool) noexcept {
+    return -ENOSYS;
+}
+
+int UringWriter::fdatasync(int) noexcept {
+    return -ENOSYS;
+}
+
+bool UringWriter::submit_and_wait(unsigned, std::int32_t*) noexcept {
+    return false;
+}
+
+#endif
\ No newline at end of file
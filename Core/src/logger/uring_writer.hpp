@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+// Minimal io_uring submitter for the log writer, driven through raw syscalls
+// so it needs neither liburing nor a new enough libc. A batch is one WRITEV
+// SQE, optionally linked to an FDATASYNC SQE, submitted and reaped with a
+// single io_uring_enter(). init() fails cleanly when the kernel (or a
+// seccomp policy) does not allow io_uring; callers then stay on writev().
+class UringWriter final {
+public:
+    UringWriter() noexcept = default;
+    ~UringWriter() noexcept;
+
+    UringWriter(const UringWriter&) = delete;
+    UringWriter& operator=(const UringWriter&) = delete;
+    UringWriter(UringWriter&&) = delete;
+    UringWriter& operator=(UringWriter&&) = delete;
+
+    [[nodiscard]] bool init(unsigned entries = 4) noexcept;
+    [[nodiscard]] bool available() const noexcept { return ring_fd_ >= 0; }
+
+    // Returns bytes written (possibly short) or -errno.
+    [[nodiscard]] ssize_t writev(int fd, const struct iovec* iov, int iovcnt, std::uint64_t offset,
+                                 bool datasync) noexcept;
+    [[nodiscard]] int fdatasync(int fd) noexcept;
+
+private:
+    int ring_fd_ = -1;
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    void* sqes_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    size_t sqes_size_ = 0;
+
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    void* cqes_ = nullptr;
+
+    [[nodiscard]] bool submit_and_wait(unsigned count, std::int32_t* results) noexcept;
+    void release() noexcept;
+};
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "metrics.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+void append(std::string& out, const char* format, auto... args) {
+    char line[256];
+    const int len = std::snprintf(line, sizeof(line), format, args...);
+    if (len > 0) {
+        out.append(line, std::min(static_cast<std::size_t>(len), sizeof(line) - 1));
+    }
+}
+
+double seconds(std::uint64_t micros) noexcept {
+    return static_cast<double>(micros) / 1e6;
+}
+
+socklen_t abstract_address(std::string_view name, struct sockaddr_un& addr) noexcept {
+    addr = {};
+    addr.sun_family = AF_UNIX;
+    const std::size_t len = std::min(name.size(), sizeof(addr.sun_path) - 1);
+    std::memcpy(addr.sun_path + 1, name.data(), len);
+    return static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + 1 + len);
+}
+
+} // namespace
+
+std::uint64_t LatencyHistogram::percentile(double q) const noexcept {
+    const std::uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(q * static_cast<double>(total))));
+    std::uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket < kBucketCount; ++bucket) {
+        seen += buckets_[bucket].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(bucket_upper_bound(bucket), max());
+        }
+    }
+    return max();
+}
+
+void MetricsRegistry::render_prometheus(std::string& out) const {
+    out.clear();
+    for (const auto& metric : metrics_) {
+        const int name_len = static_cast<int>(metric.name.size());
+        const char* name = metric.name.data();
+        append(out, "# HELP %.*s %.*s\n", name_len, name, static_cast<int>(metric.help.size()), metric.help.data());
+
+        if (metric.kind != MetricKind::HISTOGRAM) {
+            append(out, "# TYPE %.*s %s\n%.*s %llu\n", name_len, name,
+                   metric.kind == MetricKind::COUNTER ? "counter" : "gauge", name_len, name,
+                   static_cast<unsigned long long>(metric.read(metric.object)));
+            continue;
+        }
+
+        const auto& histogram = *static_cast<const LatencyHistogram*>(metric.object);
+        append(out, "# TYPE %.*s summary\n", name_len, name);
+        for (const double q : kQuantiles) {
+            append(out, "%.*s{quantile=\"%g\"} %.6f\n", name_len, name, q, seconds(histogram.percentile(q)));
+        }
+        append(out, "%.*s_sum %.6f\n%.*s_count %llu\n", name_len, name, seconds(histogram.sum()), name_len, name,
+               static_cast<unsigned long long>(histogram.count()));
+    }
+}
+
+void MetricsRegistry::render_text(std::string& out) const {
+    out.clear();
+    for (const auto& metric : metrics_) {
+        const int name_len = static_cast<int>(metric.name.size());
+        if (metric.kind != MetricKind::HISTOGRAM) {
+            append(out, "%-44.*s %llu\n", name_len, metric.name.data(),
+                   static_cast<unsigned long long>(metric.read(metric.object)));
+            continue;
+        }
+        const auto& histogram = *static_cast<const LatencyHistogram*>(metric.object);
+        append(out, "%-44.*s n=%llu p50=%lluus p90=%lluus p99=%lluus max=%lluus\n", name_len, metric.name.data(),
+               static_cast<unsigned long long>(histogram.count()),
+               static_cast<unsigned long long>(histogram.percentile(0.5)),
+               static_cast<unsigned long long>(histogram.percentile(0.9)),
+               static_cast<unsigned long long>(histogram.percentile(0.99)),
+               static_cast<unsigned long long>(histogram.max()));
+    }
+}
+
+bool MetricsRegistry::write_file(const char* path) const noexcept {
+    std::string text;
+    render_prometheus(text);
+
+    // Readers (the WebUI) must never see a half-written file.
+    const std::string temp = std::string{path} + ".tmp";
+    const int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    std::size_t written = 0;
+    while (written < text.size()) {
+        const ssize_t n = write(fd, text.data() + written, text.size() - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            close(fd);
+            unlink(temp.c_str());
+            return false;
+        }
+        written += static_cast<std::size_t>(n);
+    }
+    close(fd);
+    return rename(temp.c_str(), path) == 0;
+}
+
+StatsEndpoint::~StatsEndpoint() noexcept {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+bool StatsEndpoint::listen(std::string_view name) noexcept {
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct sockaddr_un addr;
+    const socklen_t len = abstract_address(name, addr);
+    if (bind(fd, reinterpret_cast<const struct sockaddr*>(&addr), len) != 0 || ::listen(fd, 8) != 0) {
+        close(fd);
+        return false;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+    fd_ = fd;
+    return true;
+}
+
+void StatsEndpoint::serve(const MetricsRegistry& registry) noexcept {
+    int client;
+    bool rendered = false;
+    while ((client = accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC)) >= 0) {
+        if (!rendered) {
+            registry.render_prometheus(reply_);
+            rendered = true;
+        }
+        // The reply is a few KB and fits the socket buffer; a client that
+        // stops reading just gets a truncated answer.
+        (void)!send(client, reply_.data(), reply_.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+        close(client);
+    }
+}
+
+bool StatsEndpoint::query(std::string_view name, std::string& out) noexcept {
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct sockaddr_un addr;
+    const socklen_t len = abstract_address(name, addr);
+    if (connect(fd, reinterpret_cast<const struct sockaddr*>(&addr), len) != 0) {
+        close(fd);
+        return false;
+    }
+    out.clear();
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            close(fd);
+            return false;
+        }
+        out.append(buffer, static_cast<std::size_t>(n));
+    }
+    close(fd);
+    return true;
+}
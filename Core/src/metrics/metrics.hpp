@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A counter written from many threads. Each thread adds to its own
+// cache-line-sized shard with a relaxed fetch_add, so hot paths never share
+// a line; value() sums the shards and is only as exact as a racing read.
+class ShardedCounter final {
+public:
+    static constexpr std::size_t kShards = 8;
+
+    void add(std::uint64_t n = 1) noexcept {
+        shards_[shard_index()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::uint64_t value() const noexcept {
+        std::uint64_t total = 0;
+        for (const auto& shard : shards_) {
+            total += shard.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<std::uint64_t> value{0};
+    };
+
+    static std::size_t shard_index() noexcept {
+        static std::atomic<std::size_t> next{0};
+        thread_local const std::size_t index = next.fetch_add(1, std::memory_order_relaxed) % kShards;
+        return index;
+    }
+
+    Shard shards_[kShards];
+};
+
+// HDR-style log-linear histogram of microsecond latencies. Values below 32
+// get a bucket each; above that every power of two is split into 16 linear
+// sub-buckets, so any recorded value is reported within 1/16 of itself
+// across the full 64-bit range in under 8 KB. record() is a few relaxed
+// atomics and never allocates or locks.
+class LatencyHistogram final {
+public:
+    static constexpr unsigned kSubBucketBits = 5;
+    static constexpr std::size_t kHalf = std::size_t{1} << (kSubBucketBits - 1);
+    static constexpr std::size_t kBucketCount = (64 - kSubBucketBits) * kHalf + 2 * kHalf;
+
+    void record(std::uint64_t micros) noexcept {
+        buckets_[bucket_of(micros)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(micros, std::memory_order_relaxed);
+        std::uint64_t max = max_.load(std::memory_order_relaxed);
+        while (micros > max && !max_.compare_exchange_weak(max, micros, std::memory_order_relaxed)) {
+        }
+    }
+
+    void record_since(std::chrono::steady_clock::time_point start) noexcept {
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        record(static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+    }
+
+    [[nodiscard]] std::uint64_t count() const noexcept { return count_.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::uint64_t sum() const noexcept { return sum_.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::uint64_t max() const noexcept { return max_.load(std::memory_order_relaxed); }
+
+    // Highest value equivalent to the q-quantile (0 < q <= 1); 0 when empty.
+    [[nodiscard]] std::uint64_t percentile(double q) const noexcept;
+
+    static constexpr std::size_t bucket_of(std::uint64_t value) noexcept {
+        if (value < 2 * kHalf) {
+            return static_cast<std::size_t>(value);
+        }
+        const unsigned shift = static_cast<unsigned>(std::bit_width(value)) - kSubBucketBits;
+        return shift * kHalf + static_cast<std::size_t>(value >> shift);
+    }
+
+    static constexpr std::uint64_t bucket_upper_bound(std::size_t bucket) noexcept {
+        if (bucket < 2 * kHalf) {
+            return bucket;
+        }
+        const unsigned shift = static_cast<unsigned>(bucket / kHalf - 1);
+        const std::uint64_t sub = bucket - shift * kHalf;
+        return ((sub + 1) << shift) - 1;
+    }
+
+private:
+    std::atomic<std::uint64_t> buckets_[kBucketCount]{};
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> sum_{0};
+    std::atomic<std::uint64_t> max_{0};
+};
+
+enum class MetricKind { COUNTER, GAUGE, HISTOGRAM };
+
+// Names the metrics a component already keeps and renders them on demand.
+// Nothing here runs unless someone asks: registration stores a pointer and
+// a reader, and rendering walks the list. Counters and gauges are read
+// through a plain function so the owner decides how (an atomic, a
+// container's size, a member of a single-threaded loop).
+class MetricsRegistry final {
+public:
+    using Reader = std::uint64_t (*)(const void* object);
+
+    void add_counter(std::string_view name, std::string_view help, const void* object, Reader read) {
+        metrics_.push_back(Metric{name, help, MetricKind::COUNTER, object, read});
+    }
+    void add_counter(std::string_view name, std::string_view help, const ShardedCounter& counter) {
+        add_counter(name, help, &counter,
+                    [](const void* object) { return static_cast<const ShardedCounter*>(object)->value(); });
+    }
+    void add_counter(std::string_view name, std::string_view help, const std::atomic<std::uint64_t>& counter) {
+        add_counter(name, help, &counter, [](const void* object) {
+            return static_cast<const std::atomic<std::uint64_t>*>(object)->load(std::memory_order_relaxed);
+        });
+    }
+    void add_gauge(std::string_view name, std::string_view help, const void* object, Reader read) {
+        metrics_.push_back(Metric{name, help, MetricKind::GAUGE, object, read});
+    }
+    // Rendered in seconds as a summary with p50/p90/p99/p999.
+    void add_histogram(std::string_view name, std::string_view help, const LatencyHistogram& histogram) {
+        metrics_.push_back(Metric{name, help, MetricKind::HISTOGRAM, &histogram, nullptr});
+    }
+
+    // Prometheus text exposition format, version 0.0.4.
+    void render_prometheus(std::string& out) const;
+    // One aligned line per metric, for --stats dumps.
+    void render_text(std::string& out) const;
+    // Replaces `path` atomically (write + rename) with render_prometheus().
+    bool write_file(const char* path) const noexcept;
+
+private:
+    struct Metric {
+        std::string_view name;
+        std::string_view help;
+        MetricKind kind;
+        const void* object;
+        Reader read;
+    };
+
+    std::vector<Metric> metrics_;
+};
+
+// Answers every connection on the abstract stream socket @<name> with the
+// registry's Prometheus text and closes it; the owner polls fd() and calls
+// serve(). Nothing is parsed from the client.
+class StatsEndpoint final {
+public:
+    StatsEndpoint() noexcept = default;
+    ~StatsEndpoint() noexcept;
+
+    StatsEndpoint(const StatsEndpoint&) = delete;
+    StatsEndpoint& operator=(const StatsEndpoint&) = delete;
+    StatsEndpoint(StatsEndpoint&&) = delete;
+    StatsEndpoint& operator=(StatsEndpoint&&) = delete;
+
+    bool listen(std::string_view name) noexcept;
+    [[nodiscard]] int fd() const noexcept { return fd_; }
+    void serve(const MetricsRegistry& registry) noexcept;
+
+    // Client side: reads the whole reply from @<name> into `out`.
+    static bool query(std::string_view name, std::string& out) noexcept;
+
+private:
+    int fd_ = -1;
+    std::string reply_;
+};
@@ -0,0 +1,452 @@
+#include "mixer_paths.hpp"
+#include "xxhash64.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+// audio_route expands nested paths recursively; real files nest two or
+// three deep.
+constexpr int kMaxReferenceDepth = 16;
+
+bool is_space(char c) noexcept {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+std::string_view trim(std::string_view text) noexcept {
+    while (!text.empty() && is_space(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && is_space(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+bool parse_id(std::string_view text, int& id) noexcept {
+    if (text.empty() || text.size() > 6) {
+        return false;
+    }
+    id = 0;
+    for (const char c : text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        id = id * 10 + (c - '0');
+    }
+    return true;
+}
+
+// Anything that would need an entity in an attribute value.
+bool is_plain_attribute(std::string_view text) noexcept {
+    return text.find_first_of("\"<>&\r\n") == std::string_view::npos;
+}
+
+// The whitespace before the tag at `begin` on its line, or nothing if the
+// tag does not start its line.
+std::string_view indent_of(std::string_view text, std::size_t begin) noexcept {
+    const std::size_t newline = begin ? text.rfind('\n', begin - 1) : std::string_view::npos;
+    const std::size_t line = newline == std::string_view::npos ? 0 : newline + 1;
+    const std::string_view indent = text.substr(line, begin - line);
+    return std::all_of(indent.begin(), indent.end(), is_space) ? indent : std::string_view{};
+}
+
+std::string ctl_label(const MixerCtl& ctl) {
+    std::string label{ctl.name};
+    if (ctl.reference) {
+        return "<path " + label + ">";
+    }
+    if (ctl.id >= 0) {
+        label += "[" + std::to_string(ctl.id) + "]";
+    }
+    return label;
+}
+
+bool same_ctl(const MixerCtl& a, const MixerCtl& b) noexcept {
+    return a.reference == b.reference && a.id == b.id && a.name == b.name;
+}
+
+// The entry that takes effect for `ctl` in `list`: audio_route applies
+// children in order, so the last one wins.
+const MixerCtl* last_match(const MixerCtl* first, const MixerCtl* last, const MixerCtl& ctl) noexcept {
+    const MixerCtl* found = nullptr;
+    for (const MixerCtl* entry = first; entry != last; ++entry) {
+        if (same_ctl(*entry, ctl)) {
+            found = entry;
+        }
+    }
+    return found;
+}
+
+} // namespace
+
+bool MixerDocument::open(const char* path, std::string& error) noexcept {
+    entries_.clear();
+    paths_.clear();
+    index_.clear();
+    duplicates_.clear();
+    edits_.clear();
+    inserts_.clear();
+    path_ = path;
+    return file_.open(path, error) && index(error);
+}
+
+bool MixerDocument::index(std::string& error) noexcept {
+    const std::string_view text = file_.text();
+    XmlScanner scanner(text);
+    XmlTag tag;
+    std::vector<MixerCtl> initial;
+    std::string scratch;
+    bool in_mixer = false;
+    std::uint32_t current = 0;   // 0: not inside a <path>
+    std::size_t line = 1;
+    std::size_t counted = 0;
+
+    // Tags come in document order, so lines are counted once overall
+    // rather than from the top for every path.
+    auto line_at = [&](std::size_t offset) {
+        line += static_cast<std::size_t>(std::count(text.begin() + counted, text.begin() + offset, '\n'));
+        counted = offset;
+        return line;
+    };
+
+    auto fail = [&](std::size_t offset, const std::string& message) {
+        error = path_ + ":" + std::to_string(line_of(text, offset)) + ": " + message;
+        entries_.clear();
+        paths_.clear();
+        index_.clear();
+        duplicates_.clear();
+        return false;
+    };
+    auto seal = [&](MixerPath& path) {
+        scratch.clear();
+        for (std::uint32_t i = path.first; i < path.first + path.count; ++i) {
+            const MixerCtl& ctl = entries_[i];
+            scratch.append(ctl.name).push_back('\0');
+            scratch.append(std::to_string(ctl.id)).push_back(ctl.reference ? '\1' : '\0');
+            scratch.append(ctl.value).push_back('\0');
+        }
+        path.digest = FileWatcherAPI::XXHash64::hash(scratch.data(), scratch.size());
+    };
+
+    paths_.push_back({{}, 0, 0, 0, 0, std::string_view::npos, {}});
+    while (scanner.next(tag)) {
+        if (tag.closing) {
+            if (tag.name == "path" && current) {
+                MixerPath& path = paths_[current];
+                path.count = static_cast<std::uint32_t>(entries_.size()) - path.first;
+                seal(path);
+                current = 0;
+            } else if (tag.name == "mixer") {
+                in_mixer = false;
+            }
+            continue;
+        }
+        if (tag.name == "mixer") {
+            in_mixer = true;
+            paths_[0].line = line_at(tag.begin);
+            paths_[0].insert_at = tag.end;
+            paths_[0].indent = indent_of(text, tag.begin);
+            continue;
+        }
+        if (!in_mixer || (tag.name != "path" && tag.name != "ctl")) {
+            continue;
+        }
+
+        const XmlAttribute* name = tag.find("name");
+        if (!name || name->value.empty()) {
+            return fail(tag.begin, "<" + std::string{tag.name} + "> without a name");
+        }
+        if (tag.name == "path" && !current) {
+            const auto index = static_cast<std::uint32_t>(paths_.size());
+            if (!index_.emplace(name->value, index).second) {
+                duplicates_.push_back(name->value);
+            }
+            MixerPath& path = paths_.emplace_back();
+            path.name = name->value;
+            path.first = static_cast<std::uint32_t>(entries_.size());
+            path.count = 0;
+            path.line = line_at(tag.begin);
+            path.insert_at = tag.self_closing ? std::string_view::npos : tag.end;
+            path.indent = indent_of(text, tag.begin);
+            if (tag.self_closing) {
+                seal(path);
+            } else {
+                current = index;
+            }
+            continue;
+        }
+        if (tag.name == "path" && !tag.self_closing) {
+            return fail(tag.begin, "nested <path> definition");
+        }
+
+        MixerCtl ctl{name->value, {}, -1, tag.name == "path", 0};
+        if (!ctl.reference) {
+            const XmlAttribute* value = tag.find("value");
+            const XmlAttribute* id = tag.find("id");
+            if (!value) {
+                return fail(tag.begin, "<ctl name=\"" + std::string{ctl.name} + "\"> without a value");
+            }
+            if (id && !parse_id(id->value, ctl.id)) {
+                return fail(tag.begin, "bad id \"" + std::string{id->value} + "\"");
+            }
+            ctl.value = value->value;
+            ctl.value_offset = value->offset;
+        }
+        MixerPath& owner = paths_[current];
+        if (current ? entries_.size() == owner.first : initial.empty()) {
+            owner.indent = indent_of(text, tag.begin);
+        }
+        owner.insert_at = tag.end;
+        (current ? entries_ : initial).push_back(ctl);
+    }
+    if (scanner.error()) {
+        return fail(scanner.error_offset(), scanner.error());
+    }
+    if (current) {
+        return fail(text.size(), "unterminated <path name=\"" + std::string{paths_[current].name} + "\">");
+    }
+    if (paths_[0].insert_at == std::string_view::npos) {
+        return fail(0, "no <mixer> element");
+    }
+
+    MixerPath& root = paths_[0];
+    root.first = static_cast<std::uint32_t>(entries_.size());
+    root.count = static_cast<std::uint32_t>(initial.size());
+    entries_.insert(entries_.end(), initial.begin(), initial.end());
+    seal(root);
+    index_.emplace(std::string_view{}, 0);
+    return true;
+}
+
+const MixerPath* MixerDocument::find_path(std::string_view name) const noexcept {
+    const auto it = index_.find(name);
+    return it == index_.end() ? nullptr : &paths_[it->second];
+}
+
+bool MixerDocument::resolve(std::string_view name, std::vector<const MixerCtl*>& out,
+                            std::string& error) const noexcept {
+    const MixerPath* path = find_path(name);
+    if (!path) {
+        error = "no path \"" + std::string{name} + "\"";
+        return false;
+    }
+    out.clear();
+    return resolve(*path, 0, out, error);
+}
+
+bool MixerDocument::resolve(const MixerPath& path, int depth, std::vector<const MixerCtl*>& out,
+                            std::string& error) const noexcept {
+    if (depth > kMaxReferenceDepth) {
+        error = "path references nest too deep at \"" + std::string{path.name} + "\" (a loop?)";
+        return false;
+    }
+    for (std::uint32_t i = path.first; i < path.first + path.count; ++i) {
+        const MixerCtl& ctl = entries_[i];
+        if (!ctl.reference) {
+            out.push_back(&ctl);
+            continue;
+        }
+        const MixerPath* target = find_path(ctl.name);
+        if (!target) {
+            error = "\"" + std::string{path.name} + "\" references unknown path \"" + std::string{ctl.name} + "\"";
+            return false;
+        }
+        if (!resolve(*target, depth + 1, out, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MixerDocument::set(std::string_view path_name, std::string_view ctl, int id, std::string_view value,
+                        std::string& error) noexcept {
+    const auto it = index_.find(path_name);
+    if (it == index_.end()) {
+        error = "no path \"" + std::string{path_name} + "\"";
+        return false;
+    }
+    if (ctl.empty() || !is_plain_attribute(ctl) || !is_plain_attribute(value)) {
+        error = "control names and values may not be empty or contain quotes, '<', '>', '&' or newlines";
+        return false;
+    }
+    const MixerPath& path = paths_[it->second];
+    bool found = false;
+    for (std::uint32_t i = path.first; i < path.first + path.count; ++i) {
+        const MixerCtl& entry = entries_[i];
+        if (entry.reference || entry.id != id || entry.name != ctl) {
+            continue;
+        }
+        found = true;
+        std::erase_if(edits_, [&](const SplicePatch& patch) { return patch.offset == entry.value_offset; });
+        if (entry.value != value) {
+            edits_.push_back({entry.value_offset, entry.value.size(), std::string{value}});
+        }
+    }
+    if (found) {
+        return true;
+    }
+
+    if (path.insert_at == std::string_view::npos) {
+        error = "path \"" + std::string{path_name} + "\" is an empty element; cannot add controls to it";
+        return false;
+    }
+    for (auto& insertion : inserts_) {
+        if (insertion.path == it->second && insertion.id == id && insertion.ctl == ctl) {
+            insertion.value = value;
+            return true;
+        }
+    }
+    inserts_.push_back({it->second, std::string{ctl}, id, std::string{value}});
+    return true;
+}
+
+bool MixerDocument::apply(std::string_view patch_set, std::string_view source, std::string& error) noexcept {
+    std::string section;
+    bool have_section = false;
+    std::size_t line_number = 0;
+    auto fail = [&](const std::string& message) {
+        error = std::string{source} + ":" + std::to_string(line_number) + ": " + message;
+        return false;
+    };
+
+    while (!patch_set.empty()) {
+        ++line_number;
+        const std::size_t newline = patch_set.find('\n');
+        const std::string_view line = trim(patch_set.substr(0, newline));
+        patch_set.remove_prefix(newline == std::string_view::npos ? patch_set.size() : newline + 1);
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+        if (line.front() == '[') {
+            if (line.back() != ']') {
+                return fail("expected [path name]");
+            }
+            section = trim(line.substr(1, line.size() - 2));
+            have_section = true;
+            continue;
+        }
+        if (!have_section) {
+            return fail("control before the first [path name] section");
+        }
+        const std::size_t equals = line.find('=');
+        if (equals == std::string_view::npos) {
+            return fail("expected <ctl name>[id] = <value>");
+        }
+        std::string_view name = trim(line.substr(0, equals));
+        const std::string_view value = trim(line.substr(equals + 1));
+        int id = -1;
+        if (!name.empty() && name.back() == ']') {
+            const std::size_t open = name.rfind('[');
+            if (open == std::string_view::npos || !parse_id(name.substr(open + 1, name.size() - open - 2), id)) {
+                return fail("bad control id in \"" + std::string{name} + "\"");
+            }
+            name = trim(name.substr(0, open));
+        }
+        std::string set_error;
+        if (!set(section, name, id, value, set_error)) {
+            return fail(set_error);
+        }
+    }
+    return true;
+}
+
+std::vector<SplicePatch> MixerDocument::pending() const {
+    std::vector<SplicePatch> patches = edits_;
+    std::vector<std::uint32_t> order;
+    for (const auto& insertion : inserts_) {
+        if (std::find(order.begin(), order.end(), insertion.path) == order.end()) {
+            order.push_back(insertion.path);
+        }
+    }
+    // One insertion per path, after its last child, so the new controls
+    // apply last and override anything a referenced path set.
+    for (const std::uint32_t index : order) {
+        const MixerPath& path = paths_[index];
+        SplicePatch& patch = patches.emplace_back();
+        patch.offset = path.insert_at;
+        patch.length = 0;
+        for (const auto& insertion : inserts_) {
+            if (insertion.path != index) {
+                continue;
+            }
+            patch.text.push_back('\n');
+            patch.text.append(path.indent);
+            if (path.count == 0) {
+                patch.text.append("    ");
+            }
+            patch.text.append("<ctl name=\"").append(insertion.ctl).push_back('"');
+            if (insertion.id >= 0) {
+                patch.text.append(" id=\"").append(std::to_string(insertion.id)).push_back('"');
+            }
+            patch.text.append(" value=\"").append(insertion.value).append("\" />");
+        }
+    }
+    std::sort(patches.begin(), patches.end(),
+              [](const SplicePatch& a, const SplicePatch& b) { return a.offset < b.offset; });
+    return patches;
+}
+
+bool MixerDocument::commit(std::string& error) noexcept {
+    if (!dirty()) {
+        return true;
+    }
+    if (!write_spliced(path_, file_.text(), pending(), error)) {
+        return false;
+    }
+    const std::string path = path_;
+    return open(path.c_str(), error);
+}
+
+void diff_mixer_paths(const MixerDocument& a, const MixerDocument& b, std::vector<MixerDifference>& out) {
+    out.clear();
+    const MixerCtl* a_entries = a.entries().data();
+    const MixerCtl* b_entries = b.entries().data();
+
+    for (const auto& path : a.paths()) {
+        if (a.find_path(path.name) != &path) {
+            continue;   // a duplicate definition audio_route never uses
+        }
+        const MixerPath* other = b.find_path(path.name);
+        if (!other) {
+            out.push_back({MixerDifference::Kind::Removed, path.name, {}});
+            continue;
+        }
+        if (other->digest == path.digest && other->count == path.count) {
+            continue;
+        }
+
+        MixerDifference difference{MixerDifference::Kind::Changed, path.name, {}};
+        const MixerCtl* a_first = a_entries + path.first;
+        const MixerCtl* a_last = a_first + path.count;
+        const MixerCtl* b_first = b_entries + other->first;
+        const MixerCtl* b_last = b_first + other->count;
+        for (const MixerCtl* ctl = a_first; ctl != a_last; ++ctl) {
+            if (last_match(a_first, a_last, *ctl) != ctl) {
+                continue;
+            }
+            const MixerCtl* match = last_match(b_first, b_last, *ctl);
+            if (!match) {
+                difference.details.push_back("- " + ctl_label(*ctl));
+            } else if (match->value != ctl->value) {
+                difference.details.push_back(ctl_label(*ctl) + ": " + std::string{ctl->value} + " -> " +
+                                             std::string{match->value});
+            }
+        }
+        for (const MixerCtl* ctl = b_first; ctl != b_last; ++ctl) {
+            if (last_match(b_first, b_last, *ctl) == ctl && !last_match(a_first, a_last, *ctl)) {
+                difference.details.push_back("+ " + ctl_label(*ctl) +
+                                             (ctl->reference ? "" : " = " + std::string{ctl->value}));
+            }
+        }
+        if (difference.details.empty()) {
+            difference.details.emplace_back("same controls in a different order");
+        }
+        out.push_back(std::move(difference));
+    }
+    for (const auto& path : b.paths()) {
+        if (b.find_path(path.name) == &path && !a.find_path(path.name)) {
+            out.push_back({MixerDifference::Kind::Added, path.name, {}});
+        }
+    }
+}
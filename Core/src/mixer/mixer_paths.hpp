@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "xml_edit.hpp"
+
+// One child of a path: <ctl name=".." [id=".."] value=".."/>, or a
+// <path name=".."/> reference to another path (`reference` set, `value`
+// empty). `value_offset` locates the value in the file so a patch
+// rewrites just those bytes.
+struct MixerCtl {
+    std::string_view name;
+    std::string_view value;
+    int id;                      // -1 without an id attribute
+    bool reference;
+    std::size_t value_offset;
+};
+
+// A path's children are entries()[first, first + count). Path 0 is the
+// initial settings: the <ctl>s directly under <mixer>, with an empty name.
+struct MixerPath {
+    std::string_view name;
+    std::uint32_t first;
+    std::uint32_t count;
+    std::uint64_t digest;        // of the children, in order; diff() skips equal paths
+    std::size_t line;
+    // Where a new <ctl> goes (the start of the line after the last child)
+    // and how it is indented.
+    std::size_t insert_at;
+    std::string_view indent;
+};
+
+struct MixerDifference {
+    enum class Kind { Added, Removed, Changed };
+    Kind kind;
+    std::string_view path;
+    std::vector<std::string> details;   // Changed: "- ctl", "+ ctl = v", "ctl: a -> b"
+};
+
+// An ALSA mixer_paths.xml mapped read-only and indexed in one pass. Every
+// path's children live in one contiguous arena (entries()) and a hash
+// index maps path names to them; names and values are views into the
+// mapping. As in audio_route, the first definition of a path name wins and
+// later ones are only reported by duplicates().
+//
+// set() queues byte-range patches: a changed value rewrites that value, a
+// control the path does not have yet is inserted as a new line at the end
+// of the path. commit() writes them with write_spliced().
+class MixerDocument final {
+public:
+    MixerDocument() = default;
+
+    MixerDocument(const MixerDocument&) = delete;
+    MixerDocument& operator=(const MixerDocument&) = delete;
+
+    bool open(const char* path, std::string& error) noexcept;
+
+    [[nodiscard]] std::string_view text() const noexcept { return file_.text(); }
+    [[nodiscard]] const std::vector<MixerPath>& paths() const noexcept { return paths_; }
+    [[nodiscard]] const std::vector<MixerCtl>& entries() const noexcept { return entries_; }
+    [[nodiscard]] const std::vector<std::string_view>& duplicates() const noexcept { return duplicates_; }
+    // "" finds the initial settings.
+    [[nodiscard]] const MixerPath* find_path(std::string_view name) const noexcept;
+
+    // The controls a path sets, with references expanded in place.
+    bool resolve(std::string_view name, std::vector<const MixerCtl*>& out, std::string& error) const noexcept;
+
+    // Sets control `ctl` (with `id`, or -1) of path `path` to `value`,
+    // written exactly as given.
+    bool set(std::string_view path, std::string_view ctl, int id, std::string_view value,
+             std::string& error) noexcept;
+    // A patch set: "[path name]" section headers ("[]" for the initial
+    // settings) followed by "ctl name[id] = value" lines; '#' starts a
+    // comment. `source` prefixes error messages.
+    bool apply(std::string_view patch_set, std::string_view source, std::string& error) noexcept;
+
+    [[nodiscard]] bool dirty() const noexcept { return !edits_.empty() || !inserts_.empty(); }
+    // The queued edits as sorted, non-overlapping byte ranges of text().
+    [[nodiscard]] std::vector<SplicePatch> pending() const;
+    // Writes the patched file and re-indexes it.
+    bool commit(std::string& error) noexcept;
+
+private:
+    struct Insertion {
+        std::uint32_t path;
+        std::string ctl;
+        int id;
+        std::string value;
+    };
+
+    bool index(std::string& error) noexcept;
+    bool resolve(const MixerPath& path, int depth, std::vector<const MixerCtl*>& out,
+                 std::string& error) const noexcept;
+
+    std::string path_;
+    MappedFile file_;
+    std::vector<MixerCtl> entries_;
+    std::vector<MixerPath> paths_;
+    std::unordered_map<std::string_view, std::uint32_t> index_;
+    std::vector<std::string_view> duplicates_;
+    std::vector<SplicePatch> edits_;
+    std::vector<Insertion> inserts_;
+};
+
+// Differences between two documents, path by path: paths only one side
+// defines, then paths whose children differ. Paths with equal digests are
+// not compared further.
+void diff_mixer_paths(const MixerDocument& a, const MixerDocument& b, std::vector<MixerDifference>& out);
@@ -0,0 +1,161 @@
+#include "mixer_paths.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+void print_usage(std::string_view prog_name) noexcept {
+    std::printf("Usage: %s -f <mixer_paths.xml> <command> [args]\n", prog_name.data());
+    std::printf("       %s diff <a.xml> <b.xml>\n", prog_name.data());
+    std::printf("Commands:\n");
+    std::printf("  list                     Print every path with its control count\n");
+    std::printf("  show <path>              Print the controls a path sets, references expanded\n");
+    std::printf("                           (\"\" for the initial settings)\n");
+    std::printf("  patch <patch-set> [--dry-run]\n");
+    std::printf("                           Apply a patch set and print each changed byte range\n");
+    std::printf("  diff <a.xml> <b.xml>     Print paths that differ; exit 0 if none, 1 if some\n");
+    std::printf("\nA patch set has \"[path name]\" sections (\"[]\" for the initial settings)\n");
+    std::printf("of \"ctl name[id] = value\" lines. Existing controls get their value\n");
+    std::printf("rewritten, missing ones are appended to the path. patch rewrites the file\n");
+    std::printf("atomically (temp file, fsync, rename). Errors go to stderr with exit status 2.\n");
+    std::printf("\nExamples:\n");
+    std::printf("  %s -f /vendor/etc/mixer_paths.xml show speaker\n", prog_name.data());
+    std::printf("  %s -f mixer_paths.xml patch speaker-gain.patch --dry-run\n", prog_name.data());
+    std::printf("  %s diff mixer_paths.xml mixer_paths_cdp.xml\n", prog_name.data());
+}
+
+std::string_view path_label(std::string_view name) noexcept {
+    return name.empty() ? std::string_view{"(initial settings)"} : name;
+}
+
+void print_ctl(const MixerCtl& ctl) noexcept {
+    if (ctl.id >= 0) {
+        std::printf("%.*s[%d] = %.*s\n", static_cast<int>(ctl.name.size()), ctl.name.data(), ctl.id,
+                    static_cast<int>(ctl.value.size()), ctl.value.data());
+    } else {
+        std::printf("%.*s = %.*s\n", static_cast<int>(ctl.name.size()), ctl.name.data(),
+                    static_cast<int>(ctl.value.size()), ctl.value.data());
+    }
+}
+
+int diff(const char* a_path, const char* b_path) noexcept {
+    MixerDocument a;
+    MixerDocument b;
+    std::string error;
+    if (!a.open(a_path, error) || !b.open(b_path, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 2;
+    }
+    std::vector<MixerDifference> differences;
+    diff_mixer_paths(a, b, differences);
+    for (const auto& difference : differences) {
+        const std::string_view label = path_label(difference.path);
+        const char sign = difference.kind == MixerDifference::Kind::Added     ? '+'
+                          : difference.kind == MixerDifference::Kind::Removed ? '-'
+                                                                              : '~';
+        std::printf("%c %.*s\n", sign, static_cast<int>(label.size()), label.data());
+        for (const auto& detail : difference.details) {
+            std::printf("    %s\n", detail.c_str());
+        }
+    }
+    return differences.empty() ? 0 : 1;
+}
+
+// file:line @offset+length, then the bytes replaced and their replacement.
+void print_patches(const char* file, const MixerDocument& document) noexcept {
+    const std::string_view text = document.text();
+    for (const auto& patch : document.pending()) {
+        std::printf("%s:%zu @%zu+%zu ", file, line_of(text, patch.offset), patch.offset, patch.length);
+        if (patch.length == 0) {
+            std::string_view added = patch.text;
+            while (!added.empty()) {
+                const std::size_t newline = added.find('\n', 1);
+                std::string_view line = added.substr(0, newline);
+                line.remove_prefix(std::min(line.find('<'), line.size()));
+                std::printf("%s+ %.*s\n", added.data() == patch.text.data() ? "" : "    ",
+                            static_cast<int>(line.size()), line.data());
+                added.remove_prefix(newline == std::string_view::npos ? added.size() : newline);
+            }
+        } else {
+            const std::string_view old_text = text.substr(patch.offset, patch.length);
+            std::printf("\"%.*s\" -> \"%s\"\n", static_cast<int>(old_text.size()), old_text.data(),
+                        patch.text.c_str());
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const char* file = nullptr;
+    int arg = 1;
+    for (; arg < argc; ++arg) {
+        const std::string_view option = argv[arg];
+        if (option == "-f" && arg + 1 < argc) {
+            file = argv[++arg];
+        } else if (option == "-h" || option == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            break;
+        }
+    }
+    if (arg < argc && std::string_view{argv[arg]} == "diff" && arg + 3 == argc) {
+        return diff(argv[arg + 1], argv[arg + 2]);
+    }
+    if (!file || arg >= argc) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    const std::string_view command = argv[arg++];
+
+    MixerDocument document;
+    std::string error;
+    if (!document.open(file, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 2;
+    }
+
+    if (command == "list" && arg == argc) {
+        for (const auto& path : document.paths()) {
+            const std::string_view label = path_label(path.name);
+            std::printf("%.*s\t%u\n", static_cast<int>(label.size()), label.data(), path.count);
+        }
+        for (const auto& name : document.duplicates()) {
+            std::fprintf(stderr, "warning: path \"%.*s\" is defined more than once; the first one is used\n",
+                         static_cast<int>(name.size()), name.data());
+        }
+    } else if (command == "show" && arg + 1 == argc) {
+        std::vector<const MixerCtl*> controls;
+        if (!document.resolve(argv[arg], controls, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 2;
+        }
+        for (const MixerCtl* ctl : controls) {
+            print_ctl(*ctl);
+        }
+    } else if (command == "patch" && arg < argc && argc - arg <= 2) {
+        const bool dry_run = arg + 2 == argc;
+        if (dry_run && std::string_view{argv[arg + 1]} != "--dry-run") {
+            print_usage(argv[0]);
+            return 2;
+        }
+        MappedFile patch_set;
+        if (!patch_set.open(argv[arg], error) || !document.apply(patch_set.text(), argv[arg], error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 2;
+        }
+        print_patches(file, document);
+        if (!dry_run && !document.commit(error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 2;
+        }
+    } else {
+        print_usage(argv[0]);
+        return 2;
+    }
+    return 0;
+}
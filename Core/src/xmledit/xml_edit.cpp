@@ -0,0 +1,296 @@
+#include "xml_edit.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr const char* kSelinuxLabel = "security.selinux";
+
+bool is_space(char c) noexcept {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// writev() until everything is out, resuming after short writes.
+bool write_all(int fd, std::vector<struct iovec>& iov) noexcept {
+    std::size_t first = 0;
+    while (first < iov.size()) {
+        const int count = static_cast<int>(std::min<std::size_t>(iov.size() - first, IOV_MAX));
+        ssize_t written = writev(fd, &iov[first], count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        while (first < iov.size() && static_cast<std::size_t>(written) >= iov[first].iov_len) {
+            written -= static_cast<ssize_t>(iov[first].iov_len);
+            ++first;
+        }
+        if (written > 0) {
+            iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + written;
+            iov[first].iov_len -= static_cast<std::size_t>(written);
+        }
+    }
+    return true;
+}
+
+void sync_parent_directory(const std::string& path) noexcept {
+    const std::size_t slash = path.find_last_of('/');
+    const std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    const int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        (void)fsync(fd);
+        close(fd);
+    }
+}
+
+} // namespace
+
+const XmlAttribute* XmlTag::find(std::string_view attribute) const noexcept {
+    for (const auto& candidate : attributes) {
+        if (candidate.name == attribute) {
+            return &candidate;
+        }
+    }
+    return nullptr;
+}
+
+std::string_view XmlTag::value(std::string_view attribute) const noexcept {
+    const XmlAttribute* found = find(attribute);
+    return found ? found->value : std::string_view{};
+}
+
+bool XmlScanner::fail(std::size_t offset, const char* message) noexcept {
+    error_ = message;
+    error_offset_ = offset;
+    pos_ = text_.size();
+    return false;
+}
+
+bool XmlScanner::next(XmlTag& tag) noexcept {
+    while ((pos_ = text_.find('<', pos_)) != std::string_view::npos) {
+        const std::size_t begin = pos_;
+        if (text_.compare(pos_, 4, "<!--") == 0) {
+            const std::size_t end = text_.find("-->", pos_ + 4);
+            if (end == std::string_view::npos) {
+                return fail(begin, "unterminated comment");
+            }
+            pos_ = end + 3;
+            continue;
+        }
+        if (text_.compare(pos_, 9, "<![CDATA[") == 0) {
+            const std::size_t end = text_.find("]]>", pos_ + 9);
+            if (end == std::string_view::npos) {
+                return fail(begin, "unterminated CDATA section");
+            }
+            pos_ = end + 3;
+            continue;
+        }
+        if (pos_ + 1 < text_.size() && (text_[pos_ + 1] == '?' || text_[pos_ + 1] == '!')) {
+            const std::size_t end = text_.find('>', pos_);
+            if (end == std::string_view::npos) {
+                return fail(begin, "unterminated declaration");
+            }
+            pos_ = end + 1;
+            continue;
+        }
+
+        tag.begin = begin;
+        tag.closing = pos_ + 1 < text_.size() && text_[pos_ + 1] == '/';
+        tag.self_closing = false;
+        tag.attributes.clear();
+        std::size_t name_end = begin + (tag.closing ? 2 : 1);
+        const std::size_t name_begin = name_end;
+        while (name_end < text_.size() && !is_space(text_[name_end]) && text_[name_end] != '>' &&
+               text_[name_end] != '/') {
+            ++name_end;
+        }
+        tag.name = text_.substr(name_begin, name_end - name_begin);
+        if (tag.name.empty()) {
+            return fail(begin, "malformed tag");
+        }
+        if (tag.closing) {
+            const std::size_t end = text_.find('>', name_end);
+            if (end == std::string_view::npos) {
+                return fail(begin, "unterminated tag");
+            }
+            pos_ = tag.end = end + 1;
+            return true;
+        }
+        const std::size_t end = parse_attributes(name_end, tag);
+        if (end == std::string_view::npos) {
+            return fail(begin, "malformed tag");
+        }
+        pos_ = tag.end = end;
+        return true;
+    }
+    pos_ = text_.size();
+    return false;
+}
+
+// Attributes from just after the tag name up to '>'. Returns the offset
+// past the tag, or npos if it is malformed.
+std::size_t XmlScanner::parse_attributes(std::size_t pos, XmlTag& tag) noexcept {
+    const std::string_view text = text_;
+    while (pos < text.size()) {
+        if (is_space(text[pos])) {
+            ++pos;
+            continue;
+        }
+        if (text[pos] == '>') {
+            return pos + 1;
+        }
+        if (text[pos] == '/') {
+            tag.self_closing = true;
+            return pos + 1 < text.size() && text[pos + 1] == '>' ? pos + 2 : std::string_view::npos;
+        }
+        const std::size_t name_begin = pos;
+        while (pos < text.size() && !is_space(text[pos]) && text[pos] != '=' && text[pos] != '>' && text[pos] != '/') {
+            ++pos;
+        }
+        const std::string_view name = text.substr(name_begin, pos - name_begin);
+        while (pos < text.size() && is_space(text[pos])) {
+            ++pos;
+        }
+        if (pos >= text.size() || text[pos] != '=') {
+            return std::string_view::npos;
+        }
+        ++pos;
+        while (pos < text.size() && is_space(text[pos])) {
+            ++pos;
+        }
+        if (pos >= text.size() || (text[pos] != '"' && text[pos] != '\'')) {
+            return std::string_view::npos;
+        }
+        const std::size_t value_end = text.find(text[pos], pos + 1);
+        if (value_end == std::string_view::npos) {
+            return std::string_view::npos;
+        }
+        tag.attributes.push_back({name, text.substr(pos + 1, value_end - pos - 1), pos + 1});
+        pos = value_end + 1;
+    }
+    return std::string_view::npos;
+}
+
+bool MappedFile::open(const char* path, std::string& error) noexcept {
+    close();
+    const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = std::string{path} + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        error = std::string{path} + ": " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        error = std::string{path} + ": empty file";
+        ::close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        error = std::string{path} + ": " + std::strerror(errno);
+        return false;
+    }
+    data_ = static_cast<const char*>(mapping);
+    size_ = static_cast<std::size_t>(st.st_size);
+    return true;
+}
+
+void MappedFile::close() noexcept {
+    if (data_) {
+        munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+
+bool write_spliced(const std::string& path, std::string_view original, const std::vector<SplicePatch>& patches,
+                   std::string& error) noexcept {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    const std::string temp = path + ".tmp";
+    const int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, st.st_mode & 07777);
+    if (fd < 0) {
+        error = temp + ": " + std::strerror(errno);
+        return false;
+    }
+    // The replacement must look like the file it replaces: mode (umask may
+    // have masked bits), owner when running as root, and the SELinux label
+    // the vendor partition overlay expects.
+    (void)fchmod(fd, st.st_mode & 07777);
+    (void)!fchown(fd, st.st_uid, st.st_gid);
+    char label[256];
+    const ssize_t label_size = getxattr(path.c_str(), kSelinuxLabel, label, sizeof(label));
+    if (label_size > 0) {
+        (void)fsetxattr(fd, kSelinuxLabel, label, static_cast<std::size_t>(label_size), 0);
+    }
+
+    std::vector<struct iovec> iov;
+    iov.reserve(patches.size() * 2 + 1);
+    std::size_t cursor = 0;
+    for (const auto& patch : patches) {
+        if (patch.offset > cursor) {
+            iov.push_back({const_cast<char*>(original.data() + cursor), patch.offset - cursor});
+        }
+        if (!patch.text.empty()) {
+            iov.push_back({const_cast<char*>(patch.text.data()), patch.text.size()});
+        }
+        cursor = patch.offset + patch.length;
+    }
+    if (cursor < original.size()) {
+        iov.push_back({const_cast<char*>(original.data() + cursor), original.size() - cursor});
+    }
+
+    const bool written = write_all(fd, iov) && fsync(fd) == 0;
+    const int saved_errno = errno;
+    if (close(fd) != 0 || !written) {
+        error = temp + ": " + std::strerror(written ? errno : saved_errno);
+        unlink(temp.c_str());
+        return false;
+    }
+    if (rename(temp.c_str(), path.c_str()) != 0) {
+        error = path + ": " + std::strerror(errno);
+        unlink(temp.c_str());
+        return false;
+    }
+    sync_parent_directory(path);
+    return true;
+}
+
+std::size_t line_of(std::string_view text, std::size_t offset) noexcept {
+    return 1 + static_cast<std::size_t>(std::count(text.begin(), text.begin() + std::min(offset, text.size()), '\n'));
+}
+
+void append_json_string(std::string& out, std::string_view text) {
+    out.push_back('"');
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+}
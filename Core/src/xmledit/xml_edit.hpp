@@ -0,0 +1,86 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+// Shared by the vendor config tools (dax_tool, mixer_tool): a tag scanner
+// over a mapped XML file that keeps byte offsets, and an atomic writer
+// that streams the original around a set of byte-range patches.
+
+struct XmlAttribute {
+    std::string_view name;
+    std::string_view value;   // raw: entities are not decoded
+    std::size_t offset;       // of the value
+};
+
+struct XmlTag {
+    std::string_view name;
+    std::size_t begin;        // '<'
+    std::size_t end;          // past '>'
+    bool closing;             // </name>
+    bool self_closing;        // <name ... />
+    std::vector<XmlAttribute> attributes;
+
+    [[nodiscard]] const XmlAttribute* find(std::string_view attribute) const noexcept;
+    [[nodiscard]] std::string_view value(std::string_view attribute) const noexcept;
+};
+
+// Yields start, empty and end tags in document order, skipping comments,
+// CDATA, processing instructions and declarations. Text content is not
+// reported. Just enough XML for Android vendor config files.
+class XmlScanner final {
+public:
+    explicit XmlScanner(std::string_view text) noexcept : text_(text) {}
+
+    // False at the end of the text, or on malformed markup with error()
+    // set and error_offset() pointing at it.
+    bool next(XmlTag& tag) noexcept;
+
+    [[nodiscard]] const char* error() const noexcept { return error_; }
+    [[nodiscard]] std::size_t error_offset() const noexcept { return error_offset_; }
+
+private:
+    bool fail(std::size_t offset, const char* message) noexcept;
+    std::size_t parse_attributes(std::size_t pos, XmlTag& tag) noexcept;
+
+    std::string_view text_;
+    std::size_t pos_ = 0;
+    const char* error_ = nullptr;
+    std::size_t error_offset_ = 0;
+};
+
+// A file mapped read-only.
+class MappedFile final {
+public:
+    MappedFile() = default;
+    ~MappedFile() noexcept { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const char* path, std::string& error) noexcept;
+    void close() noexcept;
+
+    [[nodiscard]] std::string_view text() const noexcept { return {data_, size_}; }
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+struct SplicePatch {
+    std::size_t offset;
+    std::size_t length;       // bytes of the original replaced by `text`
+    std::string text;
+};
+
+// Writes `original` with `patches` (sorted, non-overlapping) applied to
+// "<path>.tmp" with writev, fsyncs it and renames it over `path`, keeping
+// the file's mode, owner and SELinux label; readers never see a partial
+// file.
+bool write_spliced(const std::string& path, std::string_view original, const std::vector<SplicePatch>& patches,
+                   std::string& error) noexcept;
+
+[[nodiscard]] std::size_t line_of(std::string_view text, std::size_t offset) noexcept;
+void append_json_string(std::string& out, std::string_view text);
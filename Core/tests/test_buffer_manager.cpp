@@ -0,0 +1,104 @@
+#include "../src/logger/buffer_manager.hpp"
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <cstdio>
+
+// Several producers append numbered lines while one flusher drains the
+// buffer the way logger_daemon does; every line must come out exactly once.
+int main() {
+    std::cout << "Testing BufferManager...\n";
+
+    constexpr int kProducers = 8;
+    constexpr int kPerProducer = 20000;
+
+    BufferManager buffer(16384);
+    std::vector<std::vector<bool>> seen(kProducers, std::vector<bool>(kPerProducer, false));
+    std::atomic<int> finished{0};
+    std::atomic<long> retries{0};
+    bool duplicate = false;
+    bool malformed = false;
+    std::string carry;
+
+    auto consume = [&](std::span<const char> data) {
+        carry.append(data.data(), data.size());
+        size_t start = 0;
+        size_t newline;
+        while ((newline = carry.find('\n', start)) != std::string::npos) {
+            int producer = -1;
+            int sequence = -1;
+            if (std::sscanf(carry.c_str() + start, "p%d s%d", &producer, &sequence) != 2 ||
+                producer < 0 || producer >= kProducers || sequence < 0 || sequence >= kPerProducer) {
+                malformed = true;
+            } else if (seen[producer][sequence]) {
+                duplicate = true;
+            } else {
+                seen[producer][sequence] = true;
+            }
+            start = newline + 1;
+        }
+        carry.erase(0, start);
+    };
+
+    std::thread flusher([&] {
+        while (true) {
+            const bool done = finished.load(std::memory_order_acquire) == kProducers;
+            consume(buffer.get_data());
+            buffer.clear();
+            if (done) {
+                // One more pass picks up the half that was active at the end.
+                consume(buffer.get_data());
+                buffer.clear();
+                return;
+            }
+            std::this_thread::yield();
+        }
+    });
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&, p] {
+            char line[64];
+            for (int s = 0; s < kPerProducer; ++s) {
+                const int len = std::snprintf(line, sizeof(line), "p%d s%d payload\n", p, s);
+                const auto level = s % 1000 == 0 ? LogLevel::ERROR : LogLevel::INFO;
+                while (!buffer.add_log(std::string_view{line, static_cast<size_t>(len)}, level)) {
+                    retries.fetch_add(1, std::memory_order_relaxed);
+                    std::this_thread::yield();
+                }
+            }
+            finished.fetch_add(1, std::memory_order_release);
+        });
+    }
+
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    flusher.join();
+
+    int missing = 0;
+    for (const auto& lines : seen) {
+        for (const bool line : lines) {
+            missing += line ? 0 : 1;
+        }
+    }
+
+    std::cout << "Retries while full: " << retries.load() << '\n';
+    if (duplicate || malformed || missing != 0 || !carry.empty() || !buffer.is_empty()) {
+        std::cout << "✗ Lost or corrupted lines (missing " << missing << ", duplicate " << duplicate
+                  << ", malformed " << malformed << ")\n";
+        return 1;
+    }
+
+    if (buffer.add_log(std::string(buffer.capacity() + 1, 'x'))) {
+        std::cout << "✗ Oversized entry was accepted\n";
+        return 1;
+    }
+
+    std::cout << "✓ " << kProducers * kPerProducer << " lines delivered exactly once\n";
+    std::cout << "BufferManager test completed successfully!\n";
+    return 0;
+}
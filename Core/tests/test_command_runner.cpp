@@ -0,0 +1,118 @@
+#include "../src/filewatcher/command_runner.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+const std::string kOut = "test_data/runner_out";
+const std::string kPwned = "test_data/runner_pwned";
+
+std::string read_file(const std::string& path) {
+    std::ifstream in(path);
+    std::string text;
+    std::getline(in, text);
+    return text;
+}
+
+bool exists(const std::string& path) {
+    return access(path.c_str(), F_OK) == 0;
+}
+
+} // namespace
+
+// Commands are split into argv when they can be, handed to sh otherwise
+// without the file name ever becoming script, and started no more than
+// the concurrency limit at a time with a bounded queue behind it.
+int main() {
+    std::cout << "Testing command runner...\n";
+    std::remove(kOut.c_str());
+    std::remove(kPwned.c_str());
+
+    const CommandTemplate plain("echo  a\t$FILE b$FILE $EVENTS");
+    std::vector<std::string> argv;
+    plain.expand("x y", "modify", argv);
+    if (plain.uses_shell() || plain.program().find('/') == std::string::npos ||
+        argv != std::vector<std::string>{"echo", "a", "x y", "bx y", "modify"}) {
+        std::cout << "✗ Plain command not split into argv (" << argv.size() << " args)\n";
+        return 1;
+    }
+    std::cout << "✓ Plain commands are split on blanks and exec'd directly\n";
+
+    for (const char* command : {"echo a | cat", "echo ${FILE}", "test -f $FILE && echo yes", ""}) {
+        const CommandTemplate shell(command);
+        shell.expand("/tmp/f", "modify", argv);
+        if (!shell.uses_shell() || argv != std::vector<std::string>{"sh", "-c", command}) {
+            std::cout << "✗ \"" << command << "\" not run through sh unchanged\n";
+            return 1;
+        }
+    }
+    std::cout << "✓ Shell syntax falls back to sh -c with the script untouched\n";
+
+    // A hostile name reaches the script as data only.
+    {
+        CommandRunner runner;
+        const CommandTemplate shell("printf '%s %s\\n' \"$FILE\" \"$EVENTS\" > " + kOut);
+        const std::string name = "a'; touch " + kPwned + "; echo '$(touch " + kPwned + ")";
+        runner.submit(shell, name, "modify,close_write");
+        runner.wait_all();
+        if (exists(kPwned) || read_file(kOut) != name + " modify,close_write") {
+            std::cout << "✗ File name interpreted by the shell\n";
+            return 1;
+        }
+    }
+    std::cout << "✓ Shell commands get $FILE and $EVENTS from the environment\n";
+
+    // One running, two queued; the oldest queued commands give way.
+    {
+        CommandRunner runner;
+        runner.set_max_concurrency(1);
+        runner.set_max_queued(2);
+        const CommandTemplate slow("sleep 0.2");
+        for (int i = 0; i < 5; ++i) {
+            runner.submit(slow, "f");
+        }
+        if (runner.running() != 1 || runner.queued() != 2 || runner.dropped() != 2) {
+            std::cout << "✗ Queue cap: " << runner.running() << " running, " << runner.queued() << " queued, "
+                      << runner.dropped() << " dropped\n";
+            return 1;
+        }
+        runner.wait_all();
+        if (runner.running() != 0 || runner.queued() != 0 || runner.spawned() != 3) {
+            std::cout << "✗ wait_all() left " << runner.running() + runner.queued() << " commands\n";
+            return 1;
+        }
+    }
+    std::cout << "✓ Commands past the concurrency limit queue, and the queue is capped\n";
+
+    // reap() collects exited children without blocking and starts what
+    // was waiting for their slot.
+    {
+        CommandRunner runner;
+        runner.set_max_concurrency(1);
+        runner.submit(CommandTemplate("sleep 0.1"), "f");
+        runner.submit(CommandTemplate("true"), "f");
+        runner.reap();
+        if (runner.running() != 1 || runner.queued() != 1) {
+            std::cout << "✗ reap() waited for a running child\n";
+            return 1;
+        }
+        for (int i = 0; i < 200 && (runner.running() || runner.queued()); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            runner.reap();
+        }
+        if (runner.running() != 0 || runner.queued() != 0 || runner.spawned() != 2 || runner.failed() != 0) {
+            std::cout << "✗ reap(): " << runner.spawned() << " spawned, " << runner.running() << " running\n";
+            return 1;
+        }
+    }
+    std::cout << "✓ reap() frees slots and starts queued commands\n";
+
+    std::remove(kOut.c_str());
+    std::cout << "All tests passed!\n";
+    return 0;
+}
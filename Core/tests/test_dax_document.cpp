@@ -0,0 +1,140 @@
+#include "../src/dax/dax_document.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+std::string read_file(const char* path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+void write_file(const char* path, const std::string& text) {
+    std::ofstream(path, std::ios::binary) << text;
+}
+
+// `after` must equal `before` with every (old, new) substring swapped, once
+// each and in order: nothing else in the file may move.
+bool only_changed(const std::string& before, const std::string& after,
+                  const std::vector<std::pair<std::string, std::string>>& swaps) {
+    std::string expected = before;
+    std::size_t from = 0;
+    for (const auto& [old_text, new_text] : swaps) {
+        const std::size_t at = expected.find(old_text, from);
+        if (at == std::string::npos) {
+            return false;
+        }
+        expected.replace(at, old_text.size(), new_text);
+        from = at + new_text.size();
+    }
+    return expected == after;
+}
+
+} // namespace
+
+// The index must cover the module's real dax-default.xml, patches must
+// rewrite only the bytes they target, and commits must be atomic renames
+// that keep the file's mode.
+int main() {
+    std::cout << "Testing DAX document...\n";
+
+    const char* path = "test_data/dax-default.xml";
+    const std::string original = read_file(DAX_DEFAULT_XML);
+    write_file(path, original);
+    chmod(path, 0640);
+
+    DaxDocument document;
+    std::string error;
+    if (!document.open(path, error)) {
+        std::cout << "✗ Open: " << error << '\n';
+        return 1;
+    }
+    const DaxPreset* balanced = document.find_preset("ieq_balanced");
+    const DaxPreset* geq = document.find_preset("0");
+    if (document.presets().size() != 12 || document.profiles().size() != 9 || !balanced || !geq ||
+        balanced->geq || balanced->bands.size() != 20 || balanced->bands[0].frequency != 130 ||
+        balanced->bands[6].value != -750 || !geq->geq || geq->bands.size() != 20 ||
+        document.profiles()[3].name != "Custom" || document.profiles()[3].endpoints.empty() ||
+        document.profiles()[3].endpoints[0].type != "speaker" ||
+        document.profiles()[3].endpoints[0].presets != std::vector<std::string_view>{"ieq_warm"}) {
+        std::cout << "✗ Index of dax-default.xml\n";
+        return 1;
+    }
+    std::string json;
+    DaxDocument::preset_json(*balanced, json);
+    if (json.rfind("{\"id\":\"ieq_balanced\",\"type\":\"ieq\",\"bands\":[{\"frequency\":130,\"target\":60},", 0) != 0) {
+        std::cout << "✗ Preset JSON: " << json.substr(0, 120) << '\n';
+        return 1;
+    }
+    document.to_json(json);
+    if (json.find("{\"id\":\"3\",\"name\":\"Custom\",\"group\":\"default\",\"endpoints\":[{\"type\":\"speaker\","
+                  "\"presets\":[\"ieq_warm\"]}") == std::string::npos) {
+        std::cout << "✗ Document JSON\n";
+        return 1;
+    }
+    std::cout << "✓ Index and JSON\n";
+
+    if (document.set_band("ieq_balanced", 131, "5", error) || document.set_band("missing", 130, "5", error) ||
+        document.set_band("ieq_balanced", 130, "5;rm", error)) {
+        std::cout << "✗ Bad edits accepted\n";
+        return 1;
+    }
+    if (!document.set_band("ieq_balanced", 130, "-1200", error) || !document.set_band("0", 19688, "3.5", error) ||
+        !document.set_band("ieq_balanced", 19688, "7", error) || !document.commit(error)) {
+        std::cout << "✗ Set bands: " << error << '\n';
+        return 1;
+    }
+    const std::string patched = read_file(path);
+    if (!only_changed(original, patched,
+                      {{"<band_ieq frequency=\"130\" target=\"60\"/>", "<band_ieq frequency=\"130\" target=\"-1200\"/>"},
+                       {"<band_ieq frequency=\"19688\" target=\"-300\"/>", "<band_ieq frequency=\"19688\" target=\"7\"/>"},
+                       {"<band_geq frequency=\"19688\" gain=\"0\"/>", "<band_geq frequency=\"19688\" gain=\"3.5\"/>"}})) {
+        std::cout << "✗ Patched file differs outside the edited values\n";
+        return 1;
+    }
+    struct stat st;
+    if (stat(path, &st) != 0 || (st.st_mode & 0777) != 0640 || access("test_data/dax-default.xml.tmp", F_OK) == 0 ||
+        document.find_preset("ieq_balanced")->bands[0].value != -1200) {
+        std::cout << "✗ Commit left the wrong mode, a temp file or a stale index\n";
+        return 1;
+    }
+    std::cout << "✓ Value patches\n";
+
+    const std::vector<std::pair<int, std::string_view>> bands = {{47, "1"}, {141, "-2"}, {328, "0"}};
+    if (!document.replace_bands("ieq_warm", bands, error) || !document.commit(error)) {
+        std::cout << "✗ Replace bands: " << error << '\n';
+        return 1;
+    }
+    const std::string replaced = read_file(path);
+    const std::size_t begin = patched.find("<preset id=\"ieq_warm\"");
+    const std::size_t end = patched.find("</ieq-bands>", begin);
+    const std::size_t list_begin = patched.find("        <band_ieq", begin);
+    const std::string expected = patched.substr(0, list_begin) +
+                                 "        <band_ieq frequency=\"47\" target=\"1\"/>\n"
+                                 "        <band_ieq frequency=\"141\" target=\"-2\"/>\n"
+                                 "        <band_ieq frequency=\"328\" target=\"0\"/>\n      " + patched.substr(end);
+    const DaxPreset* warm = document.find_preset("ieq_warm");
+    if (replaced != expected || !warm || warm->bands.size() != 3 || warm->bands[1].value != -2) {
+        std::cout << "✗ Replaced band list\n";
+        return 1;
+    }
+    std::cout << "✓ Band list replacement\n";
+
+    write_file(path, "<preset id=\"x\" type=\"ieq\"><band_ieq frequency=\"1\" target=\"oops\"/></preset>");
+    if (document.open(path, error) || error.find(":1: ") == std::string::npos) {
+        std::cout << "✗ Malformed band accepted: " << error << '\n';
+        return 1;
+    }
+    std::remove(path);
+    std::cout << "✓ Malformed input rejected\n";
+
+    std::cout << "All tests passed!\n";
+    return 0;
+}
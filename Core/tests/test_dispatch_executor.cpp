@@ -0,0 +1,168 @@
+#include "../src/filewatcherAPI/dispatch_executor.hpp"
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace {
+
+struct Job {
+    uint64_t id;
+    int sequence;
+    std::vector<int>* last;   // last sequence seen per key
+    std::atomic<bool>* out_of_order;
+    std::atomic<int>* in_flight;   // per key: must never exceed one
+
+    uint64_t key() const { return id; }
+    bool coalesces_with(const Job& other) const { return id == other.id && sequence == other.sequence; }
+
+    void operator()() {
+        if (in_flight[id].fetch_add(1) != 0) {
+            out_of_order->store(true);
+        }
+        if ((*last)[id] >= sequence) {
+            out_of_order->store(true);
+        }
+        (*last)[id] = sequence;
+        in_flight[id].fetch_sub(1);
+    }
+};
+
+struct SlowJob {
+    uint64_t id;
+    int value;
+    std::atomic<int>* runs;
+    std::mutex* gate;
+
+    uint64_t key() const { return id; }
+    bool coalesces_with(const SlowJob& other) const { return id == other.id && value == other.value; }
+
+    void operator()() {
+        std::lock_guard<std::mutex> lock(*gate);
+        runs->fetch_add(1);
+    }
+};
+
+// Records the order jobs ran in; the first one waits at the gate.
+struct OrderJob {
+    uint64_t id;
+    int value;
+    std::vector<int>* ran;
+    std::mutex* gate;
+
+    uint64_t key() const { return id; }
+    bool coalesces_with(const OrderJob& other) const { return id == other.id && value == other.value; }
+
+    void operator()() {
+        std::lock_guard<std::mutex> lock(*gate);
+        ran->push_back(value);
+    }
+};
+
+} // namespace
+
+// Jobs for one key must run one at a time and in order while keys spread
+// over the pool; the two lossy policies must account for every job.
+int main() {
+    std::cout << "Testing DispatchExecutor...\n";
+
+    constexpr int kKeys = 97;
+    constexpr int kPerKey = 2000;
+    {
+        std::vector<int> last(kKeys, -1);
+        std::atomic<bool> out_of_order{false};
+        std::vector<std::atomic<int>> in_flight(kKeys);
+
+        FileWatcherAPI::DispatchOptions options;
+        options.threads = 4;
+        options.strands = 16;
+        options.queue_capacity = 64;
+        FileWatcherAPI::DispatchExecutor<Job> executor(options);
+        executor.start();
+        for (int sequence = 0; sequence < kPerKey; ++sequence) {
+            for (uint64_t id = 0; id < kKeys; ++id) {
+                executor.submit(Job{id, sequence, &last, &out_of_order, in_flight.data()});
+            }
+        }
+        executor.stop();
+
+        const auto stats = executor.stats();
+        if (out_of_order || stats.executed != static_cast<uint64_t>(kKeys) * kPerKey || stats.dropped != 0) {
+            std::cout << "✗ Ordering: executed " << stats.executed << ", dropped " << stats.dropped
+                      << (out_of_order ? ", out of order\n" : "\n");
+            return 1;
+        }
+        for (int value : last) {
+            if (value != kPerKey - 1) {
+                std::cout << "✗ Ordering: a key did not finish\n";
+                return 1;
+            }
+        }
+        std::cout << "✓ Per-key order kept (" << stats.stolen << " steals, max depth " << stats.max_queued << ")\n";
+    }
+
+    for (auto policy : {FileWatcherAPI::Backpressure::DROP_OLDEST, FileWatcherAPI::Backpressure::COALESCE}) {
+        std::atomic<int> runs{0};
+        std::mutex gate;
+        FileWatcherAPI::DispatchOptions options;
+        options.threads = 2;
+        options.strands = 1;
+        options.queue_capacity = 8;
+        options.policy = policy;
+        FileWatcherAPI::DispatchExecutor<SlowJob> executor(options);
+
+        // Hold the callback so the strand backs up.
+        gate.lock();
+        executor.start();
+        // Runs of four identical jobs: each run coalesces into its first.
+        for (int i = 0; i < 100; ++i) {
+            executor.submit(SlowJob{1, i / 4, &runs, &gate});
+        }
+        gate.unlock();
+        executor.stop();
+
+        const auto stats = executor.stats();
+        const bool accounted = stats.executed + stats.dropped + stats.coalesced == stats.submitted;
+        const bool lossy = policy == FileWatcherAPI::Backpressure::COALESCE ? stats.coalesced > 0 : stats.dropped > 0;
+        if (!accounted || !lossy || stats.max_queued > options.queue_capacity ||
+            runs.load() != static_cast<int>(stats.executed)) {
+            std::cout << "✗ Backpressure: submitted " << stats.submitted << ", executed " << stats.executed
+                      << ", dropped " << stats.dropped << ", coalesced " << stats.coalesced << '\n';
+            return 1;
+        }
+    }
+    std::cout << "✓ Drop-oldest and coalesce stay within capacity\n";
+
+    // Coalescing must not merge past a different event for the same key:
+    // MODIFY, DELETE, MODIFY has to end on MODIFY.
+    {
+        enum { kBlocker = 0, kModify = 1, kDelete = 2 };
+        std::vector<int> ran;
+        std::mutex gate;
+        FileWatcherAPI::DispatchOptions options;
+        options.threads = 1;
+        options.strands = 1;
+        options.policy = FileWatcherAPI::Backpressure::COALESCE;
+        FileWatcherAPI::DispatchExecutor<OrderJob> executor(options);
+
+        gate.lock();
+        executor.start();
+        for (int value : {kBlocker, kModify, kDelete, kModify, kModify}) {
+            executor.submit(OrderJob{7, value, &ran, &gate});
+        }
+        gate.unlock();
+        executor.stop();
+
+        if (ran.size() != 4 || ran[1] != kModify || ran[2] != kDelete || ran[3] != kModify ||
+            executor.stats().coalesced != 1) {
+            std::cout << "✗ Coalesce reordered a key: " << ran.size() << " jobs ran\n";
+            return 1;
+        }
+    }
+    std::cout << "✓ Coalesce only merges into the key's latest job\n";
+
+    std::cout << "All tests passed!\n";
+    return 0;
+}
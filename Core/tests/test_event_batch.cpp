@@ -0,0 +1,147 @@
+#include "../src/filewatcherAPI/filewatcher_api.hpp"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const std::string kDir = "test_data/event_batch";
+
+void append(const std::string& path) {
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        (void)!write(fd, "x", 1);
+        close(fd);
+    }
+}
+
+// Each delivered batch as "name:mask" strings.
+struct Batches {
+    std::vector<std::vector<std::string>> seen;
+
+    void operator()(std::span<const FileWatcherAPI::FileEvent> events) {
+        std::vector<std::string> batch;
+        for (const auto& event : events) {
+            batch.push_back(std::string{event.filename} + ":" + std::to_string(event.mask));
+        }
+        seen.push_back(std::move(batch));
+    }
+};
+
+// Polls and drains for up to `ms`, the way an application loop would.
+void run_loop(FileWatcherAPI::FileWatcher& watcher, int ms) {
+    const auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while (std::chrono::steady_clock::now() < end) {
+        struct pollfd pfd{watcher.fd(), POLLIN, 0};
+        if (poll(&pfd, 1, 5) > 0) {
+            watcher.drain();
+        }
+    }
+}
+
+} // namespace
+
+// A burst must reach a batch watch as one call, once per file with dedup,
+// and with a latency the batch must stay open across wakeups and still be
+// delivered by the timer when nothing else happens.
+int main() {
+    std::cout << "Testing batch watches...\n";
+    mkdir(kDir.c_str(), 0755);
+    const std::string a = kDir + "/a";
+    const std::string b = kDir + "/b";
+    unlink(a.c_str());
+    unlink(b.c_str());
+
+    FileWatcherAPI::FileWatcher watcher;
+    Batches plain;
+    if (!watcher.add_batch_watch(kDir, std::ref(plain), IN_CREATE | IN_MODIFY)) {
+        std::cout << "✗ Add batch watch\n";
+        return 1;
+    }
+    append(a);
+    append(b);
+    append(a);
+    run_loop(watcher, 50);
+    // a: create, modify; b: create, modify; a: modify. (inotify itself
+    // folds back-to-back repeats, so the writes alternate.)
+    if (plain.seen.size() != 1 || plain.seen[0].size() != 5) {
+        std::cout << "✗ One wakeup, one batch: " << plain.seen.size() << " batches\n";
+        return 1;
+    }
+    std::cout << "✓ One wakeup, one batch of " << plain.seen[0].size() << " events\n";
+    watcher.remove_watch(kDir);
+
+    Batches merged;
+    watcher.add_batch_watch(kDir, std::ref(merged), IN_CREATE | IN_MODIFY | IN_DELETE, {.dedup = true});
+    append(a);
+    append(b);
+    append(a);
+    unlink(b.c_str());
+    run_loop(watcher, 50);
+    const std::vector<std::string> expected{"a:" + std::to_string(IN_MODIFY),
+                                            "b:" + std::to_string(IN_MODIFY | IN_DELETE)};
+    if (merged.seen.size() != 1 || merged.seen[0] != expected) {
+        std::cout << "✗ Dedup: " << (merged.seen.empty() ? 0 : merged.seen[0].size()) << " events\n";
+        return 1;
+    }
+    std::cout << "✓ Dedup merges each file's events in place\n";
+    watcher.remove_watch(kDir);
+
+    Batches held;
+    watcher.add_batch_watch(kDir, std::ref(held), IN_MODIFY,
+                            {.dedup = true, .max_latency = std::chrono::milliseconds(150)});
+    append(a);
+    run_loop(watcher, 40);
+    append(a);
+    append(b);
+    run_loop(watcher, 40);
+    if (!held.seen.empty()) {
+        std::cout << "✗ Batch delivered before its latency\n";
+        return 1;
+    }
+    run_loop(watcher, 200);
+    if (held.seen.size() != 1 || held.seen[0].size() != 2) {
+        std::cout << "✗ Latency: " << held.seen.size() << " batches\n";
+        return 1;
+    }
+    std::cout << "✓ A batch spans wakeups up to its latency\n";
+
+    append(a);
+    run_loop(watcher, 40);
+    watcher.remove_watch(kDir);
+    run_loop(watcher, 200);
+    if (held.seen.size() != 1) {
+        std::cout << "✗ Open batch delivered after remove_watch()\n";
+        return 1;
+    }
+    std::cout << "✓ remove_watch() drops the open batch\n";
+
+    // A drain() user has no worker to flush on exit: the watcher going
+    // away must still deliver what its batches hold.
+    Batches last;
+    {
+        FileWatcherAPI::FileWatcher closing;
+        closing.add_batch_watch(kDir, std::ref(last), IN_MODIFY, {.max_latency = std::chrono::seconds(60)});
+        append(a);
+        run_loop(closing, 40);
+        if (!last.seen.empty()) {
+            std::cout << "✗ Batch delivered before its latency\n";
+            return 1;
+        }
+    }
+    if (last.seen.size() != 1 || last.seen[0].size() != 1) {
+        std::cout << "✗ Open batch lost with the watcher\n";
+        return 1;
+    }
+    std::cout << "✓ Destroying a drain() watcher delivers its open batches\n";
+
+    unlink(a.c_str());
+    rmdir(kDir.c_str());
+    std::cout << "All tests passed!\n";
+    return 0;
+}
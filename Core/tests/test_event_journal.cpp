@@ -0,0 +1,177 @@
+#include "../src/filewatcher/event_journal.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const std::string kTree = "test_data/journal_tree";
+const std::string kSub = kTree + "/sub";
+const char* kJournal = "test_data/filewatcher.journal";
+
+void write_file(const std::string& path, const char* text) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << text;
+}
+
+// Every difference between `saved` and the tree as it is now, "name:mask".
+std::vector<std::string> missed(const FileWatcherAPI::DirectorySnapshot& saved, const std::string& dir) {
+    FileWatcherAPI::DirectorySnapshot now;
+    now.capture(dir);
+    std::vector<std::string> out;
+    saved.diff(now, [&](std::string_view name, std::uint32_t mask) {
+        out.push_back(std::string{name} + ":" + std::to_string(mask & ~IN_ISDIR));
+    });
+    return out;
+}
+
+bool checkpoint(EventJournal& journal, const std::vector<std::pair<std::string, const FileWatcherAPI::DirectorySnapshot*>>& dirs) {
+    std::string error;
+    if (!journal.checkpoint(dirs, error)) {
+        std::cout << "  checkpoint: " << error << '\n';
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+// A journal reopened by the next run must give back the state as of the
+// last recorded event, so only changes made while nothing was watching
+// show up in the diff, and a damaged tail must cost only the damaged part.
+int main() {
+    std::cout << "Testing event journal...\n";
+
+    std::remove((kTree + "/a").c_str());
+    std::remove((kTree + "/b").c_str());
+    std::remove((kTree + "/c").c_str());
+    rmdir(kSub.c_str());
+    rmdir(kTree.c_str());
+    std::remove(kJournal);
+    mkdir(kTree.c_str(), 0755);
+    mkdir(kSub.c_str(), 0755);
+    write_file(kTree + "/a", "one");
+    write_file(kTree + "/b", "two");
+
+    FileWatcherAPI::DirectorySnapshot tree;
+    FileWatcherAPI::DirectorySnapshot sub;
+    tree.capture(kTree);
+    sub.capture(kSub);
+
+    std::string error;
+    EventJournal journal;
+    if (!journal.open(kJournal, error) || journal.saved_count() != 0 || journal.writable() ||
+        !journal.record_forget(kSub) || !checkpoint(journal, {{kTree, &tree}, {kSub, &sub}}) ||
+        !journal.writable()) {
+        std::cout << "✗ Cold start: " << error << '\n';
+        return 1;
+    }
+    std::cout << "✓ Cold start\n";
+
+    // Changes the watcher sees: recorded as they happen.
+    write_file(kTree + "/a", "one, longer");
+    write_file(kTree + "/c", "three");
+    std::remove((kTree + "/b").c_str());
+    for (const char* name : {"a", "b", "c"}) {
+        tree.refresh(kTree, name);
+        if (!journal.record_entry(kTree, name, IN_MODIFY, tree.find(name))) {
+            std::cout << "✗ Record " << name << '\n';
+            return 1;
+        }
+    }
+    if (!journal.record_forget(kSub) || journal.appended() != 4) {
+        std::cout << "✗ Record forget\n";
+        return 1;
+    }
+
+    // A change nobody sees: the watcher is gone.
+    journal.close();
+    write_file(kTree + "/c", "three, rewritten");
+
+    EventJournal next;
+    FileWatcherAPI::DirectorySnapshot saved;
+    if (!next.open(kJournal, error) || next.saved_count() != 1 || !next.take(kTree, saved)) {
+        std::cout << "✗ Reopen: " << error << '\n';
+        return 1;
+    }
+    const std::vector<std::string> changes = missed(saved, kTree);
+    if (changes.size() != 1 || changes[0] != "c:" + std::to_string(IN_MODIFY)) {
+        std::cout << "✗ Replay reported " << changes.size() << " changes\n";
+        return 1;
+    }
+    std::cout << "✓ Replay reports only what was missed\n";
+
+    // Tear the last record the way power loss might.
+    tree.capture(kTree);
+    if (!checkpoint(next, {{kTree, &tree}})) {
+        return 1;
+    }
+    write_file(kTree + "/a", "one, longer still");
+    tree.refresh(kTree, "a");
+    next.record_entry(kTree, "a", IN_MODIFY, tree.find("a"));
+    std::remove((kTree + "/c").c_str());
+    tree.refresh(kTree, "c");
+    next.record_entry(kTree, "c", IN_DELETE, nullptr);
+    next.close();
+
+    const int fd = open(kJournal, O_RDWR);
+    std::uint64_t tail = 0;
+    char byte = 0;
+    const bool torn = fd >= 0 && pread(fd, &tail, sizeof(tail), 16) == sizeof(tail) &&
+                      pread(fd, &byte, 1, static_cast<off_t>(tail - 1)) == 1 && (byte ^= 0x5a, true) &&
+                      pwrite(fd, &byte, 1, static_cast<off_t>(tail - 1)) == 1;
+    if (fd >= 0) {
+        close(fd);
+    }
+    EventJournal damaged;
+    if (!torn || !damaged.open(kJournal, error) || !damaged.take(kTree, saved)) {
+        std::cout << "✗ Open damaged journal: " << error << '\n';
+        return 1;
+    }
+    const std::vector<std::string> after_tear = missed(saved, kTree);
+    if (after_tear.size() != 1 || after_tear[0] != "c:" + std::to_string(IN_DELETE)) {
+        std::cout << "✗ Damaged record handling: " << after_tear.size() << " changes\n";
+        return 1;
+    }
+    std::cout << "✓ A torn record is dropped, earlier ones kept\n";
+
+    // A full log space asks for a checkpoint instead of growing.
+    damaged.set_log_space(256);
+    if (!checkpoint(damaged, {{kTree, &tree}})) {
+        return 1;
+    }
+    int accepted = 0;
+    while (accepted < 100 && damaged.record_entry(kTree, "a", IN_MODIFY, tree.find("a"))) {
+        ++accepted;
+    }
+    if (accepted == 0 || accepted == 100 || !checkpoint(damaged, {{kTree, &tree}}) || damaged.appended() != 0 ||
+        !damaged.record_entry(kTree, "a", IN_MODIFY, tree.find("a"))) {
+        std::cout << "✗ Full log space: " << accepted << " records\n";
+        return 1;
+    }
+    std::cout << "✓ Full log space\n";
+    damaged.close();
+
+    write_file(kJournal, "not a journal at all, but something the user cares about");
+    EventJournal foreign;
+    if (foreign.open(kJournal, error)) {
+        std::cout << "✗ Foreign file accepted\n";
+        return 1;
+    }
+    std::cout << "✓ Foreign file left alone\n";
+
+    std::remove(kJournal);
+    std::remove((kTree + "/a").c_str());
+    rmdir(kSub.c_str());
+    rmdir(kTree.c_str());
+
+    std::cout << "All tests passed!\n";
+    return 0;
+}
@@ -0,0 +1,229 @@
+#include "../src/filewatcherAPI/filewatcher_api.hpp"
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const std::string kDir = "test_data/event_loop";
+
+void touch(const std::string& path) {
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        (void)!write(fd, "x", 1);
+        close(fd);
+    }
+}
+
+// The smallest coroutine type that can co_await: starts at once, and
+// nobody waits for it.
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+Detached collect(FileWatcherAPI::FileWatcher& watcher, std::vector<std::string>& names, size_t count) {
+    while (names.size() < count) {
+        const FileWatcherAPI::OwnedFileEvent event = co_await watcher.next();
+        names.push_back(event.filename);
+    }
+}
+
+// Takes one event, then lets its thread start another.
+Detached take_one(FileWatcherAPI::FileWatcher& watcher, std::atomic<int>& taken, std::atomic<bool>& busy) {
+    co_await watcher.next();
+    taken.fetch_add(1);
+    busy.store(false);
+}
+
+// Waits for one event and records whether it was the closing one.
+Detached wait_closed(FileWatcherAPI::FileWatcher& watcher, int& result) {
+    const FileWatcherAPI::OwnedFileEvent event = co_await watcher.next();
+    result = (event.mask & IN_IGNORED) && event.path.empty() ? 1 : 2;
+}
+
+// Runs the caller's side of an event loop: poll, then drain.
+template <typename Done>
+bool run_loop(FileWatcherAPI::FileWatcher& watcher, Done done) {
+    for (int i = 0; i < 200 && !done(); ++i) {
+        struct pollfd pfd{watcher.fd(), POLLIN, 0};
+        if (poll(&pfd, 1, 10) > 0) {
+            watcher.drain();
+        }
+    }
+    return done();
+}
+
+} // namespace
+
+// FileWatcher without its worker thread: events must arrive through fd()
+// and drain() on the caller's thread, and a coroutine waiting on next()
+// must be resumed from drain() with the events of queued watches.
+int main() {
+    std::cout << "Testing external event loop integration...\n";
+    mkdir(kDir.c_str(), 0755);
+
+    FileWatcherAPI::FileWatcher watcher;
+    std::vector<std::string> seen;
+    if (!watcher.add_watch(kDir, [&seen](const FileWatcherAPI::FileEvent& event) {
+            seen.emplace_back(event.filename);
+        }, IN_CREATE)) {
+        std::cout << "✗ Add watch\n";
+        return 1;
+    }
+    if (watcher.drain() != 0) {
+        std::cout << "✗ drain() with nothing pending\n";
+        return 1;
+    }
+    touch(kDir + "/a");
+    if (!run_loop(watcher, [&] { return !seen.empty(); }) || seen[0] != "a") {
+        std::cout << "✗ Callback through drain()\n";
+        return 1;
+    }
+    std::cout << "✓ Callbacks run from drain() on the caller's thread\n";
+    watcher.remove_watch(kDir);
+
+    // A coroutine parks until the loop has something for it.
+    if (!watcher.add_queued_watch(kDir, IN_CLOSE_WRITE)) {
+        std::cout << "✗ Add queued watch\n";
+        return 1;
+    }
+    std::vector<std::string> names;
+    collect(watcher, names, 3);
+    if (!names.empty() || watcher.queued_count() != 0) {
+        std::cout << "✗ next() returned with nothing queued\n";
+        return 1;
+    }
+    for (const char* name : {"b", "c", "d"}) {
+        touch(kDir + "/" + name);
+    }
+    if (!run_loop(watcher, [&] { return names.size() == 3; }) || names[0] != "b" || names[2] != "d") {
+        std::cout << "✗ Coroutine saw " << names.size() << " events\n";
+        return 1;
+    }
+    std::cout << "✓ co_await next() resumes from drain()\n";
+
+    // Events that arrive before anyone waits are kept for the next await.
+    touch(kDir + "/e");
+    run_loop(watcher, [&] { return watcher.queued_count() == 1; });
+    names.clear();
+    collect(watcher, names, 1);
+    if (names.size() != 1 || names[0] != "e" || watcher.queued_count() != 0) {
+        std::cout << "✗ Queued event not delivered without suspending\n";
+        return 1;
+    }
+    std::cout << "✓ Queued events are taken without suspending\n";
+
+    // With start(), the worker hands events to parked coroutines while
+    // other threads' next() may find them queued: each must still be
+    // taken exactly once.
+    constexpr int kEvents = 300;
+    std::atomic<int> taken{0};
+    std::atomic<bool> done{false};
+    std::atomic<bool> busy[2] = {false, false};
+    watcher.start();
+    std::vector<std::thread> consumers;
+    for (auto& flag : busy) {
+        consumers.emplace_back([&] {
+            while (!done) {
+                if (!flag.exchange(true)) {
+                    take_one(watcher, taken, flag);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (int i = 0; i < kEvents; ++i) {
+        touch(kDir + "/race_" + std::to_string(i));
+    }
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (taken < kEvents && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    done = true;
+    for (auto& consumer : consumers) {
+        consumer.join();
+    }
+    const int raced = taken.load();
+    // Release whatever is still parked before the watcher goes.
+    for (int i = 0; (busy[0] || busy[1]) && i < 200; ++i) {
+        touch(kDir + "/race_" + std::to_string(i));
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    watcher.stop();
+    if (raced != kEvents || busy[0] || busy[1]) {
+        std::cout << "✗ Concurrent next(): " << raced << " of " << kEvents << " events\n";
+        return 1;
+    }
+    std::cout << "✓ Concurrent next() takes each event once\n";
+
+    // A coroutine still parked when its watcher goes away is ended, not
+    // left holding a handle nobody will resume.
+    int closed = 0;
+    {
+        FileWatcherAPI::FileWatcher closing;
+        closing.add_queued_watch(kDir, IN_CLOSE_WRITE);
+        wait_closed(closing, closed);
+        if (closed != 0) {
+            std::cout << "✗ next() returned with nothing queued\n";
+            return 1;
+        }
+    }
+    if (closed != 1) {
+        std::cout << "✗ Parked coroutine " << (closed ? "got a real event" : "never resumed") << " on close\n";
+        return 1;
+    }
+    std::cout << "✓ Destroying the watcher ends parked coroutines with IN_IGNORED\n";
+
+    // The worker blocks in epoll_wait with no timeout, and stop() wakes it
+    // through the eventfd instead of waiting out a poll interval.
+    {
+        FileWatcherAPI::FileWatcher idle;
+        idle.add_watch(kDir, [](const FileWatcherAPI::FileEvent&) {}, IN_CLOSE_WRITE);
+        idle.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        struct rusage before;
+        struct rusage after;
+        getrusage(RUSAGE_SELF, &before);
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        getrusage(RUSAGE_SELF, &after);
+        const auto start = std::chrono::steady_clock::now();
+        idle.stop();
+        const auto took = std::chrono::steady_clock::now() - start;
+        // One switch is this thread's own sleep.
+        if (after.ru_nvcsw - before.ru_nvcsw > 2 || took > std::chrono::milliseconds(100)) {
+            std::cout << "✗ Idle worker: " << after.ru_nvcsw - before.ru_nvcsw << " wakeups, stop() took "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(took).count() << " ms\n";
+            return 1;
+        }
+    }
+    std::cout << "✓ An idle worker does not wake up, and stop() ends it at once\n";
+
+    watcher.remove_watch(kDir);
+    for (const char* name : {"a", "b", "c", "d", "e"}) {
+        unlink((kDir + "/" + name).c_str());
+    }
+    for (int i = 0; i < kEvents; ++i) {
+        unlink((kDir + "/race_" + std::to_string(i)).c_str());
+    }
+    rmdir(kDir.c_str());
+
+    std::cout << "All tests passed!\n";
+    return 0;
+}
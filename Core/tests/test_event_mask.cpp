@@ -0,0 +1,132 @@
+#include "../src/filewatcherAPI/filewatcher_api.hpp"
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+using FileWatcherAPI::EventSet;
+using FileWatcherAPI::EventType;
+
+constexpr uint32_t parsed(std::string_view list) {
+    uint32_t mask = 0;
+    return FileWatcherAPI::parse_event_mask(list, mask) ? mask : 0;
+}
+
+// Parsing is exact per token and usable at compile time.
+static_assert(parsed("modify,create") == (IN_MODIFY | IN_CREATE));
+static_assert(parsed("close_write|moved_to") == (IN_CLOSE_WRITE | IN_MOVED_TO));
+static_assert(parsed("move") == IN_MOVE);
+static_assert(parsed("moved") == 0 && parsed("modifyy") == 0 && parsed("") == 0 && parsed(",") == 0);
+static_assert(parsed("all") == IN_ALL_EVENTS);
+
+// Both halves of a rename decode to MOVE; flags outside the table vanish.
+static_assert(EventSet::from_mask(IN_MOVED_FROM) == EventSet{}.add(EventType::MOVE));
+static_assert(EventSet::from_mask(IN_MODIFY | IN_ATTRIB | IN_ISDIR).size() == 2);
+static_assert(EventSet::from_mask(IN_ATTRIB | IN_MODIFY).first() == EventType::MODIFY);
+static_assert(EventSet::from_mask(IN_IGNORED | IN_Q_OVERFLOW).empty());
+static_assert(EventSet::from_mask(IN_ALL_EVENTS).size() == FileWatcherAPI::kEventTypeCount);
+static_assert(EventSet::from_mask(IN_ALL_EVENTS).mask() == IN_ALL_EVENTS);
+
+void touch(const std::string& path) {
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        (void)!write(fd, "x", 1);
+        close(fd);
+    }
+}
+
+template <typename Predicate>
+bool wait_until(Predicate predicate) {
+    for (int i = 0; i < 200 && !predicate(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return predicate();
+}
+
+} // namespace
+
+// A multi-bit event must reach one handler per type, each seeing its own
+// valid EventType, and a live watch must never report an out-of-range type.
+int main() {
+    std::cout << "Testing event masks and dispatch...\n";
+
+    int modify = 0;
+    int attrib = 0;
+    bool types_match = true;
+    FileWatcherAPI::EventDispatch dispatch;
+    dispatch.on(EventType::MODIFY, [&](const FileWatcherAPI::FileEvent& event) {
+        ++modify;
+        types_match &= event.type == EventType::MODIFY;
+    });
+    dispatch.on(EventType::ATTRIB, [&](const FileWatcherAPI::FileEvent& event) {
+        ++attrib;
+        types_match &= event.type == EventType::ATTRIB;
+    });
+    if (dispatch.mask() != (IN_MODIFY | IN_ATTRIB)) {
+        std::cout << "✗ Dispatch mask\n";
+        return 1;
+    }
+
+    // Formatting gives back a list the parser reads as the same types.
+    std::string list;
+    FileWatcherAPI::format_event_mask(IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_ISDIR, list);
+    if (list != "modify,move,close_write" || parsed(list) != (IN_MODIFY | IN_MOVE | IN_CLOSE_WRITE)) {
+        std::cout << "✗ format_event_mask() gave \"" << list << "\"\n";
+        return 1;
+    }
+    std::cout << "✓ format_event_mask() round-trips through parse_event_mask()\n";
+    const uint32_t mask = IN_MODIFY | IN_ATTRIB | IN_CREATE;
+    dispatch(FileWatcherAPI::FileEvent{"/x", "y", EventType::MODIFY, mask, EventSet::from_mask(mask)});
+    if (modify != 1 || attrib != 1 || !types_match) {
+        std::cout << "✗ Multi-bit event dispatched " << modify << "/" << attrib << '\n';
+        return 1;
+    }
+    std::cout << "✓ Multi-bit events reach one handler per type\n";
+
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        return 1;
+    }
+    const std::string base = std::string{cwd} + "/test_data/event_mask";
+    mkdir((std::string{cwd} + "/test_data").c_str(), 0755);
+    mkdir(base.c_str(), 0755);
+
+    std::atomic<int> created{0};
+    std::atomic<int> deleted{0};
+    std::atomic<bool> valid{true};
+    FileWatcherAPI::FileWatcher watcher;
+    FileWatcherAPI::EventDispatch handlers;
+    handlers.on(EventType::CREATE, [&](const FileWatcherAPI::FileEvent& event) {
+        created.fetch_add(1);
+        valid = valid && event.filename == "f" && event.types.contains(EventType::CREATE);
+    });
+    handlers.on(EventType::DELETE, [&](const FileWatcherAPI::FileEvent&) { deleted.fetch_add(1); });
+    const uint32_t events = handlers.mask();
+    if (!watcher.add_watch(base, std::move(handlers), events)) {
+        std::cout << "✗ add_watch with an EventDispatch\n";
+        return 1;
+    }
+    watcher.start();
+
+    touch(base + "/f");
+    unlink((base + "/f").c_str());
+    if (!wait_until([&] { return created.load() == 1 && deleted.load() == 1; }) || !valid) {
+        std::cout << "✗ Live dispatch: " << created.load() << " created, " << deleted.load() << " deleted\n";
+        return 1;
+    }
+    std::cout << "✓ Live events routed by type\n";
+
+    watcher.stop();
+    if (FileWatcherAPI::event_type_to_string(EventType::CLOSE_WRITE) != "CLOSE_WRITE") {
+        std::cout << "✗ event_type_to_string\n";
+        return 1;
+    }
+    std::cout << "All tests passed!\n";
+    return 0;
+}
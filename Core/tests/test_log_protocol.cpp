@@ -0,0 +1,180 @@
+#include "../src/logger/log_protocol.hpp"
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+LogFrameHeader frame(std::uint32_t pid, LogLevel level, std::uint64_t timestamp_ns = 0) {
+    LogFrameHeader header{};
+    header.timestamp_ns = timestamp_ns;
+    header.pid = pid;
+    header.level = static_cast<std::uint8_t>(level);
+    return header;
+}
+
+void append_frame(std::string& packet, LogFrameHeader header, std::string_view payload) {
+    header.length = static_cast<std::uint16_t>(payload.size());
+    packet.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    packet.append(payload);
+}
+
+} // namespace
+
+// Frames must decode exactly as they were packed, and the shared ring must
+// keep order and content across many wrap-arounds of its slots, refuse what
+// does not fit, and only ask for a wakeup once per drain.
+int main() {
+    std::cout << "Testing log protocol...\n";
+
+    // Three frames back to back, then a header whose payload was cut off.
+    {
+        std::string packet;
+        append_frame(packet, frame(1, LogLevel::INFO, 42), "first");
+        append_frame(packet, frame(2, LogLevel::ERROR), "");
+        append_frame(packet, frame(3, LogLevel::DEBUG), std::string(kLogMaxMessage, 'x'));
+        const size_t whole = packet.size();
+        append_frame(packet, frame(4, LogLevel::INFO), "truncated");
+        packet.resize(whole + sizeof(LogFrameHeader) + 3);
+
+        std::vector<std::pair<LogFrameHeader, std::string>> seen;
+        for_each_frame(packet, [&](const LogFrameHeader& header, std::string_view payload) {
+            seen.emplace_back(header, std::string{payload});
+        });
+        if (seen.size() != 3 || seen[0].first.pid != 1 || seen[0].first.timestamp_ns != 42 ||
+            seen[0].second != "first" || seen[1].first.level != static_cast<std::uint8_t>(LogLevel::ERROR) ||
+            !seen[1].second.empty() || seen[2].second != std::string(kLogMaxMessage, 'x')) {
+            std::cout << "✗ Decoded " << seen.size() << " frames\n";
+            return 1;
+        }
+    }
+    std::cout << "✓ Frames decode as packed; a cut-off frame is dropped\n";
+
+    constexpr std::uint32_t kSlots = 8;
+    std::vector<std::uint64_t> memory((SharedLogRing::bytes_for(kSlots) + 7) / 8);
+    const size_t bytes = memory.size() * 8;
+    SharedLogRing* ring = SharedLogRing::create(memory.data(), kSlots);
+
+    // attach() takes only a well-formed header within the mapped size.
+    {
+        std::uint32_t slot_count = 0;
+        if (SharedLogRing::attach(memory.data(), bytes, slot_count) != ring || slot_count != kSlots ||
+            SharedLogRing::attach(memory.data(), SharedLogRing::bytes_for(kSlots) - 1, slot_count) != nullptr) {
+            std::cout << "✗ attach() on a valid ring\n";
+            return 1;
+        }
+        std::vector<std::uint64_t> bad(memory.size());
+        SharedLogRing::create(bad.data(), 6);
+        std::vector<std::uint64_t> zeroed(memory.size());
+        if (SharedLogRing::attach(bad.data(), bytes, slot_count) != nullptr ||
+            SharedLogRing::attach(zeroed.data(), bytes, slot_count) != nullptr) {
+            std::cout << "✗ attach() accepted a malformed ring\n";
+            return 1;
+        }
+    }
+    std::cout << "✓ attach() rejects bad magic, odd slot counts and short mappings\n";
+
+    // Fill, refuse, drain, many times over: positions run far past the slot
+    // count and every line comes back in order with its own header.
+    {
+        std::uint32_t slot_count = 0;
+        SharedLogRing::attach(memory.data(), bytes, slot_count);
+        bool wake = false;
+        if (ring->push(frame(1, LogLevel::INFO), std::string(SharedLogRing::kSlotPayload + 1, 'x'), wake)) {
+            std::cout << "✗ Oversized line accepted\n";
+            return 1;
+        }
+        std::uint32_t next = 0;
+        std::uint32_t expected = 0;
+        for (int round = 0; round < 50; ++round) {
+            const int batch = 1 + round % static_cast<int>(kSlots);
+            int wakes = 0;
+            for (int i = 0; i < batch; ++i, ++next) {
+                const std::string line = "line " + std::to_string(next);
+                if (!ring->push(frame(next, LogLevel::INFO, next), line, wake)) {
+                    std::cout << "✗ push() refused line " << next << " of a ring with room\n";
+                    return 1;
+                }
+                wakes += wake;
+            }
+            // A full ring refuses, and the watermark (kSlots / 4) asks for
+            // one wakeup until the next drain.
+            if ((batch == static_cast<int>(kSlots) && ring->push(frame(0, LogLevel::INFO), "extra", wake)) ||
+                wakes != (batch >= static_cast<int>(kSlots / 4) ? 1 : 0)) {
+                std::cout << "✗ Round " << round << ": " << wakes << " wakeups\n";
+                return 1;
+            }
+            bool in_order = true;
+            const size_t drained = ring->drain(slot_count, [&](const LogFrameHeader& header, std::string_view payload) {
+                in_order = in_order && header.pid == expected && header.timestamp_ns == expected &&
+                           payload == "line " + std::to_string(expected);
+                ++expected;
+            });
+            if (!in_order || drained != static_cast<size_t>(batch) || !ring->empty()) {
+                std::cout << "✗ Round " << round << " drained " << drained << " of " << batch << "\n";
+                return 1;
+            }
+        }
+    }
+    std::cout << "✓ The ring wraps around many times keeping order and content\n";
+
+    // An ERROR line asks for a wakeup on its own.
+    {
+        std::uint32_t slot_count = 0;
+        SharedLogRing::attach(memory.data(), bytes, slot_count);
+        bool wake = false;
+        ring->push(frame(1, LogLevel::ERROR), "boom", wake);
+        const bool error_wakes = wake;
+        ring->push(frame(1, LogLevel::ERROR), "boom", wake);
+        if (!error_wakes || wake || ring->drain(slot_count, [](const LogFrameHeader&, std::string_view) {}) != 2) {
+            std::cout << "✗ ERROR line did not wake the daemon exactly once\n";
+            return 1;
+        }
+    }
+    std::cout << "✓ An ERROR line wakes the daemon once\n";
+
+    // Several producers against one consumer: nothing lost or reordered
+    // within a producer.
+    {
+        constexpr int kProducers = 4;
+        constexpr std::uint32_t kPerProducer = 20000;
+        std::uint32_t slot_count = 0;
+        SharedLogRing::attach(memory.data(), bytes, slot_count);
+        std::vector<std::thread> producers;
+        for (int p = 0; p < kProducers; ++p) {
+            producers.emplace_back([ring, p] {
+                bool wake = false;
+                for (std::uint32_t i = 0; i < kPerProducer; ++i) {
+                    const std::string line = std::to_string(i);
+                    while (!ring->push(frame(static_cast<std::uint32_t>(p), LogLevel::INFO, i), line, wake)) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        std::vector<std::uint32_t> next(kProducers, 0);
+        bool in_order = true;
+        size_t total = 0;
+        while (total < kProducers * kPerProducer) {
+            total += ring->drain(slot_count, [&](const LogFrameHeader& header, std::string_view payload) {
+                std::uint32_t& expected = next[header.pid];
+                in_order = in_order && header.timestamp_ns == expected && payload == std::to_string(expected);
+                ++expected;
+            });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        if (!in_order || !ring->empty()) {
+            std::cout << "✗ Concurrent producers: lines lost or out of order\n";
+            return 1;
+        }
+    }
+    std::cout << "✓ Concurrent producers lose and reorder nothing\n";
+
+    std::cout << "All tests passed!\n";
+    return 0;
+}
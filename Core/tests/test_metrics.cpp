@@ -0,0 +1,128 @@
+#include "../src/metrics/metrics.hpp"
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+// Percentiles must stay within the histogram's 1/16 relative error of the
+// exact answer, sharded counters must not lose increments, and the text
+// formats must round-trip through the socket and the file.
+int main() {
+    std::cout << "Testing metrics...\n";
+
+    for (std::uint64_t value : {0ull, 1ull, 31ull, 32ull, 33ull, 1000ull, 123456789ull, ~0ull}) {
+        const std::size_t bucket = LatencyHistogram::bucket_of(value);
+        const std::uint64_t upper = LatencyHistogram::bucket_upper_bound(bucket);
+        if (bucket >= LatencyHistogram::kBucketCount || upper < value || upper - value > value / 16 ||
+            (bucket > 0 && LatencyHistogram::bucket_upper_bound(bucket - 1) >= value)) {
+            std::cout << "✗ Bucket bounds for " << value << '\n';
+            return 1;
+        }
+    }
+
+    LatencyHistogram histogram;
+    std::vector<std::uint64_t> values;
+    std::mt19937_64 random(42);
+    std::lognormal_distribution<double> latency(7.0, 1.5);   // ~1 ms median, long tail
+    for (int i = 0; i < 100000; ++i) {
+        values.push_back(static_cast<std::uint64_t>(latency(random)));
+        histogram.record(values.back());
+    }
+    std::sort(values.begin(), values.end());
+    for (const double q : {0.5, 0.9, 0.99, 0.999, 1.0}) {
+        const std::uint64_t exact = values[static_cast<std::size_t>(q * static_cast<double>(values.size() - 1))];
+        const std::uint64_t reported = histogram.percentile(q);
+        if (reported < exact || reported - exact > exact / 16 + 1) {
+            std::cout << "✗ p" << q * 100 << ": " << reported << " vs exact " << exact << '\n';
+            return 1;
+        }
+    }
+    if (histogram.count() != values.size() || histogram.max() != values.back()) {
+        std::cout << "✗ Histogram count/max\n";
+        return 1;
+    }
+    std::cout << "✓ Percentiles within 1/16 of exact\n";
+
+    ShardedCounter counter;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 12; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 100000; ++i) {
+                counter.add();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (counter.value() != 1200000) {
+        std::cout << "✗ Sharded counter lost increments: " << counter.value() << '\n';
+        return 1;
+    }
+    std::cout << "✓ Sharded counter\n";
+
+    std::atomic<std::uint64_t> events{7};
+    const std::uint64_t depth = 3;
+    MetricsRegistry registry;
+    registry.add_counter("test_events_total", "Events.", events);
+    registry.add_gauge("test_depth", "Depth.", &depth,
+                       [](const void* object) { return *static_cast<const std::uint64_t*>(object); });
+    registry.add_histogram("test_latency_seconds", "Latency.", histogram);
+
+    std::string text;
+    registry.render_prometheus(text);
+    for (const char* expected : {"# TYPE test_events_total counter\ntest_events_total 7\n",
+                                 "# TYPE test_depth gauge\ntest_depth 3\n",
+                                 "# TYPE test_latency_seconds summary\n",
+                                 "test_latency_seconds{quantile=\"0.99\"} ",
+                                 "test_latency_seconds_count 100000\n"}) {
+        if (text.find(expected) == std::string::npos) {
+            std::cout << "✗ Prometheus text lacks: " << expected << '\n' << text;
+            return 1;
+        }
+    }
+    std::cout << "✓ Prometheus rendering\n";
+
+    const std::string name = "aurora_metrics_test_" + std::to_string(getpid());
+    StatsEndpoint endpoint;
+    if (!endpoint.listen(name)) {
+        std::cout << "✗ Listen on @" << name << '\n';
+        return 1;
+    }
+    std::string reply;
+    std::thread client([&] { (void)StatsEndpoint::query(name, reply); });
+    for (int i = 0; i < 100 && reply.empty(); ++i) {
+        endpoint.serve(registry);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    client.join();
+    if (reply != text) {
+        std::cout << "✗ Socket reply differs from the rendered text\n";
+        return 1;
+    }
+
+    const char* path = "test_data/metrics.prom";
+    events = 8;
+    if (!registry.write_file(path)) {
+        std::cout << "✗ write_file\n";
+        return 1;
+    }
+    std::ifstream file(path);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    if (contents.str().find("test_events_total 8\n") == std::string::npos || access("test_data/metrics.prom.tmp", F_OK) == 0) {
+        std::cout << "✗ Stats file contents\n";
+        return 1;
+    }
+    std::remove(path);
+    std::cout << "✓ Socket and file exposition\n";
+
+    std::cout << "All tests passed!\n";
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include "../src/mixer/mixer_paths.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+std::string read_file(const char* path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+void write_file(const char* path, const std::string& text) {
+    std::ofstream(path, std::ios::binary) << text;
+}
+
+const MixerDifference* find_difference(const std::vector<MixerDifference>& differences, std::string_view path) {
+    for (const auto& difference : differences) {
+        if (difference.path == path) {
+            return &difference;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+// The index must cover the module's real mixer paths, patches must touch
+// only the values they change plus one insertion per path, and diff must
+// report exactly what differs.
+int main() {
+    std::cout << "Testing mixer paths...\n";
+
+    const char* path = "test_data/mixer_paths.xml";
+    const std::string original = read_file(MIXER_PATHS_XML);
+    write_file(path, original);
+    chmod(path, 0640);
+
+    MixerDocument document;
+    std::string error;
+    if (!document.open(path, error)) {
+        std::cout << "✗ Open: " << error << '\n';
+        return 1;
+    }
+    const MixerPath* speaker = document.find_path("speaker");
+    const MixerPath* initial = document.find_path("");
+    std::vector<const MixerCtl*> controls;
+    if (!speaker || !initial || initial->count != 408 || speaker->line != 2795 ||
+        document.entries()[speaker->first].name != "WSA_CDC_DMA_RX_0 Channels" ||
+        document.entries()[speaker->first].value != "Two" ||
+        document.duplicates() != std::vector<std::string_view>{"audio-record-compress2 bt-sco-wb"}) {
+        std::cout << "✗ Index of mixer_paths.xml\n";
+        return 1;
+    }
+    if (!document.resolve("echo-reference headphones", controls, error) || controls.empty() ||
+        document.resolve("missing", controls, error)) {
+        std::cout << "✗ Resolve: " << error << '\n';
+        return 1;
+    }
+    std::cout << "✓ Index and resolve\n";
+
+    const std::string patch_set =
+        "# speaker gain overrides\n"
+        "[speaker]\n"
+        "WSA_COMP1 Switch = 0\n"
+        "RX_RX0 Digital Volume = 90\n"
+        "WSA_CDC_DMA_RX_0 Channels = Two\n"
+        "\n"
+        "[]\n"
+        "Voice Rx Gain[2] = 25\n";
+    if (document.apply("[nope]\nx = 1\n", "bad.patch", error) || error.rfind("bad.patch:2: ", 0) != 0 ||
+        document.apply("[speaker]\nx = \"1\n", "bad.patch", error) || document.dirty()) {
+        std::cout << "✗ Bad patch set accepted: " << error << '\n';
+        return 1;
+    }
+    if (!document.apply(patch_set, "speaker.patch", error)) {
+        std::cout << "✗ Apply: " << error << '\n';
+        return 1;
+    }
+    // Unchanged values are not patched: one value in the initial settings,
+    // one in speaker, one insertion into speaker.
+    const std::vector<SplicePatch> patches = document.pending();
+    if (patches.size() != 3 || patches[0].text != "25" || patches[1].text != "0" || patches[2].length != 0 ||
+        patches[2].text != "\n        <ctl name=\"RX_RX0 Digital Volume\" value=\"90\" />" || !document.commit(error)) {
+        std::cout << "✗ Patches: " << error << '\n';
+        return 1;
+    }
+    std::string expected = original;
+    const std::size_t insert = original.find("\n", original.find("<path name=\"speaker\">"));
+    const std::size_t speaker_end = original.find("    </path>", insert);
+    expected.insert(speaker_end - 1, "\n        <ctl name=\"RX_RX0 Digital Volume\" value=\"90\" />");
+    expected.replace(expected.find("\"WSA_COMP1 Switch\" value=\"1\"", insert), 28, "\"WSA_COMP1 Switch\" value=\"0\"");
+    expected.replace(expected.find("\"Voice Rx Gain\" id=\"2\" value=\"20\""), 33,
+                     "\"Voice Rx Gain\" id=\"2\" value=\"25\"");
+    struct stat st;
+    if (read_file(path) != expected || stat(path, &st) != 0 || (st.st_mode & 0777) != 0640 ||
+        access("test_data/mixer_paths.xml.tmp", F_OK) == 0) {
+        std::cout << "✗ Patched file differs outside the edited values\n";
+        return 1;
+    }
+    std::cout << "✓ Byte-range patches\n";
+
+    MixerDocument before;
+    std::vector<MixerDifference> differences;
+    if (!before.open(MIXER_PATHS_XML, error)) {
+        std::cout << "✗ Open: " << error << '\n';
+        return 1;
+    }
+    diff_mixer_paths(before, before, differences);
+    const bool identical = differences.empty();
+    diff_mixer_paths(before, document, differences);
+    const MixerDifference* changed = find_difference(differences, "speaker");
+    if (!identical || differences.size() != 2 || !changed ||
+        changed->details != std::vector<std::string>{"WSA_COMP1 Switch: 1 -> 0", "+ RX_RX0 Digital Volume = 90"} ||
+        !find_difference(differences, "")) {
+        std::cout << "✗ Diff after patch\n";
+        return 1;
+    }
+
+    MixerDocument cdp;
+    if (!cdp.open(MIXER_PATHS_CDP_XML, error)) {
+        std::cout << "✗ Open: " << error << '\n';
+        return 1;
+    }
+    diff_mixer_paths(before, cdp, differences);
+    std::size_t added = 0;
+    std::size_t removed = 0;
+    for (const auto& difference : differences) {
+        added += difference.kind == MixerDifference::Kind::Added;
+        removed += difference.kind == MixerDifference::Kind::Removed;
+    }
+    if (differences.empty() || added + removed == differences.size() || find_difference(differences, "speaker")) {
+        std::cout << "✗ Diff against mixer_paths_cdp.xml\n";
+        return 1;
+    }
+    std::cout << "✓ Diff\n";
+
+    write_file(path, "<mixer>\n<path name=\"a\">\n<ctl name=\"x\" id=\"one\" value=\"1\" />\n</path>\n</mixer>\n");
+    if (document.open(path, error) || error.find(":3: ") == std::string::npos) {
+        std::cout << "✗ Malformed control accepted: " << error << '\n';
+        return 1;
+    }
+    std::remove(path);
+    std::cout << "✓ Malformed input rejected\n";
+
+    std::cout << "All tests passed!\n";
+    return 0;
+}
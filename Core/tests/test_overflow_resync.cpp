@@ -0,0 +1,146 @@
+#include "../src/filewatcherAPI/filewatcher_api.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const std::string kDir = "test_data/overflow_resync";
+constexpr int kFiles = 64;
+constexpr int kLate = 10;
+
+// Events per file name.
+class Counter {
+public:
+    void operator()(const FileWatcherAPI::FileEvent& event) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++counts_[std::string{event.filename}];
+    }
+
+    int count(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = counts_.find(name);
+        return it != counts_.end() ? it->second : 0;
+    }
+
+private:
+    std::mutex mutex_;
+    std::map<std::string, int> counts_;
+};
+
+std::string file(const std::string& name) {
+    return kDir + "/" + name;
+}
+
+void append(const std::string& path) {
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        (void)!write(fd, "x", 1);
+        close(fd);
+    }
+}
+
+// The kernel's per-instance queue limit: inotify drops what comes after it.
+int max_queued_events() {
+    std::ifstream in("/proc/sys/fs/inotify/max_queued_events");
+    int limit = 16384;
+    in >> limit;
+    return limit;
+}
+
+void cleanup() {
+    for (int i = 0; i < kFiles; ++i) {
+        unlink(file("f_" + std::to_string(i)).c_str());
+    }
+    for (int i = 0; i < kLate; ++i) {
+        unlink(file("late_" + std::to_string(i)).c_str());
+    }
+    unlink(file("quiet").c_str());
+    rmdir(kDir.c_str());
+}
+
+} // namespace
+
+// Events past the inotify queue limit are lost; the watcher must notice
+// the overflow, rescan, and report what it missed exactly once, without
+// repeating what it had already delivered.
+int main() {
+    std::cout << "Testing overflow resync...\n";
+    cleanup();
+    mkdir(kDir.c_str(), 0755);
+    for (int i = 0; i < kFiles; ++i) {
+        append(file("f_" + std::to_string(i)));
+    }
+    append(file("quiet"));
+
+    FileWatcherAPI::FileWatcher watcher;
+    Counter counter;
+    if (!watcher.add_watch(kDir, std::ref(counter), IN_MODIFY | IN_CREATE)) {
+        std::cout << "✗ Add watch\n";
+        return 1;
+    }
+
+    // With the reader stopped, writes round-robin over the files (so
+    // inotify cannot merge them) until the queue has overflowed, then
+    // changes that can only be found by the rescan.
+    const int rounds = max_queued_events() / kFiles + 8;
+    for (int round = 0; round < rounds; ++round) {
+        for (int i = 0; i < kFiles; ++i) {
+            append(file("f_" + std::to_string(i)));
+        }
+    }
+    for (int i = 0; i < kLate; ++i) {
+        append(file("late_" + std::to_string(i)));
+    }
+    append(file("quiet"));
+
+    watcher.start();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (watcher.resync_count() == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    watcher.stop();
+
+    if (watcher.overflow_count() != 1 || watcher.resync_count() != 1) {
+        std::cout << "✗ Overflow not resynced: " << watcher.overflow_count() << " overflows, "
+                  << watcher.resync_count() << " resyncs\n";
+        return 1;
+    }
+    std::cout << "✓ IN_Q_OVERFLOW counted and followed by one resync\n";
+
+    for (int i = 0; i < kLate; ++i) {
+        if (counter.count("late_" + std::to_string(i)) != 1) {
+            std::cout << "✗ late_" << i << " reported " << counter.count("late_" + std::to_string(i)) << " times\n";
+            return 1;
+        }
+    }
+    if (counter.count("quiet") != 1) {
+        std::cout << "✗ Missed change reported " << counter.count("quiet") << " times\n";
+        return 1;
+    }
+    std::cout << "✓ Each missed change is reported once by the rescan\n";
+
+    // The queue held max_queued_events of the round-robin writes, all of
+    // them delivered; the rescan must not report those files again.
+    const int delivered = max_queued_events() / kFiles;
+    for (int i = 0; i < kFiles; ++i) {
+        const int count = counter.count("f_" + std::to_string(i));
+        if (count != delivered) {
+            std::cout << "✗ f_" << i << " reported " << count << " times, " << delivered << " queued\n";
+            return 1;
+        }
+    }
+    std::cout << "✓ Delivered changes are not repeated by the rescan\n";
+
+    cleanup();
+    std::cout << "All tests passed!\n";
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include "../src/filewatcherAPI/path_table.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+using FileWatcherAPI::PathTable;
+
+// Nodes must outlive their watch while a deeper one still needs their
+// name, go away with the last reference, and have their arena bytes
+// reclaimed without moving the paths of the nodes that remain.
+int main() {
+    std::cout << "Testing path table...\n";
+
+    PathTable table;
+    const auto root = table.add_root("/data/");
+    const auto etc = table.add_child(root, "etc");
+    const auto deep = table.add_child(etc, "audio");
+    if (table.path(deep) != "/data/etc/audio" || table.size() != 3 || !table.is_within(deep, root) ||
+        table.is_within(root, deep)) {
+        std::cout << "✗ Paths: \"" << table.path(deep) << "\"\n";
+        return 1;
+    }
+    std::cout << "✓ Paths are rebuilt from the components\n";
+
+    // etc's own watch goes first; audio still resolves through it.
+    table.release(etc);
+    if (!table.alive(etc) || table.path(deep) != "/data/etc/audio") {
+        std::cout << "✗ Parent released under a live child\n";
+        return 1;
+    }
+    table.release(deep);
+    if (table.alive(deep) || table.alive(etc) || !table.alive(root) || table.size() != 1) {
+        std::cout << "✗ Release left " << table.size() << " nodes\n";
+        return 1;
+    }
+    std::cout << "✓ A node lives exactly as long as its watch or a child needs it\n";
+
+    // Freed slots are reused.
+    const auto again = table.add_child(root, "vendor");
+    if (again != deep && again != etc) {
+        std::cout << "✗ Freed node not reused\n";
+        return 1;
+    }
+    table.release(again);
+
+    // Lots of dead names: the arena is compacted and survivors keep their paths.
+    const std::string long_name(64, 'n');
+    const auto keep = table.add_child(root, "keep");
+    std::vector<PathTable::NodeId> dead;
+    for (int i = 0; i < 200; ++i) {
+        dead.push_back(table.add_child(root, long_name + std::to_string(i)));
+    }
+    const size_t grown = table.arena_bytes();
+    for (const auto id : dead) {
+        table.release(id);
+    }
+    if (table.arena_bytes() * 4 > grown || table.path(keep) != "/data/keep" || table.path(root) != "/data/") {
+        std::cout << "✗ Compaction: " << grown << " -> " << table.arena_bytes() << " bytes\n";
+        return 1;
+    }
+    std::cout << "✓ Dead names are compacted away, live paths unchanged\n";
+
+    std::cout << "All tests passed!\n";
+    return 0;
+}
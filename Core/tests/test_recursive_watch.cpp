@@ -0,0 +1,146 @@
+#include "../src/filewatcherAPI/filewatcher_api.hpp"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const std::string kTree = "test_data/recursive_tree";
+const std::string kOutside = "test_data/recursive_outside";
+
+void touch(const std::string& path) {
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        (void)!write(fd, "x", 1);
+        close(fd);
+    }
+}
+
+// Every IN_CLOSE_WRITE as "path/filename".
+struct Written {
+    std::vector<std::string> files;
+
+    void operator()(const FileWatcherAPI::FileEvent& event) {
+        if (event.mask & IN_CLOSE_WRITE) {
+            files.push_back(std::string{event.path} + "/" + std::string{event.filename});
+        }
+    }
+
+    bool saw(const std::string& file) const {
+        for (const auto& seen : files) {
+            if (seen == file) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Polls and drains for `ms`, the way an application loop would.
+void run_loop(FileWatcherAPI::FileWatcher& watcher, int ms = 100) {
+    const auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while (std::chrono::steady_clock::now() < end) {
+        struct pollfd pfd{watcher.fd(), POLLIN, 0};
+        if (poll(&pfd, 1, 5) > 0) {
+            watcher.drain();
+        }
+    }
+}
+
+void remove_tree(const std::string& path) {
+    for (const char* file : {"/a/b/c/f", "/a/b/c/g", "/a2/b/c/f", "/a2/b/c/g", "/a2/b/c/h", "/x/y/f", "/x/f"}) {
+        unlink((path + file).c_str());
+    }
+    for (const char* dir : {"/a/b/c", "/a/b", "/a", "/a2/b/c", "/a2/b", "/a2", "/x/y/z", "/x/y", "/x"}) {
+        rmdir((path + dir).c_str());
+    }
+    rmdir(path.c_str());
+}
+
+} // namespace
+
+// A recursive watch must follow the tree as it changes: directories
+// created several levels at once, moved out (and no longer reported) and
+// moved back in under a new name, all within max_depth.
+int main() {
+    std::cout << "Testing recursive watches...\n";
+    remove_tree(kTree);
+    remove_tree(kOutside);
+    mkdir(kTree.c_str(), 0755);
+    mkdir(kOutside.c_str(), 0755);
+
+    FileWatcherAPI::FileWatcher watcher;
+    Written written;
+    if (!watcher.add_watch(kTree, std::ref(written), IN_CLOSE_WRITE, true) || watcher.watch_count() != 1) {
+        std::cout << "✗ Add recursive watch\n";
+        return 1;
+    }
+
+    // mkdir -p: b and c exist before the watch on a does.
+    mkdir((kTree + "/a").c_str(), 0755);
+    mkdir((kTree + "/a/b").c_str(), 0755);
+    mkdir((kTree + "/a/b/c").c_str(), 0755);
+    run_loop(watcher);
+    touch(kTree + "/a/b/c/f");
+    run_loop(watcher);
+    if (watcher.watch_count() != 4 || !written.saw(kTree + "/a/b/c/f")) {
+        std::cout << "✗ mkdir -p: " << watcher.watch_count() << " watches\n";
+        return 1;
+    }
+    std::cout << "✓ mkdir -p inside the tree is watched to the bottom\n";
+
+    // Moved out: its watches go, and nothing under it is reported.
+    rename((kTree + "/a").c_str(), (kOutside + "/a").c_str());
+    run_loop(watcher);
+    touch(kOutside + "/a/b/c/g");
+    run_loop(watcher);
+    if (watcher.watch_count() != 1 || written.files.size() != 1) {
+        std::cout << "✗ Moved-out directory still watched (" << watcher.watch_count() << " watches)\n";
+        return 1;
+    }
+    std::cout << "✓ A directory moved out of the tree is unwatched\n";
+
+    // Moved back under a new name: watched again, reported by that name.
+    rename((kOutside + "/a").c_str(), (kTree + "/a2").c_str());
+    run_loop(watcher);
+    touch(kTree + "/a2/b/c/h");
+    run_loop(watcher);
+    if (watcher.watch_count() != 4 || !written.saw(kTree + "/a2/b/c/h")) {
+        std::cout << "✗ Moved-in directory: " << watcher.watch_count() << " watches\n";
+        return 1;
+    }
+    std::cout << "✓ A directory moved back in is watched under its new path\n";
+    watcher.remove_watch(kTree);
+    run_loop(watcher);
+
+    // max_depth 1: the root's children, nothing below them, whether the
+    // directories were there first or came later.
+    mkdir((kTree + "/x").c_str(), 0755);
+    mkdir((kTree + "/x/y").c_str(), 0755);
+    Written shallow;
+    watcher.add_watch(kTree, std::ref(shallow), IN_CLOSE_WRITE, true, 1);
+    const size_t initial = watcher.watch_count();
+    mkdir((kTree + "/x/y/z").c_str(), 0755);
+    run_loop(watcher);
+    touch(kTree + "/x/f");
+    touch(kTree + "/x/y/f");
+    run_loop(watcher);
+    // The root, a2 and x.
+    if (initial != 3 || watcher.watch_count() != 3 || !shallow.saw(kTree + "/x/f") || shallow.files.size() != 1) {
+        std::cout << "✗ max_depth: " << initial << " then " << watcher.watch_count() << " watches\n";
+        return 1;
+    }
+    std::cout << "✓ max_depth bounds both the initial walk and new directories\n";
+    watcher.remove_watch(kTree);
+    run_loop(watcher);
+
+    remove_tree(kTree);
+    remove_tree(kOutside);
+    std::cout << "All tests passed!\n";
+    return 0;
+}
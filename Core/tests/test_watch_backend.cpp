@@ -0,0 +1,179 @@
+#include "../src/filewatcherAPI/filewatcher_api.hpp"
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+struct Seen {
+    std::string path;
+    std::string filename;
+    uint32_t mask;
+};
+
+class Recorder {
+public:
+    void operator()(const FileWatcherAPI::FileEvent& event) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        seen_.push_back({std::string{event.path}, std::string{event.filename}, event.mask});
+    }
+
+    // Waits for an event on `path`/`filename` with any of `mask`.
+    bool wait_for(const std::string& path, const std::string& filename, uint32_t mask) {
+        for (int i = 0; i < 200; ++i) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (const auto& seen : seen_) {
+                    if (seen.path == path && seen.filename == filename && (seen.mask & mask)) {
+                        return true;
+                    }
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return false;
+    }
+
+    size_t count() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return seen_.size();
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<Seen> seen_;
+};
+
+void touch(const std::string& path) {
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        (void)!write(fd, "x", 1);
+        close(fd);
+    }
+}
+
+// Filesystem marks the kernel holds for a fanotify fd.
+int filesystem_marks(int fd) {
+    std::ifstream info("/proc/self/fdinfo/" + std::to_string(fd));
+    int marks = 0;
+    for (std::string line; std::getline(info, line);) {
+        marks += line.rfind("fanotify sdev:", 0) == 0;
+    }
+    return marks;
+}
+
+} // namespace
+
+// The fanotify backend must deliver the same (path, filename, mask) events
+// as inotify through the same FileWatcher. Skipped without CAP_SYS_ADMIN.
+int main() {
+    std::cout << "Testing the fanotify watch backend...\n";
+
+    FileWatcherAPI::WatchBackend probe(FileWatcherAPI::BackendKind::FANOTIFY);
+    if (probe.fd() < 0) {
+        std::cout << "- fanotify unavailable here (needs root and Linux 5.9+), skipped\n";
+        return 0;
+    }
+
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        return 1;
+    }
+    const std::string base = std::string{cwd} + "/test_data/watch_backend";
+    for (const char* dir : {"/tree/a/b", "/tree/a/c"}) {
+        unlink((base + dir + "/f").c_str());
+        rmdir((base + dir).c_str());
+    }
+    mkdir((std::string{cwd} + "/test_data").c_str(), 0755);
+    mkdir(base.c_str(), 0755);
+    mkdir((base + "/tree").c_str(), 0755);
+    mkdir((base + "/tree/a").c_str(), 0755);
+    touch(base + "/single.conf");
+
+    FileWatcherAPI::FileWatcher watcher(FileWatcherAPI::BackendKind::FANOTIFY);
+    Recorder tree_events;
+    Recorder file_events;
+    if (watcher.backend() != FileWatcherAPI::BackendKind::FANOTIFY ||
+        !watcher.add_watch(base + "/tree", std::ref(tree_events), IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE, true) ||
+        !watcher.add_watch(base + "/single.conf", std::ref(file_events), IN_CLOSE_WRITE)) {
+        std::cout << "✗ add_watch on the fanotify backend\n";
+        return 1;
+    }
+    watcher.start();
+
+    touch(base + "/tree/a/f");
+    touch(base + "/single.conf");
+    if (!tree_events.wait_for(base + "/tree/a", "f", IN_CLOSE_WRITE) ||
+        !file_events.wait_for(base + "/single.conf", "", IN_CLOSE_WRITE)) {
+        std::cout << "✗ Directory and file watches\n";
+        return 1;
+    }
+    std::cout << "✓ Directory and file watches report like inotify\n";
+
+    // New subdirectories are followed, and a directory's own attribute
+    // change reaches its parent's watch by name through the handle cache.
+    mkdir((base + "/tree/a/b").c_str(), 0755);
+    if (!tree_events.wait_for(base + "/tree/a", "b", IN_CREATE)) {
+        std::cout << "✗ Subdirectory creation not reported\n";
+        return 1;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    touch(base + "/tree/a/b/f");
+    chmod((base + "/tree/a/b").c_str(), 0700);
+    if (!tree_events.wait_for(base + "/tree/a/b", "f", IN_CLOSE_WRITE) ||
+        !tree_events.wait_for(base + "/tree/a", "b", IN_ATTRIB) || watcher.watch_count() != 4) {
+        std::cout << "✗ New subdirectory not followed (" << watcher.watch_count() << " watches)\n";
+        return 1;
+    }
+    std::cout << "✓ Recursive watch follows the tree\n";
+
+    // A renamed directory is found under its new name.
+    rename((base + "/tree/a/b").c_str(), (base + "/tree/a/c").c_str());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    chmod((base + "/tree/a/c").c_str(), 0755);
+    if (!tree_events.wait_for(base + "/tree/a", "c", IN_ATTRIB)) {
+        std::cout << "✗ Renamed directory reported under a stale name\n";
+        return 1;
+    }
+    std::cout << "✓ A directory move invalidates its cached path\n";
+
+    // Unrelated activity on the same filesystem is filtered out.
+    const size_t before = tree_events.count() + file_events.count();
+    touch(base + "/unwatched");
+    watcher.remove_watch(base + "/tree");
+    touch(base + "/tree/a/f");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    if (tree_events.count() + file_events.count() != before || watcher.watch_count() != 1) {
+        std::cout << "✗ Events outside the watches were delivered\n";
+        return 1;
+    }
+    std::cout << "✓ Only watched paths are reported\n";
+
+    watcher.stop();
+    unlink((base + "/unwatched").c_str());
+
+    // The kernel mark goes with the last watch, even when the path the
+    // first watch was added by no longer exists.
+    FileWatcherAPI::WatchBackend backend(FileWatcherAPI::BackendKind::FANOTIFY);
+    mkdir((base + "/first").c_str(), 0755);
+    const int first = backend.add_watch((base + "/first").c_str(), IN_CREATE);
+    const int second = backend.add_watch((base + "/tree").c_str(), IN_CREATE);
+    rmdir((base + "/first").c_str());
+    backend.remove_watch(first);
+    backend.remove_watch(second);
+    if (first < 0 || second < 0 || filesystem_marks(backend.fd()) != 0) {
+        std::cout << "✗ Filesystem mark left behind (" << filesystem_marks(backend.fd()) << ")\n";
+        return 1;
+    }
+    std::cout << "✓ The last remove_watch() takes the filesystem mark\n";
+    std::cout << "All tests passed!\n";
+    return 0;
+}
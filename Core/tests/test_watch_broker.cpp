@@ -0,0 +1,146 @@
+#include "../src/filewatcher/watch_broker.hpp"
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::string_view kBroker = "aurora_watch_broker_test";
+const std::string kDir = "test_data/broker_tree";
+
+struct Seen {
+    int id;
+    std::uint32_t mask;
+    std::string name;
+};
+
+// Drains `backend` until `done` holds for what it collected, or a second passes.
+template <typename Done>
+std::vector<Seen> collect(FileWatcherAPI::WatchBackend& backend, Done done) {
+    std::vector<Seen> seen;
+    for (int i = 0; i < 100 && !done(seen); ++i) {
+        struct pollfd pfd{backend.fd(), POLLIN, 0};
+        if (poll(&pfd, 1, 10) > 0) {
+            backend.drain([&](int id, std::uint32_t mask, std::string_view name) {
+                seen.push_back({id, mask, std::string{name}});
+            });
+        }
+    }
+    return seen;
+}
+
+bool has(const std::vector<Seen>& seen, int id, std::uint32_t mask, std::string_view name = {}) {
+    for (const auto& event : seen) {
+        if (event.id == id && (event.mask & mask) && (name.empty() || event.name == name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void touch(const std::string& path) {
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        (void)!write(fd, "x", 1);
+        close(fd);
+    }
+}
+
+} // namespace
+
+// Two subscribers on one broker must share its watches, each see only
+// what it asked for, and find out when they fall a ring behind or the
+// broker goes away.
+int main() {
+    std::cout << "Testing watch broker...\n";
+    mkdir(kDir.c_str(), 0755);
+
+    auto broker = std::make_unique<WatchBroker>();
+    std::string error;
+    if (!broker->listen(kBroker, WatchBroker::kMinRingSize, error)) {
+        std::cout << "✗ Listen: " << error << '\n';
+        return 1;
+    }
+    std::thread server([&broker] { broker->run(); });
+
+    FileWatcherAPI::WatchBackend first(FileWatcherAPI::BackendKind::BROKER, kBroker);
+    FileWatcherAPI::WatchBackend second(FileWatcherAPI::BackendKind::BROKER, kBroker);
+    const int id = first.add_watch(kDir.c_str(), IN_CREATE | IN_MODIFY | IN_ONLYDIR);
+    const int same = second.add_watch(kDir.c_str(), IN_CREATE);
+    if (first.fd() < 0 || second.fd() < 0 || id < 0 || same != id) {
+        std::cout << "✗ Subscribe: ids " << id << ", " << same << '\n';
+        broker->stop();
+        server.join();
+        return 1;
+    }
+    std::cout << "✓ One watch for both subscribers\n";
+
+    touch(kDir + "/a");
+    const auto first_seen = collect(first, [&](const auto& seen) { return has(seen, id, IN_MODIFY, "a"); });
+    const auto second_seen = collect(second, [&](const auto& seen) { return has(seen, id, IN_CREATE, "a"); });
+    if (!has(first_seen, id, IN_CREATE, "a") || !has(first_seen, id, IN_MODIFY, "a") ||
+        !has(second_seen, id, IN_CREATE, "a") || has(second_seen, id, IN_MODIFY)) {
+        std::cout << "✗ Fan-out: " << first_seen.size() << " and " << second_seen.size() << " events\n";
+        broker->stop();
+        server.join();
+        return 1;
+    }
+    std::cout << "✓ Each subscriber gets its own mask\n";
+
+    // Dropping a watch ends it for that subscriber only.
+    first.remove_watch(id);
+    std::remove((kDir + "/a").c_str());
+    touch(kDir + "/b");
+    const auto after_remove = collect(first, [&](const auto& seen) { return has(seen, id, IN_IGNORED); });
+    const auto still_there = collect(second, [&](const auto& seen) { return has(seen, id, IN_CREATE, "b"); });
+    if (!has(after_remove, id, IN_IGNORED) || has(after_remove, id, IN_CREATE, "b") ||
+        !has(still_there, id, IN_CREATE, "b")) {
+        std::cout << "✗ Remove watch\n";
+        broker->stop();
+        server.join();
+        return 1;
+    }
+    std::cout << "✓ Remove watch\n";
+
+    // A subscriber that does not read while a whole ring goes by is told so.
+    constexpr int kFiles = 4000;
+    for (int i = 0; i < kFiles; ++i) {
+        const std::string path = kDir + "/burst_" + std::to_string(i);
+        touch(path);
+        std::remove(path.c_str());
+    }
+    const auto overrun = collect(second, [](const auto& seen) { return has(seen, -1, IN_Q_OVERFLOW); });
+    if (!has(overrun, -1, IN_Q_OVERFLOW) || has(overrun, id, IN_CREATE, "burst_0")) {
+        std::cout << "✗ Overrun not reported (" << overrun.size() << " events)\n";
+        broker->stop();
+        server.join();
+        return 1;
+    }
+    std::cout << "✓ Overrun reported\n";
+
+    // The broker going away ends every watch.
+    broker->stop();
+    server.join();
+    const std::size_t watches = broker->watch_count();
+    broker.reset();
+    const auto orphaned = collect(second, [&](const auto& seen) { return has(seen, id, IN_IGNORED); });
+    const bool refused = second.add_watch(kDir.c_str(), IN_CREATE) < 0;
+    std::remove((kDir + "/b").c_str());
+    rmdir(kDir.c_str());
+    if (watches != 1 || !has(orphaned, id, IN_IGNORED) || !refused) {
+        std::cout << "✗ Broker exit: " << watches << " watches left\n";
+        return 1;
+    }
+    std::cout << "✓ Broker exit ends every watch\n";
+
+    std::cout << "All tests passed!\n";
+    return 0;
+}
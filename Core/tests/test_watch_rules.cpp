@@ -0,0 +1,115 @@
+#include "../src/filewatcher/watch_rules.hpp"
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool write_file(const char* path, const char* text) {
+    FILE* file = std::fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    std::fputs(text, file);
+    std::fclose(file);
+    return true;
+}
+
+} // namespace
+
+// Globs must agree with fnmatch() on the cases rules use, whichever bucket
+// (exact, prefix, suffix, general) a pattern is sorted into, and the
+// parser must reject what it does not understand.
+int main() {
+    std::cout << "Testing watch rules...\n";
+
+    struct Case {
+        const char* pattern;
+        const char* name;
+        bool expected;
+    };
+    const Case cases[] = {
+        {"*.xml", "dax.xml", true},        {"*.xml", "dax.xml.bak", false},
+        {"audio_*", "audio_policy.conf", true}, {"audio_*", "my_audio", false},
+        {"mixer_paths.xml", "mixer_paths.xml", true}, {"mixer_paths.xml", "mixer_paths.xm", false},
+        {"*", "", true},                   {"a*b*c", "aXbYbZc", true},
+        {"a*b*c", "aXbYbZ", false},        {"?.conf", "a.conf", true},
+        {"?.conf", "ab.conf", false},      {"[a-c]x", "bx", true},
+        {"[!a-c]x", "bx", false},          {"[!a-c]x", "dx", true},
+        {"*.[ch]", "main.c", true},        {"*.[ch]", "main.o", false},
+        {"[x", "[x", true},                {"*a*a*a*a*b", "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", false},
+    };
+    for (const auto& test : cases) {
+        const FileFilter filter({test.pattern}, {});
+        if (glob_match(test.pattern, test.name) != test.expected || filter.matches(test.name) != test.expected) {
+            std::cout << "✗ '" << test.pattern << "' vs '" << test.name << "'\n";
+            return 1;
+        }
+    }
+    const FileFilter filter({"*.xml", "audio_*"}, {".*", "*.bak.xml"});
+    if (!filter.matches("dax.xml") || !filter.matches("audio_x") || filter.matches(".dax.xml") ||
+        filter.matches("dax.bak.xml") || filter.matches("dax.conf") || !FileFilter{}.matches("anything")) {
+        std::cout << "✗ Include/exclude combination\n";
+        return 1;
+    }
+    std::cout << "✓ Glob filters\n";
+
+    const char* path = "test_data/rules.conf";
+    write_file(path,
+               "# comment\n"
+               "[dolby]\n"
+               "path = /vendor/etc/dolby\n"
+               "events = modify,create\n"
+               "include = *.xml, *.conf\n"
+               "include = audio_*\n"
+               "exclude = .*\n"
+               "command = echo \"changed $FILE\"\n"
+               "debounce = 200\n"
+               "recursive = yes\n"
+               "depth = 2\n"
+               "\n"
+               "; second rule\n"
+               "[mixer]\n"
+               "path=/vendor/etc/mixer_paths.xml\n"
+               "command=true\n");
+    std::vector<WatchRule> rules;
+    std::string error;
+    if (!load_rules(path, rules, error) || rules.size() != 2) {
+        std::cout << "✗ load_rules: " << error << '\n';
+        return 1;
+    }
+    const WatchRule& dolby = rules[0];
+    if (dolby.name != "dolby" || dolby.path != "/vendor/etc/dolby" || dolby.events != (IN_MODIFY | IN_CREATE) ||
+        dolby.include != std::vector<std::string>{"*.xml", "*.conf", "audio_*"} || dolby.exclude.size() != 1 ||
+        dolby.command != "echo \"changed $FILE\"" || dolby.debounce_ms != 200 || !dolby.recursive ||
+        dolby.max_depth != 2 || rules[1].events != kDefaultEvents || rules[1].debounce_ms != -1) {
+        std::cout << "✗ Parsed fields\n";
+        return 1;
+    }
+    std::cout << "✓ Rules file parsed\n";
+
+    const char* broken[] = {
+        "path = /x\n",                               // outside a section
+        "[a]\npath = /x\ncommand = y\ncolour = 1\n", // unknown key
+        "[a]\npath = /x\n",                          // no command
+        "[a]\npath = /x\ncommand = y\n[a]\n",        // duplicate name
+        "[a]\npath = /x\ncommand = y\ndebounce = soon\n",
+        "[a\n",
+        "[a]\npath = /x\ncommand = y\nevents = modify,moved\n",
+        "[a]\npath = /x\ncommand = y\nevents = ,\n",
+    };
+    for (const char* text : broken) {
+        write_file(path, text);
+        std::vector<WatchRule> unchanged = rules;
+        if (load_rules(path, unchanged, error) || unchanged != rules) {
+            std::cout << "✗ Accepted a broken rules file:\n" << text;
+            return 1;
+        }
+    }
+    std::cout << "✓ Broken rules files rejected with " << error << '\n';
+
+    std::remove(path);
+    std::cout << "All tests passed!\n";
+    return 0;
+}
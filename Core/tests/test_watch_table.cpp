@@ -0,0 +1,133 @@
+#include "../src/filewatcherAPI/filewatcher_api.hpp"
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+void touch(const std::string& path) {
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        (void)!write(fd, "x", 1);
+        close(fd);
+    }
+}
+
+bool wait_for(const std::atomic<int>& counter, int target) {
+    for (int i = 0; i < 200 && counter.load() < target; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return counter.load() >= target;
+}
+
+} // namespace
+
+// Watches are added and removed while the worker thread is delivering
+// events; removed watches must go quiet and leave nothing behind.
+int main() {
+    std::cout << "Testing runtime add_watch/remove_watch...\n";
+
+    constexpr int kDirs = 32;
+    const std::string base = "test_data/watch_table";
+    mkdir("test_data", 0755);
+    mkdir(base.c_str(), 0755);
+    for (int i = 0; i < kDirs; ++i) {
+        mkdir((base + "/d" + std::to_string(i)).c_str(), 0755);
+    }
+
+    FileWatcherAPI::FileWatcher watcher;
+    std::atomic<int> events{0};
+    auto on_event = [&](const FileWatcherAPI::FileEvent&) { events.fetch_add(1); };
+    watcher.start();
+
+    for (int i = 0; i < kDirs; ++i) {
+        if (!watcher.add_watch(base + "/d" + std::to_string(i), on_event, IN_CLOSE_WRITE)) {
+            std::cout << "✗ add_watch failed while running\n";
+            return 1;
+        }
+    }
+    for (int i = 0; i < kDirs; ++i) {
+        touch(base + "/d" + std::to_string(i) + "/f");
+    }
+    if (watcher.watch_count() != kDirs || !wait_for(events, kDirs)) {
+        std::cout << "✗ Expected " << kDirs << " events, got " << events.load() << '\n';
+        return 1;
+    }
+    std::cout << "✓ Watches added at runtime deliver events\n";
+
+    for (int i = 0; i < kDirs; ++i) {
+        if (!watcher.remove_watch(base + "/d" + std::to_string(i))) {
+            std::cout << "✗ remove_watch failed\n";
+            return 1;
+        }
+    }
+    const int before = events.load();
+    for (int i = 0; i < kDirs; ++i) {
+        touch(base + "/d" + std::to_string(i) + "/f");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    if (watcher.watch_count() != 0 || events.load() != before || watcher.remove_watch(base + "/d0")) {
+        std::cout << "✗ Removed watches still active\n";
+        return 1;
+    }
+    std::cout << "✓ Removed watches stay quiet\n";
+
+    // Churn the table from one thread while another generates events.
+    std::atomic<bool> churning{true};
+    std::thread writer([&] {
+        while (churning.load()) {
+            for (int i = 0; i < kDirs; ++i) {
+                touch(base + "/d" + std::to_string(i) + "/f");
+            }
+        }
+    });
+    for (int round = 0; round < 50; ++round) {
+        for (int i = 0; i < kDirs; ++i) {
+            watcher.add_watch(base + "/d" + std::to_string(i), on_event, IN_CLOSE_WRITE);
+        }
+        for (int i = 0; i < kDirs; ++i) {
+            watcher.remove_watch(base + "/d" + std::to_string(i));
+        }
+    }
+    churning.store(false);
+    writer.join();
+    if (watcher.watch_count() != 0) {
+        std::cout << "✗ Churn left " << watcher.watch_count() << " watches\n";
+        return 1;
+    }
+    std::cout << "✓ Survived add/remove churn under load\n";
+
+    // A recursive watch follows new directories and is removed as a whole.
+    const std::string tree = base + "/tree";
+    unlink((tree + "/a/b/f").c_str());
+    rmdir((tree + "/a/b").c_str());
+    mkdir(tree.c_str(), 0755);
+    mkdir((tree + "/a").c_str(), 0755);
+    events.store(0);
+    if (!watcher.add_watch(tree, on_event, IN_CLOSE_WRITE, true) || watcher.watch_count() != 2) {
+        std::cout << "✗ Recursive add_watch\n";
+        return 1;
+    }
+    mkdir((tree + "/a/b").c_str(), 0755);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    touch(tree + "/a/b/f");
+    if (!wait_for(events, 1) || watcher.watch_count() != 3) {
+        std::cout << "✗ New subdirectory not followed\n";
+        return 1;
+    }
+    watcher.remove_watch(tree);
+    if (watcher.watch_count() != 0) {
+        std::cout << "✗ Recursive remove_watch left watches behind\n";
+        return 1;
+    }
+    std::cout << "✓ Recursive watch removed with its subdirectories\n";
+
+    watcher.stop();
+    std::cout << "All tests passed!\n";
+    return 0;
+}
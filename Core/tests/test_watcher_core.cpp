@@ -0,0 +1,213 @@
+#include "../src/filewatcher/watcher_core.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const std::string kTree = "test_data/core_tree";
+const std::string kRecorder = "test_data/core_record.sh";
+const std::string kLog = "test_data/core_record.log";
+const char* kJournal = "test_data/core.journal";
+
+// The command every watch runs: appends its arguments to kLog.
+const std::string kCommand = "sh " + kRecorder + " $FILE";
+
+void write_file(const std::string& path, const char* text) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << text;
+}
+
+std::vector<std::string> recorded() {
+    std::ifstream in(kLog);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(in, line);) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+void settle(int ms = 150) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// Voluntary context switches in the whole process over `ms` of doing
+// nothing here: one is this thread's own sleep, the rest are other
+// threads waking up.
+long idle_wakeups(int ms) {
+    struct rusage before;
+    struct rusage after;
+    getrusage(RUSAGE_SELF, &before);
+    settle(ms);
+    getrusage(RUSAGE_SELF, &after);
+    return after.ru_nvcsw - before.ru_nvcsw;
+}
+
+// WatcherCore::start() is the whole event loop; it runs on a thread of its
+// own here, which inherits the signal mask the constructor set up.
+class Running {
+public:
+    explicit Running(WatcherCore& core) : core_(core), thread_([&core] { core.start(); }) { settle(); }
+    ~Running() { stop(); }
+
+    void stop() {
+        if (thread_.joinable()) {
+            core_.stop();
+            thread_.join();
+        }
+    }
+
+private:
+    WatcherCore& core_;
+    std::thread thread_;
+};
+
+// The changes a journal left by a run would replay against the tree now.
+std::vector<std::string> unhandled(const std::string& dir) {
+    EventJournal journal;
+    std::string error;
+    FileWatcherAPI::DirectorySnapshot saved;
+    std::vector<std::string> out;
+    if (!journal.open(kJournal, error) || !journal.take(dir, saved)) {
+        return out;
+    }
+    FileWatcherAPI::DirectorySnapshot now;
+    now.capture(dir);
+    saved.diff(now, [&](std::string_view name, std::uint32_t) { out.emplace_back(name); });
+    return out;
+}
+
+} // namespace
+
+// WatcherCore end to end: a real inotify watch, real commands, and the
+// journal a restarted watcher would read.
+int main() {
+    std::cout << "Testing watcher core...\n";
+    mkdir(kTree.c_str(), 0755);
+    write_file(kRecorder, "echo \"$@\" >> test_data/core_record.log\n");
+    write_file(kTree + "/a", "one");
+    std::remove(kLog.c_str());
+    std::remove(kJournal);
+
+    // A change still inside its debounce window has not been handled: the
+    // journal must not claim it was, or a killed run would lose it.
+    {
+        WatcherCore core;
+        std::string error;
+        if (!core.set_journal(kJournal, error)) {
+            std::cout << "✗ Journal: " << error << '\n';
+            return 1;
+        }
+        core.set_debounce(60000);
+        core.add_watch(kTree, kCommand, IN_CLOSE_WRITE);
+        Running running(core);
+        write_file(kTree + "/a", "one, rewritten");
+        settle();
+        const std::vector<std::string> waiting = unhandled(kTree);
+        if (!recorded().empty() || waiting.size() != 1 || waiting[0] != "a") {
+            std::cout << "✗ Debounced change journaled as handled (" << waiting.size() << " left to replay)\n";
+            return 1;
+        }
+        std::cout << "✓ A debounced change stays replayable until its command runs\n";
+
+        // Stopping runs it rather than dropping it, and only then records it.
+        running.stop();
+        const std::vector<std::string> ran = recorded();
+        if (ran.size() != 1 || ran[0] != kTree + "/a" || !unhandled(kTree).empty()) {
+            std::cout << "✗ Pending command lost on stop (" << ran.size() << " ran)\n";
+            return 1;
+        }
+        std::cout << "✓ Stopping runs pending commands before the last checkpoint\n";
+    }
+    std::remove(kLog.c_str());
+
+    // Idle, the loop sleeps in epoll_wait with no timeout; stop() gets it
+    // out through the eventfd at once rather than at the next tick.
+    {
+        WatcherCore core;
+        core.add_watch(kTree, kCommand, IN_CLOSE_WRITE);
+        Running running(core);
+        const long wakeups = idle_wakeups(500);
+        const auto start = std::chrono::steady_clock::now();
+        running.stop();
+        const auto took = std::chrono::steady_clock::now() - start;
+        if (wakeups > 2 || took > std::chrono::milliseconds(100)) {
+            std::cout << "✗ Idle loop: " << wakeups << " wakeups, stop() took "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(took).count() << " ms\n";
+            return 1;
+        }
+        std::cout << "✓ The idle loop does not wake up, and stop() ends it at once\n";
+    }
+
+    // A burst runs the command once per file, only after the file has been
+    // quiet for the whole window, and with every event the burst merged.
+    {
+        WatcherCore core;
+        core.set_debounce(300);
+        core.add_watch(kTree, "echo \"$FILE $EVENTS\" >> " + kLog, IN_MODIFY | IN_CLOSE_WRITE);
+        Running running(core);
+        for (int i = 0; i < 3; ++i) {
+            write_file(kTree + "/a", "burst");
+            write_file(kTree + "/b", "burst");
+            settle();
+        }
+        // 450 ms after the first write, 150 ms after the last.
+        if (!recorded().empty()) {
+            std::cout << "✗ Command ran inside the quiet window\n";
+            return 1;
+        }
+        settle(500);
+        std::vector<std::string> ran = recorded();
+        std::sort(ran.begin(), ran.end());
+        const std::vector<std::string> expected{kTree + "/a modify,close_write", kTree + "/b modify,close_write"};
+        if (ran != expected) {
+            std::cout << "✗ Debounced burst ran " << ran.size() << " commands\n";
+            return 1;
+        }
+        std::cout << "✓ A burst runs once per file after the quiet window, with $EVENTS merged\n";
+    }
+    std::remove(kLog.c_str());
+
+    // Periodic checks: a tick with nothing changed runs nothing, and a
+    // change inotify did not report (an mtime set with utimensat() is an
+    // IN_ATTRIB, which this watch does not ask for) runs once, not on every
+    // tick after it.
+    {
+        WatcherCore core;
+        core.set_periodic_check(1);
+        core.add_watch(kTree, kCommand, IN_MODIFY);
+        Running running(core);
+        settle(2200);
+        if (!recorded().empty()) {
+            std::cout << "✗ Periodic check fired with nothing changed\n";
+            return 1;
+        }
+        const struct timespec times[2] = {{0, UTIME_OMIT}, {1000000000, 0}};
+        utimensat(AT_FDCWD, (kTree + "/a").c_str(), times, 0);
+        settle(2200);
+        const std::vector<std::string> ran = recorded();
+        if (ran.size() != 1 || ran[0] != kTree + "/a") {
+            std::cout << "✗ Missed change ran " << ran.size() << " commands over two ticks\n";
+            return 1;
+        }
+        std::cout << "✓ Periodic checks fire once per real change and never on their own\n";
+    }
+
+    std::remove(kJournal);
+    std::remove(kLog.c_str());
+    std::remove((kTree + "/a").c_str());
+    std::remove((kTree + "/b").c_str());
+    rmdir(kTree.c_str());
+    std::remove(kRecorder.c_str());
+
+    std::cout << "All tests passed!\n";
+    return 0;
+}
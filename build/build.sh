@@ -151,9 +151,9 @@ build_cpp_arch() {
     
     # Build using cmake instead of make for better cross-platform compatibility
     if [ "$debug_logging" = "true" ]; then
-        cmake --build . --parallel --config "$build_type" --target filewatcher --verbose
+        cmake --build . --parallel --config "$build_type" --target filewatcher logger_daemon logger_client logger_query dax_tool mixer_tool --verbose
     else
-        cmake --build . --parallel --config "$build_type" --target filewatcher
+        cmake --build . --parallel --config "$build_type" --target filewatcher logger_daemon logger_client logger_query dax_tool mixer_tool
     fi
     
     # Create bin directory
@@ -161,6 +161,11 @@ build_cpp_arch() {
     
     # Copy binaries with module_id and architecture suffix
     [ -f "src/filewatcher/filewatcher" ] && cp "src/filewatcher/filewatcher" "$MODULE_DIR/bin/filewatcher_${module_id}_${arch}"
+    [ -f "src/logger/logger_daemon" ] && cp "src/logger/logger_daemon" "$MODULE_DIR/bin/logger_daemon_${module_id}_${arch}"
+    [ -f "src/logger/logger_client" ] && cp "src/logger/logger_client" "$MODULE_DIR/bin/logger_client_${module_id}_${arch}"
+    [ -f "src/logger/logger_query" ] && cp "src/logger/logger_query" "$MODULE_DIR/bin/logger_query_${module_id}_${arch}"
+    [ -f "src/dax/dax_tool" ] && cp "src/dax/dax_tool" "$MODULE_DIR/bin/dax_tool_${module_id}_${arch}"
+    [ -f "src/mixer/mixer_tool" ] && cp "src/mixer/mixer_tool" "$MODULE_DIR/bin/mixer_tool_${module_id}_${arch}"
     
     # Strip debug symbols for smaller binaries (if enabled)
     if [ "$strip_binaries" = "true" ]; then
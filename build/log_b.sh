@@ -20,6 +20,9 @@ LOG_BUFFER_COUNT=0
 LOG_LAST_FLUSH=0
 LOG_INITIALIZED=false
 LOG_PID=$$
+LOG_CLIENT="${MODPATH}/bin/logger_client"
+LOG_STREAM_ACTIVE=false
+LOG_STREAM_PID=""
 
 # 初始化日志系统
 init_logger() {
@@ -37,6 +40,9 @@ init_logger() {
     # 检查并轮转日志
     rotate_logs_if_needed
     
+    # 优先使用常驻的 logger_client 协进程
+    start_log_stream
+    
     # 记录启动信息
     LOG_INITIALIZED=true
     log_info "Logger system initialized - PID: $LOG_PID, Buffer: $LOG_ENABLE_BUFFER"
@@ -44,6 +50,35 @@ init_logger() {
     return 0
 }
 
+# 启动 logger_client 流式协进程：之后每条日志只是一次 printf 到 fd 8，
+# 时间戳、PID、批量写入和轮转都由 C++ 端完成，不再为每行 fork date/echo
+start_log_stream() {
+    [ "$LOG_STREAM_ACTIVE" = "true" ] && return 0
+    [ -x "$LOG_CLIENT" ] || return 1
+    # 架构不匹配时直接回退，避免写入已退出的读端
+    "$LOG_CLIENT" -h >/dev/null 2>&1 || return 1
+    
+    local fifo="$LOG_DIR/.$LOG_FILE_NAME.fifo"
+    rm -f "$fifo"
+    mkfifo "$fifo" 2>/dev/null || return 1
+    
+    "$LOG_CLIENT" -s -o "$LOG_DIR/$LOG_FILE_NAME.log" -S "$LOG_MAX_SIZE" -n "$LOG_MAX_FILES" < "$fifo" &
+    LOG_STREAM_PID=$!
+    exec 8>"$fifo"
+    rm -f "$fifo"
+    LOG_STREAM_ACTIVE=true
+    return 0
+}
+
+# 关闭写端，协进程读到 EOF 后写出剩余日志并退出
+stop_log_stream() {
+    [ "$LOG_STREAM_ACTIVE" != "true" ] && return 0
+    exec 8>&-
+    wait "$LOG_STREAM_PID" 2>/dev/null
+    LOG_STREAM_ACTIVE=false
+    LOG_STREAM_PID=""
+}
+
 # 获取当前时间戳
 get_timestamp() {
     if [ "$LOG_ENABLE_TIMESTAMP" = "true" ]; then
@@ -114,6 +149,8 @@ write_to_file() {
 
 # 刷新缓冲区
 flush_logs() {
+    # 流式模式下由 logger_client 在 50ms 内自行批量写出
+    [ "$LOG_STREAM_ACTIVE" = "true" ] && return 0
     [ "$LOG_ENABLE_BUFFER" != "true" ] && return 0
     [ -z "$LOG_BUFFER" ] && return 0
     
@@ -155,6 +192,20 @@ log() {
     # 初始化检查
     [ "$LOG_INITIALIZED" != "true" ] && init_logger
     
+    # 流式模式：一次内建 printf，无子进程
+    if [ "$LOG_STREAM_ACTIVE" = "true" ]; then
+        local level_word
+        case "$level" in
+            1) level_word="error" ;;
+            2) level_word="warn" ;;
+            3) level_word="info" ;;
+            *) level_word="debug" ;;
+        esac
+        printf '%s %s\n' "$level_word" "$message" >&8
+        [ "$level" = "1" ] && printf '[ERROR] %s\n' "$message" >&2
+        return 0
+    fi
+    
     # 级别转换
     local level_str
     case "$level" in
@@ -213,7 +264,13 @@ set_log_file() {
     # 刷新当前缓冲区
     flush_logs
     
-    LOG_FILE_NAME="$1"
+    if [ "$LOG_STREAM_ACTIVE" = "true" ]; then
+        stop_log_stream
+        LOG_FILE_NAME="$1"
+        start_log_stream
+    else
+        LOG_FILE_NAME="$1"
+    fi
     log_info "Log file changed to: $LOG_FILE_NAME"
     return 0
 }
@@ -257,6 +314,9 @@ clean_logs() {
     
     flush_logs
     
+    local restart_stream="$LOG_STREAM_ACTIVE"
+    [ "$keep_current" != "true" ] && stop_log_stream
+    
     if [ "$keep_current" = "true" ]; then
         # 只清理轮转的日志文件
         rm -f "$LOG_DIR/$LOG_FILE_NAME.log."* 2>/dev/null
@@ -264,6 +324,7 @@ clean_logs() {
     else
         # 清理所有日志文件
         rm -f "$LOG_DIR/$LOG_FILE_NAME.log"* 2>/dev/null
+        [ "$restart_stream" = "true" ] && start_log_stream
         log_info "All log files cleaned"
     fi
     
@@ -282,6 +343,7 @@ log_stats() {
         echo "Lines: $lines"
         echo "Buffer count: $LOG_BUFFER_COUNT"
         echo "Buffer enabled: $LOG_ENABLE_BUFFER"
+        echo "Stream client: $LOG_STREAM_ACTIVE"
     else
         echo "Log file not found: $log_file"
     fi
@@ -291,6 +353,7 @@ log_stats() {
 stop_logger() {
     log_info "Stopping logger system..."
     flush_logs
+    stop_log_stream
     LOG_INITIALIZED=false
     return 0
 }
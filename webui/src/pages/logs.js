@@ -6,6 +6,9 @@ class LogsPage {
     this.logs = [];
     this.filteredLogs = []; // 筛选后的日志
     this.isLoading = false;
+    this.hasOlderLogs = false;
+    this.logQuery = `${window.core.MODULE_PATH}/bin/logger_query`;
+    this.pageSize = 500; // 每次读取的行数
     this.logLevelFilter = 'all'; // 日志级别筛选器
     this.virtualScrollConfig = {
       itemHeight: 30, // 每个日志条目的高度
@@ -70,6 +73,9 @@ class LogsPage {
 
   handleScroll(event) {
     const scrollTop = event.target.scrollTop;
+    if (scrollTop === 0 && this.hasOlderLogs && !this.isLoading) {
+      this.loadOlderLogs();
+    }
     const { itemHeight, bufferSize } = this.virtualScrollConfig;
 
     this.virtualScrollConfig.visibleStart = Math.max(
@@ -208,8 +214,9 @@ class LogsPage {
   /**
    * 根据日志级别筛选日志
    * @param {string} level - 日志级别 (all, debug, info, warn, error)
+   * @param {boolean} scrollToBottom - 渲染后是否滚动到最新日志
    */
-  filterLogsByLevel(level) {
+  filterLogsByLevel(level, scrollToBottom = true) {
     this.logLevelFilter = level;
     
     if (level === 'all') {
@@ -228,7 +235,7 @@ class LogsPage {
     this.virtualScrollConfig.visibleEnd = 0;
     
     // 重新渲染日志
-    this.renderLogs();
+    this.renderLogs(scrollToBottom);
     
     if (window.core.isDebugMode()) {
       window.core.logDebug(`Filtered logs by level: ${level}, count: ${this.filteredLogs.length}`, 'LOGS');
@@ -304,8 +311,97 @@ class LogsPage {
         return;
       }
 
-      // KSU环境中读取实际日志
+      // KSU环境中读取实际日志：logger_query 按需读取轮转文件的最后一页
       const logFile = this.getLogFilePath();
+      window.core.execCommand(
+        `"${this.logQuery}" -f "${logFile}" -L ${this.pageSize} -j 2>/dev/null`,
+        (output, success) => {
+          if (!success) {
+            this.loadLogsWithTail(logFile);
+            return;
+          }
+          try {
+            this.logs = this.parseQueryOutput(output);
+            this.hasOlderLogs = this.logs.length === this.pageSize;
+            this.filterLogsByLevel(this.logLevelFilter);
+          } catch (parseError) {
+            window.core.showError("解析日志失败", parseError.message);
+            this.renderErrorState();
+          } finally {
+            this.isLoading = false;
+          }
+        }
+      );
+    } catch (error) {
+      window.core.showError("加载日志失败", error.message);
+      this.renderErrorState();
+      this.isLoading = false;
+    }
+  }
+
+  /**
+   * 向上滚动到顶部时，用第一条日志的游标读取更早的一页
+   */
+  loadOlderLogs() {
+    const first = this.logs[0];
+    if (!first || !first.cursor) {
+      this.hasOlderLogs = false;
+      return;
+    }
+
+    this.isLoading = true;
+    const logFile = this.getLogFilePath();
+    window.core.execCommand(
+      `"${this.logQuery}" -f "${logFile}" -L ${this.pageSize} -b "${first.cursor}" -j 2>/dev/null`,
+      (output, success) => {
+        try {
+          const older = success ? this.parseQueryOutput(output) : [];
+          this.hasOlderLogs = older.length === this.pageSize;
+          if (older.length === 0) {
+            return;
+          }
+          const previousCount = this.filteredLogs.length;
+          this.logs = older.concat(this.logs);
+          this.filterLogsByLevel(this.logLevelFilter, false);
+          // 保持当前可见的日志不动
+          const logDisplay = document.getElementById("log-display");
+          if (logDisplay) {
+            logDisplay.scrollTop =
+              (this.filteredLogs.length - previousCount) * this.virtualScrollConfig.itemHeight;
+          }
+        } catch (parseError) {
+          window.core.showError("解析日志失败", parseError.message);
+        } finally {
+          this.isLoading = false;
+        }
+      }
+    );
+  }
+
+  /**
+   * logger_query -j 每行输出一个JSON对象
+   * @param {string} output
+   */
+  parseQueryOutput(output) {
+    return output
+      .split("\n")
+      .filter((line) => line.trim())
+      .map((line) => {
+        const record = JSON.parse(line);
+        const level = (record.level || "info").toLowerCase();
+        return {
+          timestamp: record.time ? new Date(record.time) : new Date(),
+          level: level === "crit" ? "error" : level,
+          message: record.message,
+          cursor: record.cursor,
+        };
+      });
+  }
+
+  // 没有 logger_query 时（例如模块未完整安装）退回到 tail
+  loadLogsWithTail(logFile) {
+    this.hasOlderLogs = false;
+    try {
       window.core.execCommand(
         `tail -n 100 "${logFile}" 2>/dev/null || echo "日志文件不存在"`,
         (output, success) => {
@@ -652,7 +748,7 @@ class LogsPage {
       .padStart(2, "0")}:${logTime.getMinutes().toString().padStart(2, "0")}`;
   }
 
-  renderLogs() {
+  renderLogs(scrollToBottom = true) {
     const logDisplay = document.getElementById("log-display");
     if (!logDisplay) return;
 
@@ -683,9 +779,11 @@ class LogsPage {
     this.renderVisibleLogs();
 
     // 滚动到底部显示最新日志
-    setTimeout(() => {
-      logDisplay.scrollTop = logDisplay.scrollHeight;
-    }, 100);
+    if (scrollToBottom) {
+      setTimeout(() => {
+        logDisplay.scrollTop = logDisplay.scrollHeight;
+      }, 100);
+    }
   }
 
   renderVisibleLogs() {
@@ -13,6 +13,7 @@ class DaxequalizerPage {
     };
     this.eventListeners = [];
     this.daxFilePath = `${window.core.MODULE_PATH}/system/vendor/etc/dolby/dax-default.xml`;
+    this.daxTool = `${window.core.MODULE_PATH}/bin/dax_tool`;
     
     // 标准化频率范围 (20段专业模式)
     this.standardFrequencies = [47, 141, 234, 328, 469, 656, 844, 1031, 1313, 1688, 2250, 3000, 3750, 4688, 5813, 7125, 9000, 11250, 13875, 19688];
@@ -199,9 +200,10 @@ class DaxequalizerPage {
         await this.createDefaultDaxConfig();
       }
       
-      const result = await window.core.exec(`cat "${this.daxFilePath}"`);
+      // dax_tool 直接索引XML并输出JSON，无需整文件读入解析
+      const result = await window.core.exec(`"${this.daxTool}" -f "${this.daxFilePath}" list`);
       if (result.errno === 0 && result.stdout) {
-        this.parseDaxXml(result.stdout);
+        this.applyDaxJson(JSON.parse(result.stdout));
         this.populateSelectors();
       } else {
         const errorMsg = result.stderr || 'DAX配置文件不存在或无法读取';
@@ -274,49 +276,9 @@ class DaxequalizerPage {
     window.core.showToast(window.i18n.t('daxEqualizer.defaultConfigCreated'), 'info');
   }
 
-  parseDaxXml(xmlContent) {
-    const parser = new DOMParser();
-    const xmlDoc = parser.parseFromString(xmlContent, 'text/xml');
-    
-    // Parse presets
-    this.data.presets = [];
-    const presets = xmlDoc.querySelectorAll('preset');
-    presets.forEach(preset => {
-      const id = preset.getAttribute('id');
-      const type = preset.getAttribute('type');
-      const bands = [];
-      
-      if (type === 'ieq') {
-        const ieqBands = preset.querySelectorAll('band_ieq');
-        ieqBands.forEach(band => {
-          bands.push({
-            frequency: parseInt(band.getAttribute('frequency')),
-            target: parseInt(band.getAttribute('target'))
-          });
-        });
-      } else if (type === 'geq') {
-        const geqBands = preset.querySelectorAll('band_geq');
-        geqBands.forEach(band => {
-          bands.push({
-            frequency: parseInt(band.getAttribute('frequency')),
-            gain: parseInt(band.getAttribute('gain'))
-          });
-        });
-      }
-      
-      this.data.presets.push({ id, type, bands });
-    });
-
-    // Parse profiles
-    this.data.profiles = [];
-    const profiles = xmlDoc.querySelectorAll('profile');
-    profiles.forEach(profile => {
-      const id = profile.getAttribute('id');
-      const name = profile.getAttribute('name');
-      const group = profile.getAttribute('group');
-      
-      this.data.profiles.push({ id, name, group });
-    });
+  applyDaxJson(dax) {
+    this.data.presets = dax.presets.map(({ id, type, bands }) => ({ id, type, bands }));
+    this.data.profiles = dax.profiles.map(({ id, name, group }) => ({ id, name, group }));
   }
 
   populateSelectors() {
@@ -580,30 +542,27 @@ class DaxequalizerPage {
     
     this.showLoading(true);
     try {
-      const updatedXml = await this.generateUpdatedXml();
-      
-      // 创建临时文件
-      const tempFile = '/tmp/dax-temp.xml';
-      const escapedXml = updatedXml.replace(/'/g, "'\"'\"'");
-      
-      // 写入临时文件
-      const writeResult = await window.core.exec(`echo '${escapedXml}' > "${tempFile}"`);
-      if (writeResult.errno !== 0) {
-        throw new Error(`Failed to create temporary file: ${writeResult.stderr}`);
+      const preset = this.targetPreset();
+      if (!preset) {
+        throw new Error('No preset to save into');
       }
-      
-      // 复制到目标位置
-      const copyResult = await window.core.exec(`cp "${tempFile}" "${this.daxFilePath}"`);
-      if (copyResult.errno !== 0) {
-        throw new Error(`Failed to copy file to target location: ${copyResult.stderr}`);
+      const isIEQ = preset.type !== 'geq';
+      const bandArgs = this.data.bands
+        .filter(band => band && band.frequency)
+        .map(band => {
+          const value = isIEQ ? Math.round(band.target || (band.gain || 0) * 100) : (band.gain || 0);
+          return `${band.frequency}=${value}`;
+        })
+        .join(' ');
+      
+      // 只改写该preset的频段，dax_tool原子写入（临时文件、fsync、rename）
+      const result = await window.core.exec(
+        `"${this.daxTool}" -f "${this.daxFilePath}" replace "${preset.id}" ${bandArgs}`
+      );
+      if (result.errno !== 0) {
+        throw new Error(`Failed to update preset ${preset.id}: ${result.stderr}`);
       }
       
-      // 清理临时文件
-      await window.core.exec(`rm "${tempFile}"`);
-      
-      // 设置权限
-      await window.core.exec(`chmod 644 "${this.daxFilePath}"`);
-      
       this.data.isDirty = false;
       document.getElementById('save-btn').disabled = true;
       window.core.showToast(window.i18n.t('daxEqualizer.saveSuccess'), 'success');
@@ -618,136 +577,13 @@ class DaxequalizerPage {
     this.showLoading(false);
   }
 
-  async generateUpdatedXml() {
-    try {
-      // 读取当前XML文件
-      const result = await window.core.exec(`cat "${this.daxFilePath}"`);
-      if (result.errno !== 0 || !result.stdout) {
-        throw new Error(`Failed to read current XML file: ${result.stderr}`);
-      }
-
-      const parser = new DOMParser();
-      const xmlDoc = parser.parseFromString(result.stdout, 'text/xml');
-      
-      // 更新当前选中的preset或创建新的
-      if (this.data.currentPreset) {
-        this.updateExistingPreset(xmlDoc);
-      } else {
-        this.createNewPreset(xmlDoc);
-      }
-      
-      // 序列化XML
-      const serializer = new XMLSerializer();
-      let xmlString = serializer.serializeToString(xmlDoc);
-      
-      // 格式化XML
-      xmlString = this.formatXml(xmlString);
-      
-      return xmlString;
-    } catch (error) {
-      window.core.logDebug(`XML generation error: ${error.message}`, 'DAX_EQ');
-      throw error;
-    }
-  }
-
-  updateExistingPreset(xmlDoc) {
-    // 查找并更新现有preset
-    const presets = xmlDoc.querySelectorAll('preset');
-    let targetPreset = null;
-    
-    for (let preset of presets) {
-      if (preset.getAttribute('id') === this.data.currentPreset.id) {
-        targetPreset = preset;
-        break;
-      }
-    }
-    
-    if (targetPreset) {
-      this.updatePresetBands(xmlDoc, targetPreset);
-    }
-  }
-
-  createNewPreset(xmlDoc) {
-    // 创建新的preset（简单模式下）
-    const profile = xmlDoc.querySelector('profile');
-    if (!profile) return;
-    
-    const preset = xmlDoc.createElement('preset');
-    preset.setAttribute('id', 'custom_preset');
-    preset.setAttribute('type', 'geq');
-    
-    this.updatePresetBands(xmlDoc, preset);
-    profile.appendChild(preset);
-  }
-
-  updatePresetBands(xmlDoc, preset) {
-    // 清除现有频段
-    const existingBands = preset.querySelectorAll('band_ieq, band_geq');
-    existingBands.forEach(band => band.remove());
-    
-    // 查找或创建data容器
-    let dataContainer = preset.querySelector('data');
-    if (!dataContainer) {
-      dataContainer = xmlDoc.createElement('data');
-      preset.appendChild(dataContainer);
-    }
-    
-    // 查找或创建频段容器
-    const isIEQ = this.data.activeEqType === 'ieq' || this.data.mode === 'simple';
-    const containerName = isIEQ ? 'ieq-bands' : 'graphic-equalizer-bands';
-    let bandsContainer = dataContainer.querySelector(containerName);
-    if (!bandsContainer) {
-      bandsContainer = xmlDoc.createElement(containerName);
-      dataContainer.appendChild(bandsContainer);
+  targetPreset() {
+    // 未选择preset时，写入与当前均衡器类型相同的第一个preset
+    if (this.data.currentPreset) {
+      return this.data.currentPreset;
     }
-    
-    // 添加更新的频段
-    this.data.bands.forEach(band => {
-      const bandElement = xmlDoc.createElement(isIEQ ? 'band_ieq' : 'band_geq');
-      bandElement.setAttribute('frequency', band.frequency.toString());
-      
-      if (isIEQ) {
-        bandElement.setAttribute('target', Math.round(band.target || band.gain * 100).toString());
-      } else {
-        bandElement.setAttribute('gain', (band.gain || 0).toString());
-      }
-      
-      bandsContainer.appendChild(bandElement);
-    });
-  }
-
-  formatXml(xml) {
-    // 简单的XML格式化
-    let formatted = '';
-    let indent = '';
-    const tab = '  ';
-    
-    xml.split(/></).forEach((node, index) => {
-      if (index > 0) {
-        node = '<' + node;
-      }
-      if (index < xml.split(/></).length - 1) {
-        node = node + '>';
-      }
-      
-      if (node.match(/^<\w[^>]*[^/]>.*<\/\w/)) {
-        // 自包含标签
-        formatted += indent + node + '\n';
-      } else if (node.match(/^<\w/)) {
-        // 开始标签
-        formatted += indent + node + '\n';
-        indent += tab;
-      } else if (node.match(/^<\//)) {
-        // 结束标签
-        indent = indent.substring(tab.length);
-        formatted += indent + node + '\n';
-      } else {
-        // 内容或自闭合标签
-        formatted += indent + node + '\n';
-      }
-    });
-    
-    return formatted;
+    const type = this.data.activeEqType === 'ieq' || this.data.mode === 'simple' ? 'ieq' : 'geq';
+    return this.data.presets.find(preset => preset.type === type);
   }
 
   async backupConfig() {